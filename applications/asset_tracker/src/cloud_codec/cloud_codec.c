@@ -16,6 +16,8 @@
 #include <modem/modem_info.h>
 #endif /* CONFIG_BSD_LIBRARY */
 #include <date_time.h>
+#include <json_reader.h>
+#include <json_writer.h>
 
 #include "cJSON.h"
 #include "cJSON_os.h"
@@ -227,6 +229,7 @@ static const char *const channel_type_str[] = {
 	[CLOUD_CHANNEL_LIGHT_IR] = CLOUD_CHANNEL_STR_LIGHT_IR,
 	[CLOUD_CHANNEL_ASSISTED_GPS] = CLOUD_CHANNEL_STR_ASSISTED_GPS,
 	[CLOUD_CHANNEL_MODEM] = CLOUD_CHANNEL_STR_MODEM,
+	[CLOUD_CHANNEL_GPS_TRACK] = CLOUD_CHANNEL_STR_GPS_TRACK,
 };
 BUILD_ASSERT(ARRAY_SIZE(channel_type_str) == CLOUD_CHANNEL__TOTAL);
 
@@ -276,6 +279,7 @@ static int cloud_set_chan_cfg_item(const enum cloud_channel channel,
 				   const enum sensor_chan_cfg_item_type type,
 				   const double value);
 
+#if defined(CONFIG_CLOUD_CODEC_JSON)
 static int json_add_obj(cJSON *parent, const char *str, cJSON *item)
 {
 	cJSON_AddItemToObject(parent, str, item);
@@ -319,22 +323,6 @@ static int json_add_bool(cJSON *parent, const char *str, const bool value)
 	return json_add_obj(parent, str, json_bool);
 }
 
-static cJSON *json_object_decode(cJSON *obj, const char *str)
-{
-	return obj ? cJSON_GetObjectItem(obj, str) : NULL;
-}
-
-static bool json_value_string_compare(cJSON *obj, const char *const str)
-{
-	char *json_str = cJSON_GetStringValue(obj);
-
-	if ((json_str == NULL) || (str == NULL)) {
-		return false;
-	}
-
-	return (strcmp(json_str, str) == 0);
-}
-
 int cloud_encode_data(const struct cloud_channel_data *channel,
 		      const enum cloud_cmd_group group,
 		      struct cloud_msg *output)
@@ -384,6 +372,7 @@ int cloud_encode_data(const struct cloud_channel_data *channel,
 
 	return 0;
 }
+#endif /* CONFIG_CLOUD_CODEC_JSON */
 
 int cloud_encode_env_sensors_data(const env_sensor_data_t *sensor_data,
 				  struct cloud_msg *output)
@@ -416,12 +405,20 @@ int cloud_encode_env_sensors_data(const env_sensor_data_t *sensor_data,
 		return -1;
 	}
 
+#if defined(CONFIG_CLOUD_CODEC_CBOR)
+	ARG_UNUSED(buf);
+	ARG_UNUSED(len);
+
+	return cloud_encode_values(&cloud_sensor, &sensor_data->value, 1,
+				   output);
+#else
 	len = snprintf(buf, sizeof(buf), "%.1f",
 		sensor_data->value);
 	cloud_sensor.data.buf = buf;
 	cloud_sensor.data.len = len;
 
 	return cloud_encode_data(&cloud_sensor, CLOUD_CMD_GROUP_DATA, output);
+#endif
 }
 
 int cloud_encode_motion_data(const motion_data_t *motion_data,
@@ -493,6 +490,15 @@ int cloud_encode_light_sensor_data(const struct light_sensor_data *sensor_data,
 		send.ir = sensor_data->ir;
 	}
 
+#if defined(CONFIG_CLOUD_CODEC_CBOR)
+	const double values[] = { send.red, send.green, send.blue, send.ir };
+
+	ARG_UNUSED(buf);
+	ARG_UNUSED(len);
+
+	return cloud_encode_values(&cloud_sensor, values, ARRAY_SIZE(values),
+				   output);
+#else
 	len = snprintf(buf, sizeof(buf), "%d %d %d %d", send.red, send.green,
 		       send.blue, send.ir);
 
@@ -500,9 +506,11 @@ int cloud_encode_light_sensor_data(const struct light_sensor_data *sensor_data,
 	cloud_sensor.data.len = len;
 
 	return cloud_encode_data(&cloud_sensor, CLOUD_CMD_GROUP_DATA, output);
+#endif
 }
 #endif /* CONFIG_LIGHT_SENSOR */
 
+#if defined(CONFIG_CLOUD_CODEC_JSON)
 int cloud_encode_config_data(struct cloud_msg *output)
 {
 	__ASSERT_NO_MSG(output != NULL);
@@ -570,33 +578,20 @@ cleanup:
 	return ret;
 }
 
-int cloud_encode_device_status_data(
-	void *modem_param,
-	const char *const ui[], const uint32_t ui_count,
-	const char *const fota[], const uint32_t fota_count,
-	const uint16_t fota_version,
-	struct cloud_msg *output)
+static int device_status_write(struct json_writer *w, void *modem_param,
+			       const char *const ui[], const uint32_t ui_count,
+			       const char *const fota[],
+			       const uint32_t fota_count,
+			       const uint16_t fota_version,
+			       size_t *item_cnt)
 {
-	__ASSERT_NO_MSG((ui != NULL) || !ui_count);
-	__ASSERT_NO_MSG((fota != NULL) || !fota_count);
-	__ASSERT_NO_MSG(output != NULL);
-
-	cJSON *root_obj = cJSON_CreateObject();
-	cJSON *state_obj = cJSON_CreateObject();
-	cJSON *reported_obj = cJSON_CreateObject();
-	cJSON *device_obj = cJSON_CreateObject();
 	char dev_str[] = CLOUD_CHANNEL_STR_DEVICE_INFO;
-	const char *channel_type;
-	int ret = 0;
 
-	if (root_obj == NULL || state_obj == NULL ||
-	    reported_obj == NULL || device_obj == NULL) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(state_obj);
-		cJSON_Delete(reported_obj);
-		cJSON_Delete(device_obj);
-		return -ENOMEM;
-	}
+	*item_cnt = 0;
+
+	json_writer_object_begin(w, NULL);
+	json_writer_object_begin(w, "state");
+	json_writer_object_begin(w, "reported");
 
 	/* Workaround for deleting "DEVICE" objects (with uppercase key) if
 	 * it already exists in the digital twin.
@@ -605,124 +600,148 @@ int cloud_encode_device_status_data(
 	 * the size of the digital twin document if the "DEVICE" is not
 	 * deleted at the same time.
 	 */
-	cJSON *dummy_obj = cJSON_CreateNull();
-
-	if (dummy_obj == NULL) {
-		/* Dummy creation failed, but we'll let it do so
-		 * silently as it's not a functionally critical error.
-		 */
-	} else {
-		ret += json_add_obj(reported_obj, dev_str, dummy_obj);
-	}
+	json_writer_null(w, dev_str);
 
 	/* Convert to lowercase for shadow */
 	for (int i = 0; dev_str[i]; ++i) {
 		dev_str[i] = tolower(dev_str[i]);
 	}
-	channel_type = dev_str;
 
-	size_t item_cnt = 0;
+	json_writer_object_begin(w, dev_str);
 
 #ifdef CONFIG_MODEM_INFO
 	if (modem_param) {
 		int val;
 
-		val = modem_info_json_object_encode((struct modem_param_info *)
-			modem_param, device_obj);
+		val = modem_info_json_write((struct modem_param_info *)
+			modem_param, w);
 		if (val > 0) {
-			item_cnt = (size_t)val;
+			*item_cnt = (size_t)val;
 		}
 	}
 #endif
 
-	if (service_info_json_object_encode(ui, ui_count,
-					    fota, fota_count,
-					    fota_version,
-					    device_obj) == 0) {
-		++item_cnt;
+	if (service_info_json_write(ui, ui_count,
+				    fota, fota_count,
+				    fota_version,
+				    w) == 0) {
+		++(*item_cnt);
 	}
 
-	if (item_cnt != 0) {
-		ret += json_add_obj(reported_obj, channel_type, device_obj);
-		ret += json_add_obj(state_obj, "reported", reported_obj);
-		ret += json_add_obj(root_obj, "state", state_obj);
-	} else {
-		ret = -ECHILD;
-	}
+	json_writer_object_end(w);
+	json_writer_object_end(w);
+	json_writer_object_end(w);
+	json_writer_object_end(w);
 
-	if (ret != 0) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(state_obj);
-		cJSON_Delete(reported_obj);
-		cJSON_Delete(device_obj);
+	return json_writer_finish(w);
+}
+
+int cloud_encode_device_status_data(
+	void *modem_param,
+	const char *const ui[], const uint32_t ui_count,
+	const char *const fota[], const uint32_t fota_count,
+	const uint16_t fota_version,
+	struct cloud_msg *output)
+{
+	__ASSERT_NO_MSG((ui != NULL) || !ui_count);
+	__ASSERT_NO_MSG((fota != NULL) || !fota_count);
+	__ASSERT_NO_MSG(output != NULL);
+
+	struct json_writer w;
+	size_t item_cnt;
+	char *buffer;
+	int len;
+
+	json_writer_init(&w, NULL, 0);
+	len = device_status_write(&w, modem_param, ui, ui_count,
+				  fota, fota_count, fota_version, &item_cnt);
+	if (len < 0) {
 		return -EAGAIN;
 	}
 
-	char *buffer;
+	if (item_cnt == 0) {
+		return -ECHILD;
+	}
 
-	buffer = cJSON_PrintUnformatted(root_obj);
-	cJSON_Delete(root_obj);
+	buffer = k_malloc(len + 1);
+	if (buffer == NULL) {
+		return -ENOMEM;
+	}
+
+	json_writer_init(&w, buffer, len + 1);
+	if (device_status_write(&w, modem_param, ui, ui_count,
+				fota, fota_count, fota_version,
+				&item_cnt) != len) {
+		k_free(buffer);
+		return -EAGAIN;
+	}
 
 	output->buf = buffer;
-	output->len = strlen(buffer);
+	output->len = len;
 
 	return 0;
 }
+#endif /* CONFIG_CLOUD_CODEC_JSON */
 
-static int cloud_decode_modem_params(cJSON *const data_obj,
-			  struct cloud_command_modem_params *const params)
+static int cloud_decode_modem_params(const struct json_reader *r, char *doc,
+				     int data_tok,
+				     struct cloud_command_modem_params *const params)
 {
-	cJSON *blob;
-	cJSON *checksum;
+	int blob;
+	int checksum;
 
-	if ((data_obj == NULL) || (params == NULL)) {
+	if ((r == NULL) || (params == NULL)) {
 		return -EINVAL;
 	}
 
-	if (!cJSON_IsObject(data_obj)) {
+	if (json_reader_type(r, data_tok) != JSON_TOKEN_OBJECT) {
 		return -ESRCH;
 	}
 
-	blob = json_object_decode(data_obj, MODEM_PARAM_BLOB_KEY_STR);
-	params->blob = cJSON_GetStringValue(blob);
+	blob = json_reader_member(r, data_tok, MODEM_PARAM_BLOB_KEY_STR);
+	checksum = json_reader_member(r, data_tok,
+				      MODEM_PARAM_CHECKSUM_KEY_STR);
 
-	checksum = json_object_decode(data_obj, MODEM_PARAM_CHECKSUM_KEY_STR);
-	params->checksum = cJSON_GetStringValue(checksum);
+	params->blob = json_reader_str_inplace(r, blob, doc);
+	params->checksum = json_reader_str_inplace(r, checksum, doc);
 
 	return (((params->blob == NULL) || (params->checksum == NULL)) ?
 			-ESRCH : 0);
 }
 
 static int cloud_cmd_parse_type(const struct cmd *const type_cmd,
-				cJSON *type_obj,
+				const struct json_reader *r, char *doc,
+				int type_tok,
 				struct cloud_command *const parsed_cmd)
 {
 	int err;
-	cJSON *decoded_obj = NULL;
+	int decoded_tok = -ENOENT;
+	bool enable;
+	char color[sizeof("ffffffff")];
 
 	if ((type_cmd == NULL) || (parsed_cmd == NULL)) {
 		return -EINVAL;
 	}
 
-	if (type_obj != NULL) {
+	if (type_tok >= 0) {
 		/* Data string type does not require additional decoding */
 		if (type_cmd->type != CLOUD_CMD_DATA_STRING) {
-			decoded_obj = json_object_decode(type_obj,
+			decoded_tok = json_reader_member(r, type_tok,
 					cmd_type_str[type_cmd->type]);
 
-			if (!decoded_obj) {
+			if (decoded_tok < 0) {
 				return -ENOENT; /* Command not found */
 			}
 		}
 
 		switch (type_cmd->type) {
 		case CLOUD_CMD_ENABLE: {
-			if (cJSON_IsNull(decoded_obj)) {
+			if (json_reader_type(r, decoded_tok) == JSON_TOKEN_NULL) {
 				parsed_cmd->data.sv.state =
 					CLOUD_CMD_STATE_FALSE;
-			} else if (cJSON_IsBool(decoded_obj)) {
-				parsed_cmd->data.sv.state =
-					cJSON_IsTrue(decoded_obj) ?
+			} else if (json_reader_bool(r, decoded_tok,
+						    &enable) == 0) {
+				parsed_cmd->data.sv.state = enable ?
 						CLOUD_CMD_STATE_TRUE :
 						CLOUD_CMD_STATE_FALSE;
 			} else {
@@ -734,14 +753,13 @@ static int cloud_cmd_parse_type(const struct cmd *const type_cmd,
 		case CLOUD_CMD_INTERVAL:
 		case CLOUD_CMD_THRESHOLD_LOW:
 		case CLOUD_CMD_THRESHOLD_HIGH: {
-			if (cJSON_IsNull(decoded_obj)) {
+			if (json_reader_type(r, decoded_tok) == JSON_TOKEN_NULL) {
 				parsed_cmd->data.sv.state =
 					CLOUD_CMD_STATE_FALSE;
-			} else if (cJSON_IsNumber(decoded_obj)) {
+			} else if (json_reader_num(r, decoded_tok,
+					&parsed_cmd->data.sv.value) == 0) {
 				parsed_cmd->data.sv.state =
 					CLOUD_CMD_STATE_UNDEFINED;
-				parsed_cmd->data.sv.value =
-					decoded_obj->valuedouble;
 			} else {
 				return -ESRCH;
 			}
@@ -749,17 +767,18 @@ static int cloud_cmd_parse_type(const struct cmd *const type_cmd,
 			break;
 		}
 		case CLOUD_CMD_COLOR: {
-			if (cJSON_GetStringValue(decoded_obj) == NULL) {
+			if (json_reader_str_copy(r, decoded_tok, color,
+						 sizeof(color)) < 0) {
 				return -ESRCH;
 			}
 
-			parsed_cmd->data.sv.value = (double)strtol(
-				cJSON_GetStringValue(decoded_obj), NULL, 16);
+			parsed_cmd->data.sv.value = (double)strtol(color, NULL,
+								   16);
 
 			break;
 		}
 		case CLOUD_CMD_MODEM_PARAM: {
-			err = cloud_decode_modem_params(decoded_obj,
+			err = cloud_decode_modem_params(r, doc, decoded_tok,
 							&parsed_cmd->data.mp);
 
 			if (err) {
@@ -770,7 +789,7 @@ static int cloud_cmd_parse_type(const struct cmd *const type_cmd,
 		}
 		case CLOUD_CMD_DATA_STRING:
 			parsed_cmd->data.data_string =
-				cJSON_GetStringValue(type_obj);
+				json_reader_str_inplace(r, type_tok, doc);
 			if (parsed_cmd->data.data_string == NULL) {
 				return -ESRCH;
 			}
@@ -801,26 +820,18 @@ static int cloud_cmd_parse_type(const struct cmd *const type_cmd,
 	return 0;
 }
 
-static int cloud_search_cmd(cJSON *root_obj)
+static int cloud_search_cmd(const struct json_reader *r, char *doc)
 {
 	int ret;
 	struct cmd *group	= NULL;
 	struct cmd *chan	= NULL;
 	struct cmd *type	= NULL;
-	cJSON *group_obj;
-	cJSON *channel_obj;
-	cJSON *type_obj;
-
-	if (root_obj == NULL) {
-		return -EINVAL;
-	}
+	int type_tok;
 
 	for (int i = 0; i < ARRAY_SIZE(cmd_groups); ++i) {
-		group_obj = json_object_decode(root_obj, cmd_groups[i]->key);
-
-		if ((group_obj != NULL) &&
-			(json_value_string_compare(group_obj,
-					cmd_group_str[cmd_groups[i]->group]))) {
+		if (json_reader_str_eq(r,
+			json_reader_member(r, 0, cmd_groups[i]->key),
+			cmd_group_str[cmd_groups[i]->group])) {
 			group = cmd_groups[i];
 			break;
 		}
@@ -833,13 +844,9 @@ static int cloud_search_cmd(cJSON *root_obj)
 	cmd_parsed.group = group->group;
 
 	for (size_t j = 0; j < group->num_children; ++j) {
-		channel_obj =
-			json_object_decode(root_obj, group->children[j].key);
-
-		if ((channel_obj != NULL) &&
-		    (json_value_string_compare(
-			    channel_obj,
-			    channel_type_str[group->children[j].channel]))) {
+		if (json_reader_str_eq(r,
+			json_reader_member(r, 0, group->children[j].key),
+			channel_type_str[group->children[j].channel])) {
 			chan = &group->children[j];
 			break;
 		}
@@ -854,9 +861,9 @@ static int cloud_search_cmd(cJSON *root_obj)
 	for (size_t k = 0; k < chan->num_children; ++k) {
 
 		type = &chan->children[k];
-		type_obj = json_object_decode(root_obj, type->key);
+		type_tok = json_reader_member(r, 0, type->key);
 
-		ret = cloud_cmd_parse_type(type, type_obj, &cmd_parsed);
+		ret = cloud_cmd_parse_type(type, r, doc, type_tok, &cmd_parsed);
 
 		if (ret != 0) {
 			if (ret != -ENOENT) {
@@ -885,22 +892,18 @@ static int cloud_search_cmd(cJSON *root_obj)
 	return 0;
 }
 
-static int cloud_search_config(cJSON * const root_obj)
+static int cloud_search_config(const struct json_reader *r, char *doc)
 {
 	struct cmd const *const group = &group_cfg_set;
-	cJSON *state_obj = NULL;
-	cJSON *config_obj = NULL;
-
-	if (root_obj == NULL) {
-		return -EINVAL;
-	}
+	int state_tok;
+	int config_tok;
 
 	/* A delta update will have state */
-	state_obj = cJSON_GetObjectItem(root_obj, "state");
-	config_obj = cJSON_DetachItemFromObject(
-		state_obj ? state_obj : root_obj, "config");
+	state_tok = json_reader_member(r, 0, "state");
+	config_tok = json_reader_member(r, state_tok >= 0 ? state_tok : 0,
+					"config");
 
-	if (config_obj == NULL) {
+	if (config_tok < 0) {
 		return 0;
 	}
 
@@ -910,11 +913,10 @@ static int cloud_search_config(cJSON * const root_obj)
 				.group = CLOUD_CMD_GROUP_CFG_SET
 			};
 
-		cJSON *channel_obj = json_object_decode(
-			config_obj,
+		int channel_tok = json_reader_member(r, config_tok,
 			channel_type_str[group->children[ch].channel]);
 
-		if (channel_obj == NULL) {
+		if (channel_tok < 0) {
 			continue;
 		}
 
@@ -924,7 +926,7 @@ static int cloud_search_config(cJSON * const root_obj)
 		/* Search channel's config types */
 		for (size_t type = 0; type < chan->num_children; ++type) {
 			int ret = cloud_cmd_parse_type(&chan->children[type],
-						   channel_obj,
+						   r, doc, channel_tok,
 						   &found_config_item);
 
 			if (ret != 0) {
@@ -952,31 +954,31 @@ static int cloud_search_config(cJSON * const root_obj)
 		}
 	}
 
-	/* Config was detached, must be deleted */
-	cJSON_Delete(config_obj);
-
 	return 0;
 }
 
-int cloud_decode_command(char const *input)
+int cloud_decode_command(char *input)
 {
-	cJSON *root_obj = NULL;
+	/* Commands are decoded one at a time from the cloud thread. */
+	static struct json_token tokens[CONFIG_CLOUD_CODEC_JSON_MAX_TOKENS];
+	struct json_reader r;
+	int err;
 
 	if (input == NULL) {
 		return -EINVAL;
 	}
 
-	root_obj = cJSON_Parse(input);
-	if (root_obj == NULL) {
-		LOG_DBG("[%s:%d] Unable to parse input", __func__, __LINE__);
+	err = json_reader_parse(&r, input, strlen(input), tokens,
+				ARRAY_SIZE(tokens));
+	if (err < 0) {
+		LOG_DBG("[%s:%d] Unable to parse input, error %d",
+			__func__, __LINE__, err);
 		return -ENOENT;
 	}
 
-	cloud_search_cmd(root_obj);
+	cloud_search_cmd(&r, input);
 
-	cloud_search_config(root_obj);
-
-	cJSON_Delete(root_obj);
+	cloud_search_config(&r, input);
 
 	return 0;
 }
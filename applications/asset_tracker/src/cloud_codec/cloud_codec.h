@@ -66,6 +66,8 @@ enum cloud_channel {
 	CLOUD_CHANNEL_ASSISTED_GPS,
 	/** The modem channel. */
 	CLOUD_CHANNEL_MODEM,
+	/** Compressed GPS track, see gps_track.h. */
+	CLOUD_CHANNEL_GPS_TRACK,
 
 	CLOUD_CHANNEL__TOTAL
 };
@@ -88,6 +90,7 @@ enum cloud_channel {
 #define CLOUD_CHANNEL_STR_ASSISTED_GPS "AGPS"
 #define CLOUD_CHANNEL_STR_RGB_LED "LED"
 #define CLOUD_CHANNEL_STR_MODEM "MODEM"
+#define CLOUD_CHANNEL_STR_GPS_TRACK "GPS_TRACK"
 
 struct cloud_data {
 	char *buf;
@@ -193,6 +196,36 @@ struct cloud_command {
 
 typedef void (*cloud_cmd_cb_t)(struct cloud_command *cmd);
 
+/** @brief Keys of the CBOR encoded messages.
+ *
+ * With CONFIG_CLOUD_CODEC_CBOR, messages are encoded as CBOR maps with
+ * these integer keys instead of the JSON key strings:
+ *
+ * - Data messages: { CHANNEL: uint, DATA: value, GROUP: uint, TS: int }
+ *   where value is text, or a number or an array of numbers for the
+ *   environment and light sensors.
+ * - Configuration: { CONFIG: { <enum cloud_channel>:
+ *                              { <enum cloud_cmd_type>: value } } }
+ * - Device status: { DEVICE: { <modem_info_cbor_encode() maps>,
+ *                              SERVICE_INFO: { UI: [text],
+ *                                              FOTA: [text],
+ *                                              FOTA_VERSION: uint } } }
+ *
+ * Channels, groups and command types are encoded with their enum values.
+ */
+enum cloud_codec_cbor_key {
+	CLOUD_CODEC_CBOR_KEY_CHANNEL,
+	CLOUD_CODEC_CBOR_KEY_DATA,
+	CLOUD_CODEC_CBOR_KEY_GROUP,
+	CLOUD_CODEC_CBOR_KEY_TS,
+	CLOUD_CODEC_CBOR_KEY_CONFIG,
+	CLOUD_CODEC_CBOR_KEY_DEVICE,
+	CLOUD_CODEC_CBOR_KEY_SERVICE_INFO,
+	CLOUD_CODEC_CBOR_KEY_UI,
+	CLOUD_CODEC_CBOR_KEY_FOTA,
+	CLOUD_CODEC_CBOR_KEY_FOTA_VERSION,
+};
+
 /**
  * @brief Encode cloud data.
  *
@@ -205,14 +238,37 @@ typedef void (*cloud_cmd_cb_t)(struct cloud_command *cmd);
 int cloud_encode_data(const struct cloud_channel_data *channel,
 	const enum cloud_cmd_group group, struct cloud_msg *output);
 
+#if defined(CONFIG_CLOUD_CODEC_CBOR)
+/**
+ * @brief Encode numeric sensor values as a data message.
+ *
+ * Only available with CBOR encoding. JSON messages carry the values as
+ * text, see @ref cloud_encode_data.
+ *
+ * @param channel The cloud channel. Its data buffer is not used.
+ * @param values Values of the channel.
+ * @param count Number of values. Multiple values are encoded as an array.
+ * @param output Pointer to the cloud data output.
+ *
+ * @return 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int cloud_encode_values(const struct cloud_channel_data *channel,
+			const double *values, size_t count,
+			struct cloud_msg *output);
+#endif /* CONFIG_CLOUD_CODEC_CBOR */
+
 /**
  * @brief Decode cloud data.
  *
- * @param input Pointer to the cloud data input.
+ * String values passed to the callback, such as modem parameters and data
+ * strings, are unescaped and null-terminated within the input buffer, and
+ * remain valid only as long as the buffer.
+ *
+ * @param input Pointer to the null-terminated cloud data input.
  *
  * @return 0 if the operation was successful, otherwise a (negative) error code.
  */
-int cloud_decode_command(char const *input);
+int cloud_decode_command(char *input);
 
 /**
  * @brief Init the cloud decoder.
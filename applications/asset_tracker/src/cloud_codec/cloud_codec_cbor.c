@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <stdbool.h>
+#include <math.h>
+#include <string.h>
+#include <zephyr.h>
+#include <zephyr/types.h>
+#include <net/cloud.h>
+#if defined(CONFIG_BSD_LIBRARY)
+#include <modem/modem_info.h>
+#endif /* CONFIG_BSD_LIBRARY */
+#include <date_time.h>
+#include <tinycbor/cbor.h>
+#include <tinycbor/cbor_buf_writer.h>
+
+#include "cloud_codec.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(cloud_codec_cbor, CONFIG_ASSET_TRACKER_LOG_LEVEL);
+
+struct cbor_msg {
+	uint8_t *buf;
+	struct cbor_buf_writer writer;
+	CborEncoder encoder;
+	CborEncoder root_map;
+};
+
+/* Messages are encoded directly in the buffer that is handed to
+ * cloud_send(), and released with cloud_release_data().
+ */
+static int msg_begin(struct cbor_msg *msg)
+{
+	msg->buf = k_malloc(CONFIG_CLOUD_CODEC_CBOR_BUF_SIZE);
+	if (msg->buf == NULL) {
+		return -ENOMEM;
+	}
+
+	cbor_buf_writer_init(&msg->writer, msg->buf,
+			     CONFIG_CLOUD_CODEC_CBOR_BUF_SIZE);
+	cbor_encoder_init(&msg->encoder, &msg->writer.enc, 0);
+
+	if (cbor_encoder_create_map(&msg->encoder, &msg->root_map,
+				    CborIndefiniteLength) != CborNoError) {
+		k_free(msg->buf);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int msg_end(struct cbor_msg *msg, CborError err,
+		   struct cloud_msg *output)
+{
+	err |= cbor_encoder_close_container(&msg->encoder, &msg->root_map);
+	if (err != CborNoError) {
+		LOG_ERR("CBOR encoding failed: %d", err);
+		k_free(msg->buf);
+		return (err & CborErrorOutOfMemory) ? -ENOMEM : -EINVAL;
+	}
+
+	output->buf = (char *)msg->buf;
+	output->len = cbor_buf_writer_buffer_size(&msg->writer, msg->buf);
+
+	return 0;
+}
+
+/* Largest magnitude that is converted to int64_t without overflow. */
+#define VALUE_INT_MAX 9.2e18
+
+/* Integral values are encoded as integers, others as single precision
+ * floats, which is enough for the sensor resolution.
+ */
+static CborError value_encode(CborEncoder *encoder, double value)
+{
+	if (isfinite(value) && (fabs(value) < VALUE_INT_MAX) &&
+	    (value == (double)(int64_t)value)) {
+		return cbor_encode_int(encoder, (int64_t)value);
+	}
+
+	return cbor_encode_float(encoder, (float)value);
+}
+
+/* Data message with either the text of the channel data, or the numeric
+ * values if values is not NULL.
+ */
+static int data_encode(const struct cloud_channel_data *channel,
+		       const enum cloud_cmd_group group,
+		       const double *values, size_t count,
+		       struct cloud_msg *output)
+{
+	int ret;
+	CborError err;
+	struct cbor_msg msg;
+	CborEncoder array;
+	int64_t data_ts;
+
+	/** Convert sample uptime to unix time ms. If this function fails the
+	 *  uptime is cleared and an empty timestamp value is encoded.
+	 */
+	data_ts = channel->ts;
+	ret = date_time_uptime_to_unix_time_ms(&data_ts);
+	if (ret) {
+		LOG_WRN("date_time_uptime_to_unix_time_ms, error: %d", ret);
+		LOG_WRN("Clearing timestamp");
+		date_time_timestamp_clear(&data_ts);
+	}
+
+	ret = msg_begin(&msg);
+	if (ret) {
+		return ret;
+	}
+
+	err = cbor_encode_uint(&msg.root_map, CLOUD_CODEC_CBOR_KEY_CHANNEL);
+	err |= cbor_encode_uint(&msg.root_map, channel->type);
+	err |= cbor_encode_uint(&msg.root_map, CLOUD_CODEC_CBOR_KEY_DATA);
+	if (values == NULL) {
+		err |= cbor_encode_text_string(&msg.root_map, channel->data.buf,
+					       channel->data.len);
+	} else if (count == 1) {
+		err |= value_encode(&msg.root_map, values[0]);
+	} else {
+		err |= cbor_encoder_create_array(&msg.root_map, &array, count);
+		for (size_t i = 0; i < count; i++) {
+			err |= value_encode(&array, values[i]);
+		}
+		err |= cbor_encoder_close_container(&msg.root_map, &array);
+	}
+	err |= cbor_encode_uint(&msg.root_map, CLOUD_CODEC_CBOR_KEY_GROUP);
+	err |= cbor_encode_uint(&msg.root_map, group);
+	err |= cbor_encode_uint(&msg.root_map, CLOUD_CODEC_CBOR_KEY_TS);
+	err |= cbor_encode_int(&msg.root_map, data_ts);
+
+	return msg_end(&msg, err, output);
+}
+
+int cloud_encode_data(const struct cloud_channel_data *channel,
+		      const enum cloud_cmd_group group,
+		      struct cloud_msg *output)
+{
+	if (channel == NULL || channel->data.buf == NULL ||
+	    channel->data.len == 0 || output == NULL ||
+	    group >= CLOUD_CMD_GROUP__TOTAL) {
+		return -EINVAL;
+	}
+
+	return data_encode(channel, group, NULL, 0, output);
+}
+
+int cloud_encode_values(const struct cloud_channel_data *channel,
+			const double *values, size_t count,
+			struct cloud_msg *output)
+{
+	if (channel == NULL || values == NULL || count == 0 ||
+	    output == NULL) {
+		return -EINVAL;
+	}
+
+	return data_encode(channel, CLOUD_CMD_GROUP_DATA, values, count,
+			   output);
+}
+
+int cloud_encode_config_data(struct cloud_msg *output)
+{
+	int ret;
+	CborError err;
+	struct cbor_msg msg;
+	CborEncoder config_map;
+	CborEncoder chan_map;
+
+	__ASSERT_NO_MSG(output != NULL);
+
+	output->buf = NULL;
+	output->len = 0;
+
+	/* Currently, the only value that can be changed from
+	 * the device is GPS enable, so it is the only
+	 * one that needs to be sent.
+	 */
+	enum cloud_cmd_state gps_state =
+		cloud_get_channel_enable_state(CLOUD_CHANNEL_GPS);
+
+	/* Nothing to report is not an error */
+	if (gps_state == CLOUD_CMD_STATE_UNDEFINED) {
+		return 0;
+	}
+
+	ret = msg_begin(&msg);
+	if (ret) {
+		return ret;
+	}
+
+	err = cbor_encode_uint(&msg.root_map, CLOUD_CODEC_CBOR_KEY_CONFIG);
+	err |= cbor_encoder_create_map(&msg.root_map, &config_map, 1);
+	err |= cbor_encode_uint(&config_map, CLOUD_CHANNEL_GPS);
+	err |= cbor_encoder_create_map(&config_map, &chan_map, 1);
+	err |= cbor_encode_uint(&chan_map, CLOUD_CMD_ENABLE);
+	err |= cbor_encode_boolean(&chan_map,
+				   gps_state == CLOUD_CMD_STATE_TRUE);
+	err |= cbor_encoder_close_container(&config_map, &chan_map);
+	err |= cbor_encoder_close_container(&msg.root_map, &config_map);
+
+	return msg_end(&msg, err, output);
+}
+
+static CborError cbor_add_str_array(CborEncoder *map, uint32_t key,
+				    const char *const items[],
+				    const uint32_t item_cnt)
+{
+	CborError err;
+	CborEncoder array;
+
+	err = cbor_encode_uint(map, key);
+	err |= cbor_encoder_create_array(map, &array, CborIndefiniteLength);
+
+	for (uint32_t cnt = 0; cnt < item_cnt; ++cnt) {
+		if (items[cnt] != NULL) {
+			err |= cbor_encode_text_stringz(&array, items[cnt]);
+		}
+	}
+
+	err |= cbor_encoder_close_container(map, &array);
+
+	return err;
+}
+
+int cloud_encode_device_status_data(
+	void *modem_param,
+	const char *const ui[], const uint32_t ui_count,
+	const char *const fota[], const uint32_t fota_count,
+	const uint16_t fota_version,
+	struct cloud_msg *output)
+{
+	int ret;
+	CborError err;
+	struct cbor_msg msg;
+	CborEncoder device_map;
+	CborEncoder service_map;
+
+	__ASSERT_NO_MSG((ui != NULL) || !ui_count);
+	__ASSERT_NO_MSG((fota != NULL) || !fota_count);
+	__ASSERT_NO_MSG(output != NULL);
+
+	ret = msg_begin(&msg);
+	if (ret) {
+		return ret;
+	}
+
+	err = cbor_encode_uint(&msg.root_map, CLOUD_CODEC_CBOR_KEY_DEVICE);
+	err |= cbor_encoder_create_map(&msg.root_map, &device_map,
+				       CborIndefiniteLength);
+
+#ifdef CONFIG_MODEM_INFO
+	if (modem_param) {
+		ret = modem_info_cbor_encode(
+			(struct modem_param_info *)modem_param, &device_map);
+		if (ret < 0) {
+			LOG_ERR("modem_info_cbor_encode, error: %d", ret);
+			k_free(msg.buf);
+			return ret;
+		}
+	}
+#endif
+
+	err |= cbor_encode_uint(&device_map,
+				CLOUD_CODEC_CBOR_KEY_SERVICE_INFO);
+	err |= cbor_encoder_create_map(&device_map, &service_map,
+				       CborIndefiniteLength);
+	err |= cbor_add_str_array(&service_map, CLOUD_CODEC_CBOR_KEY_UI,
+				  ui, ui_count);
+	err |= cbor_add_str_array(&service_map, CLOUD_CODEC_CBOR_KEY_FOTA,
+				  fota, fota_count);
+	err |= cbor_encode_uint(&service_map,
+				CLOUD_CODEC_CBOR_KEY_FOTA_VERSION);
+	err |= cbor_encode_uint(&service_map, fota_version);
+	err |= cbor_encoder_close_container(&device_map, &service_map);
+	err |= cbor_encoder_close_container(&msg.root_map, &device_map);
+
+	return msg_end(&msg, err, output);
+}
@@ -8,6 +8,8 @@
 #include <sys/util.h>
 #include <drivers/gps.h>
 #include <modem/lte_lc.h>
+#include <gps_track.h>
+#include <sys/base64.h>
 
 #include "ui.h"
 #include "gps_controller.h"
@@ -24,6 +26,15 @@ static struct k_delayed_work start_work;
 static struct k_delayed_work stop_work;
 static int gps_reporting_interval_seconds;
 
+#if defined(CONFIG_GPS_CONTROL_TRACK)
+static struct gps_track track;
+static uint8_t track_buf[CONFIG_GPS_CONTROL_TRACK_BUF_SIZE];
+/* Fixes are added from the GPS driver, the track is sent from the
+ * application work queue.
+ */
+static K_MUTEX_DEFINE(track_lock);
+#endif /* CONFIG_GPS_CONTROL_TRACK */
+
 static void start(struct k_work *work)
 {
 	ARG_UNUSED(work);
@@ -140,6 +151,60 @@ int gps_control_get_gps_reporting_interval(void)
 	return gps_reporting_interval_seconds;
 }
 
+#if defined(CONFIG_GPS_CONTROL_TRACK)
+static int track_init(void)
+{
+	const struct gps_track_config cfg = {
+		.tolerance = CONFIG_GPS_CONTROL_TRACK_TOLERANCE,
+		.turn_angle = CONFIG_GPS_CONTROL_TRACK_TURN_ANGLE,
+		.flush_distance = CONFIG_GPS_CONTROL_TRACK_FLUSH_DISTANCE,
+	};
+
+	return gps_track_init(&track, &cfg, track_buf, sizeof(track_buf));
+}
+
+int gps_control_track_add(const struct gps_pvt *pvt)
+{
+	struct gps_track_fix fix;
+	int err;
+
+	gps_track_fix_from_pvt(pvt, &fix);
+
+	k_mutex_lock(&track_lock, K_FOREVER);
+	err = gps_track_add(&track, &fix);
+	k_mutex_unlock(&track_lock);
+
+	if (err < 0) {
+		LOG_WRN("Fix not added to track, error: %d", err);
+	}
+
+	return err;
+}
+
+int gps_control_track_get(char *buf, size_t size)
+{
+	size_t len;
+	size_t olen = 0;
+	int err = 0;
+
+	k_mutex_lock(&track_lock, K_FOREVER);
+
+	len = gps_track_flush(&track);
+	if (len > 0) {
+		err = base64_encode(buf, size, &olen, track_buf, len);
+	}
+
+	k_mutex_unlock(&track_lock);
+
+	if (err) {
+		LOG_ERR("Could not encode track, error: %d", err);
+		return err;
+	}
+
+	return olen;
+}
+#endif /* CONFIG_GPS_CONTROL_TRACK */
+
 /** @brief Configures and starts the GPS device. */
 int gps_control_init(struct k_work_q *work_q, gps_event_handler_t handler)
 {
@@ -172,6 +237,14 @@ int gps_control_init(struct k_work_q *work_q, gps_event_handler_t handler)
 	k_delayed_work_init(&start_work, start);
 	k_delayed_work_init(&stop_work, stop);
 
+#if defined(CONFIG_GPS_CONTROL_TRACK)
+	err = track_init();
+	if (err) {
+		LOG_ERR("Could not initialize GPS track, error: %d", err);
+		return err;
+	}
+#endif /* CONFIG_GPS_CONTROL_TRACK */
+
 #if !defined(CONFIG_GPS_SIM)
 	gps_reporting_interval_seconds =
 		IS_ENABLED(CONFIG_GPS_START_ON_MOTION) ?
@@ -34,6 +34,34 @@ int gps_control_get_gps_reporting_interval(void);
 
 bool gps_control_set_active(bool active);
 
+#if defined(CONFIG_GPS_CONTROL_TRACK)
+/** Size of the base64 encoded track, including the null terminator. */
+#define GPS_CONTROL_TRACK_STR_SIZE \
+	(4 * ((CONFIG_GPS_CONTROL_TRACK_BUF_SIZE + 2) / 3) + 1)
+
+/**
+ * @brief Add a position fix to the track.
+ *
+ * @param pvt Position fix.
+ *
+ * @return 1 if the track should be sent, 0 if not, otherwise a (negative)
+ *         error code.
+ */
+int gps_control_track_add(const struct gps_pvt *pvt);
+
+/**
+ * @brief End the track and get it base64 encoded. The next fix starts a
+ *        new track.
+ *
+ * @param buf Buffer for the encoded track.
+ * @param size Size of the buffer, at least GPS_CONTROL_TRACK_STR_SIZE.
+ *
+ * @return Length of the encoded track, 0 if there are no fixes, otherwise a
+ *         (negative) error code.
+ */
+int gps_control_track_get(char *buf, size_t size);
+#endif /* CONFIG_GPS_CONTROL_TRACK */
+
 #ifdef __cplusplus
 }
 #endif
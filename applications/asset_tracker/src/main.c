@@ -93,6 +93,11 @@ defined(CONFIG_NRF_CLOUD_PROVISION_CERTIFICATES)
  */
 #define CONN_CYCLE_AFTER_ASSOCIATION_REQ_MS K_MINUTES(5)
 
+/* Delay before retrying to send a GPS track that is full or long enough,
+ * while it cannot be sent.
+ */
+#define GPS_TRACK_FLUSH_RETRY_DELAY K_SECONDS(5)
+
 struct rsrp_data {
 	uint16_t value;
 	uint16_t offset;
@@ -162,6 +167,11 @@ static struct k_work device_status_work;
 static struct k_delayed_work send_agps_request_work;
 static struct k_work motion_data_send_work;
 static struct k_work no_sim_go_offline_work;
+#if defined(CONFIG_GPS_CONTROL_TRACK)
+static struct k_delayed_work send_gps_track_work;
+static bool gps_track_send_pending;
+static bool gps_track_flush_pending;
+#endif /* CONFIG_GPS_CONTROL_TRACK */
 
 #if defined(CONFIG_AT_CMD)
 #define MODEM_AT_CMD_BUFFER_LEN (CONFIG_AT_CMD_RESPONSE_MAX_LEN + 1)
@@ -492,6 +502,50 @@ static void send_gps_data_work_fn(struct k_work *work)
 	sensor_data_send(&gps_cloud_data);
 }
 
+#if defined(CONFIG_GPS_CONTROL_TRACK)
+static void send_gps_track_work_fn(struct k_work *work)
+{
+	static char track_str[GPS_CONTROL_TRACK_STR_SIZE];
+	static struct cloud_channel_data track_cloud_data = {
+		.type = CLOUD_CHANNEL_GPS_TRACK,
+		.data.buf = track_str,
+	};
+	int len;
+
+	/* Keep collecting fixes until the track can be sent. A requested
+	 * flush is retried soon, as fixes are dropped while the track is
+	 * full.
+	 */
+	if (!data_send_enabled() || gps_control_is_active()) {
+		k_delayed_work_submit_to_queue(&application_work_q,
+			&send_gps_track_work,
+			gps_track_flush_pending ? GPS_TRACK_FLUSH_RETRY_DELAY :
+			K_SECONDS(CONFIG_GPS_CONTROL_TRACK_FLUSH_INTERVAL));
+		return;
+	}
+
+	gps_track_flush_pending = false;
+	k_delayed_work_submit_to_queue(&application_work_q,
+			&send_gps_track_work,
+			K_SECONDS(CONFIG_GPS_CONTROL_TRACK_FLUSH_INTERVAL));
+
+	len = gps_control_track_get(track_str, sizeof(track_str));
+	if (len <= 0) {
+		return;
+	}
+
+	track_cloud_data.data.len = len;
+	track_cloud_data.ts = k_uptime_get();
+	track_cloud_data.tag += 1;
+
+	if (track_cloud_data.tag == 0) {
+		track_cloud_data.tag = 0x1;
+	}
+
+	sensor_data_send(&track_cloud_data);
+}
+#endif /* CONFIG_GPS_CONTROL_TRACK */
+
 static void send_button_data_work_fn(struct k_work *work)
 {
 	sensor_data_send(&button_cloud_data);
@@ -672,7 +726,17 @@ static void gps_handler(const struct device *dev, struct gps_event *evt)
 		break;
 	case GPS_EVT_PVT_FIX:
 		LOG_INF("GPS_EVT_PVT_FIX");
-		gps_time_set(&evt->pvt);
+
+		/* Simulated fixes have a made-up date. */
+		if (!IS_ENABLED(CONFIG_GPS_SIM)) {
+			gps_time_set(&evt->pvt);
+		}
+
+#if defined(CONFIG_GPS_CONTROL_TRACK)
+		if (gps_control_track_add(&evt->pvt) > 0) {
+			gps_track_send_pending = true;
+		}
+#endif /* CONFIG_GPS_CONTROL_TRACK */
 		break;
 	case GPS_EVT_NMEA:
 		/* Don't spam logs */
@@ -700,8 +764,21 @@ static void gps_handler(const struct device *dev, struct gps_event *evt)
 			gps_time_from_start_to_fix_seconds +
 			gps_control_get_gps_reporting_interval());
 
+#if defined(CONFIG_GPS_CONTROL_TRACK)
+		/* The fix was added to the track, which is sent on schedule,
+		 * or now if it is full or the device has moved far enough.
+		 */
+		if (gps_track_send_pending) {
+			gps_track_send_pending = false;
+			gps_track_flush_pending = true;
+			k_delayed_work_submit_to_queue(&application_work_q,
+						       &send_gps_track_work,
+						       K_NO_WAIT);
+		}
+#else
 		k_work_submit_to_queue(&application_work_q,
 				       &send_gps_data_work);
+#endif /* CONFIG_GPS_CONTROL_TRACK */
 		env_sensors_poll();
 		break;
 	case GPS_EVT_OPERATION_BLOCKED:
@@ -1574,6 +1651,9 @@ static void work_init(void)
 	k_work_init(&device_status_work, device_status_send);
 	k_work_init(&motion_data_send_work, motion_data_send);
 	k_work_init(&no_sim_go_offline_work, no_sim_go_offline);
+#if defined(CONFIG_GPS_CONTROL_TRACK)
+	k_delayed_work_init(&send_gps_track_work, send_gps_track_work_fn);
+#endif /* CONFIG_GPS_CONTROL_TRACK */
 #if CONFIG_MODEM_INFO
 	k_delayed_work_init(&rsrp_work, modem_rsrp_data_send);
 #endif /* CONFIG_MODEM_INFO */
@@ -1705,6 +1785,12 @@ static void sensors_init(void)
 		LOG_ERR("GPS could not be initialized");
 		return;
 	}
+
+#if defined(CONFIG_GPS_CONTROL_TRACK)
+	k_delayed_work_submit_to_queue(&application_work_q,
+			&send_gps_track_work,
+			K_SECONDS(CONFIG_GPS_CONTROL_TRACK_FLUSH_INTERVAL));
+#endif /* CONFIG_GPS_CONTROL_TRACK */
 }
 
 #if defined(CONFIG_USE_UI_MODULE)
@@ -36,6 +36,8 @@ enum motion_sensor_option {
 	[MOTION_SENSOR_OPTION_SLEEP3_SAMPLE_TIME] = PMW3360_ATTR_REST3_SAMPLE_TIME,
  };
 
+ static const int motion_sensor_squal_chan = PMW3360_CHAN_SQUAL;
+
 #elif CONFIG_DESKTOP_MOTION_SENSOR_PAW3212_ENABLE
 
  #include <sensor/paw3212.h>
@@ -53,6 +55,8 @@ enum motion_sensor_option {
 	[MOTION_SENSOR_OPTION_SLEEP3_SAMPLE_TIME] = PAW3212_ATTR_SLEEP3_SAMPLE_TIME,
  };
 
+ static const int motion_sensor_squal_chan = -ENOTSUP;
+
 #else
 
  #error "Sensor not supported"
@@ -14,9 +14,27 @@ static int log_cpu_load_event(const struct event_header *eh, char *buf,
 			      size_t buf_len)
 {
 	const struct cpu_load_event *event = cast_cpu_load_event(eh);
+	int pos;
 
-	return snprintf(buf, buf_len, "CPU load: %03u,%03u%%",
-			event->load / 1000, event->load % 1000);
+	pos = snprintf(buf, buf_len, "CPU load: %03u,%03u%%",
+		       event->load / 1000, event->load % 1000);
+
+#ifdef CONFIG_DESKTOP_CPU_MEAS_TOP
+	char name[16];
+
+	for (size_t i = 0;
+	     (i < event->top_count) && ((size_t)pos < buf_len);
+	     i++) {
+		const struct cpu_load_stats_entry *entry = &event->top[i];
+
+		pos += snprintf(&buf[pos], buf_len - pos, " %s:%u,%03u%%",
+				cpu_load_stats_name_get(entry, name,
+							sizeof(name)),
+				entry->load / 1000, entry->load % 1000);
+	}
+#endif
+
+	return pos;
 }
 
 static void profile_cpu_load_event(struct log_event_buf *buf,
@@ -15,6 +15,10 @@
 
 #include "event_manager.h"
 
+#ifdef CONFIG_DESKTOP_CPU_MEAS_TOP
+#include <debug/cpu_load.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -24,6 +28,13 @@ struct cpu_load_event {
 	struct event_header header; /**< Event header. */
 
 	uint32_t load; /**< CPU load [in 0,001% units]. */
+
+#ifdef CONFIG_DESKTOP_CPU_MEAS_TOP
+	/** Threads and interrupts with highest load, sorted by load. */
+	struct cpu_load_stats_entry top[CONFIG_DESKTOP_CPU_MEAS_TOP_COUNT];
+
+	size_t top_count; /**< Number of valid entries in top. */
+#endif
 };
 
 EVENT_TYPE_DECLARE(cpu_load_event);
@@ -14,6 +14,7 @@
 #include <drivers/sensor.h>
 
 #include "motion_sensor.h"
+#include "motion_filter.h"
 
 #include "event_manager.h"
 #include "motion_event.h"
@@ -74,6 +75,13 @@ static const struct device *sensor_dev;
 
 static struct sensor_state state;
 
+static struct motion_filter_lift lift_filter;
+static struct motion_filter_accel accel_filter;
+static struct motion_filter_snap snap_filter;
+static struct motion_filter *filter_chain[3];
+static size_t filter_count;
+static uint32_t last_sample_time;
+
 static const char * const opt_descr[] = {
 	[SENSOR_OPT_VARIANT] = OPT_DESCR_MODULE_VARIANT,
 	[SENSOR_OPT_CPI] = "cpi",
@@ -219,6 +227,25 @@ static void data_ready_handler(const struct device *dev, struct sensor_trigger *
 	k_spin_unlock(&state.lock, key);
 }
 
+static uint16_t squal_read(void)
+{
+	struct sensor_value value;
+
+	if (!IS_ENABLED(CONFIG_DESKTOP_MOTION_SENSOR_LIFT_FILTER) ||
+	    (motion_sensor_squal_chan == -ENOTSUP)) {
+		return MOTION_FILTER_SQUAL_UNKNOWN;
+	}
+
+	int err = sensor_channel_get(sensor_dev, motion_sensor_squal_chan,
+				     &value);
+
+	if (err) {
+		return MOTION_FILTER_SQUAL_UNKNOWN;
+	}
+
+	return value.val1;
+}
+
 static int motion_read(bool send_event)
 {
 	struct sensor_value value_x;
@@ -235,6 +262,11 @@ static int motion_read(bool send_event)
 					 &value_y);
 	}
 
+	uint32_t now = k_cycle_get_32();
+	uint32_t dt = k_cyc_to_us_floor32(now - last_sample_time);
+
+	last_sample_time = now;
+
 	if (err || !send_event) {
 		return err;
 	}
@@ -252,10 +284,26 @@ static int motion_read(bool send_event)
 		nodata = 0;
 	}
 
+	struct motion_filter_sample sample = {
+		.dx = value_x.val1,
+		.dy = value_y.val1,
+		.dt = dt,
+		.squal = squal_read(),
+	};
+
+	/* Samples dropped by the filters, for example when the sensor is
+	 * lifted, are handled as if there was no motion.
+	 */
+	if (!motion_filter_run(filter_chain, filter_count, &sample)) {
+		nodata = 0;
+
+		return -ENODATA;
+	}
+
 	struct motion_event *event = new_motion_event();
 
-	event->dx = value_x.val1;
-	event->dy = value_y.val1;
+	event->dx = sample.dx;
+	event->dy = sample.dy;
 	EVENT_SUBMIT(event);
 
 	return err;
@@ -319,10 +367,37 @@ static void set_default_configuration(void)
 	set_option(MOTION_SENSOR_OPTION_SLEEP_ENABLE, true);
 }
 
+static void init_filters(void)
+{
+	if (IS_ENABLED(CONFIG_DESKTOP_MOTION_SENSOR_LIFT_FILTER)) {
+		motion_filter_lift_init(&lift_filter,
+				CONFIG_DESKTOP_MOTION_SENSOR_LIFT_SQUAL);
+		filter_chain[filter_count++] = &lift_filter.filter;
+	}
+
+	if (IS_ENABLED(CONFIG_DESKTOP_MOTION_SENSOR_SNAP_FILTER)) {
+		motion_filter_snap_init(&snap_filter,
+				CONFIG_DESKTOP_MOTION_SENSOR_SNAP_ANGLE);
+		filter_chain[filter_count++] = &snap_filter.filter;
+	}
+
+	if (IS_ENABLED(CONFIG_DESKTOP_MOTION_SENSOR_ACCEL_FILTER)) {
+		motion_filter_accel_init(&accel_filter,
+				CONFIG_DESKTOP_MOTION_SENSOR_ACCEL_THRESHOLD,
+				CONFIG_DESKTOP_MOTION_SENSOR_ACCEL_SLOPE,
+				CONFIG_DESKTOP_MOTION_SENSOR_ACCEL_MAX_GAIN);
+		filter_chain[filter_count++] = &accel_filter.filter;
+	}
+
+	__ASSERT_NO_MSG(filter_count <= ARRAY_SIZE(filter_chain));
+}
+
 static int init(void)
 {
 	int err = -ENXIO;
 
+	init_filters();
+
 	sensor_dev = device_get_binding(MOTION_SENSOR_DEV_NAME);
 	if (!sensor_dev) {
 		LOG_ERR("Cannot get motion sensor device");
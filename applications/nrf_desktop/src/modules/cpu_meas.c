@@ -18,17 +18,23 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_CPU_MEAS_LOG_LEVEL);
 static struct k_delayed_work cpu_load_read;
 
 
-static void send_cpu_load_event(uint32_t load)
+static void send_cpu_load_event(void)
 {
 	struct cpu_load_event *event = new_cpu_load_event();
 
-	event->load = load;
+	event->load = cpu_load_get();
+
+#ifdef CONFIG_DESKTOP_CPU_MEAS_TOP
+	event->top_count = cpu_load_stats_get(event->top,
+					      ARRAY_SIZE(event->top));
+#endif
+
 	EVENT_SUBMIT(event);
 }
 
 static void cpu_load_read_fn(struct k_work *work)
 {
-	send_cpu_load_event(cpu_load_get());
+	send_cpu_load_event();
 	cpu_load_reset();
 
 	k_delayed_work_submit(&cpu_load_read,
@@ -8,6 +8,7 @@
 
 #include <zephyr/types.h>
 #include <sys/byteorder.h>
+#include <sys/crc.h>
 #include <storage/flash_map.h>
 #include <pm_config.h>
 
@@ -43,9 +44,13 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_LOG_LEVEL);
 #define BACKGROUND_FLASH_STORE_TIMEOUT	K_MSEC(5)
 
 /* Keep small to avoid blocking the workqueue for long periods of time. */
-#define STORE_CHUNK_SIZE		16 /* bytes */
+#define STORE_CHUNK_SIZE CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_STORE_CHUNK_SIZE /* bytes */
 
 #define SYNC_BUFFER_SIZE (CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_SYNC_BUFFER_SIZE * sizeof(uint32_t)) /* bytes */
+#define SYNC_BUFFER_CNT CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_SYNC_BUFFER_CNT
+
+/* Checksum of the image is the CRC32 seeded like on the host. */
+#define IMG_CSUM_SEED			1
 
 #if CONFIG_SECURE_BOOT
  #include <fw_info.h>
@@ -70,15 +75,33 @@ static struct k_delayed_work background_store;
 
 static const struct flash_area *flash_area;
 static uint32_t cur_offset;
+static uint32_t erase_offset;
 static uint32_t img_csum;
 static uint32_t img_length;
+static uint32_t img_hash = IMG_CSUM_SEED;
+
+/* Buffers filled by the host are stored in the order of reception, while
+ * the next buffer is being filled.
+ */
+static char sync_buffer[SYNC_BUFFER_CNT][SYNC_BUFFER_SIZE] __aligned(4);
+static uint16_t sync_buffer_len[SYNC_BUFFER_CNT];
+static uint8_t store_buffer;
+static uint8_t store_buffer_cnt;
 
 static uint16_t store_offset;
 static uint16_t sync_offset;
-static char sync_buffer[SYNC_BUFFER_SIZE] __aligned(4);
 
 static bool device_in_use;
-static bool is_flash_area_clean;
+static bool is_flash_area_clean = true;
+
+static struct {
+	uint32_t rx_bytes;
+	uint32_t stall_time;
+	int64_t start_time;
+	int64_t stop_time;
+	int64_t stall_start;
+	bool stalled;
+} stats;
 
 enum dfu_opt {
 	DFU_OPT_START,
@@ -86,6 +109,7 @@ enum dfu_opt {
 	DFU_OPT_SYNC,
 	DFU_OPT_REBOOT,
 	DFU_OPT_FWINFO,
+	DFU_OPT_STATS,
 
 	DFU_OPT_COUNT
 };
@@ -95,7 +119,8 @@ const static char * const opt_descr[] = {
 	[DFU_OPT_DATA] = "data",
 	[DFU_OPT_SYNC] = "sync",
 	[DFU_OPT_REBOOT] = "reboot",
-	[DFU_OPT_FWINFO] = "fwinfo"
+	[DFU_OPT_FWINFO] = "fwinfo",
+	[DFU_OPT_STATS] = "stats"
 };
 
 static uint8_t dfu_slot_id(void)
@@ -143,6 +168,59 @@ static bool is_page_clean(const struct flash_area *fa, off_t off, size_t len)
 	return true;
 }
 
+static int erase_page(uint32_t offset)
+{
+	__ASSERT_NO_MSG(offset + FLASH_PAGE_SIZE <= flash_area->fa_size);
+
+	if (is_page_clean(flash_area, offset, FLASH_PAGE_SIZE)) {
+		return 0;
+	}
+
+	int err = flash_area_erase(flash_area, offset, FLASH_PAGE_SIZE);
+
+	if (err) {
+		LOG_ERR("Cannot erase page (%d)", err);
+	}
+
+	return err;
+}
+
+static char *rx_buffer_get(void)
+{
+	if (store_buffer_cnt == SYNC_BUFFER_CNT) {
+		return NULL;
+	}
+
+	return sync_buffer[(store_buffer + store_buffer_cnt) % SYNC_BUFFER_CNT];
+}
+
+static uint32_t rx_offset_get(void)
+{
+	uint32_t offset = cur_offset + sync_offset;
+
+	for (size_t i = 0; i < store_buffer_cnt; i++) {
+		offset += sync_buffer_len[(store_buffer + i) % SYNC_BUFFER_CNT];
+	}
+
+	return offset;
+}
+
+static void stall_start(void)
+{
+	if (!stats.stalled) {
+		stats.stall_start = k_uptime_get();
+		stats.stalled = true;
+	}
+}
+
+static void stall_stop(void)
+{
+	if (stats.stalled) {
+		stats.stall_time += k_uptime_get() - stats.stall_start;
+		stats.stalled = false;
+	}
+}
+
 static void terminate_dfu(void)
 {
 	__ASSERT_NO_MSG(flash_area != NULL);
@@ -150,9 +228,18 @@ static void terminate_dfu(void)
 	flash_area_close(flash_area);
 	k_delayed_work_cancel(&dfu_timeout);
 	k_delayed_work_cancel(&background_store);
+	k_delayed_work_cancel(&background_erase);
 	dfu_unlock(MODULE_ID(MODULE));
 	flash_area = NULL;
+	is_flash_area_clean = true;
+
+	/* Data that was not stored is dropped. */
 	sync_offset = 0;
+	store_offset = 0;
+	store_buffer_cnt = 0;
+
+	stall_stop();
+	stats.stop_time = k_uptime_get();
 }
 
 static void dfu_timeout_handler(struct k_work *work)
@@ -176,10 +263,10 @@ static void reboot_request_handler(struct k_work *work)
 
 static void background_erase_handler(struct k_work *work)
 {
-	static uint32_t erase_offset;
 	int err;
 
 	__ASSERT_NO_MSG(!is_flash_area_clean);
+	__ASSERT_NO_MSG(flash_area != NULL);
 
 	/* During page erase operation CPU stalls. As page erase takes tens of
 	 * milliseconds let's perform it in background, when user is not
@@ -192,60 +279,75 @@ static void background_erase_handler(struct k_work *work)
 		return;
 	}
 
-	if (!flash_area) {
-		err = flash_area_open(dfu_slot_id(), &flash_area);
+	/* Pages behind the image are erased after the image is written, so
+	 * that no data left by the previous update is taken as a part of it.
+	 */
+	if (erase_offset < flash_area->fa_size) {
+		err = erase_page(erase_offset);
 		if (err) {
-			LOG_ERR("Cannot open flash area (%d)", err);
-			flash_area = NULL;
+			terminate_dfu();
 			return;
 		}
+
+		erase_offset += FLASH_PAGE_SIZE;
+		k_delayed_work_submit(&background_erase, K_NO_WAIT);
+		return;
 	}
 
-	__ASSERT_NO_MSG(erase_offset + FLASH_PAGE_SIZE <= flash_area->fa_size);
+	LOG_INF("Secondary image slot is clean");
 
-	if (!is_page_clean(flash_area, erase_offset, FLASH_PAGE_SIZE)) {
-		err = flash_area_erase(flash_area, erase_offset, FLASH_PAGE_SIZE);
-		if (err) {
-			LOG_ERR("Cannot erase page (%d)", err);
-			flash_area_close(flash_area);
-			flash_area = NULL;
-			return;
-		}
+#ifdef CONFIG_BOOTLOADER_MCUBOOT
+	err = boot_request_upgrade(false);
+	if (err) {
+		LOG_ERR("Cannot request the image upgrade (err:%d)", err);
 	}
+#endif
+	terminate_dfu();
+}
 
-	erase_offset += FLASH_PAGE_SIZE;
+static void complete_dfu_image(void)
+{
+	k_delayed_work_cancel(&dfu_timeout);
 
-	if (erase_offset < flash_area->fa_size) {
-		k_delayed_work_submit(&background_erase, K_NO_WAIT);
-	} else {
-		LOG_INF("Secondary image slot is clean");
+	if (img_hash != img_csum) {
+		LOG_ERR("Image checksum mismatch (0x%" PRIx32
+			" != 0x%" PRIx32 ")", img_hash, img_csum);
 
-		dfu_unlock(MODULE_ID(MODULE));
-		is_flash_area_clean = true;
+		/* Make sure that the image cannot be booted. */
+		(void)flash_area_erase(flash_area, 0, FLASH_PAGE_SIZE);
+		cur_offset = 0;
 		erase_offset = 0;
-
-		flash_area_close(flash_area);
-		flash_area = NULL;
+		img_hash = IMG_CSUM_SEED;
+		terminate_dfu();
+		return;
 	}
+
+	LOG_INF("DFU image written");
+
+	is_flash_area_clean = false;
+	k_delayed_work_submit(&background_erase, K_NO_WAIT);
 }
 
 static void complete_dfu_data_store(void)
 {
-	cur_offset += sync_offset;
-	sync_offset = 0;
+	uint16_t len = sync_buffer_len[store_buffer];
+
+	img_hash = crc32_ieee_update(img_hash, sync_buffer[store_buffer], len);
+	cur_offset += len;
 	store_offset = 0;
 
+	store_buffer = (store_buffer + 1) % SYNC_BUFFER_CNT;
+	store_buffer_cnt--;
+
+	/* Host can send data again. */
+	stall_stop();
+
 	LOG_DBG("DFU data store complete: %" PRIu32, cur_offset);
 
 	if (cur_offset == img_length) {
-		LOG_INF("DFU image written");
-#ifdef CONFIG_BOOTLOADER_MCUBOOT
-		int err = boot_request_upgrade(false);
-		if (err) {
-			LOG_ERR("Cannot request the image upgrade (err:%d)", err);
-		}
-#endif
-		terminate_dfu();
+		complete_dfu_image();
+	} else if (store_buffer_cnt > 0) {
+		k_delayed_work_submit(&background_store, K_NO_WAIT);
 	}
 }
 
@@ -253,15 +355,17 @@ static void store_dfu_data_chunk(void)
 {
 	/* Some flash may require word alignment. */
 	BUILD_ASSERT((STORE_CHUNK_SIZE % sizeof(uint32_t)) == 0);
-	BUILD_ASSERT((sizeof(sync_buffer) % sizeof(uint32_t)) == 0);
+	BUILD_ASSERT((SYNC_BUFFER_SIZE % sizeof(uint32_t)) == 0);
 
-	__ASSERT_NO_MSG(store_offset <= sync_offset);
+	uint16_t len = sync_buffer_len[store_buffer];
+
+	__ASSERT_NO_MSG(store_offset <= len);
 	__ASSERT_NO_MSG(flash_area != NULL);
 
 	size_t store_size = STORE_CHUNK_SIZE;
 
-	if (sync_offset - store_offset < store_size) {
-		store_size = sync_offset - store_offset;
+	if (len - store_offset < store_size) {
+		store_size = len - store_offset;
 	}
 	if ((store_size > sizeof(uint32_t)) &&
 	    ((store_size % sizeof(uint32_t)) != 0)) {
@@ -269,9 +373,25 @@ static void store_dfu_data_chunk(void)
 		store_size = (store_size / sizeof(uint32_t)) * sizeof(uint32_t);
 	}
 
-	LOG_DBG("DFU data store chunk: %" PRIu32, cur_offset + store_offset);
-	int err = flash_area_write(flash_area, cur_offset + store_offset,
-				   &sync_buffer[store_offset], store_size);
+	uint32_t write_offset = cur_offset + store_offset;
+
+	/* Pages are erased just before the data is written to them. */
+	if (write_offset + store_size > erase_offset) {
+		LOG_DBG("DFU erase page: %" PRIu32, erase_offset);
+		int err = erase_page(erase_offset);
+
+		if (err) {
+			terminate_dfu();
+		} else {
+			erase_offset += FLASH_PAGE_SIZE;
+		}
+		return;
+	}
+
+	LOG_DBG("DFU data store chunk: %" PRIu32, write_offset);
+	int err = flash_area_write(flash_area, write_offset,
+				   &sync_buffer[store_buffer][store_offset],
+				   store_size);
 	if (err) {
 		LOG_ERR("Cannot write data (%d)", err);
 		terminate_dfu();
@@ -288,7 +408,12 @@ static void background_store_handler(struct k_work *work)
 		store_dfu_data_chunk();
 	}
 
-	if (store_offset < sync_offset) {
+	if (!flash_area) {
+		/* Storing failed. */
+		return;
+	}
+
+	if (store_offset < sync_buffer_len[store_buffer]) {
 		k_delayed_work_submit(&background_store, BACKGROUND_FLASH_STORE_TIMEOUT);
 		k_delayed_work_submit(&dfu_timeout, DFU_TIMEOUT);
 	} else {
@@ -303,9 +428,22 @@ static bool is_dfu_data_store_active(void)
 
 static void start_dfu_data_store(void)
 {
+	uint8_t idx = (store_buffer + store_buffer_cnt) % SYNC_BUFFER_CNT;
+
 	LOG_DBG("DFU data store start: %" PRIu32 " %" PRIu32, cur_offset, sync_offset);
-	store_offset = 0;
-	k_delayed_work_submit(&background_store, K_NO_WAIT);
+
+	sync_buffer_len[idx] = sync_offset;
+	sync_offset = 0;
+	store_buffer_cnt++;
+
+	if (store_buffer_cnt == SYNC_BUFFER_CNT) {
+		/* Host must wait until a buffer is stored. */
+		stall_start();
+	}
+
+	if (!is_dfu_data_store_active()) {
+		k_delayed_work_submit(&background_store, K_NO_WAIT);
+	}
 }
 
 static void handle_dfu_data(const uint8_t *data, size_t size)
@@ -328,13 +466,21 @@ static void handle_dfu_data(const uint8_t *data, size_t size)
 		return;
 	}
 
-	if (size > sizeof(sync_buffer) - sync_offset) {
+	char *buffer = rx_buffer_get();
+
+	if (!buffer) {
+		LOG_WRN("No free sync buffer");
+		return;
+	}
+
+	if (size > SYNC_BUFFER_SIZE - sync_offset) {
 		LOG_WRN("Chunk size truncated");
-		size = sizeof(sync_buffer) - sync_offset;
+		size = SYNC_BUFFER_SIZE - sync_offset;
 	}
-	memcpy(&sync_buffer[sync_offset], data, size);
+	memcpy(&buffer[sync_offset], data, size);
 
 	sync_offset += size;
+	stats.rx_bytes += size;
 
 	LOG_DBG("DFU chunk collected");
 
@@ -355,8 +501,6 @@ static void handle_dfu_start(const uint8_t *data, const size_t size)
 	BUILD_ASSERT(sizeof(csum) == sizeof(img_csum), "");
 	BUILD_ASSERT(sizeof(offset) == sizeof(cur_offset), "");
 
-	sync_offset = 0;
-
 	if (size < data_size) {
 		LOG_WRN("Invalid DFU start header");
 		return;
@@ -410,18 +554,12 @@ static void handle_dfu_start(const uint8_t *data, const size_t size)
 			LOG_INF("Restart DFU");
 		}
 	} else {
-		if (cur_offset != 0) {
-			k_delayed_work_submit(&background_erase, K_NO_WAIT);
-			is_flash_area_clean = false;
-			cur_offset = 0;
-			img_length = 0;
-			img_csum = 0;
-
-			return;
-		} else {
-			img_length = length;
-			img_csum = csum;
-		}
+		/* Pages are erased when the image data reaches them. */
+		cur_offset = 0;
+		erase_offset = 0;
+		img_hash = IMG_CSUM_SEED;
+		img_length = length;
+		img_csum = csum;
 	}
 
 	__ASSERT_NO_MSG(flash_area == NULL);
@@ -439,6 +577,10 @@ static void handle_dfu_start(const uint8_t *data, const size_t size)
 		terminate_dfu();
 	} else {
 		LOG_INF("DFU started");
+
+		memset(&stats, 0, sizeof(stats));
+		stats.start_time = k_uptime_get();
+
 		k_delayed_work_submit(&dfu_timeout, DFU_TIMEOUT);
 	}
 }
@@ -446,29 +588,31 @@ static void handle_dfu_start(const uint8_t *data, const size_t size)
 static void handle_dfu_sync(uint8_t *data, size_t *size)
 {
 	LOG_INF("DFU sync requested");
-	uint16_t sync_buffer_size = sizeof(sync_buffer);
+	uint16_t sync_buffer_size = SYNC_BUFFER_SIZE;
 
-	bool storing_data = (sync_offset > 0);
 	bool dfu_active = (flash_area != NULL);
 
-	if (storing_data && !is_dfu_data_store_active()) {
+	if (sync_offset > 0) {
 		start_dfu_data_store();
 	}
 
 	uint8_t dfu_state;
+	uint32_t offset = cur_offset;
 
 	if (!is_flash_area_clean) {
 		dfu_state = DFU_STATE_CLEANING;
-	} else if (storing_data) {
+	} else if (store_buffer_cnt == SYNC_BUFFER_CNT) {
 		dfu_state = DFU_STATE_STORING;
 	} else if (dfu_active) {
+		/* Buffered data will be stored unless DFU is interrupted. */
 		dfu_state = DFU_STATE_ACTIVE;
+		offset = rx_offset_get();
 	} else {
 		dfu_state = DFU_STATE_INACTIVE;
 	}
 
 	size_t data_size = sizeof(dfu_state) + sizeof(img_length) +
-			   sizeof(img_csum) + sizeof(cur_offset) +
+			   sizeof(img_csum) + sizeof(offset) +
 			   sizeof(sync_buffer_size);
 
 	*size = data_size;
@@ -484,8 +628,8 @@ static void handle_dfu_sync(uint8_t *data, size_t *size)
 	sys_put_le32(img_csum, &data[pos]);
 	pos += sizeof(img_csum);
 
-	sys_put_le32(cur_offset, &data[pos]);
-	pos += sizeof(cur_offset);
+	sys_put_le32(offset, &data[pos]);
+	pos += sizeof(offset);
 
 	sys_put_le16(sync_buffer_size, &data[pos]);
 	pos += sizeof(sync_buffer_size);
@@ -493,6 +637,38 @@ static void handle_dfu_sync(uint8_t *data, size_t *size)
 	__ASSERT_NO_MSG(pos == data_size);
 }
 
+static void handle_stats_request(uint8_t *data, size_t *size)
+{
+	int64_t end_time = (flash_area) ? k_uptime_get() : stats.stop_time;
+	uint32_t stall_time = stats.stall_time;
+
+	if (stats.stalled) {
+		stall_time += end_time - stats.stall_start;
+	}
+
+	uint32_t rx_time = end_time - stats.start_time;
+
+	size_t data_size = sizeof(stats.rx_bytes) + sizeof(rx_time) +
+			   sizeof(stall_time) + sizeof(img_hash);
+	size_t pos = 0;
+
+	*size = data_size;
+
+	sys_put_le32(stats.rx_bytes, &data[pos]);
+	pos += sizeof(stats.rx_bytes);
+
+	sys_put_le32(rx_time, &data[pos]);
+	pos += sizeof(rx_time);
+
+	sys_put_le32(stall_time, &data[pos]);
+	pos += sizeof(stall_time);
+
+	sys_put_le32(img_hash, &data[pos]);
+	pos += sizeof(img_hash);
+
+	__ASSERT_NO_MSG(pos == data_size);
+}
+
 static void handle_reboot_request(uint8_t *data, size_t *size)
 {
 	LOG_INF("System reboot requested");
@@ -652,6 +828,10 @@ static void fetch_config(const uint8_t opt_id, uint8_t *data, size_t *size)
 		handle_dfu_sync(data, size);
 		break;
 
+	case DFU_OPT_STATS:
+		handle_stats_request(data, size);
+		break;
+
 	default:
 		/* Ignore unknown event. */
 		LOG_WRN("Unknown DFU event");
@@ -692,14 +872,6 @@ static bool event_handler(const struct event_header *eh)
 			k_delayed_work_init(&reboot_request, reboot_request_handler);
 			k_delayed_work_init(&background_erase, background_erase_handler);
 			k_delayed_work_init(&background_store, background_store_handler);
-
-			if (!dfu_lock(MODULE_ID(MODULE))) {
-				/* Should not happen. */
-				__ASSERT_NO_MSG(false);
-			} else {
-				k_delayed_work_submit(&background_erase,
-						      K_NO_WAIT);
-			}
 		}
 		return false;
 	}
@@ -5,7 +5,6 @@
  */
 
 #include <zephyr/types.h>
-#include <sys/slist.h>
 #include <settings/settings.h>
 
 #include <bluetooth/services/hogp.h>
@@ -16,6 +15,7 @@
 
 #include "hid_report_desc.h"
 #include "config_channel_transport.h"
+#include "enqueued_reports.h"
 
 #include "hid_event.h"
 #include "ble_event.h"
@@ -27,6 +27,8 @@
 LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_HID_FORWARD_LOG_LEVEL);
 
 #define MAX_ENQUEUED_ITEMS CONFIG_DESKTOP_HID_FORWARD_MAX_ENQUEUED_REPORTS
+/* Subscriber keeps the reports of all disconnected peripherals. */
+#define MAX_SUB_ENQUEUED_ITEMS (MAX_ENQUEUED_ITEMS * CONFIG_BT_MAX_CONN)
 #define CFG_CHAN_RSP_READ_DELAY		K_MSEC(15)
 #define CFG_CHAN_MAX_RSP_POLL_CNT	50
 #define CFG_CHAN_UNUSED_PEER_ID		UINT8_MAX
@@ -36,25 +38,12 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_HID_FORWARD_LOG_LEVEL);
 
 BUILD_ASSERT(CFG_CHAN_MAX_RSP_POLL_CNT <= UCHAR_MAX);
 
-struct enqueued_report {
-	sys_snode_t node;
-	struct hid_report_event *report;
-};
-
-struct counted_list {
-	sys_slist_t list;
-	size_t count;
-};
-
-struct enqueued_reports {
-	struct counted_list reports[ARRAY_SIZE(input_reports)];
-	uint8_t last_idx;
-};
-
 struct subscriber {
 	const void *id;
 	uint32_t enabled_reports_bm;
 	struct enqueued_reports enqueued_reports;
+	struct hid_report_event *report_buf[ARRAY_SIZE(input_reports)]
+					   [MAX_SUB_ENQUEUED_ITEMS];
 	bool busy;
 	uint8_t last_peripheral_id;
 };
@@ -62,6 +51,8 @@ struct subscriber {
 struct hids_peripheral {
 	struct bt_hogp hogp;
 	struct enqueued_reports enqueued_reports;
+	struct hid_report_event *report_buf[ARRAY_SIZE(input_reports)]
+					   [MAX_ENQUEUED_ITEMS];
 
 	struct k_delayed_work read_rsp;
 	struct config_event *cfg_chan_rsp;
@@ -179,159 +170,18 @@ static bool is_report_enabled(struct subscriber *sub, uint8_t report_id)
 	return (sub->enabled_reports_bm & BIT(report_id)) != 0;
 }
 
-static bool is_report_enqueued(struct enqueued_reports *enqueued_reports,
-			       size_t irep_idx)
-{
-	struct counted_list *reports = &enqueued_reports->reports[irep_idx];
-
-	if (reports->count == 0) {
-		__ASSERT_NO_MSG(sys_slist_is_empty(&reports->list));
-		return false;
-	}
-	return true;
-}
-
-static bool is_any_report_enqueued(struct enqueued_reports *enqueued_reports)
-{
-	for (size_t irep_idx = 0; irep_idx < ARRAY_SIZE(enqueued_reports->reports); irep_idx++) {
-		if (is_report_enqueued(enqueued_reports, irep_idx)) {
-			return true;
-		}
-	}
-
-	return false;
-}
-
-static struct enqueued_report *get_enqueued_report(struct enqueued_reports *enqueued_reports,
-						   size_t irep_idx)
-{
-	struct counted_list *reports = &enqueued_reports->reports[irep_idx];
-	struct enqueued_report *item;
-
-	item = CONTAINER_OF(sys_slist_get(&reports->list),
-			    __typeof__(*item),
-			    node);
-	__ASSERT_NO_MSG(reports->count > 0);
-	reports->count--;
-
-	return item;
-}
-
-static void drop_enqueued_reports(struct enqueued_reports *enqueued_reports,
-				  size_t irep_idx)
-{
-	__ASSERT_NO_MSG(irep_idx < ARRAY_SIZE(enqueued_reports->reports));
-
-	while (is_report_enqueued(enqueued_reports, irep_idx)) {
-		struct enqueued_report *item;
-
-		item = get_enqueued_report(enqueued_reports, irep_idx);
-
-		k_free(item->report);
-		k_free(item);
-	}
-}
-
-static void init_enqueued_reports(struct enqueued_reports *enqueued_reports)
-{
-	for (size_t irep_idx = 0; irep_idx < ARRAY_SIZE(enqueued_reports->reports); irep_idx++) {
-		struct counted_list *reports = &enqueued_reports->reports[irep_idx];
-
-		sys_slist_init(&reports->list);
-		reports->count = 0;
-	}
-
-	enqueued_reports->last_idx = 0;
-}
-
-static struct enqueued_report *get_next_enqueued_report(struct enqueued_reports *enqueued_reports)
-{
-	struct enqueued_report *item = NULL;
-
-	for (size_t i = 0; i < ARRAY_SIZE(enqueued_reports->reports); i++) {
-		size_t irep_idx = next_id(enqueued_reports->last_idx + i,
-					  ARRAY_SIZE(enqueued_reports->reports));
-
-		if (is_report_enqueued(enqueued_reports, irep_idx)) {
-			item = get_enqueued_report(enqueued_reports, irep_idx);
-
-			enqueued_reports->last_idx = irep_idx;
-			break;
-		}
-	}
-
-	return item;
-}
-
 static void migrate_enqueued_reports(struct enqueued_reports *dst_reports,
 				     struct enqueued_reports *src_reports)
 {
 	/* Migrate only up to MAX_ENQUEUED_ITEMS newest items.
 	 * As per can hold up only up to MAX_ENQUEUED_ITEMS at a time,
-	 * migration from per to sub will affect entire list.
+	 * migration from per to sub will affect entire queue.
 	 * When migrating from sub to par we will never get more items
 	 * then the defined limit.
 	 * Leaving the oldest items at sub will allow them to be sent
 	 * out first.
 	 */
-	for (size_t irep_idx = 0; irep_idx < ARRAY_SIZE(dst_reports->reports); irep_idx++) {
-		if (is_report_enqueued(src_reports, irep_idx)) {
-			struct counted_list *dst = &dst_reports->reports[irep_idx];
-			struct counted_list *src = &src_reports->reports[irep_idx];
-
-			sys_slist_t tmp_list;
-			size_t count = 0;
-
-			sys_slist_init(&tmp_list);
-
-			/* Move excessive items to a temporary list. */
-			while (src->count > MAX_ENQUEUED_ITEMS) {
-				sys_snode_t *node = sys_slist_get(&src->list);
-				src->count--;
-
-				sys_slist_append(&tmp_list, node);
-				count++;
-			}
-
-			/* Source hold MAX_ENQUEUED_ITEMS items max.
-			 * Migrate the entire list. */
-			sys_slist_merge_slist(&dst->list, &src->list);
-			dst->count += src->count;
-
-			/* Bring back excessive items to the source list. */
-			src->list = tmp_list;
-			src->count = count;
-		}
-	}
-}
-
-static void enqueue_hid_report(struct enqueued_reports *enqueued_reports,
-			       size_t irep_idx,
-			       struct hid_report_event *report)
-{
-	__ASSERT_NO_MSG(irep_idx < ARRAY_SIZE(enqueued_reports->reports));
-
-	struct counted_list *reports = &enqueued_reports->reports[irep_idx];
-
-	struct enqueued_report *item;
-
-	if (reports->count < MAX_ENQUEUED_ITEMS) {
-		item = k_malloc(sizeof(*item));
-	} else {
-		LOG_WRN("Enqueue dropped the oldest report");
-		item = get_enqueued_report(enqueued_reports, irep_idx);
-		k_free(item->report);
-	}
-
-	if (!item) {
-		LOG_ERR("Dropped HID report");
-		/* Should never happen. */
-		__ASSERT_NO_MSG(false);
-	} else {
-		item->report = report;
-		sys_slist_append(&reports->list, &item->node);
-		reports->count++;
-	}
+	enqueued_reports_migrate(dst_reports, src_reports, MAX_ENQUEUED_ITEMS);
 }
 
 static void forward_hid_report(struct hids_peripheral *per, uint8_t report_id,
@@ -371,13 +221,15 @@ static void forward_hid_report(struct hids_peripheral *per, uint8_t report_id,
 	memcpy(&report->dyndata.data[1], data, size);
 
 	if (!sub->busy) {
-		__ASSERT_NO_MSG(!is_report_enqueued(&per->enqueued_reports, irep_idx));
+		__ASSERT_NO_MSG(!enqueued_reports_is_enqueued(&per->enqueued_reports,
+							      irep_idx));
 
 		EVENT_SUBMIT(report);
 		per->enqueued_reports.last_idx = irep_idx;
 		sub->busy = true;
-	} else {
-		enqueue_hid_report(&per->enqueued_reports, irep_idx, report);
+	} else if (enqueued_reports_put(&per->enqueued_reports, irep_idx,
+					report)) {
+		LOG_WRN("Enqueue dropped the oldest report");
 	}
 }
 
@@ -476,8 +328,7 @@ static int register_peripheral(struct bt_gatt_dm *dm, const uint8_t *hwid,
 	 * This is needed to make sure that at any time number of
 	 * allocated reports is within configured bounds.
 	 */
-	__ASSERT_NO_MSG(!is_any_report_enqueued(&per->enqueued_reports));
-	ARG_UNUSED(is_any_report_enqueued);
+	__ASSERT_NO_MSG(!enqueued_reports_is_any(&per->enqueued_reports));
 	migrate_enqueued_reports(&per->enqueued_reports,
 				 &get_subscriber(per)->enqueued_reports);
 
@@ -876,7 +727,7 @@ static void disconnect_peripheral(struct hids_peripheral *per)
 
 	migrate_enqueued_reports(&get_subscriber(per)->enqueued_reports,
 				 &per->enqueued_reports);
-	__ASSERT_NO_MSG(!is_any_report_enqueued(&per->enqueued_reports));
+	__ASSERT_NO_MSG(!enqueued_reports_is_any(&per->enqueued_reports));
 
 	bt_hogp_release(&per->hogp);
 	k_delayed_work_cancel(&per->read_rsp);
@@ -922,11 +773,11 @@ static void disable_subscription(struct subscriber *sub, uint8_t report_id)
 			continue;
 		}
 
-		drop_enqueued_reports(&per->enqueued_reports, irep_idx);
+		enqueued_reports_drop(&per->enqueued_reports, irep_idx);
 	}
 
 	/* And also this subscriber. */
-	drop_enqueued_reports(&sub->enqueued_reports, irep_idx);
+	enqueued_reports_drop(&sub->enqueued_reports, irep_idx);
 }
 
 static void hogp_ready(struct bt_hogp *hids_c)
@@ -976,7 +827,17 @@ static void init(void)
 		k_delayed_work_init(&per->read_rsp, read_rsp_fn);
 		per->cfg_chan_id = CFG_CHAN_UNUSED_PEER_ID;
 
-		init_enqueued_reports(&per->enqueued_reports);
+		enqueued_reports_init(&per->enqueued_reports,
+				      &per->report_buf[0][0],
+				      ARRAY_SIZE(per->report_buf[0]));
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(subscribers); i++) {
+		struct subscriber *sub = &subscribers[i];
+
+		enqueued_reports_init(&sub->enqueued_reports,
+				      &sub->report_buf[0][0],
+				      ARRAY_SIZE(sub->report_buf[0]));
 	}
 
 	reset_peripheral_address();
@@ -988,12 +849,12 @@ static void send_enqueued_report(struct subscriber *sub)
 		return;
 	}
 
-	struct enqueued_report *item;
+	struct hid_report_event *report;
 
 	/* First try to send report left at subscriber. */
-	item = get_next_enqueued_report(&sub->enqueued_reports);
+	report = enqueued_reports_get_next(&sub->enqueued_reports);
 
-	if (!item) {
+	if (!report) {
 		/* Look for any report to sent at linked peripherals. */
 		for (size_t i = 0; i < ARRAY_SIZE(peripherals); i++) {
 			size_t per_id = next_id(sub->last_peripheral_id + i,
@@ -1005,19 +866,17 @@ static void send_enqueued_report(struct subscriber *sub)
 				continue;
 			}
 
-			item = get_next_enqueued_report(&per->enqueued_reports);
+			report = enqueued_reports_get_next(&per->enqueued_reports);
 
-			if (item) {
+			if (report) {
 				sub->last_peripheral_id = per_id;
 				break;
 			}
 		}
 	}
 
-	if (item) {
-		EVENT_SUBMIT(item->report);
-
-		k_free(item);
+	if (report) {
+		EVENT_SUBMIT(report);
 
 		sub->busy = true;
 	}
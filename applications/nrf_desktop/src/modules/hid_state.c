@@ -14,9 +14,9 @@
 #include <sys/types.h>
 
 #include <zephyr/types.h>
-#include <sys/slist.h>
 #include <sys/util.h>
 #include <sys/byteorder.h>
+#include <debug/trace_point.h>
 
 #include "button_event.h"
 #include "motion_event.h"
@@ -35,6 +35,8 @@
 #include <logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_HID_STATE_LOG_LEVEL);
 
+TRACE_POINT_DEFINE(hid_report_send);
+TRACE_POINT_DEFINE(hid_report_issued);
 
 /**@brief Module state. */
 enum state {
@@ -81,15 +83,19 @@ struct items {
 
 /**@brief Enqueued HID state item. */
 struct item_event {
-	sys_snode_t node; /**< Event queue linked list node. */
 	struct item item; /**< HID state item which has been enqueued. */
 	uint32_t timestamp; /**< HID event timestamp. */
 };
 
-/**@brief Event queue. */
+/**@brief Event queue.
+ *
+ * Events are kept in a ring of fixed size, so that enqueuing and removing
+ * events does not use the heap.
+ */
 struct eventq {
-	sys_slist_t root;
-	size_t len;
+	struct item_event events[CONFIG_DESKTOP_HID_EVENT_QUEUE_SIZE];
+	uint8_t head; /**< Index of the oldest event. */
+	uint8_t len; /**< Number of enqueued events. */
 };
 
 /**@brief Axis data. */
@@ -98,11 +104,28 @@ struct axis_data {
 	uint8_t axis_count; /**< Number of axes in this array. */
 };
 
+/**@brief Times of a report in flight. */
+struct report_time {
+	uint32_t input; /**< Time of the oldest input carried by the report. */
+	uint32_t generated; /**< Time the report was generated. */
+	bool has_input; /**< Report carries an input change. */
+};
+
+/**@brief Report latency statistics. */
+struct latency_stats {
+	uint32_t min;
+	uint32_t max;
+	uint32_t sum;
+	uint16_t cnt;
+};
+
 struct report_data {
 	struct items items;
 	struct eventq eventq;
 	struct axis_data axes;
 	bool update_needed;
+	bool input_pending;
+	uint32_t input_time;
 	struct report_state *linked_rs;
 };
 
@@ -110,8 +133,12 @@ struct report_state {
 	enum state state;
 	uint8_t cnt;
 	uint8_t report_id;
+	bool link_slow;
 	struct subscriber *subscriber;
 	struct report_data *linked_rd;
+	struct report_time time[CONFIG_DESKTOP_HID_REPORT_PIPELINE_DEPTH];
+	uint8_t time_head;
+	struct latency_stats stats;
 };
 
 struct subscriber {
@@ -211,16 +238,7 @@ static int usage_id_compare(const void *a, const void *b)
 
 static void eventq_reset(struct eventq *eventq)
 {
-	struct item_event *event;
-	struct item_event *tmp;
-
-	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&eventq->root, event, tmp, node) {
-		sys_slist_remove(&eventq->root, NULL, &event->node);
-
-		k_free(event);
-	}
-
-	sys_slist_init(&eventq->root);
+	eventq->head = 0;
 	eventq->len = 0;
 }
 
@@ -230,82 +248,88 @@ static bool eventq_is_full(const struct eventq *eventq)
 }
 
 
-static bool eventq_is_empty(struct eventq *eventq)
+static bool eventq_is_empty(const struct eventq *eventq)
 {
-	bool empty = sys_slist_is_empty(&eventq->root);
+	return (eventq->len == 0);
+}
 
-	__ASSERT_NO_MSG(!empty == (eventq->len != 0));
+/* Get the event at a given position, counting from the oldest one. */
+static struct item_event *eventq_peek(struct eventq *eventq, size_t pos)
+{
+	size_t idx = eventq->head + pos;
+
+	__ASSERT_NO_MSG(pos < eventq->len);
+
+	if (idx >= CONFIG_DESKTOP_HID_EVENT_QUEUE_SIZE) {
+		idx -= CONFIG_DESKTOP_HID_EVENT_QUEUE_SIZE;
+	}
 
-	return empty;
+	return &eventq->events[idx];
 }
 
-static struct item_event *eventq_get(struct eventq *eventq)
+static void eventq_drop(struct eventq *eventq, size_t cnt)
 {
-	sys_snode_t *node = sys_slist_get(&eventq->root);
+	size_t head = eventq->head + cnt;
 
-	if (!node) {
-		return NULL;
+	__ASSERT_NO_MSG(cnt <= eventq->len);
+
+	if (head >= CONFIG_DESKTOP_HID_EVENT_QUEUE_SIZE) {
+		head -= CONFIG_DESKTOP_HID_EVENT_QUEUE_SIZE;
+	}
+
+	eventq->head = head;
+	eventq->len -= cnt;
+}
+
+static bool eventq_get(struct eventq *eventq, struct item_event *event)
+{
+	if (eventq_is_empty(eventq)) {
+		return false;
 	}
 
-	eventq->len--;
+	*event = *eventq_peek(eventq, 0);
+	eventq_drop(eventq, 1);
 
-	return CONTAINER_OF(node, struct item_event, node);
+	return true;
 }
 
 static void eventq_append(struct eventq *eventq, uint16_t usage_id, int16_t value)
 {
-	struct item_event *hid_event = k_malloc(sizeof(*hid_event));
-
-	if (!hid_event) {
-		LOG_ERR("Failed to allocate HID event");
+	if (eventq_is_full(eventq)) {
+		LOG_ERR("No space for HID event");
 		/* Should never happen. */
 		__ASSERT_NO_MSG(false);
 		return;
 	}
 
+	eventq->len++;
+
+	struct item_event *hid_event = eventq_peek(eventq, eventq->len - 1);
+
 	hid_event->item.usage_id = usage_id;
 	hid_event->item.value = value;
 	hid_event->timestamp = k_uptime_get_32();
-
-	/* Add a new event to the queue. */
-	sys_slist_append(&eventq->root, &hid_event->node);
-
-	eventq->len++;
 }
 
-static void eventq_region_purge(struct eventq *eventq,
-				sys_snode_t *last_to_purge)
+static void eventq_region_purge(struct eventq *eventq, size_t cnt)
 {
-	sys_snode_t *tmp;
-	sys_snode_t *tmp_safe;
-	size_t cnt = 0;
-
-	SYS_SLIST_FOR_EACH_NODE_SAFE(&eventq->root, tmp, tmp_safe) {
-		sys_slist_remove(&eventq->root, NULL, tmp);
+	eventq_drop(eventq, cnt);
 
-		k_free(CONTAINER_OF(tmp, struct item_event, node));
-		cnt++;
-
-		if (tmp == last_to_purge) {
-			break;
-		}
-	}
-
-	eventq->len -= cnt;
-
-	LOG_WRN("%u stale events removed from the queue!", cnt);
+	LOG_WRN("%zu stale events removed from the queue!", cnt);
 }
 
 
 static void eventq_cleanup(struct eventq *eventq, uint32_t timestamp)
 {
-	/* Find timed out events. */
+	/* Find timed out events. Timestamps are increasing, so the expired
+	 * events are at the head of the queue.
+	 */
 
-	sys_snode_t *first_valid;
+	size_t first_valid;
 
-	SYS_SLIST_FOR_EACH_NODE(&eventq->root, first_valid) {
-		uint32_t diff = timestamp - CONTAINER_OF(
-			first_valid, struct item_event, node)->timestamp;
+	for (first_valid = 0; first_valid < eventq->len; first_valid++) {
+		uint32_t diff = timestamp -
+				eventq_peek(eventq, first_valid)->timestamp;
 
 		if (diff < CONFIG_DESKTOP_HID_REPORT_EXPIRATION) {
 			break;
@@ -316,17 +340,11 @@ static void eventq_cleanup(struct eventq *eventq, uint32_t timestamp)
 	 * key down.
 	 */
 
-	sys_snode_t *maxfound = sys_slist_peek_head(&eventq->root);
-	size_t maxfound_pos = 0;
+	size_t maxfound = 0;
+	size_t purge_cnt = 0;
 
-	sys_snode_t *cur;
-	size_t cur_pos = 0;
-
-	sys_snode_t *tmp_safe;
-
-	SYS_SLIST_FOR_EACH_NODE_SAFE(&eventq->root, cur, tmp_safe) {
-		const struct item cur_item =
-			CONTAINER_OF(cur, struct item_event, node)->item;
+	for (size_t cur = 0; cur < first_valid; cur++) {
+		const struct item cur_item = eventq_peek(eventq, cur)->item;
 
 		if (cur_item.value > 0) {
 			/* Every key down must be paired with key up.
@@ -335,19 +353,11 @@ static void eventq_cleanup(struct eventq *eventq, uint32_t timestamp)
 			 */
 
 			unsigned int hit_count = cur_item.value;
-			sys_snode_t *j = cur;
-			size_t j_pos = cur_pos;
-
-			SYS_SLIST_ITERATE_FROM_NODE(&eventq->root, j) {
-				j_pos++;
-				if (j == first_valid) {
-					break;
-				}
+			size_t j;
 
+			for (j = cur + 1; j < first_valid; j++) {
 				const struct item item =
-					CONTAINER_OF(j,
-						     struct item_event,
-						     node)->item;
+					eventq_peek(eventq, j)->item;
 
 				if (cur_item.usage_id == item.usage_id) {
 					hit_count += item.value;
@@ -366,28 +376,61 @@ static void eventq_cleanup(struct eventq *eventq, uint32_t timestamp)
 				break;
 			}
 
-			if (j_pos > maxfound_pos) {
+			if (j > maxfound) {
 				maxfound = j;
-				maxfound_pos = j_pos;
 			}
 		}
 
-
-		if (cur == first_valid) {
-			break;
-		}
-
 		if (cur == maxfound) {
 			/* All events up to this point have pairs and can
 			 * be deleted.
 			 */
-			eventq_region_purge(eventq, maxfound);
+			purge_cnt = cur + 1;
 		}
+	}
 
-		cur_pos++;
+	if (purge_cnt > 0) {
+		eventq_region_purge(eventq, purge_cnt);
 	}
 }
 
+static bool eventq_has_usage(struct eventq *eventq, size_t cnt,
+			     uint16_t usage_id)
+{
+	for (size_t i = 0; i < cnt; i++) {
+		if (eventq_peek(eventq, i)->item.usage_id == usage_id) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Count the events at the head of the queue that can be put in one report.
+ * A usage can change only once, as otherwise a key press could be lost.
+ * A modifier change can only start a report, so that it applies to
+ * the keys that follow it but not to the keys that were pressed before.
+ */
+static size_t eventq_batch_len(struct eventq *eventq)
+{
+	size_t cnt;
+
+	for (cnt = 1; cnt < eventq->len; cnt++) {
+		uint16_t usage_id = eventq_peek(eventq, cnt)->item.usage_id;
+
+		if ((usage_id >= KEYBOARD_REPORT_FIRST_MODIFIER) &&
+		    (usage_id <= KEYBOARD_REPORT_LAST_MODIFIER)) {
+			break;
+		}
+
+		if (eventq_has_usage(eventq, cnt, usage_id)) {
+			break;
+		}
+	}
+
+	return cnt;
+}
+
 static void sort_by_usage_id(struct item items[], size_t array_size)
 {
 	for (size_t k = 0; k < array_size; k++) {
@@ -427,6 +470,84 @@ static void clear_report_data(struct report_data *rd)
 	eventq_reset(&rd->eventq);
 
 	rd->update_needed = false;
+	rd->input_pending = false;
+}
+
+static void input_time_mark(struct report_data *rd, uint32_t timestamp)
+{
+	/* Latency is measured from the oldest input that was not sent. */
+	if (!rd->input_pending) {
+		rd->input_time = timestamp;
+		rd->input_pending = true;
+	}
+}
+
+static void report_time_push(struct report_state *rs, struct report_data *rd)
+{
+	__ASSERT_NO_MSG(rs->cnt < ARRAY_SIZE(rs->time));
+
+	size_t idx = (rs->time_head + rs->cnt) % ARRAY_SIZE(rs->time);
+	struct report_time *time = &rs->time[idx];
+
+	time->generated = k_uptime_get_32();
+	time->input = rd->input_time;
+	time->has_input = rd->input_pending;
+
+	/* Axis data that did not fit in the report keeps its input time. */
+	if (!rd->update_needed) {
+		rd->input_pending = false;
+	}
+}
+
+static void latency_stats_update(struct report_state *rs, uint32_t latency)
+{
+	struct latency_stats *stats = &rs->stats;
+
+	if ((stats->cnt == 0) || (latency < stats->min)) {
+		stats->min = latency;
+	}
+	if (latency > stats->max) {
+		stats->max = latency;
+	}
+	stats->sum += latency;
+	stats->cnt++;
+
+	if (stats->cnt >= CONFIG_DESKTOP_HID_STATE_LATENCY_STATS_INTERVAL) {
+		LOG_INF("Report 0x%x latency [ms] min %u avg %u max %u",
+			rs->report_id, stats->min, stats->sum / stats->cnt,
+			stats->max);
+		memset(stats, 0, sizeof(*stats));
+	}
+}
+
+static void report_time_pop(struct report_state *rs)
+{
+	const struct report_time *time = &rs->time[rs->time_head];
+	uint32_t now = k_uptime_get_32();
+
+	rs->time_head = (rs->time_head + 1) % ARRAY_SIZE(rs->time);
+
+	if (CONFIG_DESKTOP_HID_REPORT_PIPELINE_SLOW_TIME > 0) {
+		rs->link_slow = ((now - time->generated) >
+				 CONFIG_DESKTOP_HID_REPORT_PIPELINE_SLOW_TIME);
+	}
+
+	if (IS_ENABLED(CONFIG_DESKTOP_HID_STATE_LATENCY_STATS) &&
+	    time->has_input) {
+		latency_stats_update(rs, now - time->input);
+	}
+}
+
+static unsigned int pipeline_depth_get(const struct report_state *rs)
+{
+	if ((rs->subscriber->is_usb) ||
+	    (rs->report_id == REPORT_ID_CONSUMER_CTRL) ||
+	    (rs->report_id == REPORT_ID_SYSTEM_CTRL) ||
+	    (rs->link_slow)) {
+		return 1;
+	}
+
+	return CONFIG_DESKTOP_HID_REPORT_PIPELINE_DEPTH;
 }
 
 static struct report_state *get_report_state(struct subscriber *subscriber,
@@ -876,24 +997,30 @@ static void send_report_ctrl(uint8_t report_id, struct report_data *rd)
 	rd->update_needed = false;
 }
 
-static bool update_report(struct report_data *rd)
+static bool update_report(struct report_data *rd, bool coalesce)
 {
 	bool update_needed = false;
 
 	while (!update_needed && !eventq_is_empty(&rd->eventq)) {
 		/* There are enqueued events to handle. */
-		struct item_event *event = eventq_get(&rd->eventq);
+		size_t cnt = coalesce ? eventq_batch_len(&rd->eventq) : 1;
 
-		__ASSERT_NO_MSG(event);
+		for (size_t i = 0; i < cnt; i++) {
+			struct item_event event;
+			bool found = eventq_get(&rd->eventq, &event);
 
-		update_needed = key_value_set(&rd->items,
-					      event->item.usage_id,
-					      event->item.value);
-
-		rd->update_needed = rd->update_needed || update_needed;
+			__ASSERT_NO_MSG(found);
+			ARG_UNUSED(found);
 
+			if (key_value_set(&rd->items,
+					  event.item.usage_id,
+					  event.item.value)) {
+				input_time_mark(rd, event.timestamp);
+				update_needed = true;
+			}
+		}
 
-		k_free(event);
+		rd->update_needed = rd->update_needed || update_needed;
 
 		/* If no item was changed, try next event. */
 	}
@@ -919,19 +1046,14 @@ static bool report_send(struct report_data *rd, bool check_state, bool send_alwa
 	__ASSERT_NO_MSG(state.selected);
 
 	if (!check_state || (rs->state != STATE_DISCONNECTED)) {
-		unsigned int pipeline_depth;
-
-		if ((rs->subscriber->is_usb) ||
-		    (rs->report_id == REPORT_ID_CONSUMER_CTRL) ||
-		    (rs->report_id == REPORT_ID_SYSTEM_CTRL))  {
-			pipeline_depth = 1;
-		} else {
-			pipeline_depth = 2;
-		}
+		unsigned int pipeline_depth = pipeline_depth_get(rs);
+		bool coalesce = IS_ENABLED(CONFIG_DESKTOP_HID_REPORT_COALESCE) &&
+				(rs->report_id != REPORT_ID_CONSUMER_CTRL) &&
+				(rs->report_id != REPORT_ID_SYSTEM_CTRL);
 
 		while ((rs->cnt < pipeline_depth) &&
 		       (rs->subscriber->report_cnt < rs->subscriber->report_max) &&
-		       (update_report(rd) || send_always)) {
+		       (update_report(rd, coalesce) || send_always)) {
 
 			switch (rs->report_id) {
 			case REPORT_ID_KEYBOARD_KEYS:
@@ -961,6 +1083,9 @@ static bool report_send(struct report_data *rd, bool check_state, bool send_alwa
 				break;
 			}
 
+			TRACE_POINT(hid_report_send, rs->report_id);
+			report_time_push(rs, rd);
+
 			__ASSERT_NO_MSG(rs->cnt < UINT8_MAX);
 			rs->cnt++;
 			rs->subscriber->report_cnt++;
@@ -983,6 +1108,8 @@ static void report_issued(const void *subscriber_id, uint8_t report_id, bool err
 {
 	struct subscriber *subscriber = get_subscriber(subscriber_id);
 
+	TRACE_POINT(hid_report_issued, report_id);
+
 	if (!subscriber) {
 		LOG_WRN("No subscriber %p", subscriber_id);
 		return;
@@ -998,6 +1125,7 @@ static void report_issued(const void *subscriber_id, uint8_t report_id, bool err
 	if (rs->state != STATE_DISCONNECTED) {
 		__ASSERT_NO_MSG(rs->cnt > 0);
 		rs->cnt--;
+		report_time_pop(rs);
 
 		if (rs->cnt == 0) {
 			rs->state = STATE_CONNECTED_IDLE;
@@ -1034,7 +1162,7 @@ static void report_issued(const void *subscriber_id, uint8_t report_id, bool err
 	while (true) {
 		if ((next_rs->state != STATE_DISCONNECTED) &&
 		    (next_rs->linked_rd->linked_rs == next_rs) &&
-		    (next_rs->cnt == 0)) {
+		    (next_rs->cnt < pipeline_depth_get(next_rs))) {
 			__ASSERT_NO_MSG(state.selected == subscriber);
 			if (report_send(next_rs->linked_rd, false, false)) {
 				break;
@@ -1120,6 +1248,8 @@ static void disconnect(const void *subscriber_id, uint8_t report_id)
 	rs->subscriber = NULL;
 	rs->state = STATE_DISCONNECTED;
 	rs->cnt = 0;
+	rs->time_head = 0;
+	rs->link_slow = false;
 
 	struct report_data *rd = rs->linked_rd;
 
@@ -1143,16 +1273,12 @@ static void enqueue(struct report_data *rd, uint16_t usage_id, int16_t value,
 			 * Try to remove queued items starting from the
 			 * oldest one.
 			 */
-			sys_snode_t *i;
-
-			SYS_SLIST_FOR_EACH_NODE(&rd->eventq.root, i) {
+			for (size_t i = 0; i < rd->eventq.len; i++) {
 				/* Initial cleanup was done above. Queue will
 				 * not contain events with expired timestamp.
 				 */
 				uint32_t timestamp =
-					CONTAINER_OF(i,
-						     struct item_event,
-						     node)->timestamp +
+					eventq_peek(&rd->eventq, i)->timestamp +
 					CONFIG_DESKTOP_HID_REPORT_EXPIRATION;
 
 				eventq_cleanup(&rd->eventq, timestamp);
@@ -1160,7 +1286,7 @@ static void enqueue(struct report_data *rd, uint16_t usage_id, int16_t value,
 				if (!eventq_is_full(&rd->eventq)) {
 					/* At least one element was removed
 					 * from the queue. Do not continue
-					 * list traverse, content was modified!
+					 * queue traverse, content was modified!
 					 */
 					break;
 				}
@@ -1188,17 +1314,23 @@ static void update_key(const struct hid_keymap *map, int16_t value)
 	struct report_state *rs = rd->linked_rs;
 
 	bool connected = false;
+	bool busy = false;
 
 	if (rs) {
 		connected = (rs->state != STATE_DISCONNECTED);
+		busy = connected && (rs->cnt >= pipeline_depth_get(rs));
 	}
 
-	if (!connected || !eventq_is_empty(&rd->eventq)) {
-		/* Report cannot be sent yet - enqueue this HID event. */
+	if (!connected || busy || !eventq_is_empty(&rd->eventq)) {
+		/* Report cannot be sent yet - enqueue this HID event. A key
+		 * released before the report is sent is then still reported
+		 * as pressed.
+		 */
 		enqueue(rd, map->usage_id, value, connected);
 	} else {
 		/* Update state and issue report generation event. */
 		if (key_value_set(&rd->items, map->usage_id, value)) {
+			input_time_mark(rd, k_uptime_get_32());
 			rd->update_needed = true;
 			report_send(rd, false, true);
 		}
@@ -1295,6 +1427,7 @@ static bool handle_motion_event(const struct motion_event *event)
 	rd->axes.axis[MOUSE_REPORT_AXIS_X] += event->dx;
 	rd->axes.axis[MOUSE_REPORT_AXIS_Y] += event->dy;
 	rd->update_needed = true;
+	input_time_mark(rd, k_uptime_get_32());
 
 	report_send(rd, true, true);
 
@@ -1311,6 +1444,7 @@ static bool handle_wheel_event(const struct wheel_event *event)
 
 	rd->axes.axis[MOUSE_REPORT_AXIS_WHEEL] += event->wheel;
 	rd->update_needed = true;
+	input_time_mark(rd, k_uptime_get_32());
 
 	report_send(rd, true, true);
 
@@ -21,25 +21,54 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_LED_STREAM_LOG_LEVEL);
 #define FETCH_CONFIG_SIZE 2
 #define LED_ID_POS 7
 
+/* Frame header: LED ID and sequence number of the first step. */
+#define FRAME_HEADER_SIZE 2
+#define FRAME_STEP_SIZE (INCOMING_LED_COLOR_COUNT + 2 * sizeof(uint16_t))
+#define FRAME_DELTA_SIZE INCOMING_LED_COLOR_COUNT
+#define FRAME_PLAY_SIZE 1
+#define FRAME_DEFINE_HEADER_SIZE 3
+
 #define LED_ID(led) ((led) - &leds[0])
 
 #define STEPS_QUEUE_ARRAY_SIZE (CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE + 1)
 
+#define EFFECT_ID_NONE UINT8_MAX
+
+enum frame_tag {
+	FRAME_TAG_STEP,
+	FRAME_TAG_DELTA,
+	FRAME_TAG_PLAY,
+	FRAME_TAG_DEFINE,
+};
+
 struct led {
 	const struct led_effect *state_effect;
+	const struct led_effect *stream_effect;
 	struct led_effect led_stream_effect;
 	struct led_effect_step steps_queue[STEPS_QUEUE_ARRAY_SIZE];
+	uint8_t effect_queue[STEPS_QUEUE_ARRAY_SIZE];
+	struct led_effect_step last_step;
 	uint8_t rx_idx;
 	uint8_t tx_idx;
+	uint8_t rx_seq;
 	bool streaming;
 };
 
+struct cached_effect {
+	struct led_effect effect;
+	struct led_effect_step steps[CONFIG_DESKTOP_LED_STREAM_EFFECT_STEPS];
+	uint8_t users;
+};
+
 static struct led leds[CONFIG_DESKTOP_LED_COUNT];
+static struct cached_effect effects[CONFIG_DESKTOP_LED_STREAM_EFFECT_COUNT];
 static bool initialized;
 
 enum led_stream_opt {
 	LED_STREAM_OPT_SET_LED_EFFECT,
 	LED_STREAM_OPT_GET_LEDS_STATE,
+	LED_STREAM_OPT_SET_LED_FRAMES,
+	LED_STREAM_OPT_GET_STREAM_STATE,
 
 	LED_STREAM_OPT_COUNT,
 };
@@ -47,6 +76,8 @@ enum led_stream_opt {
 const static char * const opt_descr[] = {
 	[LED_STREAM_OPT_SET_LED_EFFECT] = "set_led_effect",
 	[LED_STREAM_OPT_GET_LEDS_STATE] = "get_leds_state",
+	[LED_STREAM_OPT_SET_LED_FRAMES] = "set_led_frames",
+	[LED_STREAM_OPT_GET_STREAM_STATE] = "get_stream_state",
 };
 
 
@@ -55,6 +86,35 @@ static size_t next_index(size_t index)
 	return (index + 1) % STEPS_QUEUE_ARRAY_SIZE;
 }
 
+static void step_parse(const uint8_t *data, struct led_effect_step *step)
+{
+	size_t pos = 0;
+
+	/* Fill only leds available in the system */
+	memcpy(step->color.c, &data[pos], CONFIG_DESKTOP_LED_COLOR_COUNT);
+	pos += INCOMING_LED_COLOR_COUNT;
+
+	step->substep_count = sys_get_le16(&data[pos]);
+	pos += sizeof(step->substep_count);
+
+	step->substep_time = sys_get_le16(&data[pos]);
+}
+
+static void queue_item(struct led *led, const struct led_effect_step *step,
+		       uint8_t effect_id)
+{
+	led->steps_queue[led->rx_idx] = *step;
+	led->effect_queue[led->rx_idx] = effect_id;
+	led->rx_idx = next_index(led->rx_idx);
+	led->rx_seq++;
+
+	if (effect_id == EFFECT_ID_NONE) {
+		led->last_step = *step;
+	} else {
+		effects[effect_id].users++;
+	}
+}
+
 static bool queue_data(const uint8_t *data, const size_t size, struct led *led)
 {
 	static const size_t min_len = CONFIG_DESKTOP_LED_COLOR_COUNT * sizeof(led->steps_queue[led->rx_idx].color.c[0])
@@ -71,24 +131,16 @@ static bool queue_data(const uint8_t *data, const size_t size, struct led *led)
 
 	LOG_DBG("Enqueue effect data");
 
-	size_t pos = 0;
+	struct led_effect_step step;
 
-	/* Fill only leds available in the system */
-	memcpy(led->steps_queue[led->rx_idx].color.c, &data[pos],
-	       CONFIG_DESKTOP_LED_COLOR_COUNT);
-	pos += INCOMING_LED_COLOR_COUNT;
-
-	led->steps_queue[led->rx_idx].substep_count = sys_get_le16(&data[pos]);
-	pos += sizeof(led->steps_queue[led->rx_idx].substep_count);
+	step_parse(data, &step);
 
-	led->steps_queue[led->rx_idx].substep_time = sys_get_le16(&data[pos]);
-
-	if (led->steps_queue[led->rx_idx].substep_count == 0) {
+	if (step.substep_count == 0) {
 		LOG_WRN("Dropped led_effect with substep count equal 0");
 		return false;
 	}
 
-	led->rx_idx = next_index(led->rx_idx);
+	queue_item(led, &step, EFFECT_ID_NONE);
 
 	return true;
 }
@@ -140,48 +192,239 @@ static bool store_data(const uint8_t *data, const size_t size, struct led *led)
 static void send_data_from_queue(struct led *led)
 {
 	if (!is_queue_empty(led)) {
-		led->led_stream_effect.steps = &led->steps_queue[led->tx_idx];
-		led->led_stream_effect.step_count = 1;
-
-		send_effect(&led->led_stream_effect, led);
+		uint8_t effect_id = led->effect_queue[led->tx_idx];
+
+		if (effect_id == EFFECT_ID_NONE) {
+			led->led_stream_effect.steps =
+				&led->steps_queue[led->tx_idx];
+			led->led_stream_effect.step_count = 1;
+			led->stream_effect = &led->led_stream_effect;
+		} else {
+			led->stream_effect = &effects[effect_id].effect;
+		}
 
-		led->tx_idx = next_index(led->tx_idx);
+		send_effect(led->stream_effect, led);
 	} else {
 		LOG_INF("No steps ready in queue, stop streaming");
 
 		led->streaming = false;
+		led->stream_effect = NULL;
 
 		send_effect(led->state_effect, led);
 	}
 }
 
-static void handle_incoming_step(const uint8_t *data, const size_t size)
+static void release_data_from_queue(struct led *led)
+{
+	/* The item is kept in the queue while it is displayed, so that it
+	 * is not overwritten by incoming data.
+	 */
+	uint8_t effect_id = led->effect_queue[led->tx_idx];
+
+	if (effect_id != EFFECT_ID_NONE) {
+		__ASSERT_NO_MSG(effects[effect_id].users > 0);
+		effects[effect_id].users--;
+	}
+
+	led->tx_idx = next_index(led->tx_idx);
+}
+
+static void start_streaming(struct led *led)
+{
+	if (!led->streaming && !is_queue_empty(led)) {
+		LOG_DBG("Sending first led effect for led %zu",
+			(size_t)LED_ID(led));
+
+		led->streaming = true;
+
+		send_data_from_queue(led);
+	}
+}
+
+static struct led *get_led(const uint8_t *data, size_t led_id_pos)
 {
 	if (!initialized) {
 		LOG_WRN("Not initialized");
-		return;
+		return NULL;
 	}
 
-	size_t led_id = data[LED_ID_POS];
+	size_t led_id = data[led_id_pos];
 
 	if (led_id >= ARRAY_SIZE(leds)) {
 		LOG_WRN("Wrong LED ID: %zu, effect ignored", led_id);
+		return NULL;
+	}
+
+	return &leds[led_id];
+}
+
+static void handle_incoming_step(const uint8_t *data, const size_t size)
+{
+	if (size <= LED_ID_POS) {
+		LOG_WRN("Invalid stream data size (%zu)", size);
 		return;
 	}
 
-	struct led *led = &leds[led_id];
+	struct led *led = get_led(data, LED_ID_POS);
 
-	if (!store_data(data, size, led)) {
+	if (!led || !store_data(data, size, led)) {
 		return;
 	}
 
-	if (!led->streaming) {
-		LOG_DBG("Sending first led effect for led %zu", led_id);
+	start_streaming(led);
+}
 
-		led->streaming = true;
+/* Returns the size of the definition, or 0 if it is invalid. */
+static size_t define_effect(const uint8_t *data, size_t size)
+{
+	if (size < FRAME_DEFINE_HEADER_SIZE) {
+		return 0;
+	}
 
-		send_data_from_queue(led);
+	uint8_t effect_id = data[0];
+	uint8_t first = data[1];
+	uint8_t cnt = data[2];
+	size_t len = FRAME_DEFINE_HEADER_SIZE + cnt * FRAME_STEP_SIZE;
+
+	if ((len > size) || (cnt == 0) || (effect_id >= ARRAY_SIZE(effects)) ||
+	    (first + cnt > CONFIG_DESKTOP_LED_STREAM_EFFECT_STEPS) ||
+	    (first > effects[effect_id].effect.step_count)) {
+		LOG_WRN("Invalid effect definition");
+		return 0;
 	}
+
+	struct cached_effect *cached = &effects[effect_id];
+
+	if (cached->users > 0) {
+		/* A repeated definition of an effect that is displayed. */
+		LOG_WRN("Effect %" PRIu8 " is in use", effect_id);
+		return len;
+	}
+
+	const uint8_t *step_data = &data[FRAME_DEFINE_HEADER_SIZE];
+
+	for (size_t i = 0; i < cnt; i++) {
+		step_parse(&step_data[i * FRAME_STEP_SIZE],
+			   &cached->steps[first + i]);
+
+		if (cached->steps[first + i].substep_count == 0) {
+			LOG_WRN("Effect step with substep count equal 0");
+			cached->effect.step_count = first;
+			return 0;
+		}
+	}
+
+	cached->effect.steps = cached->steps;
+	cached->effect.step_count = first + cnt;
+	cached->effect.loop_forever = false;
+
+	return len;
+}
+
+static void handle_incoming_frames(const uint8_t *data, const size_t size)
+{
+	if (size < FRAME_HEADER_SIZE) {
+		LOG_WRN("Invalid frame size (%zu)", size);
+		return;
+	}
+
+	struct led *led = get_led(data, 0);
+
+	if (!led) {
+		return;
+	}
+
+	/* Steps that were already received are skipped, so the host can
+	 * send the frames again from the last acknowledged step.
+	 */
+	uint8_t skip = led->rx_seq - data[1];
+
+	if (skip > size - FRAME_HEADER_SIZE) {
+		LOG_WRN("Unexpected sequence number %" PRIu8 ", expected %"
+			PRIu8, data[1], led->rx_seq);
+		return;
+	}
+
+	size_t pos = FRAME_HEADER_SIZE;
+
+	while (pos < size) {
+		uint8_t tag = data[pos++];
+		size_t left = size - pos;
+		struct led_effect_step step = led->last_step;
+		uint8_t effect_id = EFFECT_ID_NONE;
+		size_t len;
+
+		switch (tag) {
+		case FRAME_TAG_STEP:
+			len = FRAME_STEP_SIZE;
+			if (left >= len) {
+				step_parse(&data[pos], &step);
+			}
+			break;
+
+		case FRAME_TAG_DELTA:
+			len = FRAME_DELTA_SIZE;
+			if (left >= len) {
+				/* Colors wrap around, so every change fits. */
+				for (size_t i = 0;
+				     i < CONFIG_DESKTOP_LED_COLOR_COUNT; i++) {
+					step.color.c[i] += data[pos + i];
+				}
+			}
+			break;
+
+		case FRAME_TAG_PLAY:
+			len = FRAME_PLAY_SIZE;
+			if (left >= len) {
+				effect_id = data[pos];
+			}
+			break;
+
+		case FRAME_TAG_DEFINE:
+			len = define_effect(&data[pos], left);
+			if (len == 0) {
+				return;
+			}
+			pos += len;
+			continue;
+
+		default:
+			len = SIZE_MAX;
+			break;
+		}
+
+		if (len > left) {
+			LOG_WRN("Invalid frame");
+			break;
+		}
+
+		pos += len;
+
+		if (skip > 0) {
+			skip--;
+			continue;
+		}
+
+		if (effect_id == EFFECT_ID_NONE) {
+			if (step.substep_count == 0) {
+				LOG_WRN("Dropped step with substep count 0");
+				break;
+			}
+		} else if ((effect_id >= ARRAY_SIZE(effects)) ||
+			   (effects[effect_id].effect.step_count == 0)) {
+			LOG_WRN("Effect %" PRIu8 " is not defined", effect_id);
+			break;
+		}
+
+		if (count_free_places(led) == 0) {
+			LOG_DBG("Queue is full - drop incoming steps");
+			break;
+		}
+
+		queue_item(led, &step, effect_id);
+	}
+
+	start_streaming(led);
 }
 
 static void config_set(const uint8_t opt_id, const uint8_t *data, const size_t size)
@@ -191,6 +434,10 @@ static void config_set(const uint8_t opt_id, const uint8_t *data, const size_t s
 		handle_incoming_step(data, size);
 		break;
 
+	case LED_STREAM_OPT_SET_LED_FRAMES:
+		handle_incoming_frames(data, size);
+		break;
+
 	default:
 		LOG_WRN("Unknown config set: %" PRIu8, opt_id);
 		break;
@@ -222,6 +469,25 @@ static void fetch_leds_state(uint8_t *data, size_t *size)
 	*size = pos;
 }
 
+static void fetch_stream_state(uint8_t *data, size_t *size)
+{
+	BUILD_ASSERT(sizeof(initialized) + ARRAY_SIZE(leds) * 2 <=
+		     CONFIG_CHANNEL_FETCHED_DATA_MAX_SIZE);
+
+	size_t pos = 0;
+
+	data[pos] = initialized;
+	pos += sizeof(initialized);
+
+	for (size_t i = 0; i < ARRAY_SIZE(leds); i++) {
+		/* Sequence number of the next step and free places. */
+		data[pos++] = leds[i].rx_seq;
+		data[pos++] = count_free_places(&leds[i]);
+	}
+
+	*size = pos;
+}
+
 static void config_get(const uint8_t opt_id, uint8_t *data, size_t *size)
 {
 	switch (opt_id) {
@@ -229,6 +495,10 @@ static void config_get(const uint8_t opt_id, uint8_t *data, size_t *size)
 		fetch_leds_state(data, size);
 		break;
 
+	case LED_STREAM_OPT_GET_STREAM_STATE:
+		fetch_stream_state(data, size);
+		break;
+
 	default:
 		LOG_WRN("Unknown config get: %" PRIu8, opt_id);
 		break;
@@ -245,7 +515,7 @@ static bool event_handler(const struct event_header *eh)
 
 		struct led *led = &leds[event->led_id];
 
-		if (event->led_effect != &led->led_stream_effect) {
+		if (event->led_effect != led->stream_effect) {
 			__ASSERT_NO_MSG(event->led_effect);
 
 			led->state_effect = event->led_effect;
@@ -262,7 +532,9 @@ static bool event_handler(const struct event_header *eh)
 
 		struct led *led = &leds[event->led_id];
 
-		if (event->led_effect == &led->led_stream_effect) {
+		if (led->streaming &&
+		    (event->led_effect == led->stream_effect)) {
+			release_data_from_queue(led);
 			send_data_from_queue(led);
 		}
 
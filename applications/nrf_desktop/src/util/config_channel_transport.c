@@ -13,6 +13,24 @@
 #define MODULE config_channel_transport
 #define TRANSPORT_HEADER_SIZE		4
 #define CONFIG_STATUS_POS		2
+#define DATA_LEN_POS			3
+
+/* Windowed frames carry the sequence number right after the header. */
+#define SEQ_POS				TRANSPORT_HEADER_SIZE
+#define WINDOWED_HEADER_SIZE		(TRANSPORT_HEADER_SIZE + 1)
+
+/* Flags sent in the data length field of windowed frames. */
+#define FRAME_WINDOWED			BIT(7)
+#define FRAME_MORE			BIT(6)
+#define FRAME_DATA_LEN_MASK		BIT_MASK(5)
+
+#define WINDOW_SIZE			CONFIG_DESKTOP_CONFIG_CHANNEL_WINDOW
+#define PAYLOAD_MAX			CONFIG_DESKTOP_CONFIG_CHANNEL_PAYLOAD_MAX
+#define TIMEOUT_MS	(CONFIG_DESKTOP_CONFIG_CHANNEL_TIMEOUT * MSEC_PER_SEC)
+
+BUILD_ASSERT(REPORT_SIZE_USER_CONFIG - TRANSPORT_HEADER_SIZE <=
+	     FRAME_DATA_LEN_MASK);
+BUILD_ASSERT(WINDOW_SIZE <= UINT8_MAX / 2);
 
 #include <logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_CONFIG_CHANNEL_LOG_LEVEL);
@@ -143,15 +161,201 @@ int config_channel_report_fill(uint8_t *buffer, const size_t length,
 	return pos;
 }
 
+static struct config_channel_transaction *trans_get(
+		struct config_channel_transport *transport, size_t idx)
+{
+	__ASSERT_NO_MSG(idx < WINDOW_SIZE);
+
+	return &transport->trans[(transport->trans_head + idx) % WINDOW_SIZE];
+}
+
+static struct config_channel_transaction *trans_find(
+		struct config_channel_transport *transport, uint16_t id)
+{
+	for (size_t i = 0; i < transport->trans_cnt; i++) {
+		struct config_channel_transaction *trans =
+			trans_get(transport, i);
+
+		if ((trans->id == id) &&
+		    (trans->state == CONFIG_CHANNEL_TRANSPORT_WAIT_RSP)) {
+			return trans;
+		}
+	}
+
+	return NULL;
+}
+
+static struct config_channel_transaction *trans_alloc(
+		struct config_channel_transport *transport, bool windowed,
+		uint8_t seq)
+{
+	__ASSERT_NO_MSG(transport->trans_cnt < WINDOW_SIZE);
+
+	struct config_channel_transaction *trans =
+		trans_get(transport, transport->trans_cnt);
+
+	transport->trans_cnt++;
+
+	/* Low byte of transport ID identifies the transaction. Responses for
+	 * dropped transactions do not match any transaction in the window.
+	 */
+	trans->id = transport->transport_id;
+	transport->transport_id = (transport->transport_id & ~0xFF) |
+				  ((transport->transport_id + 1) & 0xFF);
+
+	trans->windowed = windowed;
+	trans->seq = seq;
+	trans->state = CONFIG_CHANNEL_TRANSPORT_WAIT_RSP;
+	trans->deadline = k_uptime_get() + TIMEOUT_MS;
+
+	return trans;
+}
+
+static void trans_release(struct config_channel_transport *transport)
+{
+	__ASSERT_NO_MSG(transport->trans_cnt > 0);
+
+	transport->trans_head = (transport->trans_head + 1) % WINDOW_SIZE;
+	transport->trans_cnt--;
+}
+
+static void trans_pending_fill(struct config_channel_transaction *trans,
+			       uint8_t recipient, uint8_t event_id)
+{
+	fill_response_pending(trans->data);
+	trans->data_len = TRANSPORT_HEADER_SIZE;
+
+	if (trans->windowed) {
+		trans->data[0] = recipient;
+		trans->data[1] = event_id;
+		trans->data[DATA_LEN_POS] = FRAME_WINDOWED;
+		trans->data[SEQ_POS] = trans->seq;
+		trans->data_len = WINDOWED_HEADER_SIZE;
+	}
+}
+
+static void trans_status_set(struct config_channel_transaction *trans,
+			     enum config_status status)
+{
+	/* Send response without additional data. */
+	trans->data[CONFIG_STATUS_POS] = status;
+	trans->state = CONFIG_CHANNEL_TRANSPORT_RSP_READY;
+}
+
+static void trans_rsp_fill(struct config_channel_transaction *trans,
+			   const struct config_event *event)
+{
+	if (!trans->windowed) {
+		int pos = config_channel_report_fill(trans->data,
+				event->dyndata.size + TRANSPORT_HEADER_SIZE,
+				event);
+
+		__ASSERT_NO_MSG(pos > 0);
+		trans->data_len = pos;
+	} else {
+		size_t data_len = event->dyndata.size;
+
+		__ASSERT_NO_MSG(data_len <=
+				REPORT_SIZE_USER_CONFIG - WINDOWED_HEADER_SIZE);
+
+		trans->data[0] = event->recipient;
+		trans->data[1] = event->event_id;
+		trans->data[CONFIG_STATUS_POS] = event->status;
+		trans->data[DATA_LEN_POS] = FRAME_WINDOWED | data_len;
+		trans->data[SEQ_POS] = trans->seq;
+		memcpy(&trans->data[WINDOWED_HEADER_SIZE], event->dyndata.data,
+		       data_len);
+		trans->data_len = WINDOWED_HEADER_SIZE + data_len;
+	}
+
+	trans->state = CONFIG_CHANNEL_TRANSPORT_RSP_READY;
+}
+
+static void trans_window_info_fill(struct config_channel_transaction *trans)
+{
+	uint8_t *data = &trans->data[WINDOWED_HEADER_SIZE];
+	size_t pos = 0;
+
+	data[pos] = WINDOW_SIZE;
+	pos += sizeof(uint8_t);
+
+	sys_put_le16(PAYLOAD_MAX, &data[pos]);
+	pos += sizeof(uint16_t);
+
+	trans->data[DATA_LEN_POS] = FRAME_WINDOWED | pos;
+	trans->data_len = WINDOWED_HEADER_SIZE + pos;
+	trans_status_set(trans, CONFIG_STATUS_SUCCESS);
+}
+
+static void timeout_update(struct config_channel_transport *transport)
+{
+	/* The work is scheduled for the transaction that times out first, so
+	 * new requests do not delay the timeout of a stuck transaction.
+	 */
+	struct config_channel_transaction *first = NULL;
+
+	for (size_t i = 0; i < transport->trans_cnt; i++) {
+		struct config_channel_transaction *trans =
+			trans_get(transport, i);
+
+		if ((trans->state == CONFIG_CHANNEL_TRANSPORT_WAIT_RSP) &&
+		    (!first || (trans->deadline < first->deadline))) {
+			first = trans;
+		}
+	}
+
+	if (!first) {
+		k_delayed_work_cancel(&transport->timeout);
+		return;
+	}
+
+	int64_t left = first->deadline - k_uptime_get();
+
+	k_delayed_work_submit(&transport->timeout, K_MSEC(MAX(left, 0)));
+}
+
+static void rx_drop(struct config_channel_transport *transport)
+{
+	if (transport->rx_event) {
+		k_free(transport->rx_event);
+		transport->rx_event = NULL;
+	}
+}
+
 static void drop_transactions(struct config_channel_transport *transport)
 {
-	/* Transport ID is changed, responses for submitted requests will
-	 * be dropped.
+	/* Transactions are removed from the window, responses for submitted
+	 * requests will be dropped.
 	 */
-	if ((transport->transport_id & 0xFF) == 0xFF) {
-		transport->transport_id &= ~0xFF;
+	transport->trans_cnt = 0;
+	rx_drop(transport);
+	k_delayed_work_cancel(&transport->timeout);
+}
+
+static void mode_set(struct config_channel_transport *transport, bool windowed)
+{
+	if (transport->windowed == windowed) {
+		return;
+	}
+
+	if (transport->trans_cnt > 0) {
+		LOG_WRN("Host changed framing, transactions dropped "
+			"(transport: %p)", transport);
+		drop_transactions(transport);
 	}
-	transport->transport_id++;
+
+	transport->windowed = windowed;
+}
+
+static void request_submit(struct config_channel_transport *transport,
+			   struct config_channel_transaction *trans,
+			   struct config_event *event)
+{
+	event->transport_id = trans->id;
+	event->is_request = true;
+	EVENT_SUBMIT(event);
+
+	timeout_update(transport);
 }
 
 static void timeout_fn(struct k_work *work)
@@ -160,12 +364,28 @@ static void timeout_fn(struct k_work *work)
 					struct config_channel_transport,
 					timeout);
 
-	__ASSERT_NO_MSG(transport->state == CONFIG_CHANNEL_TRANSPORT_WAIT_RSP);
+	int64_t now = k_uptime_get();
 
-	/* Send response with timeout status, without aditional data. */
-	transport->data[CONFIG_STATUS_POS] = CONFIG_STATUS_TIMEOUT;
-	drop_transactions(transport);
-	transport->state = CONFIG_CHANNEL_TRANSPORT_RSP_READY;
+	for (size_t i = 0; i < transport->trans_cnt; i++) {
+		struct config_channel_transaction *trans =
+			trans_get(transport, i);
+
+		if ((trans->state != CONFIG_CHANNEL_TRANSPORT_WAIT_RSP) ||
+		    (trans->deadline > now)) {
+			continue;
+		}
+
+		trans_status_set(trans, CONFIG_STATUS_TIMEOUT);
+
+		/* Request that is not complete is received by the last
+		 * transaction.
+		 */
+		if (i == transport->trans_cnt - 1) {
+			rx_drop(transport);
+		}
+	}
+
+	timeout_update(transport);
 }
 
 void config_channel_transport_init(struct config_channel_transport *transport)
@@ -186,32 +406,47 @@ int config_channel_transport_get(struct config_channel_transport *transport,
 {
 	__ASSERT_NO_MSG(transport->state != CONFIG_CHANNEL_TRANSPORT_DISABLED);
 
+	/* Responses are provided in the order of requests. Last provided
+	 * frame is repeated if there is no transaction in the window.
+	 */
+	if (transport->trans_cnt > 0) {
+		struct config_channel_transaction *trans =
+			trans_get(transport, 0);
+
+		memcpy(transport->data, trans->data, trans->data_len);
+		transport->data_len = trans->data_len;
+
+		if (trans->state == CONFIG_CHANNEL_TRANSPORT_RSP_READY) {
+			trans_release(transport);
+		}
+	}
+
 	if (length < transport->data_len) {
 		LOG_ERR("Host fetched incomplete data");
 	}
 
 	memcpy(buffer, transport->data, length);
 
-	if (transport->state == CONFIG_CHANNEL_TRANSPORT_RSP_READY) {
-		transport->state = CONFIG_CHANNEL_TRANSPORT_IDLE;
-	}
-
 	return 0;
 }
 
-int config_channel_transport_set(struct config_channel_transport *transport,
-				 const uint8_t *buffer, size_t length)
+static int legacy_set(struct config_channel_transport *transport,
+		      const uint8_t *buffer, size_t length)
 {
-	__ASSERT_NO_MSG(transport->state != CONFIG_CHANNEL_TRANSPORT_DISABLED);
+	mode_set(transport, false);
 
-	if (transport->state == CONFIG_CHANNEL_TRANSPORT_WAIT_RSP) {
-		LOG_WRN("Transport %p busy", transport);
-		return -EBUSY;
-	}
+	if (transport->trans_cnt > 0) {
+		struct config_channel_transaction *trans =
+			trans_get(transport, 0);
+
+		if (trans->state == CONFIG_CHANNEL_TRANSPORT_WAIT_RSP) {
+			LOG_WRN("Transport %p busy", transport);
+			return -EBUSY;
+		}
 
-	if (transport->state == CONFIG_CHANNEL_TRANSPORT_RSP_READY) {
 		LOG_WRN("Host ignored previous response (transport: %p)",
 			transport);
+		trans_release(transport);
 	}
 
 	struct config_event *event =
@@ -225,26 +460,140 @@ int config_channel_transport_set(struct config_channel_transport *transport,
 		return -EINVAL;
 	}
 
-	event->transport_id = transport->transport_id;
-	event->is_request = true;
-	EVENT_SUBMIT(event);
-
-	k_delayed_work_submit(&transport->timeout,
-			      K_SECONDS(CONFIG_DESKTOP_CONFIG_CHANNEL_TIMEOUT));
+	struct config_channel_transaction *trans =
+		trans_alloc(transport, false, 0);
 
 	/* Store the data to send it as pending response. */
-	fill_response_pending(transport->data);
-	transport->data_len = TRANSPORT_HEADER_SIZE;
-	transport->state = CONFIG_CHANNEL_TRANSPORT_WAIT_RSP;
+	trans_pending_fill(trans, event->recipient, event->event_id);
+	request_submit(transport, trans, event);
 
 	return 0;
 }
 
+static int rx_continue(struct config_channel_transport *transport,
+		       const uint8_t *buffer, const uint8_t *data,
+		       size_t data_len)
+{
+	struct config_event *event = transport->rx_event;
+	struct config_channel_transaction *trans =
+		trans_get(transport, transport->trans_cnt - 1);
+
+	if ((buffer[0] != event->recipient) ||
+	    (buffer[1] != event->event_id) ||
+	    (buffer[CONFIG_STATUS_POS] != event->status) ||
+	    (buffer[SEQ_POS] != trans->seq)) {
+		LOG_WRN("Frame does not match the request");
+		rx_drop(transport);
+		trans_status_set(trans, CONFIG_STATUS_REJECT);
+		timeout_update(transport);
+		return -EINVAL;
+	}
+
+	if (data_len > PAYLOAD_MAX - transport->rx_len) {
+		LOG_WRN("Request data too long");
+		rx_drop(transport);
+		trans_status_set(trans, CONFIG_STATUS_REJECT);
+		timeout_update(transport);
+		return -EMSGSIZE;
+	}
+
+	memcpy(&event->dyndata.data[transport->rx_len], data, data_len);
+	transport->rx_len += data_len;
+
+	if (!(buffer[DATA_LEN_POS] & FRAME_MORE)) {
+		event->dyndata.size = transport->rx_len;
+		transport->rx_event = NULL;
+		request_submit(transport, trans, event);
+	}
+
+	return 0;
+}
+
+static int windowed_set(struct config_channel_transport *transport,
+			const uint8_t *buffer, size_t length)
+{
+	int err = frame_length_check(length);
+
+	if (err || (length < WINDOWED_HEADER_SIZE)) {
+		LOG_WRN("Received improper frame");
+		return -EINVAL;
+	}
+
+	size_t data_len = buffer[DATA_LEN_POS] & FRAME_DATA_LEN_MASK;
+	const uint8_t *data = &buffer[WINDOWED_HEADER_SIZE];
+
+	if (length - WINDOWED_HEADER_SIZE < data_len) {
+		LOG_WRN("Received improper frame");
+		return -EINVAL;
+	}
+
+	mode_set(transport, true);
+
+	if (transport->rx_event) {
+		return rx_continue(transport, buffer, data, data_len);
+	}
+
+	if (transport->trans_cnt == WINDOW_SIZE) {
+		LOG_WRN("Transport %p window full", transport);
+		return -EBUSY;
+	}
+
+	uint8_t recipient = buffer[0];
+	uint8_t event_id = buffer[1];
+	uint8_t status = buffer[CONFIG_STATUS_POS];
+	struct config_channel_transaction *trans =
+		trans_alloc(transport, true, buffer[SEQ_POS]);
+
+	trans_pending_fill(trans, recipient, event_id);
+
+	if ((status == CONFIG_STATUS_GET_WINDOW) &&
+	    (recipient == CFG_CHAN_RECIPIENT_LOCAL)) {
+		trans_window_info_fill(trans);
+		return 0;
+	}
+
+	bool more = (buffer[DATA_LEN_POS] & FRAME_MORE);
+	struct config_event *event =
+		new_config_event(more ? PAYLOAD_MAX : data_len);
+
+	event->recipient = recipient;
+	event->event_id = event_id;
+	event->status = status;
+	memcpy(event->dyndata.data, data, data_len);
+
+	if (more) {
+		/* Request is submitted when the last frame is received. */
+		transport->rx_event = event;
+		transport->rx_len = data_len;
+		timeout_update(transport);
+	} else {
+		request_submit(transport, trans, event);
+	}
+
+	return 0;
+}
+
+int config_channel_transport_set(struct config_channel_transport *transport,
+				 const uint8_t *buffer, size_t length)
+{
+	__ASSERT_NO_MSG(transport->state != CONFIG_CHANNEL_TRANSPORT_DISABLED);
+
+	if ((length > DATA_LEN_POS) &&
+	    (buffer[DATA_LEN_POS] & FRAME_WINDOWED)) {
+		return windowed_set(transport, buffer, length);
+	}
+
+	return legacy_set(transport, buffer, length);
+}
+
 bool config_channel_transport_rsp_receive(struct config_channel_transport *transport,
 					  struct config_event *event)
 {
+	struct config_channel_transaction *trans =
+		trans_find(transport, event->transport_id);
+
 	/* It's not us. */
-	if (event->transport_id != transport->transport_id) {
+	if (!trans) {
 		return false;
 	}
 
@@ -254,15 +603,9 @@ bool config_channel_transport_rsp_receive(struct config_channel_transport *trans
 		event->dyndata.size = 0;
 	}
 
-	int pos = config_channel_report_fill(transport->data,
-				event->dyndata.size + TRANSPORT_HEADER_SIZE,
-				event);
+	trans_rsp_fill(trans, event);
+	timeout_update(transport);
 
-	__ASSERT_NO_MSG(pos > 0);
-	ARG_UNUSED(pos);
-
-	transport->state = CONFIG_CHANNEL_TRANSPORT_RSP_READY;
-	k_delayed_work_cancel(&transport->timeout);
 	return true;
 }
 
@@ -271,9 +614,6 @@ void config_channel_transport_disconnect(struct config_channel_transport *transp
 	__ASSERT_NO_MSG(transport->state != CONFIG_CHANNEL_TRANSPORT_DISABLED);
 
 	/* Make sure that responses for ongoing transactions will be dropped. */
-	if (transport->state == CONFIG_CHANNEL_TRANSPORT_WAIT_RSP) {
-		drop_transactions(transport);
-	}
+	drop_transactions(transport);
 	transport->state = CONFIG_CHANNEL_TRANSPORT_IDLE;
-	k_delayed_work_cancel(&transport->timeout);
 }
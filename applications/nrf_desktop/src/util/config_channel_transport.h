@@ -51,6 +51,18 @@ enum config_channel_transport_state {
 	CONFIG_CHANNEL_TRANSPORT_RSP_READY
 };
 
+/** @brief Transaction in flight on the configuration channel transport. */
+struct config_channel_transaction {
+	uint16_t id;
+	uint8_t seq;
+	bool windowed;
+	uint8_t data_len;
+	uint8_t data[REPORT_SIZE_USER_CONFIG];
+	int64_t deadline;
+
+	enum config_channel_transport_state state;
+};
+
 /** @brief Configuration channel transport. */
 struct config_channel_transport {
 	struct k_delayed_work timeout;
@@ -58,6 +70,16 @@ struct config_channel_transport {
 	uint16_t transport_id;
 	uint8_t data[REPORT_SIZE_USER_CONFIG];
 
+	/* Transactions in the order of requests. */
+	struct config_channel_transaction trans[CONFIG_DESKTOP_CONFIG_CHANNEL_WINDOW];
+	uint8_t trans_head;
+	uint8_t trans_cnt;
+	bool windowed;
+
+	/* Request received in multiple frames. */
+	struct config_event *rx_event;
+	size_t rx_len;
+
 	enum config_channel_transport_state state;
 };
 
@@ -70,6 +92,10 @@ void config_channel_transport_init(struct config_channel_transport *transport);
 /**
  * @brief Handle a get operation on the configuration channel.
  *
+ * Responses are provided in the order of requests. The response for
+ * the oldest transaction in flight is removed from the window once it is
+ * provided to the host.
+ *
  * @param transport Pointer to the configuration channel transport instance.
  * @param buffer    Pointer to the buffer to be filled when handling the get
  *                  request.
@@ -84,13 +110,17 @@ int config_channel_transport_get(struct config_channel_transport *transport,
 /**
  * @brief Handle a set operation on the configuration channel.
  *
+ * A windowed request is accepted while there is space in the window of
+ * transactions in flight. A request that is not windowed is accepted only
+ * when no response is awaited.
+ *
  * @param transport Pointer to the configuration channel transport instance.
  * @param buffer    Pointer to the report buffer to be parsed to handle
  *                  the set request.
  * @param length    Length of the incoming data.
  *
- * @return 0 if the operation was successful. Otherwise, a (negative) error
- *	     code is returned.
+ * @return 0 if the operation was successful, -EBUSY if the request cannot
+ *	     be accepted now. Otherwise, a (negative) error code is returned.
  */
 int config_channel_transport_set(struct config_channel_transport *transport,
 				 const uint8_t *buffer, size_t length);
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+
+#include "enqueued_reports.h"
+
+
+void enqueued_reports_init(struct enqueued_reports *enqueued_reports,
+			   struct hid_report_event **report_buf,
+			   size_t queue_size)
+{
+	for (size_t irep_idx = 0; irep_idx < ARRAY_SIZE(enqueued_reports->reports); irep_idx++) {
+		report_queue_init(&enqueued_reports->reports[irep_idx],
+				  &report_buf[irep_idx * queue_size],
+				  queue_size);
+	}
+
+	enqueued_reports->last_idx = 0;
+}
+
+bool enqueued_reports_put(struct enqueued_reports *enqueued_reports,
+			  size_t irep_idx, struct hid_report_event *report)
+{
+	__ASSERT_NO_MSG(irep_idx < ARRAY_SIZE(enqueued_reports->reports));
+
+	struct report_queue *reports = &enqueued_reports->reports[irep_idx];
+	struct hid_report_event *dropped = report_queue_put(reports, report);
+
+	if (dropped) {
+		k_free(dropped);
+		return true;
+	}
+
+	return false;
+}
+
+struct hid_report_event *enqueued_reports_get_next(struct enqueued_reports *enqueued_reports)
+{
+	struct hid_report_event *report = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(enqueued_reports->reports); i++) {
+		size_t irep_idx = (enqueued_reports->last_idx + i + 1) %
+				  ARRAY_SIZE(enqueued_reports->reports);
+
+		report = report_queue_get(&enqueued_reports->reports[irep_idx]);
+
+		if (report) {
+			enqueued_reports->last_idx = irep_idx;
+			break;
+		}
+	}
+
+	return report;
+}
+
+void enqueued_reports_drop(struct enqueued_reports *enqueued_reports,
+			   size_t irep_idx)
+{
+	__ASSERT_NO_MSG(irep_idx < ARRAY_SIZE(enqueued_reports->reports));
+
+	struct report_queue *reports = &enqueued_reports->reports[irep_idx];
+	struct hid_report_event *report;
+
+	while ((report = report_queue_get(reports)) != NULL) {
+		k_free(report);
+	}
+}
+
+void enqueued_reports_migrate(struct enqueued_reports *dst,
+			      struct enqueued_reports *src, size_t max_cnt)
+{
+	for (size_t irep_idx = 0; irep_idx < ARRAY_SIZE(dst->reports); irep_idx++) {
+		report_queue_move(&dst->reports[irep_idx],
+				  &src->reports[irep_idx],
+				  max_cnt);
+	}
+}
+
+bool enqueued_reports_is_any(const struct enqueued_reports *enqueued_reports)
+{
+	for (size_t irep_idx = 0; irep_idx < ARRAY_SIZE(enqueued_reports->reports); irep_idx++) {
+		if (enqueued_reports_is_enqueued(enqueued_reports, irep_idx)) {
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _ENQUEUED_REPORTS_H_
+#define _ENQUEUED_REPORTS_H_
+
+/**
+ * @file
+ * @defgroup enqueued_reports Enqueued HID reports
+ * @{
+ * @brief HID report queues of a peripheral or a subscriber.
+ *
+ * There is one queue for every input report. Reports are taken from the
+ * queues in the round-robin fashion.
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "hid_report_desc.h"
+#include "report_queue.h"
+
+/** @brief Enqueued HID reports. */
+struct enqueued_reports {
+	struct report_queue reports[ARRAY_SIZE(input_reports)];
+	uint8_t last_idx;
+};
+
+/**
+ * @brief Initialize the queues.
+ *
+ * @param enqueued_reports Pointer to the enqueued reports.
+ * @param report_buf       Array of event pointers, split between the queues.
+ * @param queue_size       Number of reports in every queue.
+ */
+void enqueued_reports_init(struct enqueued_reports *enqueued_reports,
+			   struct hid_report_event **report_buf,
+			   size_t queue_size);
+
+/**
+ * @brief Add a report to the queue of its input report.
+ *
+ * If the queue is full, the oldest report is dropped and freed.
+ *
+ * @param enqueued_reports Pointer to the enqueued reports.
+ * @param irep_idx         Index of the input report.
+ * @param report           Report to be added.
+ *
+ * @return True if the oldest report was dropped.
+ */
+bool enqueued_reports_put(struct enqueued_reports *enqueued_reports,
+			  size_t irep_idx, struct hid_report_event *report);
+
+/**
+ * @brief Remove the oldest report of the next input report that has one.
+ *
+ * @param enqueued_reports Pointer to the enqueued reports.
+ *
+ * @return Removed report, or NULL if all the queues are empty.
+ */
+struct hid_report_event *enqueued_reports_get_next(struct enqueued_reports *enqueued_reports);
+
+/**
+ * @brief Drop and free all reports of an input report.
+ *
+ * @param enqueued_reports Pointer to the enqueued reports.
+ * @param irep_idx         Index of the input report.
+ */
+void enqueued_reports_drop(struct enqueued_reports *enqueued_reports,
+			   size_t irep_idx);
+
+/**
+ * @brief Move the newest reports of every input report to other queues.
+ *
+ * @param dst     Pointer to the destination reports.
+ * @param src     Pointer to the source reports.
+ * @param max_cnt Maximum number of reports moved for an input report.
+ */
+void enqueued_reports_migrate(struct enqueued_reports *dst,
+			      struct enqueued_reports *src, size_t max_cnt);
+
+/**
+ * @brief Check if a report of an input report is enqueued.
+ *
+ * @param enqueued_reports Pointer to the enqueued reports.
+ * @param irep_idx         Index of the input report.
+ *
+ * @return True if the queue of the input report is not empty.
+ */
+static inline bool enqueued_reports_is_enqueued(const struct enqueued_reports *enqueued_reports,
+						size_t irep_idx)
+{
+	return !report_queue_is_empty(&enqueued_reports->reports[irep_idx]);
+}
+
+/**
+ * @brief Check if any report is enqueued.
+ *
+ * @param enqueued_reports Pointer to the enqueued reports.
+ *
+ * @return True if any of the queues is not empty.
+ */
+bool enqueued_reports_is_any(const struct enqueued_reports *enqueued_reports);
+
+/**
+ * @}
+ */
+
+#endif /* _ENQUEUED_REPORTS_H_ */
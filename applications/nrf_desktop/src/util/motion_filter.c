@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <stdlib.h>
+
+#include "motion_filter.h"
+
+#define GAIN_UNITY	100
+
+/* One degree in radians, Q10. */
+#define DEG_Q10		18
+
+#define Q10_ONE		BIT(10)
+
+
+static bool lift_process(struct motion_filter *filter,
+			 struct motion_filter_sample *sample)
+{
+	struct motion_filter_lift *lift =
+		CONTAINER_OF(filter, struct motion_filter_lift, filter);
+
+	return (sample->squal == MOTION_FILTER_SQUAL_UNKNOWN) ||
+	       (sample->squal >= lift->min_squal);
+}
+
+void motion_filter_lift_init(struct motion_filter_lift *lift,
+			     uint16_t min_squal)
+{
+	lift->filter.process = lift_process;
+	lift->min_squal = min_squal;
+}
+
+/* Length of the motion vector approximated as max + 3/8 min, which is
+ * within 7% and does not need a square root.
+ */
+static uint32_t motion_len(const struct motion_filter_sample *sample)
+{
+	uint32_t x = abs(sample->dx);
+	uint32_t y = abs(sample->dy);
+
+	return (x > y) ? (x + 3 * y / 8) : (y + 3 * x / 8);
+}
+
+static int32_t scale(int32_t value, uint32_t gain, int32_t *rem)
+{
+	int32_t scaled = value * (int32_t)gain + *rem;
+	int32_t out = scaled / GAIN_UNITY;
+
+	*rem = scaled - out * GAIN_UNITY;
+
+	return out;
+}
+
+static bool accel_process(struct motion_filter *filter,
+			  struct motion_filter_sample *sample)
+{
+	struct motion_filter_accel *accel =
+		CONTAINER_OF(filter, struct motion_filter_accel, filter);
+	uint32_t dt = MAX(sample->dt, 1);
+	uint64_t speed = (uint64_t)motion_len(sample) * USEC_PER_SEC / dt;
+	uint32_t gain = GAIN_UNITY;
+
+	if (speed > accel->threshold) {
+		uint64_t boost = (speed - accel->threshold) * accel->slope /
+				 1000;
+
+		gain = MIN(GAIN_UNITY + boost, accel->max_gain);
+	}
+
+	sample->dx = scale(sample->dx, gain, &accel->rem_x);
+	sample->dy = scale(sample->dy, gain, &accel->rem_y);
+
+	return true;
+}
+
+void motion_filter_accel_init(struct motion_filter_accel *accel,
+			      uint32_t threshold, uint16_t slope,
+			      uint16_t max_gain)
+{
+	__ASSERT_NO_MSG(max_gain >= GAIN_UNITY);
+
+	accel->filter.process = accel_process;
+	accel->threshold = threshold;
+	accel->slope = slope;
+	accel->max_gain = max_gain;
+	accel->rem_x = 0;
+	accel->rem_y = 0;
+}
+
+static bool snap_process(struct motion_filter *filter,
+			 struct motion_filter_sample *sample)
+{
+	struct motion_filter_snap *snap =
+		CONTAINER_OF(filter, struct motion_filter_snap, filter);
+	uint32_t x = abs(sample->dx);
+	uint32_t y = abs(sample->dy);
+
+	if ((uint64_t)y * Q10_ONE <= (uint64_t)x * snap->tan) {
+		sample->dy = 0;
+	} else if ((uint64_t)x * Q10_ONE <= (uint64_t)y * snap->tan) {
+		sample->dx = 0;
+	}
+
+	return true;
+}
+
+void motion_filter_snap_init(struct motion_filter_snap *snap, uint8_t angle)
+{
+	__ASSERT_NO_MSG((angle > 0) && (angle <= 45));
+
+	/* tan(a) ~= a + a^3 / 3, within 6% up to 45 degrees. */
+	uint32_t rad = (uint32_t)angle * DEG_Q10;
+
+	snap->filter.process = snap_process;
+	snap->tan = rad + rad * rad * rad / (3 * Q10_ONE * Q10_ONE);
+}
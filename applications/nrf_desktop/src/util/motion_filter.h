@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _MOTION_FILTER_H_
+#define _MOTION_FILTER_H_
+
+/**
+ * @file
+ * @defgroup motion_filter Motion filters
+ * @{
+ * @brief Filters applied to motion sensor samples.
+ *
+ * Each filter is a stage that modifies a sample in place. Stages are
+ * chained in an array and run in order for every sample read from the
+ * sensor. A custom stage is added by embedding @ref motion_filter as the
+ * first member of its context.
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Surface quality of a sample that was read without it. */
+#define MOTION_FILTER_SQUAL_UNKNOWN UINT16_MAX
+
+/** @brief Motion sample. */
+struct motion_filter_sample {
+	/** Motion on the X axis in sensor counts. */
+	int32_t dx;
+	/** Motion on the Y axis in sensor counts. */
+	int32_t dy;
+	/** Time since the previous sample in microseconds. */
+	uint32_t dt;
+	/** Surface quality, or MOTION_FILTER_SQUAL_UNKNOWN. */
+	uint16_t squal;
+};
+
+struct motion_filter;
+
+/**
+ * @brief Motion filter stage callback.
+ *
+ * @param filter Pointer to the stage.
+ * @param sample Sample to be filtered in place.
+ *
+ * @return false if the sample is dropped, true otherwise.
+ */
+typedef bool (*motion_filter_process_t)(struct motion_filter *filter,
+					struct motion_filter_sample *sample);
+
+/** @brief Motion filter stage. */
+struct motion_filter {
+	motion_filter_process_t process;
+};
+
+/** @brief Stage dropping motion when the sensor is lifted. */
+struct motion_filter_lift {
+	struct motion_filter filter;
+	uint16_t min_squal;
+};
+
+/** @brief Stage scaling motion with speed. */
+struct motion_filter_accel {
+	struct motion_filter filter;
+	uint32_t threshold;
+	uint16_t slope;
+	uint16_t max_gain;
+	/* Parts of a count left after scaling, in hundredths. */
+	int32_t rem_x;
+	int32_t rem_y;
+};
+
+/** @brief Stage snapping motion close to an axis onto the axis. */
+struct motion_filter_snap {
+	struct motion_filter filter;
+	/* Tangent of the snapping angle, Q10. */
+	uint16_t tan;
+};
+
+/**
+ * @brief Initialize the lift stage.
+ *
+ * Samples with surface quality below @p min_squal are dropped.
+ * Samples with unknown surface quality are kept.
+ *
+ * @param lift      Pointer to the stage.
+ * @param min_squal Lowest surface quality of a sample that is kept.
+ */
+void motion_filter_lift_init(struct motion_filter_lift *lift,
+			     uint16_t min_squal);
+
+/**
+ * @brief Initialize the acceleration stage.
+ *
+ * Above @p threshold, the motion is multiplied by a gain that grows by
+ * @p slope percent for every 1000 counts per second, up to @p max_gain.
+ * The parts of a count that are left after scaling are carried over to
+ * the next samples, so that slow motion is not lost.
+ *
+ * @param accel     Pointer to the stage.
+ * @param threshold Speed in counts per second above which the gain is
+ *                  applied.
+ * @param slope     Gain increase in percent per 1000 counts per second.
+ * @param max_gain  Largest gain in percent.
+ */
+void motion_filter_accel_init(struct motion_filter_accel *accel,
+			      uint32_t threshold, uint16_t slope,
+			      uint16_t max_gain);
+
+/**
+ * @brief Initialize the angle snapping stage.
+ *
+ * Motion along a direction that is closer than @p angle to the X or Y
+ * axis is moved onto the axis.
+ *
+ * @param snap  Pointer to the stage.
+ * @param angle Snapping angle in degrees, from 1 to 45.
+ */
+void motion_filter_snap_init(struct motion_filter_snap *snap, uint8_t angle);
+
+/**
+ * @brief Run a sample through a chain of stages.
+ *
+ * Stages that follow a stage that dropped the sample are not run.
+ *
+ * @param chain  Array of stages, run in order.
+ * @param cnt    Number of stages in @p chain.
+ * @param sample Sample to be filtered in place.
+ *
+ * @return false if the sample is dropped, true otherwise.
+ */
+static inline bool motion_filter_run(struct motion_filter * const *chain,
+				     size_t cnt,
+				     struct motion_filter_sample *sample)
+{
+	for (size_t i = 0; i < cnt; i++) {
+		if (!chain[i]->process(chain[i], sample)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @}
+ */
+
+#endif /* _MOTION_FILTER_H_ */
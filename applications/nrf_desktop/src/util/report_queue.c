@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+
+#include "report_queue.h"
+
+
+static size_t wrap(const struct report_queue *queue, size_t idx)
+{
+	return (idx >= queue->size) ? (idx - queue->size) : idx;
+}
+
+void report_queue_init(struct report_queue *queue,
+		       struct hid_report_event **buf, size_t size)
+{
+	__ASSERT_NO_MSG(buf);
+	__ASSERT_NO_MSG((size > 0) && (size <= UINT16_MAX));
+
+	queue->buf = buf;
+	queue->size = size;
+	queue->head = 0;
+	queue->count = 0;
+}
+
+struct hid_report_event *report_queue_put(struct report_queue *queue,
+					  struct hid_report_event *report)
+{
+	struct hid_report_event *dropped = NULL;
+
+	__ASSERT_NO_MSG(report);
+
+	if (queue->count == queue->size) {
+		dropped = report_queue_get(queue);
+	}
+
+	queue->buf[wrap(queue, queue->head + queue->count)] = report;
+	queue->count++;
+
+	return dropped;
+}
+
+struct hid_report_event *report_queue_get(struct report_queue *queue)
+{
+	if (queue->count == 0) {
+		return NULL;
+	}
+
+	struct hid_report_event *report = queue->buf[queue->head];
+
+	queue->head = wrap(queue, queue->head + 1);
+	queue->count--;
+
+	return report;
+}
+
+size_t report_queue_move(struct report_queue *dst, struct report_queue *src,
+			 size_t cnt)
+{
+	cnt = MIN(cnt, src->count);
+	cnt = MIN(cnt, dst->size - dst->count);
+
+	/* The newest reports are at the end of the source queue. */
+	size_t first = src->count - cnt;
+
+	for (size_t i = 0; i < cnt; i++) {
+		size_t src_idx = wrap(src, src->head + first + i);
+		size_t dst_idx = wrap(dst, dst->head + dst->count);
+
+		dst->buf[dst_idx] = src->buf[src_idx];
+		dst->count++;
+	}
+
+	src->count -= cnt;
+
+	return cnt;
+}
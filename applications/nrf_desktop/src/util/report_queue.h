@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _REPORT_QUEUE_H_
+#define _REPORT_QUEUE_H_
+
+/**
+ * @file
+ * @defgroup report_queue HID report queue
+ * @{
+ * @brief Fixed-size queue of HID report events.
+ *
+ * The queue keeps pointers to the events, so that an enqueued report is
+ * submitted as it was received, without copying it again. No memory is
+ * allocated by the queue.
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct hid_report_event;
+
+/** @brief HID report queue. */
+struct report_queue {
+	struct hid_report_event **buf;
+	uint16_t size;
+	uint16_t head;
+	uint16_t count;
+};
+
+/**
+ * @brief Initialize the queue.
+ *
+ * @param queue Pointer to the queue.
+ * @param buf   Array of event pointers used to store the queue.
+ * @param size  Number of elements in @p buf.
+ */
+void report_queue_init(struct report_queue *queue,
+		       struct hid_report_event **buf, size_t size);
+
+/**
+ * @brief Add a report at the end of the queue.
+ *
+ * If the queue is full, the oldest report is removed to make room.
+ *
+ * @param queue  Pointer to the queue.
+ * @param report Report to be added.
+ *
+ * @return Report that was removed from the queue, or NULL if the queue was
+ *         not full. The caller is responsible for freeing the report.
+ */
+struct hid_report_event *report_queue_put(struct report_queue *queue,
+					  struct hid_report_event *report);
+
+/**
+ * @brief Remove the oldest report from the queue.
+ *
+ * @param queue Pointer to the queue.
+ *
+ * @return Removed report, or NULL if the queue is empty.
+ */
+struct hid_report_event *report_queue_get(struct report_queue *queue);
+
+/**
+ * @brief Move the newest reports from one queue to the end of another.
+ *
+ * The order of the moved reports is kept. The reports that do not fit in
+ * @p dst are left in @p src.
+ *
+ * @param dst Pointer to the destination queue.
+ * @param src Pointer to the source queue.
+ * @param cnt Maximum number of reports to be moved.
+ *
+ * @return Number of moved reports.
+ */
+size_t report_queue_move(struct report_queue *dst, struct report_queue *src,
+			 size_t cnt);
+
+/**
+ * @brief Get the number of reports in the queue.
+ *
+ * @param queue Pointer to the queue.
+ *
+ * @return Number of reports.
+ */
+static inline size_t report_queue_count(const struct report_queue *queue)
+{
+	return queue->count;
+}
+
+/**
+ * @brief Check if the queue is empty.
+ *
+ * @param queue Pointer to the queue.
+ *
+ * @return True if there are no reports in the queue.
+ */
+static inline bool report_queue_is_empty(const struct report_queue *queue)
+{
+	return (queue->count == 0);
+}
+
+/**
+ * @}
+ */
+
+#endif /* _REPORT_QUEUE_H_ */
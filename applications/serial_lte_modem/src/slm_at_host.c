@@ -11,6 +11,7 @@
 #include <drivers/uart.h>
 #include <string.h>
 #include <init.h>
+#include <sys/ring_buffer.h>
 #include <modem/at_cmd.h>
 #include <modem/at_notif.h>
 #include <power/reboot.h>
@@ -61,6 +62,18 @@ LOG_MODULE_REGISTER(at_host, CONFIG_SLM_LOG_LEVEL);
 #define UART_RX_LEN	256
 #define UART_RX_TIMEOUT 1
 
+/* Free space kept in the data mode buffer for bytes still arriving
+ * through UART DMA after RX has been stopped.
+ */
+#define DATAMODE_RX_HEADROOM	(UART_RX_BUF_NUM * UART_RX_LEN)
+#define DATAMODE_TERM_LEN	(sizeof(CONFIG_SLM_DATAMODE_TERMINATOR) - 1)
+
+BUILD_ASSERT(CONFIG_SLM_DATAMODE_BUF_SIZE > 2 * DATAMODE_RX_HEADROOM,
+	     "Data mode buffer is too small");
+BUILD_ASSERT(CONFIG_SLM_DATAMODE_FLUSH_SIZE <=
+	     CONFIG_SLM_DATAMODE_BUF_SIZE - DATAMODE_RX_HEADROOM,
+	     "Data mode flush size exceeds buffer size");
+
 /** @brief Termination Modes. */
 enum term_modes {
 	MODE_NULL_TERM, /**< Null Termination */
@@ -90,6 +103,19 @@ static uint8_t *uart_tx_buf;
 
 static K_SEM_DEFINE(tx_done, 0, 1);
 
+RING_BUF_DECLARE(datamode_rb, CONFIG_SLM_DATAMODE_BUF_SIZE);
+static struct k_delayed_work datamode_flush_work;
+static struct k_delayed_work datamode_term_work;
+static slm_datamode_handler_t datamode_handler;
+static bool datamode;
+static bool datamode_rx_paused;
+static bool datamode_exit_req;
+/* Number of escape sequence characters received so far. They are held back
+ * until it is known whether they are data or the escape sequence.
+ */
+static size_t datamode_term_len;
+static int64_t datamode_rx_time;
+
 /* global functions defined in different files */
 void enter_idle(void);
 void enter_sleep(bool wake_up);
@@ -124,6 +150,204 @@ void rsp_send(const uint8_t *str, size_t len)
 	}
 }
 
+int datamode_send(const uint8_t *data, size_t len)
+{
+	int ret;
+
+	k_sem_take(&tx_done, K_FOREVER);
+
+	/* Transmit from the caller's buffer, nothing to free on TX_DONE */
+	uart_tx_buf = NULL;
+	ret = uart_tx(uart_dev, data, len, SYS_FOREVER_MS);
+	if (ret) {
+		LOG_WRN("uart_tx failed: %d", ret);
+		k_sem_give(&tx_done);
+		return ret;
+	}
+
+	/* Hold the caller until the buffer is no longer in use */
+	k_sem_take(&tx_done, K_FOREVER);
+	k_sem_give(&tx_done);
+
+	return 0;
+}
+
+int enter_datamode(slm_datamode_handler_t handler)
+{
+	if (handler == NULL) {
+		return -EINVAL;
+	}
+	if (datamode) {
+		LOG_WRN("Already in data mode");
+		return -EALREADY;
+	}
+
+	ring_buf_reset(&datamode_rb);
+	datamode_handler = handler;
+	datamode_exit_req = false;
+	datamode_term_len = 0;
+	datamode_rx_time = k_uptime_get();
+	datamode = true;
+	LOG_INF("Enter data mode");
+
+	return 0;
+}
+
+bool in_datamode(void)
+{
+	return datamode;
+}
+
+bool exit_datamode(void)
+{
+	if (!datamode) {
+		return false;
+	}
+
+	datamode = false;
+	datamode_exit_req = false;
+	LOG_INF("Exit data mode");
+
+	return true;
+}
+
+static void datamode_flush(struct k_work *work)
+{
+	uint8_t *data;
+	uint32_t len;
+	int ret;
+
+	ARG_UNUSED(work);
+
+	while (datamode) {
+		/* Hand the buffered data to the service in place */
+		len = ring_buf_get_claim(&datamode_rb, &data,
+					 CONFIG_SLM_DATAMODE_BUF_SIZE);
+		if (len == 0) {
+			break;
+		}
+		ret = datamode_handler(DATAMODE_SEND, data, len);
+		if (ret <= 0) {
+			LOG_WRN("Data mode send failed: %d, %d dropped",
+				ret, len);
+			ret = len;
+		}
+		ring_buf_get_finish(&datamode_rb, MIN(ret, len));
+	}
+
+	if (datamode_rx_paused) {
+		ret = uart_rx_enable(uart_dev, uart_rx_buf[0],
+				     sizeof(uart_rx_buf[0]), UART_RX_TIMEOUT);
+		if (ret == 0) {
+			datamode_rx_paused = false;
+		} else if (ret != -EBUSY) {
+			/* -EBUSY: retried on UART_RX_DISABLED */
+			LOG_ERR("UART RX failed: %d", ret);
+		}
+	}
+
+	if (datamode && datamode_exit_req) {
+		(void)datamode_handler(DATAMODE_EXIT, NULL, 0);
+		(void)exit_datamode();
+		rsp_send(OK_STR, sizeof(OK_STR) - 1);
+	}
+}
+
+static void datamode_rx_put(const uint8_t *data, size_t len)
+{
+	uint32_t ret;
+
+	ret = ring_buf_put(&datamode_rb, data, len);
+	if (ret < len) {
+		LOG_WRN("Data mode RX overrun, %d dropped", len - ret);
+	}
+}
+
+/* Called when UART has been idle for the guard time after a part of the
+ * escape sequence was received.
+ */
+static void datamode_term_check(struct k_work *work)
+{
+	int key;
+
+	ARG_UNUSED(work);
+
+	key = irq_lock();
+	if (datamode_term_len == DATAMODE_TERM_LEN) {
+		datamode_exit_req = true;
+	} else if (datamode_term_len > 0) {
+		/* Incomplete sequence, the characters are data */
+		datamode_rx_put(CONFIG_SLM_DATAMODE_TERMINATOR,
+				datamode_term_len);
+	}
+	datamode_term_len = 0;
+	irq_unlock(key);
+
+	k_delayed_work_submit(&datamode_flush_work, K_NO_WAIT);
+}
+
+static void datamode_rx_handler(const uint8_t *data, size_t len)
+{
+	int64_t now = k_uptime_get();
+	bool guard_before = (now - datamode_rx_time) >=
+			    CONFIG_SLM_DATAMODE_GUARD_TIME;
+	size_t start = 0;
+
+	datamode_rx_time = now;
+
+	if (datamode_exit_req) {
+		return;
+	}
+
+	/* Any data received within the guard time after the escape sequence
+	 * makes it data.
+	 */
+	k_delayed_work_cancel(&datamode_term_work);
+
+	/* The escape sequence must be preceded by the guard time. It can be
+	 * split across UART bursts.
+	 */
+	for (size_t i = 0; i < len; i++) {
+		if ((datamode_term_len < DATAMODE_TERM_LEN) &&
+		    (data[i] == CONFIG_SLM_DATAMODE_TERMINATOR[datamode_term_len]) &&
+		    ((datamode_term_len > 0) || ((i == 0) && guard_before))) {
+			datamode_term_len++;
+			start = i + 1;
+			continue;
+		}
+
+		if (datamode_term_len > 0) {
+			datamode_rx_put(CONFIG_SLM_DATAMODE_TERMINATOR,
+					datamode_term_len);
+			datamode_term_len = 0;
+		}
+	}
+
+	if (datamode_term_len > 0) {
+		/* Wait for the guard time after the sequence */
+		k_delayed_work_submit(&datamode_term_work,
+				      K_MSEC(CONFIG_SLM_DATAMODE_GUARD_TIME));
+		return;
+	}
+
+	datamode_rx_put(&data[start], len - start);
+
+	/* Stop receiving until the service has drained the buffer */
+	if (!datamode_rx_paused &&
+	    ring_buf_space_get(&datamode_rb) < DATAMODE_RX_HEADROOM) {
+		datamode_rx_paused = true;
+		uart_rx_disable(uart_dev);
+	}
+
+	if (datamode_rx_paused ||
+	    ring_buf_size_get(&datamode_rb) >= CONFIG_SLM_DATAMODE_FLUSH_SIZE) {
+		k_delayed_work_submit(&datamode_flush_work, K_NO_WAIT);
+	} else {
+		k_delayed_work_submit(&datamode_flush_work,
+				      K_MSEC(CONFIG_SLM_DATAMODE_FLUSH_TIME));
+	}
+}
+
 static int set_uart_baudrate(uint32_t baudrate)
 {
 	int err = -EINVAL;
@@ -385,10 +609,8 @@ static void cmd_send(struct k_work *work)
 		}
 	}
 
-	err = slm_at_tcp_proxy_parse(at_buf, at_buf_len);
-	if (err > 0) {
-		goto done;
-	} else if (err == 0) {
+	err = slm_at_tcp_proxy_parse(at_buf);
+	if (err == 0) {
 		rsp_send(OK_STR, sizeof(OK_STR) - 1);
 		goto done;
 	} else if (err != -ENOENT) {
@@ -396,10 +618,8 @@ static void cmd_send(struct k_work *work)
 		goto done;
 	}
 
-	err = slm_at_udp_proxy_parse(at_buf, at_buf_len);
-	if (err > 0) {
-		goto done;
-	} else if (err == 0) {
+	err = slm_at_udp_proxy_parse(at_buf);
+	if (err == 0) {
 		rsp_send(OK_STR, sizeof(OK_STR) - 1);
 		goto done;
 	} else if (err != -ENOENT) {
@@ -622,8 +842,13 @@ static void uart_callback(const struct device *dev, struct uart_event *evt,
 		LOG_INF("TX_ABORTED");
 		break;
 	case UART_RX_RDY:
-		for (int i = pos; i < (pos + evt->data.rx.len); i++) {
-			uart_rx_handler(evt->data.rx.buf[i]);
+		if (datamode) {
+			datamode_rx_handler(&evt->data.rx.buf[pos],
+					    evt->data.rx.len);
+		} else {
+			for (int i = pos; i < (pos + evt->data.rx.len); i++) {
+				uart_rx_handler(evt->data.rx.buf[i]);
+			}
 		}
 		pos += evt->data.rx.len;
 		break;
@@ -643,6 +868,9 @@ static void uart_callback(const struct device *dev, struct uart_event *evt,
 		break;
 	case UART_RX_DISABLED:
 		LOG_DBG("RX_DISABLED");
+		if (datamode_rx_paused) {
+			k_delayed_work_submit(&datamode_flush_work, K_NO_WAIT);
+		}
 		break;
 	default:
 		break;
@@ -763,6 +991,8 @@ int slm_at_host_init(void)
 	}
 #endif
 	k_work_init(&cmd_send_work, cmd_send);
+	k_delayed_work_init(&datamode_flush_work, datamode_flush);
+	k_delayed_work_init(&datamode_term_work, datamode_term_check);
 	k_sem_give(&tx_done);
 	rsp_send(SLM_SYNC_STR, sizeof(SLM_SYNC_STR)-1);
 
@@ -37,6 +37,68 @@ enum slm_data_type_t {
 	DATATYPE_OMATLV
 };
 
+/**@brief Data mode operations. */
+enum slm_datamode_op {
+	DATAMODE_SEND,  /**< Send data received from UART to the service */
+	DATAMODE_EXIT   /**< Host requested to leave data mode */
+};
+
+/**@brief Data mode handler type.
+ *
+ * For @ref DATAMODE_SEND, the handler returns the number of bytes consumed
+ * from @p data (which may be fewer than @p len), or a negative error code
+ * in which case the data is dropped.
+ */
+typedef int (*slm_datamode_handler_t)(uint8_t op, const uint8_t *data,
+				      int len);
+
+/**
+ * @brief Enter data mode.
+ *
+ * In data mode, UART input is no longer parsed as AT commands. It is
+ * collected in a ring buffer and handed to @p handler in place, when
+ * either the flush size or the flush time is reached. Data mode is left
+ * when the configured escape sequence arrives on its own, or when the
+ * service calls @ref exit_datamode.
+ *
+ * @param handler Data mode handler of the service.
+ *
+ * @retval 0 If the operation was successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int enter_datamode(slm_datamode_handler_t handler);
+
+/**
+ * @brief Check whether SLM is in data mode.
+ *
+ * @retval true If data mode is active.
+ */
+bool in_datamode(void);
+
+/**
+ * @brief Exit data mode.
+ *
+ * Pending UART data is dropped.
+ *
+ * @retval true If data mode was active.
+ */
+bool exit_datamode(void);
+
+/**
+ * @brief Send data to UART in data mode.
+ *
+ * The data is transmitted directly from @p data, without copying. The call
+ * blocks until the transfer is done, which throttles the socket receiver to
+ * the UART rate.
+ *
+ * @param data Data to send.
+ * @param len Length of data.
+ *
+ * @retval 0 If the operation was successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int datamode_send(const uint8_t *data, size_t len);
+
 /**
  * @brief Initialize AT host for serial LTE modem
  *
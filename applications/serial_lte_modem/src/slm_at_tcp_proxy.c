@@ -212,6 +212,9 @@ static int do_tcp_server_stop(int error)
 			}
 		}
 #endif
+		if (proxy.datamode) {
+			(void)exit_datamode();
+		}
 		(void)slm_at_tcp_proxy_init();
 		if (error) {
 			sprintf(rsp_buf, "#XTCPSVR: %d stopped\r\n", error);
@@ -322,6 +325,9 @@ static int do_tcp_client_disconnect(int error)
 			LOG_WRN("close() failed: %d", -errno);
 			ret = -errno;
 		}
+		if (proxy.datamode) {
+			(void)exit_datamode();
+		}
 		(void)slm_at_tcp_proxy_init();
 		if (error) {
 			sprintf(rsp_buf, "#XTCPCLI: %d disconnected\r\n",
@@ -423,7 +429,21 @@ static int do_tcp_send_datamode(const uint8_t *data, int datalen)
 			K_NO_WAIT);
 	}
 
-	return offset;
+	return (offset > 0) ? offset : ret;
+}
+
+static int tcp_datamode_callback(uint8_t op, const uint8_t *data, int len)
+{
+	int ret = 0;
+
+	if (op == DATAMODE_SEND) {
+		ret = do_tcp_send_datamode(data, len);
+		LOG_DBG("datamode send: %d", ret);
+	} else if (op == DATAMODE_EXIT) {
+		proxy.datamode = false;
+	}
+
+	return ret;
 }
 
 static int tcp_data_save(uint8_t *data, uint32_t length)
@@ -514,7 +534,7 @@ thread_entry:
 				continue;
 			}
 			if (proxy.datamode) {
-				rsp_send(data, ret);
+				(void)datamode_send(data, ret);
 			} else if (slm_util_hex_check(data, ret)) {
 				ret = slm_util_htoa(data, ret, data_hex,
 					DATA_HEX_MAX_SIZE);
@@ -593,6 +613,7 @@ static int handle_at_tcp_server(enum at_cmd_type cmd_type)
 			err = do_tcp_server_start(port, proxy.sec_tag);
 			if (err == 0 && op == AT_SERVER_START_WITH_DATAMODE) {
 				proxy.datamode = true;
+				(void)enter_datamode(tcp_datamode_callback);
 			}
 		} else if (op == AT_SERVER_STOP) {
 			if (proxy.sock < 0) {
@@ -678,6 +699,7 @@ static int handle_at_tcp_client(enum at_cmd_type cmd_type)
 			if (err == 0 &&
 			    op == AT_CLIENT_CONNECT_WITH_DATAMODE) {
 				proxy.datamode = true;
+				(void)enter_datamode(tcp_datamode_callback);
 			}
 		} else if (op == AT_CLIENT_DISCONNECT) {
 			if (proxy.sock < 0) {
@@ -803,7 +825,7 @@ static int handle_at_tcp_recv(enum at_cmd_type cmd_type)
 
 /**@brief API to handle TCP proxy AT commands
  */
-int slm_at_tcp_proxy_parse(const char *at_cmd, uint16_t length)
+int slm_at_tcp_proxy_parse(const char *at_cmd)
 {
 	int ret = -ENOENT;
 	enum at_cmd_type type;
@@ -823,11 +845,6 @@ int slm_at_tcp_proxy_parse(const char *at_cmd, uint16_t length)
 		}
 	}
 
-	/* handle sending in data mode */
-	if (ret == -ENOENT && proxy.datamode) {
-		ret = do_tcp_send_datamode(at_cmd, length);
-	}
-
 	return ret;
 }
 
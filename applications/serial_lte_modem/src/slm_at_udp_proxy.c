@@ -154,6 +154,9 @@ static int do_udp_server_stop(int error)
 			LOG_WRN("close() failed: %d", -errno);
 			ret = -errno;
 		}
+		if (udp_datamode) {
+			(void)exit_datamode();
+		}
 		(void)slm_at_udp_proxy_init();
 		if (error) {
 			sprintf(rsp_buf, "#XUDPSVR: %d stopped\r\n", error);
@@ -263,6 +266,9 @@ static int do_udp_client_disconnect(void)
 			LOG_WRN("close() failed: %d", -errno);
 			ret = -errno;
 		}
+		if (udp_datamode) {
+			(void)exit_datamode();
+		}
 		(void)slm_at_udp_proxy_init();
 		sprintf(rsp_buf, "#XUDPCLI: disconnected\r\n");
 		rsp_send(rsp_buf, strlen(rsp_buf));
@@ -323,7 +329,22 @@ static int do_udp_send_datamode(const uint8_t *data, int datalen)
 		offset += ret;
 	}
 
-	return offset;
+	return (offset > 0) ? offset : ret;
+}
+
+static int udp_datamode_callback(uint8_t op, const uint8_t *data, int len)
+{
+	int ret = 0;
+
+	if (op == DATAMODE_SEND) {
+		/* One datagram per flush, bounded by the MTU */
+		ret = do_udp_send_datamode(data, MIN(len, NET_IPV4_MTU));
+		LOG_DBG("datamode send: %d", ret);
+	} else if (op == DATAMODE_EXIT) {
+		udp_datamode = false;
+	}
+
+	return ret;
 }
 
 static void udp_thread_func(void *p1, void *p2, void *p3)
@@ -347,7 +368,7 @@ static void udp_thread_func(void *p1, void *p2, void *p3)
 			continue;
 		}
 		if (udp_datamode) {
-			rsp_send(data, ret);
+			(void)datamode_send(data, ret);
 		} else if (slm_util_hex_check(data, ret)) {
 			ret = slm_util_htoa(data, ret, data_hex,
 				DATA_HEX_MAX_SIZE);
@@ -410,6 +431,7 @@ static int handle_at_udp_server(enum at_cmd_type cmd_type)
 			err = do_udp_server_start(port);
 			if (err == 0 && op == AT_SERVER_START_WITH_DATAMODE) {
 				udp_datamode = true;
+				(void)enter_datamode(udp_datamode_callback);
 			}
 		} else if (op == AT_SERVER_STOP) {
 			if (udp_sock < 0) {
@@ -493,6 +515,7 @@ static int handle_at_udp_client(enum at_cmd_type cmd_type)
 			if (err == 0 &&
 			    op == AT_CLIENT_CONNECT_WITH_DATAMODE) {
 				udp_datamode = true;
+				(void)enter_datamode(udp_datamode_callback);
 			}
 		} else if (op == AT_CLIENT_DISCONNECT) {
 			if (udp_sock < 0) {
@@ -580,7 +603,7 @@ static int handle_at_udp_send(enum at_cmd_type cmd_type)
 
 /**@brief API to handle UDP Proxy AT commands
  */
-int slm_at_udp_proxy_parse(const char *at_cmd, uint16_t length)
+int slm_at_udp_proxy_parse(const char *at_cmd)
 {
 	int ret = -ENOENT;
 	enum at_cmd_type type;
@@ -600,11 +623,6 @@ int slm_at_udp_proxy_parse(const char *at_cmd, uint16_t length)
 		}
 	}
 
-	/* handle sending in data mode */
-	if (ret == -ENOENT && udp_datamode) {
-		ret = do_udp_send_datamode(at_cmd, length);
-	}
-
 	return ret;
 }
 
@@ -19,12 +19,29 @@
 #define BASE_GSP_SAMPLE_LAT	(CONFIG_GPS_SIM_BASE_LATITUDE / 1000.0)
 #define BASE_GSP_SAMPLE_LNG	(CONFIG_GPS_SIM_BASE_LONGITUDE / 1000.0)
 
+/* The generated sentences have no date, a fixed one is used for the fixes. */
+#define BASE_GPS_SAMPLE_YEAR	2020
+#define BASE_GPS_SAMPLE_MONTH	1
+#define BASE_GPS_SAMPLE_DAY	1
+
+/* Fields of a $GPRMC sentence, up to and including the date. */
+#define RMC_FIELD_COUNT		10
+#define KNOTS_TO_MPS		0.514444
+
 /* Whole NMEA sentence, including CRC. */
 #define GPS_NMEA_SENTENCE "$GPGGA,%02d%02d%02d.200,%8.3f,%c,%09.3f,%c,1,"      \
 			  "12,1.0,0.0,M,0.0,M,,*%02X"
 
 LOG_MODULE_REGISTER(gps_sim, CONFIG_GPS_SIM_LOG_LEVEL);
 
+#if defined(CONFIG_GPS_SIM_TRACE)
+/* Recorded NMEA sentences, one per line. */
+static const char trace[] = {
+#include <gps_sim_trace.inc>
+	'\0'
+};
+#endif
+
 enum gps_sim_state {
 	GPS_SIM_UNINIT,
 	GPS_SIM_IDLE,
@@ -68,6 +85,114 @@ static uint8_t nmea_checksum_get(const uint8_t *gps_data)
 	return checksum;
 }
 
+/**
+ * @brief Converts a position in the NMEA format, degrees * 100 + minutes,
+ * to degrees.
+ */
+static double nmea_to_degrees(double value)
+{
+	double degrees = (int)(value / 100.0);
+
+	return degrees + (value - degrees * 100.0) / 60.0;
+}
+
+/**
+ * @brief Converts a position in degrees to the NMEA format.
+ */
+static double degrees_to_nmea(double degrees)
+{
+	double whole = (int)degrees;
+
+	return whole * 100.0 + (degrees - whole) * 60.0;
+}
+
+#if defined(CONFIG_GPS_SIM_TRACE)
+/**
+ * @brief Parses a $GPRMC sentence of a trace.
+ *
+ * @param sentence Pointer to the sentence, ended by a line break or the end
+ * of the trace.
+ * @param pvt Pointer to gps_pvt struct where the position fix will be stored.
+ *
+ * @return true if the sentence is a valid position fix.
+ */
+static bool rmc_parse(const char *sentence, struct gps_pvt *pvt)
+{
+	const char *field[RMC_FIELD_COUNT];
+	const char *pos = sentence;
+	size_t count = 0;
+	double time;
+	long date;
+
+	while (count < ARRAY_SIZE(field)) {
+		field[count++] = pos;
+		pos = strpbrk(pos, ",\r\n");
+		if ((pos == NULL) || (*pos != ',')) {
+			break;
+		}
+		pos++;
+	}
+
+	/* Any talker ID, but only fixes marked as valid. */
+	if ((count < ARRAY_SIZE(field)) || (sentence[0] != '$') ||
+	    (strncmp(&sentence[3], "RMC,", 4) != 0) || (*field[2] != 'A')) {
+		return false;
+	}
+
+	time = strtod(field[1], NULL);
+	date = strtol(field[9], NULL, 10);
+
+	memset(pvt, 0, sizeof(*pvt));
+	pvt->latitude = nmea_to_degrees(strtod(field[3], NULL));
+	pvt->longitude = nmea_to_degrees(strtod(field[5], NULL));
+	pvt->speed = strtod(field[7], NULL) * KNOTS_TO_MPS;
+	pvt->heading = strtod(field[8], NULL);
+	pvt->datetime.year = 2000 + date % 100;
+	pvt->datetime.month = (date / 100) % 100;
+	pvt->datetime.day = date / 10000;
+	pvt->datetime.hour = (int)time / 10000;
+	pvt->datetime.minute = ((int)time / 100) % 100;
+	pvt->datetime.seconds = (int)time % 100;
+	pvt->datetime.ms = (time - (int)time) * MSEC_PER_SEC;
+
+	if (*field[4] == 'S') {
+		pvt->latitude = -pvt->latitude;
+	}
+
+	if (*field[6] == 'W') {
+		pvt->longitude = -pvt->longitude;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Gets the next position fix from the trace, starting over at the
+ * end of it.
+ *
+ * @param pvt Pointer to gps_pvt struct where the position fix will be stored.
+ *
+ * @return true if a fix was found.
+ */
+static bool trace_gps_data(struct gps_pvt *pvt)
+{
+	static const char *line = trace;
+
+	/* Every iteration moves on at least one line. */
+	for (size_t i = 0; i < sizeof(trace); i++) {
+		const char *sentence = line;
+		const char *end = strchr(line, '\n');
+
+		line = ((end == NULL) || (end[1] == '\0')) ? trace : end + 1;
+
+		if (rmc_parse(sentence, pvt)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+#else
 /**
  * @brief Calculates sine from uptime
  * The input to the sin() function is limited to avoid overflow issues
@@ -107,13 +232,11 @@ static double generate_pseudo_random(void)
 /**
  * @brief Function generatig GPS data
  *
- * @param gps_nmea Pointer to gps_nmea struct where the NMEA
- * sentence will be stored.
+ * @param pvt Pointer to gps_pvt struct where the position fix will be stored.
  * @param max_variation The maximum value the latitude and longitude in the
  * generated sentence can vary for each iteration. In units of minutes.
  */
-static void generate_gps_data(struct gps_nmea *gps_data,
-			      double max_variation)
+static void generate_gps_data(struct gps_pvt *pvt, double max_variation)
 {
 	static uint8_t hour = BASE_GPS_SAMPLE_HOUR;
 	static uint8_t minute = BASE_GPS_SAMPLE_MINUTE;
@@ -121,10 +244,7 @@ static void generate_gps_data(struct gps_nmea *gps_data,
 	static uint32_t last_uptime;
 	double lat = BASE_GSP_SAMPLE_LAT;
 	double lng = BASE_GSP_SAMPLE_LNG;
-	char lat_heading = 'N';
-	char lng_heading = 'E';
 	uint32_t uptime;
-	uint8_t checksum;
 
 	if (IS_ENABLED(CONFIG_GPS_SIM_ELLIPSOID)) {
 		lat = generate_sine(BASE_GSP_SAMPLE_LAT, max_variation / 2.0);
@@ -156,6 +276,33 @@ static void generate_gps_data(struct gps_nmea *gps_data,
 		}
 	}
 
+	memset(pvt, 0, sizeof(*pvt));
+	pvt->latitude = nmea_to_degrees(lat);
+	pvt->longitude = nmea_to_degrees(lng);
+	pvt->datetime.year = BASE_GPS_SAMPLE_YEAR;
+	pvt->datetime.month = BASE_GPS_SAMPLE_MONTH;
+	pvt->datetime.day = BASE_GPS_SAMPLE_DAY;
+	pvt->datetime.hour = hour;
+	pvt->datetime.minute = minute;
+	pvt->datetime.seconds = second;
+}
+#endif /* CONFIG_GPS_SIM_TRACE */
+
+/**
+ * @brief Formats a position fix as an NMEA sentence
+ *
+ * @param gps_data Pointer to gps_nmea struct where the NMEA
+ * sentence will be stored.
+ * @param pvt Pointer to the position fix.
+ */
+static void nmea_format(struct gps_nmea *gps_data, const struct gps_pvt *pvt)
+{
+	double lat = degrees_to_nmea(pvt->latitude);
+	double lng = degrees_to_nmea(pvt->longitude);
+	char lat_heading = 'N';
+	char lng_heading = 'E';
+	uint8_t checksum;
+
 	if (lat < 0) {
 		lat *= -1.0;
 		lat_heading = 'S';
@@ -169,7 +316,8 @@ static void generate_gps_data(struct gps_nmea *gps_data,
 	/* Format the sentence, excluding the CRC. */
 	snprintf(gps_data->buf,
 		 GPS_NMEA_SENTENCE_MAX_LENGTH, GPS_NMEA_SENTENCE,
-		 hour, minute, second, lat, lat_heading, lng, lng_heading, 0);
+		 pvt->datetime.hour, pvt->datetime.minute,
+		 pvt->datetime.seconds, lat, lat_heading, lng, lng_heading, 0);
 
 	/* Calculate the CRC (stop when '*' is found, thus excluding the CRC),
 	 * then reformat the string, this time including the CRC.
@@ -183,7 +331,8 @@ static void generate_gps_data(struct gps_nmea *gps_data,
 
 	gps_data->len =
 		snprintf(gps_data->buf, GPS_NMEA_SENTENCE_MAX_LENGTH,
-			 GPS_NMEA_SENTENCE, hour, minute, second, lat,
+			 GPS_NMEA_SENTENCE, pvt->datetime.hour,
+			 pvt->datetime.minute, pvt->datetime.seconds, lat,
 			 lat_heading, lng, lng_heading, checksum);
 
 	LOG_DBG("%s (%d bytes)", log_strdup(gps_data->buf), gps_data->len);
@@ -270,18 +419,28 @@ static void fix_work_fn(struct k_work *work)
 	struct gps_sim_data *drv_data =
 		CONTAINER_OF(work, struct gps_sim_data, fix_work);
 	struct gps_event evt = {
-		.type = GPS_EVT_NMEA_FIX,
+		.type = GPS_EVT_PVT_FIX,
 	};
 
 	if (drv_data->state != GPS_SIM_ACTIVE_SEARCH) {
 		return;
 	}
 
+#if defined(CONFIG_GPS_SIM_TRACE)
+	if (!trace_gps_data(&evt.pvt)) {
+		LOG_WRN("No position fix in the trace");
+		return;
+	}
+#else
+	generate_gps_data(&evt.pvt, CONFIG_GPS_SIM_MAX_STEP / 1000.0);
+#endif
+
 	k_delayed_work_cancel(&drv_data->timeout_work);
 
-	generate_gps_data(&drv_data->nmea_sample,
-			  CONFIG_GPS_SIM_MAX_STEP / 1000.0);
+	nmea_format(&drv_data->nmea_sample, &evt.pvt);
+	notify_event(drv_data->dev, &evt);
 
+	evt.type = GPS_EVT_NMEA_FIX;
 	evt.nmea.len = drv_data->nmea_sample.len;
 
 	memcpy(evt.nmea.buf, drv_data->nmea_sample.buf,
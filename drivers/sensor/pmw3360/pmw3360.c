@@ -98,12 +98,20 @@ LOG_MODULE_REGISTER(pmw3360, CONFIG_PMW3360_LOG_LEVEL);
 #define PMW3360_MAX_BURST_SIZE			12
 
 /* Register count used for reading a single motion burst */
+#ifdef CONFIG_PMW3360_BURST_QUALITY
+#define PMW3360_BURST_SIZE			PMW3360_MAX_BURST_SIZE
+#else
 #define PMW3360_BURST_SIZE			6
+#endif
 
 /* Position of X in motion burst data */
 #define PMW3360_DX_POS				2
 #define PMW3360_DY_POS				4
 
+/* Position of surface quality and shutter in motion burst data */
+#define PMW3360_SQUAL_POS			6
+#define PMW3360_SHUTTER_POS			10
+
 /* Rest_En position in Config2 register. */
 #define PMW3360_REST_EN_POS			5
 
@@ -136,6 +144,8 @@ struct pmw3360_data {
 	struct k_spinlock            lock;
 	int16_t                        x;
 	int16_t                        y;
+	uint8_t                        squal;
+	uint16_t                       shutter;
 	sensor_trigger_handler_t     data_ready_handler;
 	struct k_work                trigger_handler_work;
 	struct k_delayed_work        init_work;
@@ -913,6 +923,12 @@ static int pmw3360_sample_fetch(const struct device *dev, enum sensor_channel ch
 			dev_data->x = -y;
 			dev_data->y = -x;
 		}
+
+		if (IS_ENABLED(CONFIG_PMW3360_BURST_QUALITY)) {
+			dev_data->squal = data[PMW3360_SQUAL_POS];
+			dev_data->shutter =
+				sys_get_be16(&data[PMW3360_SHUTTER_POS]);
+		}
 	}
 
 	return err;
@@ -930,7 +946,8 @@ static int pmw3360_channel_get(const struct device *dev, enum sensor_channel cha
 		return -EBUSY;
 	}
 
-	switch (chan) {
+	/* Private channels are not part of the enum. */
+	switch ((int)chan) {
 	case SENSOR_CHAN_POS_DX:
 		val->val1 = dev_data->x;
 		val->val2 = 0;
@@ -941,6 +958,22 @@ static int pmw3360_channel_get(const struct device *dev, enum sensor_channel cha
 		val->val2 = 0;
 		break;
 
+	case PMW3360_CHAN_SQUAL:
+		if (!IS_ENABLED(CONFIG_PMW3360_BURST_QUALITY)) {
+			return -ENOTSUP;
+		}
+		val->val1 = dev_data->squal;
+		val->val2 = 0;
+		break;
+
+	case PMW3360_CHAN_SHUTTER:
+		if (!IS_ENABLED(CONFIG_PMW3360_BURST_QUALITY)) {
+			return -ENOTSUP;
+		}
+		val->val1 = dev_data->shutter;
+		val->val2 = 0;
+		break;
+
 	default:
 		return -ENOTSUP;
 	}
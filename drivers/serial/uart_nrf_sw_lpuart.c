@@ -5,6 +5,7 @@
  */
 
 #include <drivers/uart.h>
+#include <drivers/uart_nrf_sw_lpuart.h>
 #include <drivers/gpio.h>
 #include <hal/nrf_gpio.h>
 #include <hal/nrf_gpiote.h>
@@ -12,6 +13,12 @@
 
 LOG_MODULE_REGISTER(lpuart, CONFIG_NRF_SW_LPUART_LOG_LEVEL);
 
+#if CONFIG_NRF_SW_LPUART_STATS
+#define STATS_ADD(data, field, val) ((data)->stats.field += (val))
+#else
+#define STATS_ADD(data, field, val)
+#endif
+
 /* Structure describing bidirectional pin. */
 struct lpuart_bidir_gpio {
 	struct gpio_callback callback;
@@ -52,13 +59,52 @@ enum rx_state {
 	RX_TO_OFF,
 };
 
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+/* Buffer passed to uart_tx. */
+struct lpuart_tx_write {
+	const uint8_t *buf;
+	size_t len;
+};
+
+/* Data sent with a single handshake and a single transfer. */
+struct lpuart_tx_batch {
+	uint8_t buf[CONFIG_NRF_SW_LPUART_TX_QUEUE_SIZE];
+	size_t len;
+
+	/* Longest timeout of the writes in the batch. */
+	int32_t timeout;
+
+	/* Writes reported to the user when the batch is completed. */
+	struct lpuart_tx_write writes[CONFIG_NRF_SW_LPUART_TX_QUEUE_WRITES];
+	size_t write_cnt;
+};
+
+struct lpuart_tx_queue {
+	/* One batch is filled while the other one is being sent. */
+	struct lpuart_tx_batch batch[2];
+
+	/* Index of the batch being filled. */
+	uint8_t fill;
+
+	/* Timer started by the first write to the empty batch. */
+	struct k_timer linger_timer;
+
+	/* Set by uart_tx_abort. The batch being filled is dropped together
+	 * with the batch being sent.
+	 */
+	bool abort;
+};
+#endif
+
 #if CONFIG_NRF_SW_LPUART_INT_DRIVEN
 struct lpuart_int_driven {
 	uart_irq_callback_user_data_t callback;
 	void *user_data;
 
+#if !CONFIG_NRF_SW_LPUART_TX_QUEUE
 	uint8_t txbuf[CONFIG_NRF_SW_LPUART_INT_DRV_TX_BUF_SIZE];
 	size_t txlen;
+#endif
 
 	uint8_t rxbuf[CONFIG_NRF_SW_LPUART_MAX_PACKET_SIZE];
 	size_t rxlen;
@@ -72,6 +118,9 @@ struct lpuart_int_driven {
 
 /* Low power uart structure. */
 struct lpuart_data {
+	/* Low power UART device. */
+	const struct device *dev;
+
 	/* Physical UART device */
 	const struct device *uart;
 
@@ -109,6 +158,17 @@ struct lpuart_data {
 	/* Set to true if request has been detected. */
 	bool rx_req;
 
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+	struct lpuart_tx_queue tx_queue;
+#endif
+
+#if CONFIG_NRF_SW_LPUART_STATS
+	struct nrf_sw_lpuart_stats stats;
+
+	/* Cycle counter value when the current TX request was issued. */
+	uint32_t tx_req_cycles;
+#endif
+
 #if CONFIG_NRF_SW_LPUART_INT_DRIVEN
 	struct lpuart_int_driven int_driven;
 #endif
@@ -214,6 +274,7 @@ static void activate_rx(struct lpuart_data *data)
 	ctrl_pin_clear(&data->rdy_pin);
 	ctrl_pin_set(&data->rdy_pin, false);
 	LOG_DBG("RX: Ready");
+	STATS_ADD(data, rx_wakeups, 1);
 	data->rx_req = false;
 	data->rx_state = RX_ACTIVE;
 }
@@ -242,13 +303,34 @@ static void deactivate_rx(struct lpuart_data *data)
 	}
 }
 
+/* With the TX queue, the buffer is released in tx_queue_complete together with
+ * the batch it points to.
+ */
 static void tx_complete(struct lpuart_data *data)
 {
 	ctrl_pin_idle(&data->req_pin);
+#if !CONFIG_NRF_SW_LPUART_TX_QUEUE
 	data->tx_buf = NULL;
+#endif
 	data->tx_active = false;
 }
 
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+static void tx_queue_complete(struct lpuart_data *data, bool aborted);
+#endif
+
+/* Requests the transfer of the current TX buffer from the receiver. */
+static void tx_request(struct lpuart_data *data, int32_t timeout)
+{
+	STATS_ADD(data, tx_handshakes, 1);
+#if CONFIG_NRF_SW_LPUART_STATS
+	data->tx_req_cycles = k_cycle_get_32();
+#endif
+
+	k_timer_start(&data->tx_timer, SYS_TIMEOUT_MS(timeout), K_NO_WAIT);
+	ctrl_pin_set(&data->req_pin, false);
+}
+
 static void on_req_pin_change(struct lpuart_data *data)
 {
 	int key;
@@ -266,6 +348,8 @@ static void on_req_pin_change(struct lpuart_data *data)
 	LOG_DBG("TX: Confirmed, starting.");
 	ctrl_pin_set(&data->req_pin, true);
 	k_timer_stop(&data->tx_timer);
+	STATS_ADD(data, tx_handshake_us,
+		  k_cyc_to_us_floor32(k_cycle_get_32() - data->tx_req_cycles));
 
 	key = irq_lock();
 	data->tx_active = true;
@@ -276,6 +360,9 @@ static void on_req_pin_change(struct lpuart_data *data)
 	if (err < 0) {
 		LOG_ERR("TX: Not started (error: %d)", err);
 		tx_complete(data);
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+		tx_queue_complete(data, true);
+#endif
 	}
 }
 
@@ -386,6 +473,228 @@ static void user_callback(const struct device *dev, struct uart_event *evt)
 	}
 }
 
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+/* Starts sending the batch being filled. If the previous batch is still being
+ * sent, the batch is sent when the previous one is completed.
+ */
+static void tx_queue_flush(struct lpuart_data *data)
+{
+	struct lpuart_tx_queue *queue = &data->tx_queue;
+	struct lpuart_tx_batch *batch;
+	int key;
+
+	key = irq_lock();
+	batch = &queue->batch[queue->fill];
+	if ((data->tx_buf != NULL) || (batch->len == 0)) {
+		irq_unlock(key);
+		return;
+	}
+
+	data->tx_buf = batch->buf;
+	data->tx_len = batch->len;
+	queue->fill ^= 1;
+	irq_unlock(key);
+
+	k_timer_stop(&queue->linger_timer);
+
+	LOG_DBG("TX: Batch len:%d, writes:%d", batch->len, batch->write_cnt);
+	tx_request(data, batch->timeout);
+}
+
+/* Copies data to the batch being filled. If @p track is set, the whole buffer
+ * must fit and it is reported to the user when the batch is completed.
+ * Otherwise, as much data as fits is copied.
+ *
+ * Returns number of copied bytes or -EBUSY if no data could be copied.
+ */
+static int tx_queue_append(struct lpuart_data *data, const uint8_t *buf,
+			   size_t len, int32_t timeout, bool track)
+{
+	struct lpuart_tx_queue *queue = &data->tx_queue;
+	struct lpuart_tx_batch *batch;
+	size_t space;
+	bool first;
+	bool full;
+	int key;
+
+	key = irq_lock();
+	batch = &queue->batch[queue->fill];
+	space = sizeof(batch->buf) - batch->len;
+
+	if (!track) {
+		len = MIN(len, space);
+	}
+
+	if ((len == 0) || (len > space) ||
+	    (track && (batch->write_cnt == ARRAY_SIZE(batch->writes)))) {
+		irq_unlock(key);
+		return -EBUSY;
+	}
+
+	if (track) {
+		batch->writes[batch->write_cnt].buf = buf;
+		batch->writes[batch->write_cnt].len = len;
+		batch->write_cnt++;
+	}
+
+	first = (batch->len == 0);
+	if (first || (timeout == SYS_FOREVER_MS) ||
+	    ((batch->timeout != SYS_FOREVER_MS) && (timeout > batch->timeout))) {
+		batch->timeout = timeout;
+	}
+
+	memcpy(&batch->buf[batch->len], buf, len);
+	batch->len += len;
+	full = (batch->len == sizeof(batch->buf));
+	STATS_ADD(data, tx_writes, 1);
+	irq_unlock(key);
+
+	if (full || (CONFIG_NRF_SW_LPUART_TX_QUEUE_LINGER == 0)) {
+		tx_queue_flush(data);
+	} else if (first) {
+		k_timer_start(&queue->linger_timer,
+			      K_USEC(CONFIG_NRF_SW_LPUART_TX_QUEUE_LINGER),
+			      K_NO_WAIT);
+	}
+
+	return len;
+}
+
+static size_t tx_queue_space_get(const struct lpuart_data *data)
+{
+	const struct lpuart_tx_queue *queue = &data->tx_queue;
+
+	return sizeof(queue->batch[0].buf) - queue->batch[queue->fill].len;
+}
+
+static void tx_queue_linger_timeout(struct k_timer *timer)
+{
+	struct lpuart_data *data = CONTAINER_OF(timer, struct lpuart_data,
+						tx_queue.linger_timer);
+
+	tx_queue_flush(data);
+}
+
+/* Empties the batch. Returns number of writes copied to @p writes. */
+static size_t tx_batch_reset(struct lpuart_tx_batch *batch,
+			     struct lpuart_tx_write *writes)
+{
+	size_t write_cnt = batch->write_cnt;
+
+	memcpy(writes, batch->writes, write_cnt * sizeof(writes[0]));
+	batch->len = 0;
+	batch->write_cnt = 0;
+
+	return write_cnt;
+}
+
+/* Called when the batch being sent is completed. Releases the TX buffer, starts
+ * sending the next batch and reports the completed writes to the user. If the
+ * transfer was aborted by uart_tx_abort, the batch being filled is reported as
+ * aborted as well.
+ */
+static void tx_queue_complete(struct lpuart_data *data, bool aborted)
+{
+	struct lpuart_tx_queue *queue = &data->tx_queue;
+	struct lpuart_tx_write writes[2 * CONFIG_NRF_SW_LPUART_TX_QUEUE_WRITES];
+	size_t sent_cnt;
+	size_t write_cnt;
+	bool abort;
+	int key;
+
+	/* The buffer is released in the same critical section, so that
+	 * a flush cannot switch batches before the sent one is reset.
+	 */
+	key = irq_lock();
+	if (data->tx_buf == NULL) {
+		/* Nothing was being sent. */
+		sent_cnt = 0;
+	} else {
+		data->tx_buf = NULL;
+		sent_cnt = tx_batch_reset(&queue->batch[queue->fill ^ 1],
+					  writes);
+	}
+	write_cnt = sent_cnt;
+	abort = queue->abort;
+	queue->abort = false;
+	if (abort) {
+		write_cnt += tx_batch_reset(&queue->batch[queue->fill],
+					    &writes[sent_cnt]);
+	}
+	irq_unlock(key);
+
+	if (abort) {
+		k_timer_stop(&queue->linger_timer);
+	} else {
+		tx_queue_flush(data);
+	}
+
+	for (size_t i = 0; i < write_cnt; i++) {
+		bool done = !aborted && (i < sent_cnt);
+		struct uart_event evt = {
+			.type = done ? UART_TX_DONE : UART_TX_ABORTED,
+			.data = {
+				.tx = {
+					.buf = writes[i].buf,
+					.len = done ? writes[i].len : 0
+				}
+			}
+		};
+
+		user_callback(data->dev, &evt);
+	}
+
+#if CONFIG_NRF_SW_LPUART_INT_DRIVEN
+	if (data->int_driven.tx_enabled) {
+		data->int_driven.callback(data->dev, data->int_driven.user_data);
+	}
+#endif
+}
+
+/* Aborts the batch being sent and drops the batch being filled. */
+static int tx_queue_abort(struct lpuart_data *data)
+{
+	struct lpuart_tx_queue *queue = &data->tx_queue;
+	bool pending;
+	int err;
+	int key;
+
+	k_timer_stop(&queue->linger_timer);
+
+	key = irq_lock();
+	pending = (data->tx_buf != NULL);
+	if (!pending && (queue->batch[queue->fill].len == 0)) {
+		irq_unlock(key);
+		return -EFAULT;
+	}
+
+	queue->abort = true;
+	irq_unlock(key);
+
+	if (pending) {
+		k_timer_stop(&data->tx_timer);
+
+		/* Batches are completed in the UART_TX_ABORTED event if the
+		 * transfer was started.
+		 */
+		err = uart_tx_abort(data->uart);
+		if (err != -EFAULT) {
+			return err;
+		}
+
+		STATS_ADD(data, tx_aborts, 1);
+	}
+
+	key = irq_lock();
+	tx_complete(data);
+	irq_unlock(key);
+
+	tx_queue_complete(data, true);
+
+	return 0;
+}
+#endif /* CONFIG_NRF_SW_LPUART_TX_QUEUE */
+
 static void uart_callback(const struct device *uart, struct uart_event *evt,
 			  void *user_data)
 {
@@ -397,23 +706,36 @@ static void uart_callback(const struct device *uart, struct uart_event *evt,
 	{
 		const uint8_t *txbuf = evt->data.tx.buf;
 
+		STATS_ADD(data, tx_bytes, evt->data.tx.len);
 		tx_complete(data);
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+		ARG_UNUSED(txbuf);
+		tx_queue_complete(data, false);
+#else
 		if (txbuf == (void *)&data->txbyte) {
 			data->txbyte = -1;
 		} else {
 			user_callback(dev, evt);
 		}
+#endif
 
 		break;
 	}
 	case UART_TX_ABORTED:
 		LOG_DBG("tx aborted");
+		STATS_ADD(data, tx_aborts, 1);
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+		tx_complete(data);
+		tx_queue_complete(data, true);
+#else
 		user_callback(dev, evt);
+#endif
 		break;
 
 	case UART_RX_RDY:
 		LOG_DBG("RX: Ready buf:%p, offset: %d,len: %d",
 		     evt->data.rx.buf, evt->data.rx.offset, evt->data.rx.len);
+		STATS_ADD(data, rx_bytes, evt->data.rx.len);
 		user_callback(dev, evt);
 		break;
 
@@ -468,7 +790,12 @@ static void tx_timeout(struct k_timer *timer)
 	}
 
 	tx_complete(data);
+	STATS_ADD(data, tx_aborts, 1);
 
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+	ARG_UNUSED(txbuf);
+	tx_queue_complete(data, true);
+#else
 	if (txbuf == (void *)&data->txbyte) {
 		data->txbyte = -1;
 	} else {
@@ -484,6 +811,7 @@ static void tx_timeout(struct k_timer *timer)
 
 		user_callback(dev, &evt);
 	}
+#endif
 }
 
 static int api_tx(const struct device *dev, const uint8_t *buf,
@@ -491,22 +819,38 @@ static int api_tx(const struct device *dev, const uint8_t *buf,
 {
 	struct lpuart_data *data = get_dev_data(dev);
 
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+	int ret;
+
+	if ((len == 0) || (len > CONFIG_NRF_SW_LPUART_TX_QUEUE_SIZE)) {
+		return -EINVAL;
+	}
+
+	LOG_DBG("tx len:%d", len);
+	ret = tx_queue_append(data, buf, len, timeout, true);
+
+	return (ret < 0) ? ret : 0;
+#else
 	if (!atomic_ptr_cas((atomic_ptr_t *)&data->tx_buf, NULL, (void *)buf)) {
 		return -EBUSY;
 	}
 
 	LOG_DBG("tx len:%d", len);
 	data->tx_len = len;
-	k_timer_start(&data->tx_timer, SYS_TIMEOUT_MS(timeout), K_NO_WAIT);
-
-	ctrl_pin_set(&data->req_pin, false);
+	STATS_ADD(data, tx_writes, 1);
+	tx_request(data, timeout);
 
 	return 0;
+#endif
 }
 
 static int api_tx_abort(const struct device *dev)
 {
 	struct lpuart_data *data = get_dev_data(dev);
+
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+	return tx_queue_abort(data);
+#else
 	const uint8_t *buf = data->tx_buf;
 	int err;
 	int key;
@@ -541,6 +885,7 @@ static int api_tx_abort(const struct device *dev)
 	user_callback(dev, &event);
 
 	return err;
+#endif
 }
 
 static int api_rx_enable(const struct device *dev, uint8_t *buf,
@@ -635,10 +980,12 @@ static void int_driven_evt_handler(const struct device *lpuart,
 	bool call_handler = false;
 
 	switch (evt->type) {
+#if !CONFIG_NRF_SW_LPUART_TX_QUEUE
 	case UART_TX_DONE:
 		data->int_driven.txlen = 0;
 		call_handler = true;
 		break;
+#endif
 	case UART_RX_RDY:
 		__ASSERT_NO_MSG(data->int_driven.rxlen == 0);
 		data->int_driven.rxlen = evt->data.rx.len;
@@ -701,6 +1048,14 @@ static int api_fifo_fill(const struct device *dev,
 			 int size)
 {
 	struct lpuart_data *data = get_dev_data(dev);
+
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+	int len = tx_queue_append(data, tx_data, size,
+				  CONFIG_NRF_SW_LPUART_DEFAULT_TX_TIMEOUT,
+				  false);
+
+	return (len < 0) ? 0 : len;
+#else
 	int err;
 
 	size = MIN(size, sizeof(data->int_driven.txbuf));
@@ -720,6 +1075,16 @@ static int api_fifo_fill(const struct device *dev,
 	}
 
 	return size;
+#endif
+}
+
+static bool int_driven_tx_ready(const struct lpuart_data *data)
+{
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+	return tx_queue_space_get(data) > 0;
+#else
+	return data->tx_buf == NULL;
+#endif
 }
 
 static void api_irq_tx_enable(const struct device *dev)
@@ -727,7 +1092,7 @@ static void api_irq_tx_enable(const struct device *dev)
 	struct lpuart_data *data = get_dev_data(dev);
 
 	data->int_driven.tx_enabled = true;
-	if (data->tx_buf == NULL) {
+	if (int_driven_tx_ready(data)) {
 		data->int_driven.callback(dev, data->int_driven.user_data);
 	}
 }
@@ -743,7 +1108,7 @@ static int api_irq_tx_ready(const struct device *dev)
 {
 	struct lpuart_data *data = get_dev_data(dev);
 
-	return data->int_driven.tx_enabled && (data->tx_buf == NULL);
+	return data->int_driven.tx_enabled && int_driven_tx_ready(data);
 }
 
 static void api_irq_callback_set(const struct device *dev,
@@ -833,9 +1198,16 @@ static int lpuart_init(const struct device *dev)
 		return -EINVAL;
 	}
 
+	data->dev = dev;
+
 	k_timer_init(&data->tx_timer, tx_timeout, NULL);
 	k_timer_user_data_set(&data->tx_timer, (void *)dev);
 
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+	k_timer_init(&data->tx_queue.linger_timer, tx_queue_linger_timeout,
+		     NULL);
+#endif
+
 	err = uart_callback_set(data->uart, uart_callback, (void *)dev);
 	if (err < 0) {
 		return -EINVAL;
@@ -869,6 +1241,19 @@ static void api_poll_out(const struct device *dev, unsigned char out_char)
 {
 	struct lpuart_data *data = get_dev_data(dev);
 	bool thread_ctx = !k_is_in_isr() && !k_is_pre_kernel();
+
+#if CONFIG_NRF_SW_LPUART_TX_QUEUE
+	/* Characters are aggregated in the queue and sent in one transfer. */
+	while (tx_queue_append(data, &out_char, 1,
+			       CONFIG_NRF_SW_LPUART_DEFAULT_TX_TIMEOUT,
+			       false) < 0) {
+		if (!thread_ctx) {
+			return;
+		}
+
+		k_msleep(1);
+	}
+#else
 	int err;
 
 	if (thread_ctx) {
@@ -889,7 +1274,31 @@ static void api_poll_out(const struct device *dev, unsigned char out_char)
 	if (err < 0) {
 		data->txbyte = -1;
 	}
+#endif
+}
+
+#if CONFIG_NRF_SW_LPUART_STATS
+void nrf_sw_lpuart_stats_get(const struct device *dev,
+			     struct nrf_sw_lpuart_stats *stats)
+{
+	const struct lpuart_data *data = get_dev_data(dev);
+	int key;
+
+	key = irq_lock();
+	*stats = data->stats;
+	irq_unlock(key);
+}
+
+void nrf_sw_lpuart_stats_reset(const struct device *dev)
+{
+	struct lpuart_data *data = get_dev_data(dev);
+	int key;
+
+	key = irq_lock();
+	memset(&data->stats, 0, sizeof(data->stats));
+	irq_unlock(key);
 }
+#endif /* CONFIG_NRF_SW_LPUART_STATS */
 
 static int api_configure(const struct device *dev, const struct uart_config *cfg)
 {
@@ -6,6 +6,7 @@
 #ifndef __CPU_LOAD_H
 #define __CPU_LOAD_H
 
+#include <stddef.h>
 #include <zephyr/types.h>
 
 #ifdef __cplusplus
@@ -46,6 +47,51 @@ void cpu_load_reset(void);
  */
 uint32_t cpu_load_get(void);
 
+struct k_thread;
+
+/** @brief Entry of the CPU load breakdown. */
+struct cpu_load_stats_entry {
+	/** Thread, or NULL if the entry describes an interrupt. The thread
+	 *  might have been aborted after the entry was obtained.
+	 */
+	const struct k_thread *thread;
+
+	/** Interrupt number, valid if @ref thread is NULL. */
+	int irq;
+
+	/** CPU load of the thread or interrupt in 0,001% units. */
+	uint32_t load;
+};
+
+/** @brief Get the threads and interrupts using the most CPU time.
+ *
+ * The breakdown is available if CONFIG_CPU_LOAD_STATS is enabled. The time
+ * is attributed by sampling the executed context with a fixed rate, so the
+ * result is statistical. The idle thread is not reported. The breakdown
+ * covers the same period as @ref cpu_load_get.
+ *
+ * @param[out] entries Array filled with entries sorted by descending load.
+ * @param[in]  count   Size of @p entries.
+ *
+ * @return Number of entries written to @p entries.
+ */
+size_t cpu_load_stats_get(struct cpu_load_stats_entry *entries, size_t count);
+
+/** @brief Get the name of a CPU load breakdown entry.
+ *
+ * The thread name is used if CONFIG_THREAD_NAME is enabled and the thread
+ * has a name. Otherwise, or if the thread has been aborted, the thread address
+ * or the interrupt number is used.
+ *
+ * @param[in]  entry Entry.
+ * @param[out] buf   Buffer for the name.
+ * @param[in]  len   Length of @p buf.
+ *
+ * @return @p buf
+ */
+const char *cpu_load_stats_name_get(const struct cpu_load_stats_entry *entry,
+				    char *buf, size_t len);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#ifndef __TRACE_POINT_H
+#define __TRACE_POINT_H
+
+#include <stddef.h>
+#include <zephyr/types.h>
+#include <sys/atomic.h>
+#include <sys/util.h>
+#include <toolchain.h>
+
+#if defined(CONFIG_TRACE_POINT) && !defined(CONFIG_BOARD_NATIVE_POSIX)
+#include <hal/nrf_timer.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup trace_point Trace points
+ * @brief Module for recording timestamped software events.
+ *
+ * @{
+ */
+
+/** @brief Trace point descriptor. */
+struct trace_point {
+	/** Name of the trace point. */
+	const char *name;
+};
+
+/** @brief Trace record. */
+struct trace_point_record {
+	/** Timestamp in ticks of the trace point timer. */
+	uint32_t timestamp;
+
+	/** Argument passed to @ref TRACE_POINT. */
+	uint32_t arg;
+
+	/** Index of the trace point, see @ref trace_point_get. */
+	uint16_t id;
+};
+
+/** @cond INTERNAL_HIDDEN */
+
+#ifdef CONFIG_TRACE_POINT
+
+struct trace_point_slot {
+	/* Index of the record stored in the slot, or TRACE_POINT_SEQ_BUSY of
+	 * the index while the record is being written.
+	 */
+	uint32_t seq;
+	struct trace_point_record record;
+};
+
+extern const struct trace_point _trace_point_list_start[];
+extern const struct trace_point _trace_point_list_end[];
+
+extern struct trace_point_slot trace_point_ring[];
+extern atomic_t trace_point_head;
+extern atomic_t trace_point_enabled;
+
+#define TRACE_POINT_RING_MASK (CONFIG_TRACE_POINT_BUF_SIZE - 1)
+
+/* Value that is never a valid index of a record stored in the slot. */
+#define TRACE_POINT_SEQ_BUSY(idx) ((uint32_t)(idx) - 1)
+
+#ifdef CONFIG_BOARD_NATIVE_POSIX
+uint32_t trace_point_timestamp_get(void);
+#else
+static inline uint32_t trace_point_timestamp_get(void)
+{
+	NRF_TIMER_Type *timer =
+		NRFX_CONCAT_2(NRF_TIMER, CONFIG_TRACE_POINT_TIMER_INSTANCE);
+
+	/* If the capture is preempted by another trace point, the timestamp
+	 * is taken later by the duration of the preemption.
+	 */
+	nrf_timer_task_trigger(timer, NRF_TIMER_TASK_CAPTURE0);
+	return nrf_timer_cc_get(timer, NRF_TIMER_CC_CHANNEL0);
+}
+#endif
+
+static inline void z_trace_point_record(const struct trace_point *tp,
+					uint32_t arg)
+{
+	struct trace_point_slot *slot;
+	uint32_t idx;
+
+	if (!atomic_get(&trace_point_enabled)) {
+		return;
+	}
+
+	/* Reserve the slot first, so that the writers preempting this one
+	 * use other slots. The oldest records are overwritten.
+	 */
+	idx = atomic_inc(&trace_point_head);
+	slot = &trace_point_ring[idx & TRACE_POINT_RING_MASK];
+
+	slot->seq = TRACE_POINT_SEQ_BUSY(idx);
+	compiler_barrier();
+
+	slot->record.timestamp = trace_point_timestamp_get();
+	slot->record.arg = arg;
+	slot->record.id = tp - _trace_point_list_start;
+
+	compiler_barrier();
+	slot->seq = idx;
+}
+
+#endif /* CONFIG_TRACE_POINT */
+
+/** @endcond */
+
+/** @brief Define a trace point.
+ *
+ * The trace point is registered at compile time. Its index in the table
+ * of trace points is stored in the records.
+ *
+ * @param _name Name of the trace point.
+ */
+#ifdef CONFIG_TRACE_POINT
+#define TRACE_POINT_DEFINE(_name)					       \
+	const Z_STRUCT_SECTION_ITERABLE(trace_point, _trace_point_##_name) = { \
+		.name = STRINGIFY(_name),				       \
+	}
+#else
+#define TRACE_POINT_DEFINE(_name) TRACE_POINT_DECLARE(_name)
+#endif
+
+/** @brief Declare a trace point defined in another file.
+ *
+ * @param _name Name of the trace point.
+ */
+#define TRACE_POINT_DECLARE(_name)					       \
+	extern const struct trace_point _trace_point_##_name
+
+/** @brief Record a trace point.
+ *
+ * The record contains the timestamp, the trace point and @p _arg. The macro
+ * can be used in interrupts. It compiles to nothing if CONFIG_TRACE_POINT
+ * is disabled, @p _arg is not evaluated then.
+ *
+ * @param _name Name of the trace point.
+ * @param _arg  32-bit argument stored in the record.
+ */
+#ifdef CONFIG_TRACE_POINT
+#define TRACE_POINT(_name, _arg)					       \
+	z_trace_point_record(&_trace_point_##_name, (uint32_t)(_arg))
+#else
+#define TRACE_POINT(_name, _arg) ((void)sizeof(_arg))
+#endif
+
+/** @brief Get a trace point by its index.
+ *
+ * @param id Index of the trace point.
+ *
+ * @return Trace point or NULL if @p id is invalid.
+ */
+const struct trace_point *trace_point_get(uint16_t id);
+
+/** @brief Get the frequency of the trace point timer.
+ *
+ * @return Frequency of the timer in Hz.
+ */
+uint32_t trace_point_timestamp_freq_get(void);
+
+/** @brief Initialize the trace points.
+ *
+ * Start the timer used for timestamps and enable the recording.
+ *
+ * @return 0 on success or negative error code.
+ */
+int trace_point_init(void);
+
+/** @brief Enable or disable recording of trace points.
+ *
+ * @param enable Enable recording.
+ */
+void trace_point_enable(bool enable);
+
+/** @brief Read the oldest trace records.
+ *
+ * Records read by this function are removed from the buffer. If the writers
+ * overwrote records that were not read, the number of lost records is
+ * reported.
+ *
+ * @param[out] records Array filled with the records, from the oldest.
+ * @param[in]  count   Size of @p records.
+ * @param[out] lost    Number of lost records. Can be NULL.
+ *
+ * @return Number of records written to @p records.
+ */
+size_t trace_point_read(struct trace_point_record *records, size_t count,
+			uint32_t *lost);
+
+/** @brief Read all trace records and send them to the dump backend.
+ *
+ * @return Number of dumped records.
+ */
+size_t trace_point_dump(void);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRACE_POINT_H */
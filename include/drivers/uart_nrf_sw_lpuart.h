@@ -0,0 +1,71 @@
+/**
+ * @file uart_nrf_sw_lpuart.h
+ *
+ * @brief Public APIs for the low power UART driver.
+ */
+
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#ifndef ZEPHYR_INCLUDE_UART_NRF_SW_LPUART_H_
+#define ZEPHYR_INCLUDE_UART_NRF_SW_LPUART_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <device.h>
+#include <zephyr/types.h>
+
+/** @brief Low power UART statistics.
+ *
+ * Handshake overhead per byte is @ref tx_handshake_us divided by
+ * @ref tx_bytes. Wake-ups per byte are @ref rx_wakeups divided by
+ * @ref rx_bytes.
+ */
+struct nrf_sw_lpuart_stats {
+	/** Number of writes: uart_tx, uart_poll_out and uart_fifo_fill calls. */
+	uint32_t tx_writes;
+
+	/** Number of TX handshakes. Every handshake starts one transfer. */
+	uint32_t tx_handshakes;
+
+	/** Total time from the TX request to the receiver readiness. */
+	uint32_t tx_handshake_us;
+
+	/** Number of transmitted bytes. */
+	uint32_t tx_bytes;
+
+	/** Number of transfers that timed out or were aborted. */
+	uint32_t tx_aborts;
+
+	/** Number of times the receiver was woken up by the peer. */
+	uint32_t rx_wakeups;
+
+	/** Number of received bytes. */
+	uint32_t rx_bytes;
+};
+
+/** @brief Get the statistics of the low power UART.
+ *
+ * Available if CONFIG_NRF_SW_LPUART_STATS is enabled.
+ *
+ * @param dev   Low power UART device.
+ * @param stats Statistics.
+ */
+void nrf_sw_lpuart_stats_get(const struct device *dev,
+			     struct nrf_sw_lpuart_stats *stats);
+
+/** @brief Reset the statistics of the low power UART.
+ *
+ * @param dev Low power UART device.
+ */
+void nrf_sw_lpuart_stats_reset(const struct device *dev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZEPHYR_INCLUDE_UART_NRF_SW_LPUART_H_ */
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef GPS_TRACK_H__
+#define GPS_TRACK_H__
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <drivers/gps.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file gps_track.h
+ *
+ * @defgroup gps_track GPS track compression
+ * @{
+ * @brief Library for collecting GPS fixes into compressed track segments.
+ *
+ * Fixes are stored in fixed point and simplified as they arrive: a fix
+ * is only written to the segment when the track cannot be reconstructed
+ * within a given tolerance by interpolating between the written fixes.
+ * Written fixes are delta encoded, which makes a segment an order of
+ * magnitude smaller than sending each fix on its own.
+ *
+ * A segment starts with a version byte, followed by the first fix as a
+ * little-endian 32-bit time in seconds since the epoch and 32-bit
+ * latitude and longitude in microdegrees. Each following fix is encoded
+ * as the difference from the previous one: the time as an unsigned
+ * LEB128 varint, and the latitude and longitude as zigzag encoded
+ * varints.
+ */
+
+/** Version of the segment format. */
+#define GPS_TRACK_FORMAT_VERSION 1
+
+/** Size of the version and the first fix of a segment. */
+#define GPS_TRACK_HEADER_SIZE 13
+
+/** Largest size of a delta encoded fix. */
+#define GPS_TRACK_POINT_MAX_SIZE 15
+
+/** @brief Position and time of a fix. */
+struct gps_track_point {
+	/** Time in seconds since the epoch. */
+	uint32_t time;
+	/** Latitude in microdegrees. */
+	int32_t lat;
+	/** Longitude in microdegrees. */
+	int32_t lng;
+};
+
+/** @brief Fix given to the track.
+ *
+ * The speed and heading are used to keep the fixes where the direction
+ * changes, but are not part of the segment.
+ */
+struct gps_track_fix {
+	struct gps_track_point point;
+	/** Speed in centimeters per second. */
+	uint16_t speed;
+	/** Heading in degrees, 0 to 359. */
+	uint16_t heading;
+};
+
+/** @brief Track configuration. */
+struct gps_track_config {
+	/** Largest distance in meters between a dropped fix and the track
+	 *  reconstructed from the written fixes.
+	 */
+	uint16_t tolerance;
+	/** Change of heading in degrees after which a fix is written even
+	 *  if it is within the tolerance, or 0 to only use the tolerance.
+	 */
+	uint16_t turn_angle;
+	/** Distance in meters from the start of the segment after which a
+	 *  flush is requested, or 0 to not request flushes on motion.
+	 */
+	uint32_t flush_distance;
+};
+
+/** @brief Track context.
+ *
+ * The members are internal to the library.
+ */
+struct gps_track {
+	struct gps_track_config cfg;
+	/* Tolerance and flush distance squared, in microdegrees. */
+	int64_t tolerance_sq;
+	int64_t flush_distance_sq;
+	uint8_t *buf;
+	size_t size;
+	size_t len;
+	/* First fix of the segment. */
+	struct gps_track_point start;
+	/* Last fix written to the segment. */
+	struct gps_track_fix anchor;
+	/* Scale of longitude to latitude differences at the anchor, Q16. */
+	int32_t lng_scale;
+	/* Fixes received after the anchor that are not written yet. */
+	struct gps_track_point window[CONFIG_GPS_TRACK_WINDOW_SIZE];
+	struct gps_track_fix last;
+	uint8_t window_len;
+	bool flushed;
+};
+
+/** @brief Segment reader context.
+ *
+ * The members are internal to the library.
+ */
+struct gps_track_reader {
+	const uint8_t *data;
+	size_t len;
+	size_t offset;
+	struct gps_track_point last;
+};
+
+/** @brief Initialize a track.
+ *
+ * @param track Track.
+ * @param cfg   Configuration.
+ * @param buf   Buffer for the encoded segment. It must fit the header
+ *              and at least two fixes.
+ * @param size  Size of @p buf.
+ *
+ * @retval 0 If the track was initialized.
+ * @retval -EINVAL If the buffer is too small.
+ */
+int gps_track_init(struct gps_track *track, const struct gps_track_config *cfg,
+		   uint8_t *buf, size_t size);
+
+/** @brief Convert a position fix from a GPS device.
+ *
+ * @param pvt Fix from the GPS device.
+ * @param fix Converted fix.
+ */
+void gps_track_fix_from_pvt(const struct gps_pvt *pvt,
+			    struct gps_track_fix *fix);
+
+/** @brief Add a fix to the track.
+ *
+ * @param track Track.
+ * @param fix   Fix to add.
+ *
+ * @retval 0 If the fix was added.
+ * @retval 1 If the fix was added and the segment should be flushed,
+ *           because it is almost full or the device moved more than the
+ *           flush distance.
+ * @retval -EINVAL If the fix is not newer than the previous one. The fix
+ *                 is ignored.
+ * @retval -ENOMEM If the segment is full. The fix is ignored.
+ */
+int gps_track_add(struct gps_track *track, const struct gps_track_fix *fix);
+
+/** @brief End the current segment.
+ *
+ * The last fix is written, and the segment is kept in the buffer given
+ * to @ref gps_track_init until the next fix is added, which starts a new
+ * segment.
+ *
+ * @param track Track.
+ *
+ * @return Length of the segment, or 0 if no fixes were added since the
+ *         last flush.
+ */
+size_t gps_track_flush(struct gps_track *track);
+
+/** @brief Start reading an encoded segment.
+ *
+ * @param reader Reader.
+ * @param data   Segment.
+ * @param len    Length of the segment.
+ *
+ * @retval 0 If the segment header is valid.
+ * @retval -EBADMSG If the segment is too short or has another version.
+ */
+int gps_track_reader_init(struct gps_track_reader *reader,
+			  const uint8_t *data, size_t len);
+
+/** @brief Read the next fix of a segment.
+ *
+ * @param reader Reader.
+ * @param point  Fix read.
+ *
+ * @retval 0 If a fix was read.
+ * @retval -ENODATA If all fixes were read.
+ * @retval -EBADMSG If the segment is malformed.
+ */
+int gps_track_read(struct gps_track_reader *reader,
+		   struct gps_track_point *point);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GPS_TRACK_H__ */
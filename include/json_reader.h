@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef JSON_READER_H__
+#define JSON_READER_H__
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file json_reader.h
+ *
+ * @defgroup json_reader In-place JSON reader
+ * @{
+ * @brief Library for reading selected values from a JSON document.
+ *
+ * The document is split into an array of tokens provided by the caller.
+ * Tokens refer to the original buffer instead of copying the values, so
+ * no memory is allocated. Values are then looked up by member name or by
+ * JSON pointer (RFC 6901), and converted only when they are read.
+ *
+ * Tokens are referred to by their index. Lookup functions return a
+ * negative error code when a value is not found, and all functions that
+ * take a token index accept such an error code, which makes it possible
+ * to chain lookups and check the result only once.
+ */
+
+/** Maximum length of a document. */
+#define JSON_READER_MAX_LEN UINT16_MAX
+
+/** @brief JSON value types. */
+enum json_token_type {
+	/** No value, for example because a lookup failed. */
+	JSON_TOKEN_NONE,
+	JSON_TOKEN_OBJECT,
+	JSON_TOKEN_ARRAY,
+	JSON_TOKEN_STRING,
+	JSON_TOKEN_NUMBER,
+	JSON_TOKEN_BOOL,
+	JSON_TOKEN_NULL,
+};
+
+/** @brief Token of a JSON document.
+ *
+ * Object members are stored as a string token for the name, followed by
+ * the tokens of the value. The members are internal to the library and
+ * must not be accessed directly.
+ */
+struct json_token {
+	/** Offset of the value, after the quote for strings. */
+	uint16_t start;
+	/** Offset after the value, at the quote for strings. */
+	uint16_t end;
+	/** Number of members of an object or elements of an array. */
+	uint16_t size;
+	/** Index of the token following the value and its children. */
+	uint16_t next;
+	/** Type of the value, see @ref json_token_type. */
+	uint8_t type;
+};
+
+/** @brief JSON reader context. */
+struct json_reader {
+	/** Document. */
+	const char *json;
+	/** Token array. */
+	struct json_token *tokens;
+	/** Number of tokens in use. */
+	size_t count;
+};
+
+/** @brief Split a JSON document into tokens.
+ *
+ * The document must remain valid as long as the reader is used. The
+ * root value of the document is token 0.
+ *
+ * @param r          Reader to initialize.
+ * @param json       Document. It does not need to be null-terminated.
+ * @param len        Length of the document.
+ * @param tokens     Token array.
+ * @param max_tokens Number of tokens in the array.
+ *
+ * @retval >0 Number of tokens used.
+ * @retval -ENOMEM The document has more values than @p max_tokens.
+ * @retval -EMSGSIZE The document is longer than @ref JSON_READER_MAX_LEN.
+ * @retval -EINVAL The document is not valid JSON.
+ */
+int json_reader_parse(struct json_reader *r, const char *json, size_t len,
+		      struct json_token *tokens, size_t max_tokens);
+
+/** @brief Get the type of a value.
+ *
+ * @param r   Reader.
+ * @param tok Token index, or a negative error code.
+ *
+ * @return Type of the value, or JSON_TOKEN_NONE if @p tok is not valid.
+ */
+enum json_token_type json_reader_type(const struct json_reader *r, int tok);
+
+/** @brief Find an object member by name.
+ *
+ * @param r    Reader.
+ * @param tok  Token index of an object, or a negative error code.
+ * @param name Member name.
+ *
+ * @return Token index of the member value, or -ENOENT if there is no
+ *         such member.
+ */
+int json_reader_member(const struct json_reader *r, int tok,
+		       const char *name);
+
+/** @brief Find a value by JSON pointer.
+ *
+ * The pointer is evaluated relative to @p tok, so that for example
+ * "/state/config" finds the "config" member of the "state" object, and
+ * "/items/0" finds the first element of the "items" array. An empty
+ * pointer refers to @p tok itself.
+ *
+ * @param r       Reader.
+ * @param tok     Token index, or a negative error code.
+ * @param pointer JSON pointer.
+ *
+ * @return Token index of the value, or -ENOENT if it does not exist.
+ */
+int json_reader_find(const struct json_reader *r, int tok,
+		     const char *pointer);
+
+/** @brief Compare a string value.
+ *
+ * @param r   Reader.
+ * @param tok Token index, or a negative error code.
+ * @param str Null-terminated string.
+ *
+ * @return true if the value is a string equal to @p str, after
+ *         unescaping.
+ */
+bool json_reader_str_eq(const struct json_reader *r, int tok,
+			const char *str);
+
+/** @brief Copy a string value.
+ *
+ * The string is unescaped and copied to @p buf. If it does not fit, it
+ * is truncated. The copy is always null-terminated.
+ *
+ * @param r    Reader.
+ * @param tok  Token index, or a negative error code.
+ * @param buf  Output buffer.
+ * @param size Size of the output buffer.
+ *
+ * @return Length of the unescaped string, which is @p size or more if
+ *         it was truncated. -EINVAL if the value is not a string.
+ */
+int json_reader_str_copy(const struct json_reader *r, int tok, char *buf,
+			 size_t size);
+
+/** @brief Unescape a string value in place.
+ *
+ * The string is unescaped within the document and null-terminated by
+ * overwriting its closing quote, which requires the document to be
+ * writable. The token must not be read again afterwards.
+ *
+ * @param r    Reader.
+ * @param tok  Token index, or a negative error code.
+ * @param json The document that was given to @ref json_reader_parse.
+ *
+ * @return Pointer to the string within @p json, or NULL if the value is
+ *         not a string.
+ */
+char *json_reader_str_inplace(const struct json_reader *r, int tok,
+			      char *json);
+
+/** @brief Read a number.
+ *
+ * @param r   Reader.
+ * @param tok Token index, or a negative error code.
+ * @param val Value.
+ *
+ * @retval 0 If the operation was successful.
+ * @retval -EINVAL The value is not a number.
+ */
+int json_reader_num(const struct json_reader *r, int tok, double *val);
+
+/** @brief Read a boolean.
+ *
+ * @param r   Reader.
+ * @param tok Token index, or a negative error code.
+ * @param val Value.
+ *
+ * @retval 0 If the operation was successful.
+ * @retval -EINVAL The value is not a boolean.
+ */
+int json_reader_bool(const struct json_reader *r, int tok, bool *val);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JSON_READER_H__ */
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef JSON_WRITER_H__
+#define JSON_WRITER_H__
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file json_writer.h
+ *
+ * @defgroup json_writer Streaming JSON writer
+ * @{
+ * @brief Library for writing JSON documents directly to a buffer.
+ *
+ * The writer emits compact (unformatted) JSON into a buffer provided by
+ * the caller, without building an intermediate object tree and without
+ * using the heap.
+ *
+ * Errors are sticky: once a call fails, all following calls are
+ * ignored and the first error is reported by @ref json_writer_finish.
+ * This allows a document to be written with a sequence of calls and
+ * checked only once at the end.
+ */
+
+/** Maximum nesting depth of objects and arrays. */
+#define JSON_WRITER_MAX_DEPTH 31
+
+/** @brief JSON writer context.
+ *
+ * The members are internal to the library and must not be accessed
+ * directly.
+ */
+struct json_writer {
+	/** Output buffer, or NULL when only measuring the length. */
+	char *buf;
+	/** Size of the output buffer. */
+	size_t size;
+	/** Number of characters of the document written so far. */
+	size_t len;
+	/** Bit n is set when nothing has been written at depth n yet. */
+	uint32_t empty;
+	/** Bit n is set when the container at depth n is an object. */
+	uint32_t object;
+	/** Current nesting depth. */
+	uint8_t depth;
+	/** First error that occurred, or 0. */
+	int err;
+};
+
+/** @brief Initialize a JSON writer.
+ *
+ * If @p buf is NULL, nothing is written and the writer only computes
+ * the length of the document. This can be used to allocate a buffer of
+ * the exact size before writing the document a second time.
+ *
+ * @param w    Writer to initialize.
+ * @param buf  Output buffer, or NULL.
+ * @param size Size of the output buffer, including the null terminator.
+ */
+void json_writer_init(struct json_writer *w, char *buf, size_t size);
+
+/** @brief Open an object.
+ *
+ * @param w   Writer.
+ * @param key Member name if the enclosing container is an object,
+ *            NULL otherwise.
+ *
+ * @return 0 or the first error that occurred on the writer.
+ */
+int json_writer_object_begin(struct json_writer *w, const char *key);
+
+/** @brief Close the innermost object.
+ *
+ * @param w Writer.
+ *
+ * @return 0 or the first error that occurred on the writer.
+ */
+int json_writer_object_end(struct json_writer *w);
+
+/** @brief Open an array.
+ *
+ * @param w   Writer.
+ * @param key Member name if the enclosing container is an object,
+ *            NULL otherwise.
+ *
+ * @return 0 or the first error that occurred on the writer.
+ */
+int json_writer_array_begin(struct json_writer *w, const char *key);
+
+/** @brief Close the innermost array.
+ *
+ * @param w Writer.
+ *
+ * @return 0 or the first error that occurred on the writer.
+ */
+int json_writer_array_end(struct json_writer *w);
+
+/** @brief Write a string value, escaped as required by JSON.
+ *
+ * @param w   Writer.
+ * @param key Member name, or NULL inside an array.
+ * @param str Null-terminated string. NULL is written as a JSON null.
+ *
+ * @return 0 or the first error that occurred on the writer.
+ */
+int json_writer_str(struct json_writer *w, const char *key, const char *str);
+
+/** @brief Write an integer value.
+ *
+ * @param w   Writer.
+ * @param key Member name, or NULL inside an array.
+ * @param val Value.
+ *
+ * @return 0 or the first error that occurred on the writer.
+ */
+int json_writer_int(struct json_writer *w, const char *key, int64_t val);
+
+/** @brief Write a floating-point value.
+ *
+ * Integral values are written without a fraction, other values with
+ * up to 15 significant digits, so the written value may differ from
+ * @p val in the last digits. NaN and infinity are not valid JSON and
+ * are written as null.
+ *
+ * @param w   Writer.
+ * @param key Member name, or NULL inside an array.
+ * @param val Value.
+ *
+ * @return 0 or the first error that occurred on the writer.
+ */
+int json_writer_num(struct json_writer *w, const char *key, double val);
+
+/** @brief Write a boolean value.
+ *
+ * @param w   Writer.
+ * @param key Member name, or NULL inside an array.
+ * @param val Value.
+ *
+ * @return 0 or the first error that occurred on the writer.
+ */
+int json_writer_bool(struct json_writer *w, const char *key, bool val);
+
+/** @brief Write a null value.
+ *
+ * @param w   Writer.
+ * @param key Member name, or NULL inside an array.
+ *
+ * @return 0 or the first error that occurred on the writer.
+ */
+int json_writer_null(struct json_writer *w, const char *key);
+
+/** @brief Complete the document.
+ *
+ * Checks that all containers are closed and null-terminates the output.
+ *
+ * @param w Writer.
+ *
+ * @retval >=0 Length of the document, excluding the null terminator.
+ * @retval -ENOMEM The document does not fit in the buffer.
+ * @retval -EINVAL The document is not well formed, for example because
+ *                 a container is not closed or a key is missing.
+ */
+int json_writer_finish(struct json_writer *w);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JSON_WRITER_H__ */
@@ -11,6 +11,14 @@
 #include <cJSON.h>
 #endif
 
+#ifdef CONFIG_TINYCBOR
+#include <tinycbor/cbor.h>
+#endif
+
+#ifdef CONFIG_JSON_WRITER
+#include <json_writer.h>
+#endif
+
 #include <modem/at_params.h>
 
 #ifdef __cplusplus
@@ -67,6 +75,22 @@ enum modem_info {
 	MODEM_INFO_COUNT,	/**< Number of legal elements in the enum. */
 };
 
+/**@brief Additional keys used in the CBOR encoding.
+ *
+ * Modem parameters are keyed by their @ref modem_info type. These keys
+ * are used for the parameter groups and the values that do not have a
+ * type of their own.
+ */
+enum modem_info_cbor_key {
+	MODEM_INFO_CBOR_KEY_NETWORK = MODEM_INFO_COUNT, /**< Network map. */
+	MODEM_INFO_CBOR_KEY_SIM,	  /**< SIM card map. */
+	MODEM_INFO_CBOR_KEY_DEVICE,	  /**< Device map. */
+	MODEM_INFO_CBOR_KEY_NETWORK_MODE, /**< Network mode string. */
+	MODEM_INFO_CBOR_KEY_BOARD,	  /**< Board name. */
+	MODEM_INFO_CBOR_KEY_APP_VERSION,  /**< Application version. */
+	MODEM_INFO_CBOR_KEY_APP_NAME,	  /**< Application name. */
+};
+
 /**@brief LTE parameter data. **/
 struct lte_param {
 	uint16_t value; /**< The retrieved value. */
@@ -226,6 +250,42 @@ int modem_info_json_object_encode(struct modem_param_info *modem,
 				  cJSON *root_obj);
 #endif
 
+#ifdef CONFIG_TINYCBOR
+/** @brief Encode the modem parameters in CBOR.
+ *
+ * The network, SIM card and device parameters are added as nested maps
+ * to an open CBOR map, with the keys defined by @ref modem_info and
+ * @ref modem_info_cbor_key. The data is written directly to the buffer
+ * of the encoder.
+ *
+ * @param modem Pointer to the modem parameter structure.
+ * @param map   Encoder of an open CBOR map.
+ *
+ * @return Number of maps added if the operation was successful.
+ *         Otherwise, a (negative) error code is returned.
+ */
+int modem_info_cbor_encode(struct modem_param_info *modem,
+			   CborEncoder *map);
+#endif
+
+#ifdef CONFIG_JSON_WRITER
+/** @brief Write the modem parameters as JSON.
+ *
+ * The network, SIM card and device parameters are written as nested
+ * objects to an open JSON object, with the same member names as
+ * @ref modem_info_json_object_encode. No memory is allocated.
+ *
+ * @param modem Pointer to the modem parameter structure.
+ * @param w     Writer with an open JSON object.
+ *
+ * @return Number of JSON objects written if the operation was
+ *         successful.
+ *         Otherwise, a (negative) error code is returned.
+ */
+int modem_info_json_write(struct modem_param_info *modem,
+			  struct json_writer *w);
+#endif
+
 /** @brief Obtain the modem parameters.
  *
  * The data is stored in the provided info structure.
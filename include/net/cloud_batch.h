@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef ZEPHYR_INCLUDE_CLOUD_BATCH_H_
+#define ZEPHYR_INCLUDE_CLOUD_BATCH_H_
+
+/**
+ * @brief Cloud message batching
+ * @defgroup cloud_batch Cloud message batching
+ * @ingroup cloud_api
+ * @{
+ */
+
+#include <zephyr.h>
+#include <net/cloud.h>
+
+/**@brief Priority of a batched message. */
+enum cloud_batch_prio {
+	/** The message is buffered until the batch is flushed. */
+	CLOUD_BATCH_PRIO_LOW,
+	/** The message and all buffered messages are sent immediately. */
+	CLOUD_BATCH_PRIO_HIGH,
+
+	CLOUD_BATCH_PRIO_COUNT
+};
+
+/**@brief Initialize message batching.
+ *
+ * @param backend Pointer to the cloud backend that batches are sent to.
+ *
+ * @return 0 or a negative error code indicating reason of failure.
+ */
+int cloud_batch_init(const struct cloud_backend *const backend);
+
+/**@brief Add a message to the batch.
+ *
+ * The message payload is copied, so the caller may release it when this
+ * function returns. Each payload must be a complete JSON value. The batch
+ * is sent as a single JSON array in one cloud_send() call when it reaches
+ * @option{CONFIG_CLOUD_BATCH_FLUSH_SIZE} bytes, when the oldest message has
+ * been buffered for @option{CONFIG_CLOUD_BATCH_FLUSH_TIME} seconds, when a
+ * message with @ref CLOUD_BATCH_PRIO_HIGH is added, or when a message for
+ * a different endpoint is added.
+ *
+ * The batch is sent with the highest QoS of the messages it contains.
+ *
+ * @param msg  Pointer to the cloud message.
+ * @param prio Priority of the message.
+ *
+ * If cloud_send() fails, the buffered messages are kept and the send is
+ * retried after @option{CONFIG_CLOUD_BATCH_FLUSH_TIME} seconds. If the
+ * buffered messages had to be sent before @p msg could be added, because
+ * of an endpoint change or a full buffer, and that failed, @p msg is not
+ * added.
+ *
+ * @retval 0 If the message was added, or sent as part of a batch.
+ * @retval -EMSGSIZE If the message does not fit in an empty batch.
+ * @return Otherwise, the first error code from cloud_send().
+ */
+int cloud_batch_add(const struct cloud_msg *const msg,
+		    enum cloud_batch_prio prio);
+
+/**@brief Send all buffered messages.
+ *
+ * The messages are kept if the send fails.
+ *
+ * @return 0 or a negative error code indicating reason of failure.
+ */
+int cloud_batch_flush(void);
+
+/**@brief Drop all buffered messages without sending them. */
+void cloud_batch_clear(void);
+
+/**@brief Get the number of buffered messages.
+ *
+ * @return Number of messages waiting in the batch.
+ */
+size_t cloud_batch_count(void);
+
+/**
+ * @}
+ */
+
+#endif /* ZEPHYR_INCLUDE_CLOUD_BATCH_H_ */
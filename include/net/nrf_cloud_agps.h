@@ -23,6 +23,10 @@ extern "C" {
  */
 
 /**@brief Requests specified A-GPS data from nRF Cloud.
+ *
+ * If CONFIG_NRF_CLOUD_AGPS_CACHE is enabled, cached data that is still
+ * valid is injected into the modem first, and only the remaining data is
+ * requested.
  *
  * @param request Structure containing specified A-GPS data to be requested.
  *
@@ -48,6 +52,38 @@ int nrf_cloud_agps_request_all(void);
  */
 int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket);
 
+/**@brief Starts processing binary A-GPS data received in fragments.
+ *
+ * Each element is injected into the modem as soon as it is complete, so
+ * the response does not have to be stored in full. The fragments are
+ * passed to @ref nrf_cloud_agps_process_fragment and the end of the data
+ * is signaled with @ref nrf_cloud_agps_process_end.
+ *
+ * @param socket Pointer to GNSS socket to which A-GPS data will be injected.
+ *		 If NULL, the nRF9160 GPS driver is used to inject the data.
+ *
+ * @return 0 if successful, otherwise a (negative) error code.
+ */
+int nrf_cloud_agps_process_begin(const int *socket);
+
+/**@brief Processes a fragment of binary A-GPS data.
+ *
+ * @param buf Pointer to the fragment. It can be split at any byte.
+ * @param len Length of the fragment.
+ *
+ * @retval 0 If successful.
+ * @retval -EBADMSG The data is malformed. The rest of the data is rejected.
+ * @return Other (negative) error code if the data could not be injected.
+ */
+int nrf_cloud_agps_process_fragment(const char *buf, size_t len);
+
+/**@brief Ends processing of binary A-GPS data received in fragments.
+ *
+ * @retval 0 If all data was processed.
+ * @retval -EBADMSG The data was truncated or malformed.
+ */
+int nrf_cloud_agps_process_end(void);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -23,6 +23,13 @@ enum pmw3360_attribute {
 	PMW3360_ATTR_REST3_SAMPLE_TIME,
 };
 
+enum pmw3360_channel {
+	/** Surface quality, available with CONFIG_PMW3360_BURST_QUALITY. */
+	PMW3360_CHAN_SQUAL = SENSOR_CHAN_PRIV_START,
+	/** Shutter time, available with CONFIG_PMW3360_BURST_QUALITY. */
+	PMW3360_CHAN_SHUTTER,
+};
+
 #define PMW3360_SVALUE_TO_CPI(svalue) ((uint32_t)(svalue).val1)
 #define PMW3360_SVALUE_TO_TIME(svalue) ((uint32_t)(svalue).val1)
 #define PMW3360_SVALUE_TO_BOOL(svalue) ((svalue).val1 != 0)
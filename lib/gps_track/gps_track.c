@@ -0,0 +1,336 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <sys/byteorder.h>
+#include <sys/timeutil.h>
+#include <gps_track.h>
+
+/* Microdegrees of latitude per kilometer. */
+#define UDEG_PER_KM 8993
+
+/* Below this speed in centimeters per second, the heading is noise. */
+#define TURN_MIN_SPEED 100
+
+/* Half a turn in millidegrees squared, for the cosine approximation. */
+#define HALF_TURN_MDEG_SQ (180000LL * 180000LL)
+
+static int64_t meters_to_udeg_sq(uint32_t meters)
+{
+	int64_t udeg = (int64_t)meters * UDEG_PER_KM / 1000;
+
+	return udeg * udeg;
+}
+
+/* Cosine of the latitude in Q16, which scales longitude differences to
+ * the same length as latitude differences. Bhaskara's approximation is
+ * within 0.2 %, which is more than enough for a tolerance.
+ */
+static int32_t lng_scale_get(int32_t lat)
+{
+	int64_t mdeg_sq = (int64_t)(lat / 1000) * (lat / 1000);
+
+	return (int32_t)(((HALF_TURN_MDEG_SQ - 4 * mdeg_sq) << 16) /
+			 (HALF_TURN_MDEG_SQ + mdeg_sq));
+}
+
+static int64_t dist_sq(const struct gps_track *track, int64_t dlat,
+		       int64_t dlng)
+{
+	int64_t dx = (dlng * track->lng_scale) >> 16;
+
+	return dlat * dlat + dx * dx;
+}
+
+static uint16_t heading_diff(uint16_t a, uint16_t b)
+{
+	uint16_t diff = (a > b) ? (a - b) : (b - a);
+
+	return (diff > 180) ? (360 - diff) : diff;
+}
+
+static size_t varint_put(uint8_t *buf, uint32_t value)
+{
+	size_t len = 0;
+
+	while (value >= 0x80) {
+		buf[len++] = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+
+	buf[len++] = value;
+
+	return len;
+}
+
+static uint32_t zigzag(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static void anchor_set(struct gps_track *track, const struct gps_track_fix *fix)
+{
+	track->anchor = *fix;
+	track->lng_scale = lng_scale_get(fix->point.lat);
+	track->window_len = 0;
+}
+
+static void segment_start(struct gps_track *track,
+			  const struct gps_track_fix *fix)
+{
+	uint8_t *buf = track->buf;
+
+	buf[0] = GPS_TRACK_FORMAT_VERSION;
+	sys_put_le32(fix->point.time, &buf[1]);
+	sys_put_le32((uint32_t)fix->point.lat, &buf[5]);
+	sys_put_le32((uint32_t)fix->point.lng, &buf[9]);
+
+	track->len = GPS_TRACK_HEADER_SIZE;
+	track->start = fix->point;
+	track->flushed = false;
+
+	anchor_set(track, fix);
+}
+
+/* Write a fix as the difference from the anchor. */
+static void point_write(struct gps_track *track,
+			const struct gps_track_point *point)
+{
+	const struct gps_track_point *prev = &track->anchor.point;
+	uint8_t *buf = &track->buf[track->len];
+
+	buf += varint_put(buf, point->time - prev->time);
+	buf += varint_put(buf, zigzag(point->lat - prev->lat));
+	buf += varint_put(buf, zigzag(point->lng - prev->lng));
+
+	track->len = buf - track->buf;
+}
+
+/* Check whether the fixes after the anchor can be dropped if the track
+ * continues in a straight line from the anchor to the new fix. Each
+ * dropped fix is compared with the position interpolated at its time.
+ */
+static bool window_covered(const struct gps_track *track,
+			   const struct gps_track_fix *fix)
+{
+	const struct gps_track_point *a = &track->anchor.point;
+	const struct gps_track_point *p = &fix->point;
+	int64_t dt = p->time - a->time;
+	int64_t dlat = p->lat - a->lat;
+	int64_t dlng = p->lng - a->lng;
+
+	if (track->window_len >= ARRAY_SIZE(track->window)) {
+		return false;
+	}
+
+	if ((track->cfg.turn_angle > 0) &&
+	    (track->anchor.speed >= TURN_MIN_SPEED) &&
+	    (fix->speed >= TURN_MIN_SPEED) &&
+	    (heading_diff(track->anchor.heading, fix->heading) >
+	     track->cfg.turn_angle)) {
+		return false;
+	}
+
+	for (size_t i = 0; i < track->window_len; i++) {
+		const struct gps_track_point *w = &track->window[i];
+		int64_t wt = w->time - a->time;
+		int64_t lat = a->lat + dlat * wt / dt;
+		int64_t lng = a->lng + dlng * wt / dt;
+
+		if (dist_sq(track, w->lat - lat, w->lng - lng) >
+		    track->tolerance_sq) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static size_t room_left(const struct gps_track *track)
+{
+	return track->size - track->len;
+}
+
+int gps_track_init(struct gps_track *track, const struct gps_track_config *cfg,
+		   uint8_t *buf, size_t size)
+{
+	__ASSERT_NO_MSG(track != NULL);
+	__ASSERT_NO_MSG(cfg != NULL);
+	__ASSERT_NO_MSG(buf != NULL);
+
+	if (size < GPS_TRACK_HEADER_SIZE + 2 * GPS_TRACK_POINT_MAX_SIZE) {
+		return -EINVAL;
+	}
+
+	memset(track, 0, sizeof(*track));
+	track->cfg = *cfg;
+	track->tolerance_sq = meters_to_udeg_sq(cfg->tolerance);
+	track->flush_distance_sq = meters_to_udeg_sq(cfg->flush_distance);
+	track->buf = buf;
+	track->size = size;
+	track->flushed = true;
+
+	return 0;
+}
+
+void gps_track_fix_from_pvt(const struct gps_pvt *pvt,
+			    struct gps_track_fix *fix)
+{
+	struct tm tm = {
+		.tm_year = pvt->datetime.year - 1900,
+		.tm_mon = pvt->datetime.month - 1,
+		.tm_mday = pvt->datetime.day,
+		.tm_hour = pvt->datetime.hour,
+		.tm_min = pvt->datetime.minute,
+		.tm_sec = pvt->datetime.seconds,
+	};
+	float speed = pvt->speed * 100.0f + 0.5f;
+
+	fix->point.time = (uint32_t)timeutil_timegm(&tm);
+	fix->point.lat = (int32_t)(pvt->latitude * 1000000.0 +
+				   ((pvt->latitude < 0) ? -0.5 : 0.5));
+	fix->point.lng = (int32_t)(pvt->longitude * 1000000.0 +
+				   ((pvt->longitude < 0) ? -0.5 : 0.5));
+	fix->speed = (speed < 0.0f) ? 0 :
+		     (speed > UINT16_MAX) ? UINT16_MAX : (uint16_t)speed;
+	fix->heading = (pvt->heading < 0.0f) ? 0 :
+		       (uint16_t)pvt->heading % 360;
+}
+
+int gps_track_add(struct gps_track *track, const struct gps_track_fix *fix)
+{
+	const struct gps_track_point *p = &fix->point;
+	const struct gps_track_point *prev;
+
+	if (track->flushed) {
+		segment_start(track, fix);
+		return 0;
+	}
+
+	prev = (track->window_len > 0) ? &track->last.point :
+					 &track->anchor.point;
+	if (p->time <= prev->time) {
+		return -EINVAL;
+	}
+
+	if ((track->window_len > 0) && !window_covered(track, fix)) {
+		/* Keep room for the last fix, written on flush. */
+		if (room_left(track) < 2 * GPS_TRACK_POINT_MAX_SIZE) {
+			return -ENOMEM;
+		}
+
+		point_write(track, &track->last.point);
+		anchor_set(track, &track->last);
+	}
+
+	track->window[track->window_len++] = *p;
+	track->last = *fix;
+
+	if (room_left(track) < 2 * GPS_TRACK_POINT_MAX_SIZE) {
+		return 1;
+	}
+
+	if ((track->cfg.flush_distance > 0) &&
+	    (dist_sq(track, p->lat - track->start.lat,
+		     p->lng - track->start.lng) > track->flush_distance_sq)) {
+		return 1;
+	}
+
+	return 0;
+}
+
+size_t gps_track_flush(struct gps_track *track)
+{
+	if (track->flushed) {
+		return 0;
+	}
+
+	if (track->window_len > 0) {
+		point_write(track, &track->last.point);
+	}
+
+	track->flushed = true;
+
+	return track->len;
+}
+
+int gps_track_reader_init(struct gps_track_reader *reader,
+			  const uint8_t *data, size_t len)
+{
+	__ASSERT_NO_MSG(reader != NULL);
+
+	if ((data == NULL) || (len < GPS_TRACK_HEADER_SIZE) ||
+	    (data[0] != GPS_TRACK_FORMAT_VERSION)) {
+		return -EBADMSG;
+	}
+
+	memset(reader, 0, sizeof(*reader));
+	reader->data = data;
+	reader->len = len;
+	/* The first fix follows the version. */
+	reader->offset = 1;
+
+	return 0;
+}
+
+static int varint_get(struct gps_track_reader *reader, uint32_t *value)
+{
+	*value = 0;
+
+	for (int shift = 0; shift < 32; shift += 7) {
+		uint8_t byte;
+
+		if (reader->offset >= reader->len) {
+			return -EBADMSG;
+		}
+
+		byte = reader->data[reader->offset++];
+		*value |= (uint32_t)(byte & 0x7F) << shift;
+
+		if (!(byte & 0x80)) {
+			return 0;
+		}
+	}
+
+	return -EBADMSG;
+}
+
+int gps_track_read(struct gps_track_reader *reader,
+		   struct gps_track_point *point)
+{
+	uint32_t dt;
+	uint32_t dlat;
+	uint32_t dlng;
+
+	if (reader->offset == 1) {
+		reader->last.time = sys_get_le32(&reader->data[1]);
+		reader->last.lat = (int32_t)sys_get_le32(&reader->data[5]);
+		reader->last.lng = (int32_t)sys_get_le32(&reader->data[9]);
+		reader->offset = GPS_TRACK_HEADER_SIZE;
+		*point = reader->last;
+
+		return 0;
+	}
+
+	if (reader->offset >= reader->len) {
+		return -ENODATA;
+	}
+
+	if (varint_get(reader, &dt) || varint_get(reader, &dlat) ||
+	    varint_get(reader, &dlng)) {
+		return -EBADMSG;
+	}
+
+	reader->last.time += dt;
+	reader->last.lat = (int32_t)((uint32_t)reader->last.lat +
+				     ((dlat >> 1) ^ -(dlat & 1)));
+	reader->last.lng = (int32_t)((uint32_t)reader->last.lng +
+				     ((dlng >> 1) ^ -(dlng & 1)));
+	*point = reader->last;
+
+	return 0;
+}
@@ -0,0 +1,773 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <stdlib.h>
+#include <json_reader.h>
+
+/* Longest number that is converted, including the terminator. */
+#define NUM_MAX_LEN 32
+
+enum parse_state {
+	EXPECT_VALUE,
+	EXPECT_VALUE_OR_END,
+	EXPECT_KEY,
+	EXPECT_KEY_OR_END,
+	EXPECT_COLON,
+	EXPECT_SEPARATOR,
+	EXPECT_NOTHING,
+};
+
+struct parser {
+	const char *json;
+	size_t len;
+	size_t pos;
+	struct json_token *tokens;
+	size_t max_tokens;
+	size_t count;
+	/* Innermost open container, or -1. */
+	int parent;
+	enum parse_state state;
+};
+
+static bool is_space(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+static bool is_digit(char c)
+{
+	return (c >= '0') && (c <= '9');
+}
+
+static int hex_val(char c)
+{
+	if (is_digit(c)) {
+		return c - '0';
+	} else if ((c >= 'a') && (c <= 'f')) {
+		return c - 'a' + 10;
+	} else if ((c >= 'A') && (c <= 'F')) {
+		return c - 'A' + 10;
+	}
+
+	return -1;
+}
+
+static struct json_token *token_alloc(struct parser *p, uint8_t type,
+				      size_t start)
+{
+	struct json_token *tok;
+
+	if (p->count >= p->max_tokens) {
+		return NULL;
+	}
+
+	/* Values in arrays are counted here, object members by their name. */
+	if ((p->parent >= 0) &&
+	    (p->tokens[p->parent].type == JSON_TOKEN_ARRAY)) {
+		p->tokens[p->parent].size++;
+	}
+
+	tok = &p->tokens[p->count++];
+	tok->type = type;
+	tok->start = start;
+	tok->end = start;
+	tok->size = 0;
+	tok->next = p->count;
+
+	return tok;
+}
+
+static void value_done(struct parser *p)
+{
+	p->state = (p->parent < 0) ? EXPECT_NOTHING : EXPECT_SEPARATOR;
+}
+
+static int parse_string(struct parser *p, struct json_token *tok)
+{
+	const char *json = p->json;
+
+	/* Skip the opening quote. */
+	tok->start = ++p->pos;
+
+	while (p->pos < p->len) {
+		char c = json[p->pos];
+
+		if (c == '"') {
+			tok->end = p->pos++;
+			return 0;
+		}
+
+		if ((uint8_t)c < 0x20) {
+			return -EINVAL;
+		}
+
+		if (c != '\\') {
+			p->pos++;
+			continue;
+		}
+
+		if (++p->pos >= p->len) {
+			return -EINVAL;
+		}
+
+		switch (json[p->pos]) {
+		case '"':
+		case '\\':
+		case '/':
+		case 'b':
+		case 'f':
+		case 'n':
+		case 'r':
+		case 't':
+			p->pos++;
+			break;
+		case 'u':
+			if (p->pos + 4 >= p->len) {
+				return -EINVAL;
+			}
+
+			for (int i = 1; i <= 4; i++) {
+				if (hex_val(json[p->pos + i]) < 0) {
+					return -EINVAL;
+				}
+			}
+
+			p->pos += 5;
+			break;
+		default:
+			return -EINVAL;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static size_t skip_digits(struct parser *p)
+{
+	size_t start = p->pos;
+
+	while ((p->pos < p->len) && is_digit(p->json[p->pos])) {
+		p->pos++;
+	}
+
+	return p->pos - start;
+}
+
+static int parse_number(struct parser *p, struct json_token *tok)
+{
+	const char *json = p->json;
+
+	if (json[p->pos] == '-') {
+		p->pos++;
+	}
+
+	if ((p->pos < p->len) && (json[p->pos] == '0')) {
+		p->pos++;
+	} else if (skip_digits(p) == 0) {
+		return -EINVAL;
+	}
+
+	if ((p->pos < p->len) && (json[p->pos] == '.')) {
+		p->pos++;
+		if (skip_digits(p) == 0) {
+			return -EINVAL;
+		}
+	}
+
+	if ((p->pos < p->len) &&
+	    ((json[p->pos] == 'e') || (json[p->pos] == 'E'))) {
+		p->pos++;
+		if ((p->pos < p->len) &&
+		    ((json[p->pos] == '+') || (json[p->pos] == '-'))) {
+			p->pos++;
+		}
+		if (skip_digits(p) == 0) {
+			return -EINVAL;
+		}
+	}
+
+	tok->end = p->pos;
+
+	return 0;
+}
+
+static int parse_literal(struct parser *p, struct json_token *tok,
+			 const char *literal)
+{
+	size_t len = strlen(literal);
+
+	if ((p->len - p->pos < len) ||
+	    (memcmp(&p->json[p->pos], literal, len) != 0)) {
+		return -EINVAL;
+	}
+
+	p->pos += len;
+	tok->end = p->pos;
+
+	return 0;
+}
+
+static int parse_value(struct parser *p)
+{
+	char c = p->json[p->pos];
+	struct json_token *tok;
+	uint8_t type;
+	int err;
+
+	switch (c) {
+	case '{':
+		type = JSON_TOKEN_OBJECT;
+		break;
+	case '[':
+		type = JSON_TOKEN_ARRAY;
+		break;
+	case '"':
+		type = JSON_TOKEN_STRING;
+		break;
+	case 't':
+	case 'f':
+		type = JSON_TOKEN_BOOL;
+		break;
+	case 'n':
+		type = JSON_TOKEN_NULL;
+		break;
+	default:
+		if ((c != '-') && !is_digit(c)) {
+			return -EINVAL;
+		}
+		type = JSON_TOKEN_NUMBER;
+		break;
+	}
+
+	tok = token_alloc(p, type, p->pos);
+	if (tok == NULL) {
+		return -ENOMEM;
+	}
+
+	switch (type) {
+	case JSON_TOKEN_OBJECT:
+	case JSON_TOKEN_ARRAY:
+		/* Link to the enclosing container until this one is closed. */
+		tok->next = (uint16_t)p->parent;
+		p->parent = p->count - 1;
+		p->pos++;
+		p->state = (type == JSON_TOKEN_OBJECT) ?
+			   EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END;
+		return 0;
+	case JSON_TOKEN_STRING:
+		err = parse_string(p, tok);
+		break;
+	case JSON_TOKEN_BOOL:
+		err = parse_literal(p, tok, (c == 't') ? "true" : "false");
+		break;
+	case JSON_TOKEN_NULL:
+		err = parse_literal(p, tok, "null");
+		break;
+	default:
+		err = parse_number(p, tok);
+		break;
+	}
+
+	if (err) {
+		return err;
+	}
+
+	value_done(p);
+
+	return 0;
+}
+
+static int parse_key(struct parser *p)
+{
+	struct json_token *tok;
+	int err;
+
+	if (p->json[p->pos] != '"') {
+		return -EINVAL;
+	}
+
+	tok = token_alloc(p, JSON_TOKEN_STRING, p->pos);
+	if (tok == NULL) {
+		return -ENOMEM;
+	}
+
+	err = parse_string(p, tok);
+	if (err) {
+		return err;
+	}
+
+	p->tokens[p->parent].size++;
+	p->state = EXPECT_COLON;
+
+	return 0;
+}
+
+static int parse_end(struct parser *p, uint8_t type)
+{
+	struct json_token *container;
+	int grandparent;
+
+	if (p->parent < 0) {
+		return -EINVAL;
+	}
+
+	container = &p->tokens[p->parent];
+	if (container->type != type) {
+		return -EINVAL;
+	}
+
+	grandparent = (int16_t)container->next;
+	container->end = ++p->pos;
+	container->next = p->count;
+	p->parent = grandparent;
+
+	value_done(p);
+
+	return 0;
+}
+
+static int parse(struct parser *p)
+{
+	int err = 0;
+
+	while (p->pos < p->len) {
+		char c = p->json[p->pos];
+
+		if (is_space(c)) {
+			p->pos++;
+			continue;
+		}
+
+		switch (p->state) {
+		case EXPECT_VALUE_OR_END:
+			if (c == ']') {
+				err = parse_end(p, JSON_TOKEN_ARRAY);
+				break;
+			}
+			/* Fall through. */
+		case EXPECT_VALUE:
+			err = parse_value(p);
+			break;
+		case EXPECT_KEY_OR_END:
+			if (c == '}') {
+				err = parse_end(p, JSON_TOKEN_OBJECT);
+				break;
+			}
+			/* Fall through. */
+		case EXPECT_KEY:
+			err = parse_key(p);
+			break;
+		case EXPECT_COLON:
+			if (c != ':') {
+				return -EINVAL;
+			}
+			p->pos++;
+			p->state = EXPECT_VALUE;
+			break;
+		case EXPECT_SEPARATOR:
+			if (c == ',') {
+				p->pos++;
+				p->state = (p->tokens[p->parent].type ==
+					    JSON_TOKEN_OBJECT) ?
+					   EXPECT_KEY : EXPECT_VALUE;
+			} else if (c == '}') {
+				err = parse_end(p, JSON_TOKEN_OBJECT);
+			} else if (c == ']') {
+				err = parse_end(p, JSON_TOKEN_ARRAY);
+			} else {
+				return -EINVAL;
+			}
+			break;
+		default:
+			/* Only white space may follow the root value. */
+			return -EINVAL;
+		}
+
+		if (err) {
+			return err;
+		}
+	}
+
+	return (p->state == EXPECT_NOTHING) ? 0 : -EINVAL;
+}
+
+int json_reader_parse(struct json_reader *r, const char *json, size_t len,
+		      struct json_token *tokens, size_t max_tokens)
+{
+	struct parser p = {
+		.json = json,
+		.len = len,
+		.tokens = tokens,
+		/* Open containers keep a signed parent index in the next
+		 * field, so token indexes must fit in 15 bits.
+		 */
+		.max_tokens = MIN(max_tokens, INT16_MAX),
+		.parent = -1,
+		.state = EXPECT_VALUE,
+	};
+	int err;
+
+	__ASSERT_NO_MSG(r != NULL);
+	__ASSERT_NO_MSG((json != NULL) && (tokens != NULL));
+
+	r->json = json;
+	r->tokens = tokens;
+	r->count = 0;
+
+	if (len > JSON_READER_MAX_LEN) {
+		return -EMSGSIZE;
+	}
+
+	err = parse(&p);
+	if (err) {
+		return err;
+	}
+
+	r->count = p.count;
+
+	return r->count;
+}
+
+static const struct json_token *token_get(const struct json_reader *r,
+					  int tok)
+{
+	if ((tok < 0) || ((size_t)tok >= r->count)) {
+		return NULL;
+	}
+
+	return &r->tokens[tok];
+}
+
+/* Unescape the next character of a string. The output is never longer
+ * than the escaped input, which allows unescaping in place.
+ */
+static size_t unescape_char(const char **pos, char out[4])
+{
+	const char *s = *pos;
+	uint32_t cp;
+
+	if (s[0] != '\\') {
+		out[0] = s[0];
+		*pos = s + 1;
+		return 1;
+	}
+
+	*pos = s + 2;
+
+	switch (s[1]) {
+	case 'b':
+		out[0] = '\b';
+		return 1;
+	case 'f':
+		out[0] = '\f';
+		return 1;
+	case 'n':
+		out[0] = '\n';
+		return 1;
+	case 'r':
+		out[0] = '\r';
+		return 1;
+	case 't':
+		out[0] = '\t';
+		return 1;
+	case 'u':
+		break;
+	default:
+		out[0] = s[1];
+		return 1;
+	}
+
+	cp = (hex_val(s[2]) << 12) | (hex_val(s[3]) << 8) |
+	     (hex_val(s[4]) << 4) | hex_val(s[5]);
+	*pos = s + 6;
+
+	/* Combine a surrogate pair, if the low surrogate follows. */
+	if ((cp >= 0xd800) && (cp < 0xdc00) &&
+	    (s[6] == '\\') && (s[7] == 'u')) {
+		uint32_t low = (hex_val(s[8]) << 12) | (hex_val(s[9]) << 8) |
+			       (hex_val(s[10]) << 4) | hex_val(s[11]);
+
+		if ((low >= 0xdc00) && (low < 0xe000)) {
+			cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+			*pos = s + 12;
+		}
+	}
+
+	if (cp < 0x80) {
+		out[0] = cp;
+		return 1;
+	} else if (cp < 0x800) {
+		out[0] = 0xc0 | (cp >> 6);
+		out[1] = 0x80 | (cp & 0x3f);
+		return 2;
+	} else if (cp < 0x10000) {
+		out[0] = 0xe0 | (cp >> 12);
+		out[1] = 0x80 | ((cp >> 6) & 0x3f);
+		out[2] = 0x80 | (cp & 0x3f);
+		return 3;
+	}
+
+	out[0] = 0xf0 | (cp >> 18);
+	out[1] = 0x80 | ((cp >> 12) & 0x3f);
+	out[2] = 0x80 | ((cp >> 6) & 0x3f);
+	out[3] = 0x80 | (cp & 0x3f);
+	return 4;
+}
+
+/* Compare a string token with a name of the given length. In a JSON
+ * pointer, "~0" and "~1" stand for '~' and '/'.
+ */
+static bool name_eq(const struct json_reader *r, const struct json_token *t,
+		    const char *name, size_t name_len, bool pointer)
+{
+	const char *pos = &r->json[t->start];
+	const char *end = &r->json[t->end];
+	const char *name_end = name + name_len;
+	char out[4];
+
+	while ((pos < end) && (name < name_end)) {
+		size_t len = unescape_char(&pos, out);
+
+		for (size_t i = 0; i < len; i++) {
+			char c;
+
+			if (name >= name_end) {
+				return false;
+			}
+
+			c = *name++;
+			if (pointer && (c == '~') && (name < name_end)) {
+				c = (*name++ == '0') ? '~' : '/';
+			}
+
+			if (c != out[i]) {
+				return false;
+			}
+		}
+	}
+
+	return (pos == end) && (name == name_end);
+}
+
+static int member_find(const struct json_reader *r, int tok,
+		       const char *name, size_t name_len, bool pointer)
+{
+	const struct json_token *t = token_get(r, tok);
+	int key;
+
+	if ((t == NULL) || (t->type != JSON_TOKEN_OBJECT)) {
+		return -ENOENT;
+	}
+
+	key = tok + 1;
+
+	for (uint16_t i = 0; i < t->size; i++) {
+		if (name_eq(r, &r->tokens[key], name, name_len, pointer)) {
+			return key + 1;
+		}
+
+		/* Skip the name and the value. */
+		key = r->tokens[key + 1].next;
+	}
+
+	return -ENOENT;
+}
+
+static int element_find(const struct json_reader *r, int tok,
+			const char *index, size_t index_len)
+{
+	const struct json_token *t = token_get(r, tok);
+	size_t idx = 0;
+	int elem;
+
+	if ((t == NULL) || (t->type != JSON_TOKEN_ARRAY) ||
+	    (index_len == 0) || ((index[0] == '0') && (index_len > 1))) {
+		return -ENOENT;
+	}
+
+	for (size_t i = 0; i < index_len; i++) {
+		if (!is_digit(index[i])) {
+			return -ENOENT;
+		}
+		idx = idx * 10 + (index[i] - '0');
+		if (idx >= t->size) {
+			return -ENOENT;
+		}
+	}
+
+	elem = tok + 1;
+
+	while (idx--) {
+		elem = r->tokens[elem].next;
+	}
+
+	return elem;
+}
+
+enum json_token_type json_reader_type(const struct json_reader *r, int tok)
+{
+	const struct json_token *t = token_get(r, tok);
+
+	return (t == NULL) ? JSON_TOKEN_NONE : t->type;
+}
+
+int json_reader_member(const struct json_reader *r, int tok,
+		       const char *name)
+{
+	return member_find(r, tok, name, strlen(name), false);
+}
+
+int json_reader_find(const struct json_reader *r, int tok,
+		     const char *pointer)
+{
+	if (token_get(r, tok) == NULL) {
+		return -ENOENT;
+	}
+
+	while (*pointer != '\0') {
+		const char *seg;
+		size_t seg_len;
+
+		if (*pointer != '/') {
+			return -ENOENT;
+		}
+
+		seg = ++pointer;
+		while ((*pointer != '\0') && (*pointer != '/')) {
+			pointer++;
+		}
+		seg_len = pointer - seg;
+
+		if (json_reader_type(r, tok) == JSON_TOKEN_ARRAY) {
+			tok = element_find(r, tok, seg, seg_len);
+		} else {
+			tok = member_find(r, tok, seg, seg_len, true);
+		}
+
+		if (tok < 0) {
+			return tok;
+		}
+	}
+
+	return tok;
+}
+
+bool json_reader_str_eq(const struct json_reader *r, int tok,
+			const char *str)
+{
+	const struct json_token *t = token_get(r, tok);
+
+	if ((t == NULL) || (t->type != JSON_TOKEN_STRING)) {
+		return false;
+	}
+
+	return name_eq(r, t, str, strlen(str), false);
+}
+
+int json_reader_str_copy(const struct json_reader *r, int tok, char *buf,
+			 size_t size)
+{
+	const struct json_token *t = token_get(r, tok);
+	const char *pos;
+	const char *end;
+	size_t len = 0;
+	char out[4];
+
+	if ((t == NULL) || (t->type != JSON_TOKEN_STRING)) {
+		return -EINVAL;
+	}
+
+	__ASSERT_NO_MSG((buf != NULL) && (size > 0));
+
+	pos = &r->json[t->start];
+	end = &r->json[t->end];
+
+	while (pos < end) {
+		size_t n = unescape_char(&pos, out);
+
+		for (size_t i = 0; i < n; i++, len++) {
+			if (len < size - 1) {
+				buf[len] = out[i];
+			}
+		}
+	}
+
+	buf[MIN(len, size - 1)] = '\0';
+
+	return len;
+}
+
+char *json_reader_str_inplace(const struct json_reader *r, int tok,
+			      char *json)
+{
+	const struct json_token *t = token_get(r, tok);
+	const char *pos;
+	const char *end;
+	char *str;
+	char *dst;
+
+	if ((t == NULL) || (t->type != JSON_TOKEN_STRING)) {
+		return NULL;
+	}
+
+	__ASSERT_NO_MSG(json == r->json);
+
+	str = &json[t->start];
+	dst = str;
+	pos = str;
+	end = &json[t->end];
+
+	while (pos < end) {
+		char out[4];
+		size_t n = unescape_char(&pos, out);
+
+		memcpy(dst, out, n);
+		dst += n;
+	}
+
+	*dst = '\0';
+
+	return str;
+}
+
+int json_reader_num(const struct json_reader *r, int tok, double *val)
+{
+	const struct json_token *t = token_get(r, tok);
+	char num[NUM_MAX_LEN];
+	size_t len;
+
+	if ((t == NULL) || (t->type != JSON_TOKEN_NUMBER)) {
+		return -EINVAL;
+	}
+
+	len = t->end - t->start;
+	if (len >= sizeof(num)) {
+		return -EINVAL;
+	}
+
+	/* The document is not null-terminated after the number. */
+	memcpy(num, &r->json[t->start], len);
+	num[len] = '\0';
+
+	*val = strtod(num, NULL);
+
+	return 0;
+}
+
+int json_reader_bool(const struct json_reader *r, int tok, bool *val)
+{
+	const struct json_token *t = token_get(r, tok);
+
+	if ((t == NULL) || (t->type != JSON_TOKEN_BOOL)) {
+		return -EINVAL;
+	}
+
+	*val = (r->json[t->start] == 't');
+
+	return 0;
+}
@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <json_writer.h>
+
+/* Largest magnitude for which a double is written as an integer. */
+#define INTEGRAL_LIMIT 1e15
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static void set_err(struct json_writer *w, int err)
+{
+	if (w->err == 0) {
+		w->err = err;
+	}
+}
+
+static void put(struct json_writer *w, const char *data, size_t len)
+{
+	if (w->err) {
+		return;
+	}
+
+	if (w->buf != NULL) {
+		/* Keep one byte for the null terminator. */
+		if (len >= w->size - w->len) {
+			set_err(w, -ENOMEM);
+			return;
+		}
+
+		memcpy(&w->buf[w->len], data, len);
+	}
+
+	w->len += len;
+}
+
+static void put_char(struct json_writer *w, char c)
+{
+	put(w, &c, 1);
+}
+
+static void put_escaped(struct json_writer *w, const char *str)
+{
+	const char *run = str;
+	char esc[6] = { '\\', 'u', '0', '0' };
+
+	put_char(w, '"');
+
+	for (; *str != '\0'; str++) {
+		uint8_t c = (uint8_t)*str;
+		size_t esc_len = 2;
+
+		if ((c >= 0x20) && (c != '"') && (c != '\\')) {
+			continue;
+		}
+
+		/* Copy the characters that need no escaping in one go. */
+		put(w, run, str - run);
+		run = str + 1;
+
+		switch (c) {
+		case '"':
+		case '\\':
+			esc[1] = c;
+			break;
+		case '\b':
+			esc[1] = 'b';
+			break;
+		case '\f':
+			esc[1] = 'f';
+			break;
+		case '\n':
+			esc[1] = 'n';
+			break;
+		case '\r':
+			esc[1] = 'r';
+			break;
+		case '\t':
+			esc[1] = 't';
+			break;
+		default:
+			esc[1] = 'u';
+			esc[4] = hex_digits[c >> 4];
+			esc[5] = hex_digits[c & 0xf];
+			esc_len = sizeof(esc);
+			break;
+		}
+
+		put(w, esc, esc_len);
+	}
+
+	put(w, run, str - run);
+	put_char(w, '"');
+}
+
+/* Write the separator and member name that precede a value. */
+static int value_begin(struct json_writer *w, const char *key)
+{
+	uint32_t bit = BIT(w->depth);
+
+	if (w->err) {
+		return w->err;
+	}
+
+	if (w->depth == 0) {
+		/* Only one value at the top level, and it has no name. */
+		if (!(w->empty & bit) || (key != NULL)) {
+			set_err(w, -EINVAL);
+			return w->err;
+		}
+	} else if (((w->object & bit) != 0) != (key != NULL)) {
+		set_err(w, -EINVAL);
+		return w->err;
+	}
+
+	if (!(w->empty & bit)) {
+		put_char(w, ',');
+	}
+
+	w->empty &= ~bit;
+
+	if (key != NULL) {
+		put_escaped(w, key);
+		put_char(w, ':');
+	}
+
+	return w->err;
+}
+
+static int container_begin(struct json_writer *w, const char *key,
+			   bool object)
+{
+	if (value_begin(w, key)) {
+		return w->err;
+	}
+
+	if (w->depth >= JSON_WRITER_MAX_DEPTH) {
+		set_err(w, -EINVAL);
+		return w->err;
+	}
+
+	w->depth++;
+	w->empty |= BIT(w->depth);
+
+	if (object) {
+		w->object |= BIT(w->depth);
+	} else {
+		w->object &= ~BIT(w->depth);
+	}
+
+	put_char(w, object ? '{' : '[');
+
+	return w->err;
+}
+
+static int container_end(struct json_writer *w, bool object)
+{
+	if (w->err) {
+		return w->err;
+	}
+
+	if ((w->depth == 0) ||
+	    (((w->object & BIT(w->depth)) != 0) != object)) {
+		set_err(w, -EINVAL);
+		return w->err;
+	}
+
+	w->depth--;
+	put_char(w, object ? '}' : ']');
+
+	return w->err;
+}
+
+static void put_int(struct json_writer *w, int64_t val)
+{
+	char digits[20];
+	size_t pos = sizeof(digits);
+	uint64_t mag = (val < 0) ? -(uint64_t)val : (uint64_t)val;
+
+	do {
+		digits[--pos] = '0' + (mag % 10);
+		mag /= 10;
+	} while (mag != 0);
+
+	if (val < 0) {
+		put_char(w, '-');
+	}
+
+	put(w, &digits[pos], sizeof(digits) - pos);
+}
+
+void json_writer_init(struct json_writer *w, char *buf, size_t size)
+{
+	__ASSERT_NO_MSG(w != NULL);
+	__ASSERT_NO_MSG((buf == NULL) || (size > 0));
+
+	w->buf = buf;
+	w->size = size;
+	w->len = 0;
+	w->empty = BIT(0);
+	w->object = 0;
+	w->depth = 0;
+	w->err = 0;
+}
+
+int json_writer_object_begin(struct json_writer *w, const char *key)
+{
+	return container_begin(w, key, true);
+}
+
+int json_writer_object_end(struct json_writer *w)
+{
+	return container_end(w, true);
+}
+
+int json_writer_array_begin(struct json_writer *w, const char *key)
+{
+	return container_begin(w, key, false);
+}
+
+int json_writer_array_end(struct json_writer *w)
+{
+	return container_end(w, false);
+}
+
+int json_writer_str(struct json_writer *w, const char *key, const char *str)
+{
+	if (str == NULL) {
+		return json_writer_null(w, key);
+	}
+
+	if (value_begin(w, key) == 0) {
+		put_escaped(w, str);
+	}
+
+	return w->err;
+}
+
+int json_writer_int(struct json_writer *w, const char *key, int64_t val)
+{
+	if (value_begin(w, key) == 0) {
+		put_int(w, val);
+	}
+
+	return w->err;
+}
+
+int json_writer_num(struct json_writer *w, const char *key, double val)
+{
+	char num[32];
+	int len;
+
+	if (isnan(val) || isinf(val)) {
+		return json_writer_null(w, key);
+	}
+
+	if ((fabs(val) < INTEGRAL_LIMIT) && (val == (double)(int64_t)val)) {
+		return json_writer_int(w, key, (int64_t)val);
+	}
+
+	if (value_begin(w, key)) {
+		return w->err;
+	}
+
+	len = snprintf(num, sizeof(num), "%1.15g", val);
+	if ((len < 0) || ((size_t)len >= sizeof(num))) {
+		set_err(w, -EINVAL);
+		return w->err;
+	}
+
+	put(w, num, len);
+
+	return w->err;
+}
+
+int json_writer_bool(struct json_writer *w, const char *key, bool val)
+{
+	static const char true_str[] = "true";
+	static const char false_str[] = "false";
+
+	if (value_begin(w, key) == 0) {
+		if (val) {
+			put(w, true_str, sizeof(true_str) - 1);
+		} else {
+			put(w, false_str, sizeof(false_str) - 1);
+		}
+	}
+
+	return w->err;
+}
+
+int json_writer_null(struct json_writer *w, const char *key)
+{
+	static const char null_str[] = "null";
+
+	if (value_begin(w, key) == 0) {
+		put(w, null_str, sizeof(null_str) - 1);
+	}
+
+	return w->err;
+}
+
+int json_writer_finish(struct json_writer *w)
+{
+	if (w->err) {
+		return w->err;
+	}
+
+	if ((w->depth != 0) || (w->empty & BIT(0))) {
+		return -EINVAL;
+	}
+
+	if (w->buf != NULL) {
+		w->buf[w->len] = '\0';
+	}
+
+	return w->len;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <tinycbor/cbor.h>
+#include <modem/modem_info.h>
+#include <modem/at_params.h>
+#include <logging/log.h>
+
+LOG_MODULE_REGISTER(modem_info_cbor);
+
+static CborError cbor_add_data(struct lte_param *param, CborEncoder *map)
+{
+	CborError err;
+	/* modem_info_type_get() returns a negative error code on failure. */
+	int data_type;
+
+	data_type = (int)modem_info_type_get(param->type);
+	if (data_type < 0) {
+		return CborErrorImproperValue;
+	}
+
+	err = cbor_encode_uint(map, param->type);
+
+	if (data_type == AT_PARAM_TYPE_STRING &&
+	    param->type != MODEM_INFO_AREA_CODE) {
+		err |= cbor_encode_text_stringz(map, param->value_string);
+	} else {
+		err |= cbor_encode_uint(map, param->value);
+	}
+
+	return err;
+}
+
+static CborError network_data_add(struct network_param *network,
+				  CborEncoder *map)
+{
+	CborError err;
+	CborEncoder network_map;
+	char network_mode[MODEM_INFO_NETWORK_MODE_MAX_SIZE] = "";
+
+	if (network->lte_mode.value == 1) {
+		strcat(network_mode, "LTE-M");
+	} else if (network->nbiot_mode.value == 1) {
+		strcat(network_mode, "NB-IoT");
+	}
+
+	if (network->gps_mode.value == 1) {
+		strcat(network_mode, " GPS");
+	}
+
+	err = cbor_encode_uint(map, MODEM_INFO_CBOR_KEY_NETWORK);
+	err |= cbor_encoder_create_map(map, &network_map,
+				       CborIndefiniteLength);
+	err |= cbor_add_data(&network->current_band, &network_map);
+	err |= cbor_add_data(&network->sup_band, &network_map);
+	err |= cbor_add_data(&network->area_code, &network_map);
+	err |= cbor_add_data(&network->current_operator, &network_map);
+	err |= cbor_add_data(&network->ip_address, &network_map);
+	err |= cbor_add_data(&network->ue_mode, &network_map);
+	err |= cbor_encode_uint(&network_map, MODEM_INFO_CELLID);
+	err |= cbor_encode_uint(&network_map, (uint32_t)network->cellid_dec);
+	err |= cbor_encode_uint(&network_map, MODEM_INFO_CBOR_KEY_NETWORK_MODE);
+	err |= cbor_encode_text_stringz(&network_map, network_mode);
+	err |= cbor_encoder_close_container(map, &network_map);
+
+	return err;
+}
+
+static CborError sim_data_add(struct sim_param *sim, CborEncoder *map)
+{
+	CborError err;
+	CborEncoder sim_map;
+
+	err = cbor_encode_uint(map, MODEM_INFO_CBOR_KEY_SIM);
+	err |= cbor_encoder_create_map(map, &sim_map, CborIndefiniteLength);
+	err |= cbor_add_data(&sim->uicc, &sim_map);
+	err |= cbor_add_data(&sim->iccid, &sim_map);
+	err |= cbor_add_data(&sim->imsi, &sim_map);
+	err |= cbor_encoder_close_container(map, &sim_map);
+
+	return err;
+}
+
+static CborError cbor_add_str(CborEncoder *map, uint32_t key,
+			      const char *str)
+{
+	CborError err;
+
+	if (str == NULL) {
+		return CborNoError;
+	}
+
+	err = cbor_encode_uint(map, key);
+	err |= cbor_encode_text_stringz(map, str);
+
+	return err;
+}
+
+static CborError device_data_add(struct device_param *device,
+				 CborEncoder *map)
+{
+	CborError err;
+	CborEncoder device_map;
+
+	err = cbor_encode_uint(map, MODEM_INFO_CBOR_KEY_DEVICE);
+	err |= cbor_encoder_create_map(map, &device_map,
+				       CborIndefiniteLength);
+	err |= cbor_add_data(&device->modem_fw, &device_map);
+	err |= cbor_add_data(&device->battery, &device_map);
+	err |= cbor_add_data(&device->imei, &device_map);
+	err |= cbor_add_str(&device_map, MODEM_INFO_CBOR_KEY_BOARD,
+			    device->board);
+	err |= cbor_add_str(&device_map, MODEM_INFO_CBOR_KEY_APP_VERSION,
+			    device->app_version);
+	err |= cbor_add_str(&device_map, MODEM_INFO_CBOR_KEY_APP_NAME,
+			    device->app_name);
+	err |= cbor_encoder_close_container(map, &device_map);
+
+	return err;
+}
+
+int modem_info_cbor_encode(struct modem_param_info *modem,
+			   CborEncoder *map)
+{
+	CborError err = CborNoError;
+	int map_count = 0;
+
+	if (modem == NULL || map == NULL) {
+		return -EINVAL;
+	}
+
+	if (IS_ENABLED(CONFIG_MODEM_INFO_ADD_NETWORK)) {
+		err |= network_data_add(&modem->network, map);
+		map_count++;
+	}
+
+	if (IS_ENABLED(CONFIG_MODEM_INFO_ADD_SIM)) {
+		err |= sim_data_add(&modem->sim, map);
+		map_count++;
+	}
+
+	if (IS_ENABLED(CONFIG_MODEM_INFO_ADD_DEVICE)) {
+		err |= device_data_add(&modem->device, map);
+		map_count++;
+	}
+
+	if (err != CborNoError) {
+		LOG_DBG("CBOR encoding failed: %d", err);
+		return (err & CborErrorOutOfMemory) ? -ENOMEM : -EINVAL;
+	}
+
+	return map_count;
+}
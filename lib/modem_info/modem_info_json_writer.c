@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <json_writer.h>
+#include <modem/modem_info.h>
+#include <modem/at_params.h>
+#include <logging/log.h>
+
+LOG_MODULE_REGISTER(modem_info_json_writer);
+
+static void json_write_data(struct lte_param *param, struct json_writer *w)
+{
+	char data_name[MODEM_INFO_MAX_RESPONSE_SIZE] = "";
+	/* modem_info_type_get() returns a negative error code on failure. */
+	int data_type;
+
+	if (modem_info_name_get(param->type, data_name) < 0) {
+		LOG_DBG("Data name not obtained for %d", param->type);
+		return;
+	}
+
+	data_type = (int)modem_info_type_get(param->type);
+	if (data_type < 0) {
+		return;
+	}
+
+	if (data_type == AT_PARAM_TYPE_STRING &&
+	    param->type != MODEM_INFO_AREA_CODE) {
+		json_writer_str(w, data_name, param->value_string);
+	} else {
+		json_writer_int(w, data_name, param->value);
+	}
+}
+
+static int network_data_write(struct network_param *network,
+			      struct json_writer *w)
+{
+	char data_name[MODEM_INFO_MAX_RESPONSE_SIZE] = "";
+	char network_mode[MODEM_INFO_NETWORK_MODE_MAX_SIZE] = "";
+
+	if (network->lte_mode.value == 1) {
+		strcat(network_mode, "LTE-M");
+	} else if (network->nbiot_mode.value == 1) {
+		strcat(network_mode, "NB-IoT");
+	}
+
+	if (network->gps_mode.value == 1) {
+		strcat(network_mode, " GPS");
+	}
+
+	json_writer_object_begin(w, "networkInfo");
+	json_write_data(&network->current_band, w);
+	json_write_data(&network->sup_band, w);
+	json_write_data(&network->area_code, w);
+	json_write_data(&network->current_operator, w);
+	json_write_data(&network->ip_address, w);
+	json_write_data(&network->ue_mode, w);
+
+	if (modem_info_name_get(network->cellid_hex.type, data_name) >= 0) {
+		json_writer_num(w, data_name, network->cellid_dec);
+	}
+
+	json_writer_str(w, "networkMode", network_mode);
+
+	return json_writer_object_end(w);
+}
+
+static int sim_data_write(struct sim_param *sim, struct json_writer *w)
+{
+	json_writer_object_begin(w, "simInfo");
+	json_write_data(&sim->uicc, w);
+	json_write_data(&sim->iccid, w);
+	json_write_data(&sim->imsi, w);
+
+	return json_writer_object_end(w);
+}
+
+static int device_data_write(struct device_param *device,
+			     struct json_writer *w)
+{
+	json_writer_object_begin(w, "deviceInfo");
+	json_write_data(&device->modem_fw, w);
+	json_write_data(&device->battery, w);
+	json_write_data(&device->imei, w);
+
+	if (device->board != NULL) {
+		json_writer_str(w, "board", device->board);
+	}
+
+	if (device->app_version != NULL) {
+		json_writer_str(w, "appVersion", device->app_version);
+	}
+
+	if (device->app_name != NULL) {
+		json_writer_str(w, "appName", device->app_name);
+	}
+
+	return json_writer_object_end(w);
+}
+
+int modem_info_json_write(struct modem_param_info *modem,
+			  struct json_writer *w)
+{
+	int obj_count = 0;
+	int err = 0;
+
+	if (modem == NULL || w == NULL) {
+		return -EINVAL;
+	}
+
+	if (IS_ENABLED(CONFIG_MODEM_INFO_ADD_NETWORK)) {
+		err = network_data_write(&modem->network, w);
+		obj_count++;
+	}
+
+	if (IS_ENABLED(CONFIG_MODEM_INFO_ADD_SIM)) {
+		err = sim_data_write(&modem->sim, w);
+		obj_count++;
+	}
+
+	if (IS_ENABLED(CONFIG_MODEM_INFO_ADD_DEVICE)) {
+		err = device_data_write(&modem->device, w);
+		obj_count++;
+	}
+
+	/* Writer errors are sticky, so the last result covers all calls. */
+	if (err) {
+		LOG_DBG("JSON writing failed: %d", err);
+		return err;
+	}
+
+	return obj_count;
+}
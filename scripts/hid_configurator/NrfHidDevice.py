@@ -9,6 +9,7 @@ import time
 import logging
 from enum import IntEnum
 import codecs
+import collections
 
 REPORT_ID = 6
 REPORT_SIZE = 30
@@ -28,6 +29,12 @@ POLL_RETRY_COUNT = 200
 
 END_OF_TRANSFER_CHAR = '\n'
 
+# Flags in the data length field of windowed frames
+FRAME_WINDOWED = 0x80
+FRAME_MORE = 0x40
+FRAME_DATA_LEN_MASK = 0x1f
+WINDOWED_DATA_LEN_MAX = EVENT_DATA_LEN_MAX - 1
+
 
 class ConfigStatus(IntEnum):
     PENDING            = 0
@@ -43,6 +50,7 @@ class ConfigStatus(IntEnum):
     REJECT             = 10
     WRITE_FAIL         = 11
     DISCONNECTED       = 12
+    GET_WINDOW         = 13
     FAULT              = 99
 
 class NrfHidTransport():
@@ -66,7 +74,8 @@ class NrfHidTransport():
                         ConfigStatus.GET_HWID,
                         ConfigStatus.GET_BOARD_NAME,
                         ConfigStatus.INDEX_PEERS,
-                        ConfigStatus.GET_PEER):
+                        ConfigStatus.GET_PEER,
+                        ConfigStatus.GET_WINDOW):
             assert event_id == 0
             assert event_data_len == 0
         elif status == ConfigStatus.FETCH:
@@ -86,6 +95,56 @@ class NrfHidTransport():
 
         return report
 
+    @staticmethod
+    def _create_windowed_reports(recipient, event_id, status, event_data, seq):
+        # Windowed request is split into frames that carry the sequence
+        # number of the request after the header.
+        if event_data is None:
+            event_data = b''
+
+        chunks = [event_data[i:i + WINDOWED_DATA_LEN_MAX]
+                  for i in range(0, len(event_data), WINDOWED_DATA_LEN_MAX)]
+        if not chunks:
+            chunks = [b'']
+
+        reports = []
+        for i, chunk in enumerate(chunks):
+            data_len = len(chunk) | FRAME_WINDOWED
+            if i < len(chunks) - 1:
+                data_len |= FRAME_MORE
+
+            report = struct.pack(NrfHidTransport.HEADER_FORMAT + 'B', REPORT_ID,
+                                 recipient, event_id, status, data_len, seq)
+            report += chunk
+            report += b'\0' * (REPORT_SIZE - len(report))
+            reports.append(report)
+
+        return reports
+
+    @staticmethod
+    def _parse_windowed_response(response_raw):
+        fmt = NrfHidTransport.HEADER_FORMAT + 'B'
+        data_field_len = len(response_raw) - struct.calcsize(fmt)
+
+        if data_field_len < 0:
+            return None
+
+        (report_id, rcpt, event_id, status, data_len, seq) = \
+            struct.unpack(fmt, response_raw[:struct.calcsize(fmt)])
+
+        if (report_id != REPORT_ID) or not (data_len & FRAME_WINDOWED):
+            return None
+
+        data_len &= FRAME_DATA_LEN_MASK
+        if data_len > data_field_len:
+            return None
+
+        data = response_raw[struct.calcsize(fmt):][:data_len]
+        if data_len == 0:
+            data = None
+
+        return (rcpt, event_id, status, seq, data)
+
     @staticmethod
     def _parse_response(response_raw):
         data_field_len = len(response_raw) - \
@@ -173,6 +232,123 @@ class NrfHidTransport():
         return success, fetched_data
 
 
+class NrfHidPipeline():
+    # Windowed requests are sent without waiting for the responses to
+    # the previous ones. The device provides the responses in order.
+    def __init__(self, dev, recipient, window, poll_interval=POLL_INTERVAL_DEFAULT):
+        self.dev = dev
+        self.recipient = recipient
+        self.window = window
+        self.poll_interval = poll_interval
+        self.seq = 0
+        self.in_flight = collections.deque()
+
+    @staticmethod
+    def open(dev, recipient):
+        # Device that does not support windowed requests rejects the request
+        # or responds with a frame that is not windowed.
+        pipeline = NrfHidPipeline(dev, recipient, 1)
+        success, fetched_data = pipeline.exchange(0, ConfigStatus.GET_WINDOW, None)
+
+        fmt = '<BH'
+        if (not success) or (fetched_data is None) or \
+           (len(fetched_data) < struct.calcsize(fmt)):
+            return None, None
+
+        window, payload_max = struct.unpack(fmt, fetched_data[:struct.calcsize(fmt)])
+        if window == 0:
+            return None, None
+
+        pipeline.window = window
+        logging.debug('Window of {} requests, up to {} bytes'.format(window, payload_max))
+
+        return pipeline, payload_max
+
+    def _complete_oldest(self):
+        seq, event_id = self.in_flight.popleft()
+
+        for i in range(POLL_RETRY_COUNT):
+            if i > 0:
+                time.sleep(self.poll_interval)
+
+            try:
+                response_raw = self.dev.get_feature_report(REPORT_ID, REPORT_SIZE)
+            except Exception as e:
+                logging.error('Get feature report problem: {}'.format(e))
+                break
+
+            rsp = NrfHidTransport._parse_windowed_response(response_raw)
+            if rsp is None:
+                logging.debug('Windowed response not received')
+                break
+
+            (rsp_recipient, rsp_event_id, rsp_status, rsp_seq, rsp_event_data) = rsp
+            rsp_status = ConfigStatus(rsp_status)
+
+            if (rsp_seq != seq) or (rsp_recipient != self.recipient) or \
+               (rsp_event_id != event_id):
+                logging.error('Response does not match the request:\n'
+                              '\trequest: seq {} event_id {}\n'
+                              '\tresponse: seq {} event_id {}'.format(seq, event_id,
+                                                                      rsp_seq, rsp_event_id))
+                break
+
+            if rsp_status == ConfigStatus.PENDING:
+                # Response was not ready
+                continue
+
+            if rsp_status != ConfigStatus.SUCCESS:
+                logging.warning('Error response code: {}'.format(rsp_status.name))
+                break
+
+            return True, rsp_event_data
+
+        # Responses for the requests sent later cannot be trusted.
+        self.in_flight.clear()
+
+        return False, None
+
+    def submit(self, event_id, status, event_data):
+        if len(self.in_flight) >= self.window:
+            success, _ = self._complete_oldest()
+            if not success:
+                return False
+
+        reports = NrfHidTransport._create_windowed_reports(self.recipient, event_id,
+                                                           status, event_data,
+                                                           self.seq)
+        try:
+            for report in reports:
+                self.dev.send_feature_report(report)
+        except Exception as e:
+            logging.debug('Send feature report problem: {}'.format(e))
+            self.in_flight.clear()
+            return False
+
+        self.in_flight.append((self.seq, event_id))
+        self.seq = (self.seq + 1) & 0xff
+
+        return True
+
+    def flush(self):
+        success = True
+
+        while self.in_flight:
+            rsp_success, _ = self._complete_oldest()
+            success = success and rsp_success
+
+        return success
+
+    def exchange(self, event_id, status, event_data):
+        if not self.flush():
+            return False, None
+
+        if not self.submit(event_id, status, event_data):
+            return False, None
+
+        return self._complete_oldest()
+
+
 class NrfHidDevice():
     def __init__(self, dev, recipient):
         self.recipient = recipient
@@ -181,6 +357,8 @@ class NrfHidDevice():
         self.dev_config = None
         self.board_name = None
         self.hwid = None
+        self.pipeline = None
+        self.payload_max = EVENT_DATA_LEN_MAX
 
         board_name, hwid = NrfHidDevice._read_device_info(dev, recipient)
 
@@ -194,6 +372,13 @@ class NrfHidDevice():
             self.board_name = board_name
             self.hwid = hwid
 
+            # Dongle forwards one request at a time to the peripheral.
+            if recipient == LOCAL_RECIPIENT:
+                pipeline, payload_max = NrfHidPipeline.open(dev, recipient)
+                if pipeline is not None:
+                    self.pipeline = pipeline
+                    self.payload_max = payload_max
+
     @staticmethod
     def open_devices(vid):
         dir_devs = {}
@@ -492,3 +677,30 @@ class NrfHidDevice():
 
     def config_set(self, module_name, option_name, value, poll_interval=POLL_INTERVAL_DEFAULT):
         return self._config_operation(module_name, option_name, False, value, poll_interval)
+
+    def get_payload_max(self):
+        return self.payload_max
+
+    def config_set_many(self, module_name, option_name, values, poll_interval=POLL_INTERVAL_DEFAULT):
+        # Values longer than a single report can be set only if the device
+        # supports windowed requests, see get_payload_max.
+        if (not self.initialized()) or (self.pipeline is None):
+            for value in values:
+                if not self.config_set(module_name, option_name, value, poll_interval):
+                    return False
+            return True
+
+        try:
+            event_id = NrfHidDevice._get_event_id(module_name, option_name, self.dev_config)
+        except KeyError:
+            print("No module: {} or option: {}".format(module_name, option_name))
+            return False
+
+        self.pipeline.poll_interval = poll_interval
+
+        for value in values:
+            assert len(value) <= self.payload_max
+            if not self.pipeline.submit(event_id, ConfigStatus.SET, value):
+                return False
+
+        return self.pipeline.flush()
@@ -153,7 +153,8 @@ def perform_led_stream(dev, args):
         except NameError:
             print('Music LED stream functionality is not available')
     else:
-        send_continuous_led_stream(dev, args.led_id, args.freq)
+        send_continuous_led_stream(dev, args.led_id, args.freq,
+                                   effects=args.effects)
 
 
 def parse_arguments():
@@ -183,6 +184,8 @@ def parse_arguments():
     parser_stream.add_argument('led_id', type=int, help='Stream LED ID')
     parser_stream.add_argument('freq', type=int, help='Color change frequency (in Hz)')
     parser_stream.add_argument('--file', type=str, help='Selected audio file (*.wav)')
+    parser_stream.add_argument('--effects', action='store_true',
+                               help='Play fade effects defined on the device')
 
     assert isinstance(MODULE_CONFIG, dict)
     parser_config = sp_commands.add_parser('config',
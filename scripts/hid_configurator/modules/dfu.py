@@ -78,6 +78,31 @@ class DFUInfo:
                                                  self.img_csum, self.offset, self.sync_buffer_size)
 
 
+class DFUStats:
+    def __init__(self, fetched_data):
+        fmt = '<IIII'
+        assert struct.calcsize(fmt) <= EVENT_DATA_LEN_MAX
+        assert struct.calcsize(fmt) == len(fetched_data)
+        vals = struct.unpack(fmt, fetched_data)
+        self.rx_bytes = vals[0]
+        self.rx_time = vals[1]
+        self.stall_time = vals[2]
+        self.img_hash = vals[3]
+
+    def get_throughput(self):
+        if self.rx_time == 0:
+            return 0
+        return self.rx_bytes * 1000 / self.rx_time
+
+    def __str__(self):
+        return ('DFU statistics\n'
+                '  Received: {} bytes in {} ms ({:.0f} B/s)\n'
+                '  Stalled: {} ms\n'
+                '  Image checksum: {}').format(self.rx_bytes, self.rx_time,
+                                               self.get_throughput(), self.stall_time,
+                                               self.img_hash)
+
+
 class FwInfo:
     def __init__(self, fetched_data):
         fmt = '<BIBBHI'
@@ -382,6 +407,20 @@ def dfu_sync(dev):
         return None
 
 
+def dfu_stats(dev):
+    # Statistics are not provided by older firmware.
+    dev_config = dev.get_device_config()
+    if (dev_config is None) or ('stats' not in dev_config.get('dfu', [])):
+        return None
+
+    success, fetched_data = dev.config_get('dfu', 'stats')
+
+    if success and fetched_data:
+        return DFUStats(fetched_data)
+    else:
+        return None
+
+
 def dfu_start(dev, img_length, img_csum, offset):
     # Start DFU operation at selected offset.
     # It can happen that device will reject this request - this will be
@@ -490,6 +529,10 @@ def dfu_transfer(dev, dfu_image, progress_callback):
             else:
                 success = True
 
+                stats = dfu_stats(dev)
+                if stats is not None:
+                    print(stats)
+
     return success
 
 
@@ -525,22 +568,25 @@ def send_chunks(dev, img_csum, img_file, img_length, offset, sync_buffer_size, p
     next_checkpoint = offset + sync_buffer_size
     if next_checkpoint > img_length: next_checkpoint = img_length
 
+    # Data up to the next checkpoint is sent without waiting for responses
+    # if the device supports windowed requests.
+    payload_max = dev.get_payload_max()
+
     while offset < img_length:
         # Set current progress
         progress_callback(int(offset / img_length * 1000))
 
         # Read data from the file
-        chunk_len = EVENT_DATA_LEN_MAX
-        if next_checkpoint - offset < chunk_len:
-            chunk_len = next_checkpoint - offset
-        chunk_data = img_file.read(chunk_len)
+        chunk_data = img_file.read(next_checkpoint - offset)
         chunk_len = len(chunk_data)
         if chunk_len == 0:
             break
 
         # Send data to the device
         logging.debug('Send DFU request: offset {}, size {}'.format(offset, chunk_len))
-        success = dev.config_set('dfu', 'data', chunk_data)
+        payloads = [chunk_data[i:i + payload_max]
+                    for i in range(0, chunk_len, payload_max)]
+        success = dev.config_set_many('dfu', 'data', payloads)
         if not success:
             print('Lost communication with the device')
             break
@@ -5,12 +5,25 @@
 
 import struct
 import random
+import time
 
 from NrfHidDevice import EVENT_DATA_LEN_MAX
 
 LED_STREAM_DATA = 0x0
 MS_PER_SEC = 1000
 
+FRAME_TAG_STEP = 0
+FRAME_TAG_DELTA = 1
+FRAME_TAG_PLAY = 2
+FRAME_TAG_DEFINE = 3
+
+FRAME_HEADER_SIZE = 2
+FRAME_STEP_FMT = '<BBBHH'
+# Number of steps in a single effect definition record.
+FRAME_DEFINE_STEP_CNT = 2
+# Effect table size set by CONFIG_DESKTOP_LED_STREAM_EFFECT_COUNT.
+EFFECT_CNT_DEFAULT = 4
+
 
 class Step:
     def __init__(self, r, g, b, substep_count, substep_time):
@@ -78,7 +91,243 @@ def fetch_free_steps_buffer_info(dev, led_id):
     return success, (data_unpacked[0], data_unpacked[led_id + 1])
 
 
-def send_continuous_led_stream(dev, led_id, freq, substep_cnt = 10):
+class LedFrameStream:
+    """Sends LED effect steps in frames with multiple steps.
+
+    Steps are delta encoded against the previous step when their timing
+    is the same. Repeated effects are defined on the device once, found
+    by their content and then referenced by ID. The device acknowledges
+    the steps by the sequence number returned in the stream state.
+    """
+
+    def __init__(self, dev, led_id, effect_cnt=EFFECT_CNT_DEFAULT):
+        self.dev = dev
+        self.led_id = led_id
+        self.effect_cnt = effect_cnt
+        self.effects = {}
+        self.seq = 0
+        self.credits = 0
+        self.max_free = 0
+        self.last = None
+        # Steps not acknowledged yet, each with the effect definitions
+        # sent right before it.
+        self.unacked = []
+        self.defines = []
+        self.frame = bytearray()
+        self.frame_seq = 0
+
+    @staticmethod
+    def supported(dev):
+        config = dev.get_device_config()
+
+        return (config is not None) and \
+               ('set_led_frames' in config.get('led_stream', []))
+
+    def sync(self):
+        if not self.flush():
+            return False, False
+
+        success, fetched_data = self.dev.config_get('led_stream',
+                                                    'get_stream_state',
+                                                    poll_interval=0.001)
+        if (not success) or (fetched_data is None) or \
+           (len(fetched_data) < 3 + 2 * self.led_id):
+            return False, False
+
+        ready = bool(fetched_data[0])
+        dev_seq, free = struct.unpack_from('<BB', fetched_data,
+                                           1 + 2 * self.led_id)
+
+        base = (self.seq - len(self.unacked)) % 256
+        acked = min((dev_seq - base) % 256, len(self.unacked))
+        resend = self.unacked[acked:]
+
+        self.unacked = []
+        self.seq = dev_seq
+        self.credits = free
+        self.max_free = max(self.max_free, free)
+
+        # Steps dropped by the device are sent again.
+        for defines, record in resend:
+            for define in defines:
+                if not self._append(define, False):
+                    return False, ready
+
+            if not self._append(record, True):
+                return False, ready
+
+        return True, ready
+
+    def flush(self):
+        if not self.frame:
+            return True
+
+        data = bytes([self.led_id, self.frame_seq]) + bytes(self.frame)
+        self.frame = bytearray()
+
+        return self.dev.config_set('led_stream', 'set_led_frames', data,
+                                   poll_interval=0.001)
+
+    def _append(self, record, is_step):
+        if len(self.frame) + len(record) > \
+           EVENT_DATA_LEN_MAX - FRAME_HEADER_SIZE:
+            if not self.flush():
+                return False
+
+        if not self.frame:
+            self.frame_seq = self.seq
+
+        self.frame += record
+
+        if is_step:
+            self.unacked.append((self.defines, record))
+            self.defines = []
+            self.seq = (self.seq + 1) % 256
+            self.credits -= 1
+        else:
+            self.defines.append(record)
+
+        return True
+
+    @staticmethod
+    def _step_data(step):
+        return struct.pack(FRAME_STEP_FMT, step.r, step.g, step.b,
+                           step.substep_count, step.substep_time)
+
+    def send_step(self, step):
+        last = self.last
+
+        if (last is not None) and \
+           (last.substep_count == step.substep_count) and \
+           (last.substep_time == step.substep_time):
+            # Colors wrap around on the device, so every change fits.
+            record = bytes([FRAME_TAG_DELTA,
+                            (step.r - last.r) % 256,
+                            (step.g - last.g) % 256,
+                            (step.b - last.b) % 256])
+        else:
+            record = bytes([FRAME_TAG_STEP]) + \
+                     LedFrameStream._step_data(step)
+
+        self.last = Step(step.r, step.g, step.b, step.substep_count,
+                         step.substep_time)
+
+        return self._append(record, True)
+
+    def _wait_drained(self):
+        while True:
+            success, ready = self.sync()
+            if not success or not ready:
+                return False
+
+            if self.credits >= self.max_free:
+                return True
+
+            time.sleep(0.01)
+
+    def send_effect(self, steps):
+        key = tuple(LedFrameStream._step_data(s) for s in steps)
+
+        if key in self.effects:
+            effect_id = self.effects.pop(key)
+        else:
+            if len(self.effects) == self.effect_cnt:
+                # The least recently used effect is replaced. It cannot
+                # be redefined while the device still displays it.
+                del self.effects[next(iter(self.effects))]
+                if not self._wait_drained():
+                    return False
+
+            effect_id = min(set(range(self.effect_cnt)) -
+                            set(self.effects.values()))
+
+            for first in range(0, len(key), FRAME_DEFINE_STEP_CNT):
+                chunk = key[first:first + FRAME_DEFINE_STEP_CNT]
+                record = bytes([FRAME_TAG_DEFINE, effect_id, first,
+                                len(chunk)]) + b''.join(chunk)
+                if not self._append(record, False):
+                    return False
+
+        self.effects[key] = effect_id
+
+        return self._append(bytes([FRAME_TAG_PLAY, effect_id]), True)
+
+
+def send_continuous_led_steps(dev, led_id, step):
+    while True:
+        success, (ready, free) = fetch_free_steps_buffer_info(dev, led_id)
+
+        if not success:
+            break
+
+        if not ready:
+            print('LEDs are not ready')
+            break
+
+        while free > 0:
+            # Send steps with random color and predefined duration
+            step.generate_random_color()
+
+            success = led_send_single_step(dev, step, led_id)
+
+            if not success:
+                break
+
+            free -= 1
+
+
+def send_continuous_led_frames(dev, led_id, step):
+    stream = LedFrameStream(dev, led_id)
+
+    while True:
+        success, ready = stream.sync()
+
+        if not success:
+            break
+
+        if not ready:
+            print('LEDs are not ready')
+            break
+
+        while stream.credits > 0:
+            # Send steps with random color and predefined duration
+            step.generate_random_color()
+
+            if not stream.send_step(step):
+                break
+
+
+def send_continuous_led_effects(dev, led_id, step):
+    stream = LedFrameStream(dev, led_id)
+
+    # The palette fits in the effect table of the device, so every effect
+    # is defined once and then played by its ID.
+    palette = []
+    for _ in range(stream.effect_cnt):
+        step.generate_random_color()
+        # Fade in to the color and out to black.
+        palette.append([Step(step.r, step.g, step.b, step.substep_count,
+                             step.substep_time),
+                        Step(0, 0, 0, step.substep_count,
+                             step.substep_time)])
+
+    while True:
+        success, ready = stream.sync()
+
+        if not success:
+            break
+
+        if not ready:
+            print('LEDs are not ready')
+            break
+
+        while stream.credits > 0:
+            if not stream.send_effect(random.choice(palette)):
+                break
+
+
+def send_continuous_led_stream(dev, led_id, freq, substep_cnt = 10,
+                               effects = False):
     if not validate_params(freq, led_id):
         return
 
@@ -93,26 +342,16 @@ def send_continuous_led_stream(dev, led_id, freq, substep_cnt = 10):
         )
 
         print('LED stream started, press Ctrl+C to interrupt')
-        while True:
-            success, (ready, free) = fetch_free_steps_buffer_info(dev, led_id)
-
-            if not success:
-                break
-
-            if not ready:
-                print('LEDs are not ready')
-                break
-
-            while free > 0:
-                # Send steps with random color and predefined duration
-                step.generate_random_color()
-
-                success = led_send_single_step(dev, step, led_id)
-
-                if not success:
-                    break
 
-                free -= 1
+        if LedFrameStream.supported(dev):
+            if effects:
+                send_continuous_led_effects(dev, led_id, step)
+            else:
+                send_continuous_led_frames(dev, led_id, step)
+        elif effects:
+            print('LED effects are not supported by the device')
+        else:
+            send_continuous_led_steps(dev, led_id, step)
     except Exception as e:
         print(e)
     except KeyboardInterrupt as e:
@@ -4,7 +4,6 @@
  * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
  */
 #include <debug/cpu_load.h>
-#include <shell/shell.h>
 #ifdef DPPI_PRESENT
 #include <nrfx_dppi.h>
 #else
@@ -16,6 +15,7 @@
 #include <hal/nrf_power.h>
 #include <debug/ppi_trace.h>
 #include <logging/log.h>
+#include "cpu_load_internal.h"
 
 LOG_MODULE_REGISTER(cpu_load, CONFIG_CPU_LOAD_LOG_LEVEL);
 
@@ -25,16 +25,8 @@ LOG_MODULE_REGISTER(cpu_load, CONFIG_CPU_LOAD_LOG_LEVEL);
 /* Indicates that channel is not allocated. */
 #define CH_INVALID 0xFF
 
-/* Define to please compiler when periodic logging is disabled. */
-#ifdef CONFIG_CPU_LOAD_LOG_INTERVAL
-#define CPU_LOAD_LOG_INTERVAL CONFIG_CPU_LOAD_LOG_INTERVAL
-#else
-#define CPU_LOAD_LOG_INTERVAL 0
-#endif
-
 static nrfx_timer_t timer = NRFX_TIMER_INSTANCE(CONFIG_CPU_LOAD_TIMER_INSTANCE);
 static bool ready;
-static struct k_delayed_work cpu_load_log;
 static uint32_t cycle_ref;
 static uint32_t shared_ch_mask;
 
@@ -103,23 +95,6 @@ static void ppi_cleanup(uint8_t ch_tick, uint8_t ch_sleep, uint8_t ch_wakeup)
 	}
 }
 
-static void cpu_load_log_fn(struct k_work *item)
-{
-	uint32_t load = cpu_load_get();
-	uint32_t percent = load / 1000;
-	uint32_t fraction = load % 1000;
-
-	cpu_load_reset();
-	LOG_INF("Load:%d,%03d%%", percent, fraction);
-	k_delayed_work_submit(&cpu_load_log, K_MSEC(CPU_LOAD_LOG_INTERVAL));
-}
-
-static int cpu_load_log_init(void)
-{
-	k_delayed_work_init(&cpu_load_log, cpu_load_log_fn);
-	return k_delayed_work_submit(&cpu_load_log, K_MSEC(CPU_LOAD_LOG_INTERVAL));
-}
-
 static void timer_handler(nrf_timer_event_t event_type, void *context)
 {
 	/*empty*/
@@ -139,6 +114,13 @@ int cpu_load_init(void)
 		return 0;
 	}
 
+	if (IS_ENABLED(CONFIG_CPU_LOAD_STATS)) {
+		ret = cpu_load_stats_init();
+		if (ret) {
+			return ret;
+		}
+	}
+
 	config.frequency = NRF_TIMER_FREQ_1MHz;
 	config.bit_width = NRF_TIMER_BIT_WIDTH_32;
 
@@ -207,10 +189,19 @@ int cpu_load_init(void)
 	return ret;
 }
 
+bool cpu_load_is_ready(void)
+{
+	return ready;
+}
+
 void cpu_load_reset(void)
 {
 	nrfx_timer_clear(&timer);
 	cycle_ref = k_cycle_get_32();
+
+	if (IS_ENABLED(CONFIG_CPU_LOAD_STATS)) {
+		cpu_load_stats_reset();
+	}
 }
 
 static uint32_t sleep_ticks_to_us(uint32_t ticks)
@@ -245,51 +236,3 @@ uint32_t cpu_load_get(void)
 
 	return (uint32_t)load;
 }
-
-static int cmd_cpu_load_get(const struct shell *shell, size_t argc, char **argv)
-{
-	uint32_t load;
-	uint32_t percent;
-	uint32_t fraction;
-
-	if (!ready) {
-		shell_error(shell, "Not initialized.");
-		return 0;
-	}
-
-	load = cpu_load_get();
-	percent = load / 1000;
-	fraction = load % 1000;
-
-	shell_print(shell, "CPU load:%d,%03d%%", percent, fraction);
-
-	return 0;
-}
-
-static int cmd_cpu_load_reset(const struct shell *shell,
-				size_t argc, char **argv)
-{
-	int err;
-
-	err = cpu_load_init();
-	if (err != 0) {
-		shell_error(shell, "Init failed (err:%d)");
-		return 0;
-	}
-
-	cpu_load_reset();
-
-	return 0;
-}
-
-SHELL_STATIC_SUBCMD_SET_CREATE(sub_cmd_cpu_load,
-	SHELL_CMD_ARG(get, NULL, "Get load", cmd_cpu_load_get, 1, 0),
-	SHELL_CMD_ARG(reset, NULL, "Reset measurement",
-			cmd_cpu_load_reset, 1, 0),
-	SHELL_CMD_ARG(init, NULL, "Init",
-			cmd_cpu_load_reset, 1, 0),
-	SHELL_SUBCMD_SET_END
-);
-
-SHELL_COND_CMD_ARG_REGISTER(CONFIG_CPU_LOAD_CMDS, cpu_load, &sub_cmd_cpu_load,
-			"CPU load", cmd_cpu_load_get, 1, 1);
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#ifndef __CPU_LOAD_INTERNAL_H
+#define __CPU_LOAD_INTERNAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef CONFIG_BOARD_NATIVE_POSIX
+/* Host C library. */
+#include <time.h>
+
+/** @brief Get the time of a host clock in microseconds. */
+uint64_t cpu_load_host_clock_us(clockid_t clock);
+#endif
+
+/** @brief Check if the CPU load measurement is initialized. */
+bool cpu_load_is_ready(void);
+
+/** @brief Start the periodic logging of the CPU load. */
+int cpu_load_log_init(void);
+
+/** @brief Start sampling of the executed threads and interrupts. */
+int cpu_load_stats_init(void);
+
+/** @brief Reset the threads and interrupts samples. */
+void cpu_load_stats_reset(void);
+
+#endif /* __CPU_LOAD_INTERNAL_H */
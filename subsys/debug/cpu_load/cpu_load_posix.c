@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* CPU load measurement for native_posix.
+ *
+ * The simulated clocks do not tell how busy the CPU is, so the load is the
+ * CPU time consumed by the process compared to the elapsed host time. The
+ * process sleeps when Zephyr is idle only if the execution is slowed down to
+ * real time (CONFIG_NATIVE_POSIX_SLOWDOWN_TO_REAL_TIME).
+ */
+#include <zephyr.h>
+#include <debug/cpu_load.h>
+#include <logging/log.h>
+#include "cpu_load_internal.h"
+
+LOG_MODULE_REGISTER(cpu_load, CONFIG_CPU_LOAD_LOG_LEVEL);
+
+static bool ready;
+static uint64_t busy_ref;
+static uint64_t total_ref;
+
+uint64_t cpu_load_host_clock_us(clockid_t clock)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(clock, &ts);
+
+	return (uint64_t)ts.tv_sec * USEC_PER_SEC + ts.tv_nsec / NSEC_PER_USEC;
+}
+
+int cpu_load_init(void)
+{
+	int ret = 0;
+
+	if (ready) {
+		return 0;
+	}
+
+	if (IS_ENABLED(CONFIG_CPU_LOAD_STATS)) {
+		ret = cpu_load_stats_init();
+		if (ret) {
+			return ret;
+		}
+	}
+
+	cpu_load_reset();
+
+	if (IS_ENABLED(CONFIG_CPU_LOAD_LOG_PERIODIC)) {
+		ret = cpu_load_log_init();
+	}
+
+	ready = true;
+
+	return ret;
+}
+
+bool cpu_load_is_ready(void)
+{
+	return ready;
+}
+
+void cpu_load_reset(void)
+{
+	busy_ref = cpu_load_host_clock_us(CLOCK_PROCESS_CPUTIME_ID);
+	total_ref = cpu_load_host_clock_us(CLOCK_MONOTONIC);
+
+	if (IS_ENABLED(CONFIG_CPU_LOAD_STATS)) {
+		cpu_load_stats_reset();
+	}
+}
+
+uint32_t cpu_load_get(void)
+{
+	uint64_t busy_us = cpu_load_host_clock_us(CLOCK_PROCESS_CPUTIME_ID) -
+			   busy_ref;
+	uint64_t total_us = cpu_load_host_clock_us(CLOCK_MONOTONIC) - total_ref;
+
+	if (total_us == 0) {
+		return 0;
+	}
+
+	/* Process CPU time may include time spent on other host threads. */
+	return (uint32_t)((MIN(busy_us, total_us) * 100000) / total_us);
+}
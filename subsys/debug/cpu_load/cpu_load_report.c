@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <stdlib.h>
+#include <debug/cpu_load.h>
+#include <shell/shell.h>
+#include <logging/log.h>
+#include "cpu_load_internal.h"
+
+LOG_MODULE_DECLARE(cpu_load, CONFIG_CPU_LOAD_LOG_LEVEL);
+
+/* Define to please compiler when periodic logging is disabled. */
+#ifdef CONFIG_CPU_LOAD_LOG_INTERVAL
+#define CPU_LOAD_LOG_INTERVAL CONFIG_CPU_LOAD_LOG_INTERVAL
+#else
+#define CPU_LOAD_LOG_INTERVAL 0
+#endif
+
+#ifdef CONFIG_CPU_LOAD_STATS
+#define TOP_COUNT CONFIG_CPU_LOAD_STATS_TOP_COUNT
+#define TOP_COUNT_MAX CONFIG_CPU_LOAD_STATS_THREADS
+#else
+#define TOP_COUNT 0
+#define TOP_COUNT_MAX 1
+#endif
+
+/* Longest name of an entry, including the terminating character. */
+#define NAME_LEN 32
+
+static struct k_delayed_work cpu_load_log;
+
+static void cpu_load_log_top(void)
+{
+#if TOP_COUNT > 0
+	struct cpu_load_stats_entry entries[TOP_COUNT];
+	char name[NAME_LEN];
+	size_t count;
+
+	count = cpu_load_stats_get(entries, ARRAY_SIZE(entries));
+
+	for (size_t i = 0; i < count; i++) {
+		LOG_INF("  %s:%d,%03d%%",
+			log_strdup(cpu_load_stats_name_get(&entries[i], name,
+							   sizeof(name))),
+			entries[i].load / 1000, entries[i].load % 1000);
+	}
+#endif
+}
+
+static void cpu_load_log_fn(struct k_work *item)
+{
+	uint32_t load = cpu_load_get();
+	uint32_t percent = load / 1000;
+	uint32_t fraction = load % 1000;
+
+	LOG_INF("Load:%d,%03d%%", percent, fraction);
+	cpu_load_log_top();
+
+	cpu_load_reset();
+	k_delayed_work_submit(&cpu_load_log, K_MSEC(CPU_LOAD_LOG_INTERVAL));
+}
+
+int cpu_load_log_init(void)
+{
+	k_delayed_work_init(&cpu_load_log, cpu_load_log_fn);
+	return k_delayed_work_submit(&cpu_load_log, K_MSEC(CPU_LOAD_LOG_INTERVAL));
+}
+
+static int cmd_cpu_load_get(const struct shell *shell, size_t argc, char **argv)
+{
+	uint32_t load;
+	uint32_t percent;
+	uint32_t fraction;
+
+	if (!cpu_load_is_ready()) {
+		shell_error(shell, "Not initialized.");
+		return 0;
+	}
+
+	load = cpu_load_get();
+	percent = load / 1000;
+	fraction = load % 1000;
+
+	shell_print(shell, "CPU load:%d,%03d%%", percent, fraction);
+
+	return 0;
+}
+
+static int cmd_cpu_load_reset(const struct shell *shell,
+				size_t argc, char **argv)
+{
+	int err;
+
+	err = cpu_load_init();
+	if (err != 0) {
+		shell_error(shell, "Init failed (err:%d)", err);
+		return 0;
+	}
+
+	cpu_load_reset();
+
+	return 0;
+}
+
+static int cmd_cpu_load_top(const struct shell *shell, size_t argc, char **argv)
+{
+	struct cpu_load_stats_entry entries[TOP_COUNT_MAX];
+	char name[NAME_LEN];
+	size_t max_count = TOP_COUNT;
+	size_t count;
+
+	if (!cpu_load_is_ready()) {
+		shell_error(shell, "Not initialized.");
+		return 0;
+	}
+
+	if (argc > 1) {
+		max_count = strtoul(argv[1], NULL, 0);
+	}
+
+	count = cpu_load_stats_get(entries, MIN(max_count,
+						ARRAY_SIZE(entries)));
+
+	for (size_t i = 0; i < count; i++) {
+		shell_print(shell, "%-*s %3d,%03d%%", NAME_LEN,
+			    cpu_load_stats_name_get(&entries[i], name,
+						    sizeof(name)),
+			    entries[i].load / 1000, entries[i].load % 1000);
+	}
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_cmd_cpu_load,
+	SHELL_CMD_ARG(get, NULL, "Get load", cmd_cpu_load_get, 1, 0),
+	SHELL_CMD_ARG(reset, NULL, "Reset measurement",
+			cmd_cpu_load_reset, 1, 0),
+	SHELL_CMD_ARG(init, NULL, "Init",
+			cmd_cpu_load_reset, 1, 0),
+	SHELL_COND_CMD_ARG(CONFIG_CPU_LOAD_STATS, top, NULL,
+			"Get threads and interrupts with highest load",
+			cmd_cpu_load_top, 1, 1),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_COND_CMD_ARG_REGISTER(CONFIG_CPU_LOAD_CMDS, cpu_load, &sub_cmd_cpu_load,
+			"CPU load", cmd_cpu_load_get, 1, 1);
@@ -0,0 +1,443 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* CPU load breakdown.
+ *
+ * The executed context is sampled. The kernel calls the thread switch and
+ * interrupt hooks (sys_trace_thread_switched_in, sys_trace_isr_enter and
+ * the related ones) only for the tracing backend selected in the kernel
+ * configuration: SystemView, CTF or CPU stats. There is no backend for
+ * application hooks, so exact accounting would replace the tracing backend
+ * of the application.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <zephyr.h>
+#include <debug/cpu_load.h>
+#ifdef CONFIG_BOARD_NATIVE_POSIX
+/* Host C library. */
+#include <signal.h>
+#include <sys/time.h>
+#else
+#include <nrfx_timer.h>
+#endif
+#include <logging/log.h>
+#include "cpu_load_internal.h"
+
+LOG_MODULE_DECLARE(cpu_load, CONFIG_CPU_LOAD_LOG_LEVEL);
+
+/* Interrupt number used when the sampled context is a thread. */
+#define IRQ_NONE -1
+
+#define SAMPLE_PERIOD_US (USEC_PER_SEC / CONFIG_CPU_LOAD_STATS_SAMPLE_RATE)
+
+struct thread_samples {
+	const struct k_thread *thread;
+	uint64_t samples;
+	bool alive;
+};
+
+static struct thread_samples threads[CONFIG_CPU_LOAD_STATS_THREADS];
+static uint64_t irq_samples[CONFIG_NUM_IRQS];
+static bool initialized;
+
+static void sample(const struct k_thread *thread, int irq, uint32_t weight)
+{
+	if (irq != IRQ_NONE) {
+		irq_samples[irq] += weight;
+		return;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(threads); i++) {
+		if (threads[i].thread == thread) {
+			threads[i].samples += weight;
+			return;
+		}
+
+		if (threads[i].thread == NULL) {
+			threads[i].thread = thread;
+			threads[i].samples = weight;
+			return;
+		}
+	}
+
+	/* Threads that do not fit in the array are only counted in total. */
+}
+
+#ifdef CONFIG_BOARD_NATIVE_POSIX
+
+/* Simulated time does not advance while the code runs, so a kernel timer
+ * would always sample the idle thread. The sampler is a host timer of the
+ * process CPU time instead. Every sample attributes the CPU time consumed
+ * since the previous one to the thread that runs. Interrupts are attributed
+ * to the interrupted thread. The samples are in microseconds and are
+ * compared to the elapsed host time, like in cpu_load_get.
+ *
+ * The host signal may be handled by any host thread, so the samples are
+ * protected with a flag instead of locking interrupts. A sample that finds
+ * the flag set leaves its CPU time to the next one.
+ */
+static atomic_t samples_busy;
+static uint64_t sample_cpu_us;
+static uint64_t reset_us;
+
+static unsigned int samples_lock(void)
+{
+	while (!atomic_cas(&samples_busy, 0, 1)) {
+	}
+
+	return 0;
+}
+
+static void samples_unlock(unsigned int key)
+{
+	ARG_UNUSED(key);
+
+	atomic_clear(&samples_busy);
+}
+
+static void samples_total_reset(void)
+{
+	reset_us = cpu_load_host_clock_us(CLOCK_MONOTONIC);
+	sample_cpu_us = cpu_load_host_clock_us(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+static uint64_t samples_total_get(void)
+{
+	return cpu_load_host_clock_us(CLOCK_MONOTONIC) - reset_us;
+}
+
+static void sampler_handler(int sig)
+{
+	uint64_t cpu_us;
+
+	if (!atomic_cas(&samples_busy, 0, 1)) {
+		return;
+	}
+
+	cpu_us = cpu_load_host_clock_us(CLOCK_PROCESS_CPUTIME_ID);
+	sample(k_current_get(), IRQ_NONE, (uint32_t)(cpu_us - sample_cpu_us));
+	sample_cpu_us = cpu_us;
+
+	atomic_clear(&samples_busy);
+}
+
+static int sampler_start(void)
+{
+	struct sigaction action = {
+		.sa_handler = sampler_handler,
+		.sa_flags = SA_RESTART,
+	};
+	struct itimerval timer = {
+		.it_interval.tv_usec = SAMPLE_PERIOD_US,
+		.it_value.tv_usec = SAMPLE_PERIOD_US,
+	};
+
+	sigemptyset(&action.sa_mask);
+
+	if (sigaction(SIGPROF, &action, NULL) ||
+	    setitimer(ITIMER_PROF, &timer, NULL)) {
+		return -EIO;
+	}
+
+	return 0;
+}
+
+#else
+
+static uint64_t total_samples;
+
+static unsigned int samples_lock(void)
+{
+	return irq_lock();
+}
+
+static void samples_unlock(unsigned int key)
+{
+	irq_unlock(key);
+}
+
+static void samples_total_reset(void)
+{
+	total_samples = 0;
+}
+
+static uint64_t samples_total_get(void)
+{
+	return total_samples;
+}
+
+#define SAMPLER_IRQ NRFX_CONCAT_3(TIMER, \
+				  CONFIG_CPU_LOAD_STATS_TIMER_INSTANCE, \
+				  _IRQn)
+#define SAMPLER_IRQ_HANDLER NRFX_CONCAT_3(nrfx_timer_, \
+					  CONFIG_CPU_LOAD_STATS_TIMER_INSTANCE, \
+					  _irq_handler)
+
+BUILD_ASSERT(CONFIG_CPU_LOAD_STATS_TIMER_INSTANCE !=
+	     CONFIG_CPU_LOAD_TIMER_INSTANCE,
+	     "CPU load measurement and sampling must use different TIMERs");
+
+static nrfx_timer_t sampler =
+	NRFX_TIMER_INSTANCE(CONFIG_CPU_LOAD_STATS_TIMER_INSTANCE);
+
+/** @brief Get the interrupt preempted by the sampler.
+ *
+ * If interrupts are nested, the one with the highest priority is the one
+ * that was executed when the sampler fired.
+ */
+static int active_irq_get(void)
+{
+	int irq = IRQ_NONE;
+	uint32_t prio = UINT32_MAX;
+
+	for (size_t i = 0; i < ARRAY_SIZE(NVIC->IABR); i++) {
+		uint32_t active = NVIC->IABR[i];
+
+		while (active) {
+			int n = (i * 32) + __builtin_ctz(active);
+
+			active &= active - 1;
+
+			if ((n == SAMPLER_IRQ) || (n >= CONFIG_NUM_IRQS)) {
+				continue;
+			}
+
+			if (NVIC_GetPriority(n) < prio) {
+				prio = NVIC_GetPriority(n);
+				irq = n;
+			}
+		}
+	}
+
+	return irq;
+}
+
+static void sampler_handler(nrf_timer_event_t event_type, void *context)
+{
+	total_samples++;
+	sample(k_current_get(), active_irq_get(), 1);
+}
+
+static int sampler_start(void)
+{
+	nrfx_timer_config_t config = NRFX_TIMER_DEFAULT_CONFIG;
+	nrfx_err_t err;
+
+	config.frequency = NRF_TIMER_FREQ_1MHz;
+	config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+	config.interrupt_priority = CONFIG_CPU_LOAD_STATS_IRQ_PRIORITY;
+
+	err = nrfx_timer_init(&sampler, &config, sampler_handler);
+	if (err != NRFX_SUCCESS) {
+		return -EBUSY;
+	}
+
+	IRQ_CONNECT(SAMPLER_IRQ, CONFIG_CPU_LOAD_STATS_IRQ_PRIORITY,
+		    SAMPLER_IRQ_HANDLER, NULL, 0);
+	irq_enable(SAMPLER_IRQ);
+
+	nrfx_timer_extended_compare(&sampler, NRF_TIMER_CC_CHANNEL0,
+				    nrfx_timer_us_to_ticks(&sampler,
+							   SAMPLE_PERIOD_US),
+				    NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK, true);
+	nrfx_timer_enable(&sampler);
+
+	return 0;
+}
+
+#endif /* CONFIG_BOARD_NATIVE_POSIX */
+
+int cpu_load_stats_init(void)
+{
+	int err;
+
+	if (initialized) {
+		return 0;
+	}
+
+	cpu_load_stats_reset();
+
+	err = sampler_start();
+	if (err) {
+		LOG_ERR("Sampler start failed (err:%d)", err);
+		return err;
+	}
+
+	initialized = true;
+
+	return 0;
+}
+
+void cpu_load_stats_reset(void)
+{
+	unsigned int key = samples_lock();
+
+	memset(threads, 0, sizeof(threads));
+	memset(irq_samples, 0, sizeof(irq_samples));
+	samples_total_reset();
+
+	samples_unlock(key);
+}
+
+static void thread_alive_mark(const struct k_thread *thread, void *user_data)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(threads); i++) {
+		if (threads[i].thread == thread) {
+			threads[i].alive = true;
+			return;
+		}
+	}
+}
+
+/** @brief Drop the threads that have been aborted.
+ *
+ * The memory of an aborted thread may be reused, so its entry must not be
+ * dereferenced. Must be called with the samples locked.
+ */
+static void threads_prune(void)
+{
+	size_t used = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(threads); i++) {
+		threads[i].alive = false;
+	}
+
+	k_thread_foreach(thread_alive_mark, NULL);
+
+	for (size_t i = 0; i < ARRAY_SIZE(threads); i++) {
+		if (threads[i].alive) {
+			threads[used++] = threads[i];
+		}
+	}
+
+	memset(&threads[used], 0, (ARRAY_SIZE(threads) - used) *
+	       sizeof(threads[0]));
+}
+
+static void thread_find(const struct k_thread *thread, void *user_data)
+{
+	const struct k_thread **found = user_data;
+
+	if (thread == *found) {
+		*found = NULL;
+	}
+}
+
+static bool thread_is_alive(const struct k_thread *thread)
+{
+	const struct k_thread *found = thread;
+
+	k_thread_foreach(thread_find, &found);
+
+	return (found == NULL);
+}
+
+/** @brief Insert entry to the array sorted by descending load. */
+static void entry_insert(struct cpu_load_stats_entry *entries, size_t *used,
+			 size_t count, const struct cpu_load_stats_entry *entry)
+{
+	size_t i = *used;
+
+	if ((i == count) && (entries[count - 1].load >= entry->load)) {
+		return;
+	}
+
+	if (i < count) {
+		(*used)++;
+	} else {
+		i = count - 1;
+	}
+
+	while ((i > 0) && (entries[i - 1].load < entry->load)) {
+		entries[i] = entries[i - 1];
+		i--;
+	}
+
+	entries[i] = *entry;
+}
+
+static uint32_t samples_to_load(uint64_t samples, uint64_t total)
+{
+	return (uint32_t)(MIN(samples, total) * 100000 / total);
+}
+
+size_t cpu_load_stats_get(struct cpu_load_stats_entry *entries, size_t count)
+{
+	struct cpu_load_stats_entry entry;
+	size_t used = 0;
+	uint64_t total;
+	unsigned int key;
+
+	if (!initialized || (count == 0)) {
+		return 0;
+	}
+
+	key = samples_lock();
+
+	total = samples_total_get();
+	if (total == 0) {
+		samples_unlock(key);
+		return 0;
+	}
+
+	threads_prune();
+
+	for (size_t i = 0; i < ARRAY_SIZE(threads); i++) {
+		const struct k_thread *thread = threads[i].thread;
+
+		if (thread == NULL) {
+			break;
+		}
+
+		if (thread->base.prio == K_IDLE_PRIO) {
+			continue;
+		}
+
+		entry.thread = thread;
+		entry.irq = IRQ_NONE;
+		entry.load = samples_to_load(threads[i].samples, total);
+		entry_insert(entries, &used, count, &entry);
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(irq_samples); i++) {
+		if (irq_samples[i] == 0) {
+			continue;
+		}
+
+		entry.thread = NULL;
+		entry.irq = i;
+		entry.load = samples_to_load(irq_samples[i], total);
+		entry_insert(entries, &used, count, &entry);
+	}
+
+	samples_unlock(key);
+
+	return used;
+}
+
+const char *cpu_load_stats_name_get(const struct cpu_load_stats_entry *entry,
+				    char *buf, size_t len)
+{
+	const char *name = NULL;
+
+	if (entry->thread == NULL) {
+		snprintf(buf, len, "irq %d", entry->irq);
+		return buf;
+	}
+
+	if (IS_ENABLED(CONFIG_THREAD_NAME) && thread_is_alive(entry->thread)) {
+		name = k_thread_name_get((k_tid_t)entry->thread);
+	}
+
+	if ((name != NULL) && (name[0] != '\0')) {
+		snprintf(buf, len, "%s", name);
+	} else {
+		snprintf(buf, len, "%p", entry->thread);
+	}
+
+	return buf;
+}
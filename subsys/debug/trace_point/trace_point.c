@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <zephyr.h>
+#include <init.h>
+#include <sys/printk.h>
+#include <debug/trace_point.h>
+#include <profiler.h>
+#include <logging/log.h>
+
+#ifdef CONFIG_BOARD_NATIVE_POSIX
+/* Host C library. */
+#include <time.h>
+#endif
+
+LOG_MODULE_REGISTER(trace_point, CONFIG_TRACE_POINT_LOG_LEVEL);
+
+BUILD_ASSERT((CONFIG_TRACE_POINT_BUF_SIZE &
+	      (CONFIG_TRACE_POINT_BUF_SIZE - 1)) == 0,
+	     "Buffer size must be a power of two");
+
+/* Number of records read from the buffer at once during the dump. */
+#define DUMP_CHUNK 16
+
+/* Define to please compiler when periodic dump is disabled. */
+#ifdef CONFIG_TRACE_POINT_DUMP_INTERVAL
+#define DUMP_INTERVAL CONFIG_TRACE_POINT_DUMP_INTERVAL
+#else
+#define DUMP_INTERVAL 0
+#endif
+
+#ifdef CONFIG_TRACE_POINT_TIMER_FREQ_1MHZ
+#define TIMER_FREQ NRF_TIMER_FREQ_1MHz
+#define TIMER_FREQ_HZ 1000000
+#else
+#define TIMER_FREQ NRF_TIMER_FREQ_16MHz
+#define TIMER_FREQ_HZ 16000000
+#endif
+
+struct trace_point_slot trace_point_ring[CONFIG_TRACE_POINT_BUF_SIZE];
+atomic_t trace_point_head;
+atomic_t trace_point_enabled;
+
+/* Index of the next record to be read. */
+static uint32_t tail;
+static K_MUTEX_DEFINE(read_mutex);
+static struct k_delayed_work dump_work;
+static bool initialized;
+
+#ifdef CONFIG_TRACE_POINT_DUMP_PROFILER
+/* Profiler event type of every trace point, registered on the first dump. */
+static uint16_t profiler_ids[CONFIG_MAX_NUMBER_OF_CUSTOM_EVENTS];
+static size_t profiler_id_count;
+static bool profiler_registered;
+#endif
+
+#ifdef CONFIG_BOARD_NATIVE_POSIX
+uint32_t trace_point_timestamp_get(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint32_t)(ts.tv_sec * USEC_PER_SEC + ts.tv_nsec / NSEC_PER_USEC);
+}
+
+uint32_t trace_point_timestamp_freq_get(void)
+{
+	return USEC_PER_SEC;
+}
+
+static void timer_start(void)
+{
+}
+#else
+uint32_t trace_point_timestamp_freq_get(void)
+{
+	return TIMER_FREQ_HZ;
+}
+
+static void timer_start(void)
+{
+	NRF_TIMER_Type *timer =
+		NRFX_CONCAT_2(NRF_TIMER, CONFIG_TRACE_POINT_TIMER_INSTANCE);
+
+	nrf_timer_mode_set(timer, NRF_TIMER_MODE_TIMER);
+	nrf_timer_bit_width_set(timer, NRF_TIMER_BIT_WIDTH_32);
+	nrf_timer_frequency_set(timer, TIMER_FREQ);
+	nrf_timer_task_trigger(timer, NRF_TIMER_TASK_CLEAR);
+	nrf_timer_task_trigger(timer, NRF_TIMER_TASK_START);
+}
+#endif /* CONFIG_BOARD_NATIVE_POSIX */
+
+const struct trace_point *trace_point_get(uint16_t id)
+{
+	if (id >= (_trace_point_list_end - _trace_point_list_start)) {
+		return NULL;
+	}
+
+	return &_trace_point_list_start[id];
+}
+
+void trace_point_enable(bool enable)
+{
+	atomic_set(&trace_point_enabled, enable);
+}
+
+size_t trace_point_read(struct trace_point_record *records, size_t count,
+			uint32_t *lost)
+{
+	uint32_t lost_cnt = 0;
+	uint32_t head;
+	size_t n = 0;
+
+	k_mutex_lock(&read_mutex, K_FOREVER);
+
+	head = atomic_get(&trace_point_head);
+
+	if ((head - tail) > CONFIG_TRACE_POINT_BUF_SIZE) {
+		lost_cnt += head - tail - CONFIG_TRACE_POINT_BUF_SIZE;
+		tail = head - CONFIG_TRACE_POINT_BUF_SIZE;
+	}
+
+	while ((n < count) && (tail != head)) {
+		const struct trace_point_slot *slot =
+			&trace_point_ring[tail & TRACE_POINT_RING_MASK];
+		uint32_t seq = slot->seq;
+
+		if ((seq == TRACE_POINT_SEQ_BUSY(tail)) ||
+		    (seq == tail - CONFIG_TRACE_POINT_BUF_SIZE)) {
+			/* The writer did not finish yet. */
+			break;
+		}
+
+		if (seq == tail) {
+			compiler_barrier();
+			records[n] = slot->record;
+			compiler_barrier();
+
+			/* Check if the record was not overwritten while being
+			 * copied.
+			 */
+			seq = slot->seq;
+		}
+
+		if (seq == tail) {
+			n++;
+		} else {
+			lost_cnt++;
+		}
+
+		tail++;
+	}
+
+	k_mutex_unlock(&read_mutex);
+
+	if (lost) {
+		*lost = lost_cnt;
+	}
+
+	return n;
+}
+
+#ifdef CONFIG_TRACE_POINT_DUMP_PROFILER
+static void profiler_register(void)
+{
+	static const char * const labels[] = {"timestamp", "arg"};
+	static const enum profiler_arg types[] = {PROFILER_ARG_U32,
+						  PROFILER_ARG_U32};
+	size_t tp_count = _trace_point_list_end - _trace_point_list_start;
+
+	for (size_t i = 0; i < tp_count; i++) {
+		if (profiler_num_events >= CONFIG_MAX_NUMBER_OF_CUSTOM_EVENTS) {
+			LOG_WRN("No profiler event types left for %zu trace "
+				"points", tp_count - i);
+			break;
+		}
+
+		profiler_ids[i] = profiler_register_event_type(
+					_trace_point_list_start[i].name,
+					(const char **)labels, types,
+					ARRAY_SIZE(labels));
+		profiler_id_count++;
+	}
+
+	profiler_registered = true;
+}
+
+static void record_dump(const struct trace_point_record *record)
+{
+	struct log_event_buf buf;
+	uint16_t profiler_id;
+
+	if (record->id >= profiler_id_count) {
+		return;
+	}
+
+	profiler_id = profiler_ids[record->id];
+	if (!is_profiling_enabled(profiler_id)) {
+		return;
+	}
+
+	profiler_log_start(&buf);
+	profiler_log_encode_u32(&buf, record->timestamp);
+	profiler_log_encode_u32(&buf, record->arg);
+	profiler_log_send(&buf, profiler_id);
+}
+
+static void lost_dump(uint32_t lost)
+{
+	LOG_WRN("%u trace records lost", lost);
+}
+#else
+static void record_dump(const struct trace_point_record *record)
+{
+	const struct trace_point *tp = trace_point_get(record->id);
+
+	printk("tp,%u,%s,%u\n", record->timestamp,
+	       tp ? tp->name : "?", record->arg);
+}
+
+static void lost_dump(uint32_t lost)
+{
+	printk("tp_lost,%u\n", lost);
+}
+#endif /* CONFIG_TRACE_POINT_DUMP_PROFILER */
+
+size_t trace_point_dump(void)
+{
+	struct trace_point_record records[DUMP_CHUNK];
+	size_t total = 0;
+	uint32_t lost;
+	size_t count;
+
+#ifdef CONFIG_TRACE_POINT_DUMP_PROFILER
+	if (!profiler_registered) {
+		profiler_register();
+	}
+#endif
+
+	do {
+		count = trace_point_read(records, ARRAY_SIZE(records), &lost);
+
+		if (lost) {
+			lost_dump(lost);
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			record_dump(&records[i]);
+		}
+
+		total += count;
+	} while (count == ARRAY_SIZE(records));
+
+	return total;
+}
+
+static void dump_work_fn(struct k_work *work)
+{
+	trace_point_dump();
+	k_delayed_work_submit(&dump_work, K_MSEC(DUMP_INTERVAL));
+}
+
+int trace_point_init(void)
+{
+	if (initialized) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(trace_point_ring); i++) {
+		trace_point_ring[i].seq = TRACE_POINT_SEQ_BUSY(i);
+	}
+
+	timer_start();
+	trace_point_enable(true);
+
+	if (IS_ENABLED(CONFIG_TRACE_POINT_DUMP_PERIODIC)) {
+		k_delayed_work_init(&dump_work, dump_work_fn);
+		k_delayed_work_submit(&dump_work, K_MSEC(DUMP_INTERVAL));
+	}
+
+	initialized = true;
+
+	LOG_INF("%zu trace points, timer %u Hz",
+		(size_t)(_trace_point_list_end - _trace_point_list_start),
+		trace_point_timestamp_freq_get());
+
+	return 0;
+}
+
+#ifdef CONFIG_TRACE_POINT_AUTO_INIT
+static int trace_point_sys_init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return trace_point_init();
+}
+
+SYS_INIT(trace_point_sys_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+#endif
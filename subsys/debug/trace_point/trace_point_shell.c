@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <shell/shell.h>
+#include <debug/trace_point.h>
+
+/* Number of records read from the buffer at once. */
+#define READ_CHUNK 16
+
+static int cmd_list(const struct shell *shell, size_t argc, char **argv)
+{
+	const struct trace_point *tp;
+
+	shell_print(shell, "Timer frequency: %u Hz",
+		    trace_point_timestamp_freq_get());
+
+	for (uint16_t id = 0; (tp = trace_point_get(id)) != NULL; id++) {
+		shell_print(shell, "%3u: %s", id, tp->name);
+	}
+
+	return 0;
+}
+
+static int cmd_read(const struct shell *shell, size_t argc, char **argv)
+{
+	struct trace_point_record records[READ_CHUNK];
+	uint32_t lost;
+	size_t count;
+
+	do {
+		count = trace_point_read(records, ARRAY_SIZE(records), &lost);
+
+		if (lost) {
+			shell_warn(shell, "%u records lost", lost);
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			const struct trace_point *tp =
+				trace_point_get(records[i].id);
+
+			shell_print(shell, "%10u %-24s %u", records[i].timestamp,
+				    tp ? tp->name : "?", records[i].arg);
+		}
+	} while (count == ARRAY_SIZE(records));
+
+	return 0;
+}
+
+static int cmd_dump(const struct shell *shell, size_t argc, char **argv)
+{
+	shell_print(shell, "Dumped %zu records", trace_point_dump());
+
+	return 0;
+}
+
+static int cmd_enable(const struct shell *shell, size_t argc, char **argv)
+{
+	int err = trace_point_init();
+
+	if (err) {
+		shell_error(shell, "Init failed (err:%d)", err);
+		return 0;
+	}
+
+	trace_point_enable(true);
+
+	return 0;
+}
+
+static int cmd_disable(const struct shell *shell, size_t argc, char **argv)
+{
+	trace_point_enable(false);
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_trace_point,
+	SHELL_CMD_ARG(list, NULL, "List trace points", cmd_list, 1, 0),
+	SHELL_CMD_ARG(read, NULL, "Print and remove recorded trace points",
+		      cmd_read, 1, 0),
+	SHELL_CMD_ARG(dump, NULL, "Send recorded trace points to the backend",
+		      cmd_dump, 1, 0),
+	SHELL_CMD_ARG(enable, NULL, "Enable recording", cmd_enable, 1, 0),
+	SHELL_CMD_ARG(disable, NULL, "Disable recording", cmd_disable, 1, 0),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(trace_point, &sub_trace_point, "Trace points", NULL);
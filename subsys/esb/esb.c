@@ -10,6 +10,7 @@
 #include <esb.h>
 #include <stddef.h>
 #include <string.h>
+#include <debug/trace_point.h>
 
 /* Constants */
 
@@ -160,6 +161,9 @@ static bool esb_initialized;
 static struct esb_config esb_cfg;
 static volatile enum esb_state esb_state = ESB_STATE_IDLE;
 
+TRACE_POINT_DEFINE(esb_radio_irq);
+TRACE_POINT_DEFINE(esb_evt_irq);
+
 /* Default address configuration for ESB.
  * Roughly equal to the nRF24Lxx defaults, except for the number of pipes,
  * because more pipes are supported.
@@ -916,6 +920,8 @@ static void get_and_clear_irqs(uint32_t *interrupts)
 
 static void RADIO_IRQHandler(void)
 {
+	TRACE_POINT(esb_radio_irq, esb_state);
+
 	if (NRF_RADIO->EVENTS_READY &&
 	    (NRF_RADIO->INTENSET & RADIO_INTENSET_READY_Msk)) {
 		NRF_RADIO->EVENTS_READY = 0;
@@ -953,6 +959,8 @@ static void ESB_EVT_IRQHandler(void)
 	event.tx_attempts = last_tx_attempts;
 
 	get_and_clear_irqs(&interrupts);
+	TRACE_POINT(esb_evt_irq, interrupts);
+
 	if (event_handler != NULL) {
 		if (interrupts & INT_TX_SUCCESS_MSK) {
 			event.evt_id = ESB_EVENT_TX_SUCCESS;
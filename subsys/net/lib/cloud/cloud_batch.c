@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <string.h>
+#include <net/cloud.h>
+#include <net/cloud_batch.h>
+#include <logging/log.h>
+
+LOG_MODULE_REGISTER(cloud_batch, CONFIG_CLOUD_BATCH_LOG_LEVEL);
+
+/* Messages are stored back to back in the buffer, each one prefixed by
+ * its length. The length prefix is never smaller than the separator
+ * added when the batch is encoded, so an encoded batch of n >= 1
+ * messages ("[a,b,...]") always fits in a buffer of the ring size.
+ */
+struct batch_record_hdr {
+	uint16_t len;
+} __packed;
+
+BUILD_ASSERT(CONFIG_CLOUD_BATCH_FLUSH_SIZE <= CONFIG_CLOUD_BATCH_BUF_SIZE,
+	     "Flush size exceeds the batch buffer size");
+
+/* Records are kept until the batch is sent successfully, so that a failed
+ * send can be retried.
+ */
+static uint8_t batch_buf[CONFIG_CLOUD_BATCH_BUF_SIZE];
+static size_t batch_len;
+static uint8_t batch_payload[CONFIG_CLOUD_BATCH_BUF_SIZE];
+
+static K_MUTEX_DEFINE(batch_lock);
+static struct k_delayed_work flush_work;
+
+static const struct cloud_backend *batch_backend;
+static struct cloud_endpoint batch_ep;
+static enum cloud_qos batch_qos;
+static size_t batch_count;
+
+static size_t batch_encode(void)
+{
+	struct batch_record_hdr hdr;
+	size_t offset = 0;
+	size_t len = 0;
+
+	batch_payload[len++] = '[';
+
+	for (size_t i = 0; i < batch_count; i++) {
+		memcpy(&hdr, &batch_buf[offset], sizeof(hdr));
+		offset += sizeof(hdr);
+
+		if (i > 0) {
+			batch_payload[len++] = ',';
+		}
+
+		memcpy(&batch_payload[len], &batch_buf[offset], hdr.len);
+		offset += hdr.len;
+		len += hdr.len;
+	}
+
+	batch_payload[len++] = ']';
+
+	return len;
+}
+
+static void batch_reset(void)
+{
+	batch_count = 0;
+	batch_len = 0;
+	batch_qos = CLOUD_QOS_AT_MOST_ONCE;
+}
+
+/* Must be called with batch_lock held. The messages are kept if sending
+ * fails, and the send is retried after the flush time.
+ */
+static int batch_send(void)
+{
+	int err;
+	struct cloud_msg msg = {
+		.buf = (char *)batch_payload,
+		.qos = batch_qos,
+		.endpoint = batch_ep,
+	};
+
+	if (batch_count == 0) {
+		return 0;
+	}
+
+	k_delayed_work_cancel(&flush_work);
+
+	msg.len = batch_encode();
+
+	LOG_DBG("Sending %d messages, %d bytes", batch_count, msg.len);
+
+	err = cloud_send(batch_backend, &msg);
+	if (err) {
+		LOG_ERR("cloud_send failed, error: %d", err);
+		k_delayed_work_submit(&flush_work,
+				      K_SECONDS(CONFIG_CLOUD_BATCH_FLUSH_TIME));
+		return err;
+	}
+
+	batch_reset();
+
+	return 0;
+}
+
+static void flush_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	(void)cloud_batch_flush();
+}
+
+int cloud_batch_init(const struct cloud_backend *const backend)
+{
+	if (backend == NULL) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&batch_lock, K_FOREVER);
+
+	batch_backend = backend;
+	batch_reset();
+	k_delayed_work_init(&flush_work, flush_work_fn);
+
+	k_mutex_unlock(&batch_lock);
+
+	return 0;
+}
+
+int cloud_batch_add(const struct cloud_msg *const msg,
+		    enum cloud_batch_prio prio)
+{
+	int err = 0;
+	struct batch_record_hdr hdr;
+
+	if (msg == NULL || msg->buf == NULL || msg->len == 0 ||
+	    prio >= CLOUD_BATCH_PRIO_COUNT) {
+		return -EINVAL;
+	}
+
+	if (batch_backend == NULL) {
+		return -ENOTCONN;
+	}
+
+	if (msg->len + sizeof(hdr) > CONFIG_CLOUD_BATCH_BUF_SIZE) {
+		LOG_ERR("Message of %d bytes does not fit in a batch",
+			msg->len);
+		return -EMSGSIZE;
+	}
+
+	k_mutex_lock(&batch_lock, K_FOREVER);
+
+	/* A batch is sent to a single endpoint. If the buffered messages
+	 * cannot be sent, the new message is not added.
+	 */
+	if (batch_count > 0 &&
+	    (msg->endpoint.type != batch_ep.type ||
+	     msg->endpoint.str != batch_ep.str)) {
+		err = batch_send();
+		if (err) {
+			goto out;
+		}
+	}
+
+	if (sizeof(batch_buf) - batch_len < msg->len + sizeof(hdr)) {
+		err = batch_send();
+		if (err) {
+			goto out;
+		}
+	}
+
+	hdr.len = msg->len;
+	memcpy(&batch_buf[batch_len], &hdr, sizeof(hdr));
+	batch_len += sizeof(hdr);
+	memcpy(&batch_buf[batch_len], msg->buf, msg->len);
+	batch_len += msg->len;
+
+	if (batch_count++ == 0) {
+		batch_ep = msg->endpoint;
+		k_delayed_work_submit(&flush_work,
+				      K_SECONDS(CONFIG_CLOUD_BATCH_FLUSH_TIME));
+	}
+
+	batch_qos = MAX(batch_qos, msg->qos);
+
+	if (prio == CLOUD_BATCH_PRIO_HIGH ||
+	    batch_len >= CONFIG_CLOUD_BATCH_FLUSH_SIZE) {
+		err = batch_send();
+	}
+
+out:
+	k_mutex_unlock(&batch_lock);
+
+	return err;
+}
+
+int cloud_batch_flush(void)
+{
+	int err;
+
+	if (batch_backend == NULL) {
+		return -ENOTCONN;
+	}
+
+	k_mutex_lock(&batch_lock, K_FOREVER);
+	err = batch_send();
+	k_mutex_unlock(&batch_lock);
+
+	return err;
+}
+
+void cloud_batch_clear(void)
+{
+	k_mutex_lock(&batch_lock, K_FOREVER);
+
+	k_delayed_work_cancel(&flush_work);
+	batch_reset();
+
+	k_mutex_unlock(&batch_lock);
+}
+
+size_t cloud_batch_count(void)
+{
+	return batch_count;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef NRF_CLOUD_AGPS_CACHE_H_
+#define NRF_CLOUD_AGPS_CACHE_H_
+
+#include <zephyr.h>
+#include <drivers/gps.h>
+
+#include "nrf_cloud_agps_schema_v1.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Function used to inject a cached element into the modem. */
+typedef int (*nrf_cloud_agps_cache_send_t)(
+	const struct nrf_cloud_apgs_element *element);
+
+/** @brief Store an A-GPS element received from nRF Cloud.
+ *
+ * Ephemerides, almanacs, UTC parameters and Klobuchar corrections are
+ * kept in RAM and written to flash in the background. Other types are
+ * ignored, as they are only valid at the time they were received.
+ *
+ * @param element Element to store.
+ */
+void nrf_cloud_agps_cache_store(const struct nrf_cloud_apgs_element *element);
+
+/** @brief Inject cached A-GPS data that is still valid.
+ *
+ * All cached elements asked for by @p request that have not expired are
+ * passed to @p send in one pass. The elements that were injected are
+ * removed from @p request, so that only the remaining data has to be
+ * requested from nRF Cloud.
+ *
+ * @param request Requested data, updated with the data still needed.
+ * @param send    Function injecting an element into the modem.
+ *
+ * @return Number of elements injected, or a negative error code if the
+ *         current time is not known.
+ */
+int nrf_cloud_agps_cache_inject(struct gps_agps_request *request,
+				nrf_cloud_agps_cache_send_t send);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NRF_CLOUD_AGPS_CACHE_H_ */
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef NRF_CLOUD_AGPS_PARSER_H_
+#define NRF_CLOUD_AGPS_PARSER_H_
+
+#include <zephyr.h>
+
+#include "nrf_cloud_agps_schema_v1.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Largest element in the binary format. */
+#define NRF_CLOUD_AGPS_PARSER_BUF_SIZE \
+	sizeof(struct nrf_cloud_agps_ephemeris)
+
+/** @brief Function called for each complete element.
+ *
+ * The element points either into the data given to
+ * @ref nrf_cloud_agps_parser_feed or into the parser, and is only valid
+ * until the function returns.
+ *
+ * @return 0 to continue parsing, or a negative error code to stop.
+ */
+typedef int (*nrf_cloud_agps_parser_cb_t)(
+	const struct nrf_cloud_apgs_element *element, void *user_data);
+
+/** @brief A-GPS binary data parser.
+ *
+ * The members are internal to the parser.
+ */
+struct nrf_cloud_agps_parser {
+	nrf_cloud_agps_parser_cb_t cb;
+	void *user_data;
+	/* Elements left in the current array. */
+	uint16_t elements_left;
+	/* Type of the elements in the current array. */
+	uint8_t type;
+	uint8_t state;
+	/* Part of an element split between two fragments. */
+	uint8_t fill;
+	uint8_t buf[NRF_CLOUD_AGPS_PARSER_BUF_SIZE];
+};
+
+/** @brief Initialize a parser for a new A-GPS response.
+ *
+ * @param parser    Parser.
+ * @param cb        Function called for each element.
+ * @param user_data User data passed to @p cb.
+ */
+void nrf_cloud_agps_parser_init(struct nrf_cloud_agps_parser *parser,
+				nrf_cloud_agps_parser_cb_t cb, void *user_data);
+
+/** @brief Parse the next fragment of an A-GPS response.
+ *
+ * Fragments may be split at any byte. Elements that are complete within
+ * a fragment are passed on without being copied.
+ *
+ * @param parser Parser.
+ * @param data   Fragment.
+ * @param len    Length of the fragment.
+ *
+ * @retval 0 If the fragment was parsed.
+ * @retval -EBADMSG The data is malformed. Further data is rejected.
+ * @return Error returned by the callback, which also stops parsing.
+ */
+int nrf_cloud_agps_parser_feed(struct nrf_cloud_agps_parser *parser,
+			       const uint8_t *data, size_t len);
+
+/** @brief Check that the complete A-GPS response was parsed.
+ *
+ * @param parser Parser.
+ *
+ * @retval 0 If the response ended after a complete element.
+ * @retval -EBADMSG The response was truncated or malformed.
+ */
+int nrf_cloud_agps_parser_finish(struct nrf_cloud_agps_parser *parser);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NRF_CLOUD_AGPS_PARSER_H_ */
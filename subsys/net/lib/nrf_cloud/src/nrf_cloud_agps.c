@@ -19,6 +19,10 @@ LOG_MODULE_REGISTER(nrf_cloud_agps, CONFIG_NRF_CLOUD_AGPS_LOG_LEVEL);
 
 #include "nrf_cloud_transport.h"
 #include "nrf_cloud_agps_schema_v1.h"
+#include "nrf_cloud_agps_parser.h"
+#if defined(CONFIG_NRF_CLOUD_AGPS_CACHE)
+#include "nrf_cloud_agps_cache.h"
+#endif
 
 extern void agps_print(enum nrf_cloud_agps_type type, void *data);
 
@@ -40,6 +44,9 @@ static enum gps_agps_type type_lookup_socket2gps[] = {
 	[NRF_GNSS_AGPS_INTEGRITY]	= GPS_AGPS_INTEGRITY,
 };
 
+static int agps_send_to_modem(
+	const struct nrf_cloud_apgs_element *agps_data);
+
 void agps_print_enable(bool enable)
 {
 	agps_print_enabled = enable;
@@ -69,7 +76,7 @@ static int type_array2str(enum gps_agps_type *types, size_t type_count,
 	return 0;
 }
 
-int nrf_cloud_agps_request(const struct gps_agps_request request)
+static int agps_request_send(const struct gps_agps_request request)
 {
 	int err, len;
 	char types_str[20];
@@ -198,6 +205,31 @@ int nrf_cloud_agps_request(const struct gps_agps_request request)
 	return 0;
 }
 
+int nrf_cloud_agps_request(const struct gps_agps_request request)
+{
+#if defined(CONFIG_NRF_CLOUD_AGPS_CACHE)
+	struct gps_agps_request remaining = request;
+	int injected;
+
+	if ((gps_dev == NULL) && (fd < 0)) {
+		gps_dev = device_get_binding("NRF9160_GPS");
+	}
+
+	if ((gps_dev != NULL) || (fd >= 0)) {
+		injected = nrf_cloud_agps_cache_inject(&remaining,
+						       agps_send_to_modem);
+		if (injected > 0) {
+			LOG_INF("%d A-GPS elements injected from cache",
+				injected);
+		}
+	}
+
+	return agps_request_send(remaining);
+#else
+	return agps_request_send(request);
+#endif /* CONFIG_NRF_CLOUD_AGPS_CACHE */
+}
+
 int nrf_cloud_agps_request_all(void)
 {
 	struct gps_agps_request request = {
@@ -249,7 +281,7 @@ static int send_to_modem(void *data, size_t data_len,
 }
 
 static int copy_utc(nrf_gnss_agps_data_utc_t *dst,
-		    struct nrf_cloud_apgs_element *src)
+		    const struct nrf_cloud_apgs_element *src)
 {
 	if ((src == NULL) || (dst == NULL)) {
 		return -EINVAL;
@@ -268,7 +300,7 @@ static int copy_utc(nrf_gnss_agps_data_utc_t *dst,
 }
 
 static int copy_almanac(nrf_gnss_agps_data_almanac_t *dst,
-			struct nrf_cloud_apgs_element *src)
+			const struct nrf_cloud_apgs_element *src)
 {
 	if ((src == NULL) || (dst == NULL)) {
 		return -EINVAL;
@@ -293,7 +325,7 @@ static int copy_almanac(nrf_gnss_agps_data_almanac_t *dst,
 }
 
 static int copy_ephemeris(nrf_gnss_agps_data_ephemeris_t *dst,
-			  struct nrf_cloud_apgs_element *src)
+			  const struct nrf_cloud_apgs_element *src)
 {
 	if ((src == NULL) || (dst == NULL)) {
 		return -EINVAL;
@@ -330,7 +362,7 @@ static int copy_ephemeris(nrf_gnss_agps_data_ephemeris_t *dst,
 }
 
 static int copy_klobuchar(nrf_gnss_agps_data_klobuchar_t *dst,
-			  struct nrf_cloud_apgs_element *src)
+			  const struct nrf_cloud_apgs_element *src)
 {
 	if ((src == NULL) || (dst == NULL)) {
 		return -EINVAL;
@@ -349,7 +381,7 @@ static int copy_klobuchar(nrf_gnss_agps_data_klobuchar_t *dst,
 }
 
 static int copy_location(nrf_gnss_agps_data_location_t *dst,
-			 struct nrf_cloud_apgs_element *src)
+			 const struct nrf_cloud_apgs_element *src)
 {
 	if ((src == NULL) || (dst == NULL)) {
 		return -EINVAL;
@@ -368,7 +400,7 @@ static int copy_location(nrf_gnss_agps_data_location_t *dst,
 }
 
 static int copy_time_and_tow(nrf_gnss_agps_data_system_time_and_sv_tow_t *dst,
-			     struct nrf_cloud_apgs_element *src)
+			     const struct nrf_cloud_apgs_element *src)
 {
 	if ((src == NULL) || (dst == NULL)) {
 		return -EINVAL;
@@ -394,7 +426,8 @@ static int copy_time_and_tow(nrf_gnss_agps_data_system_time_and_sv_tow_t *dst,
 	return 0;
 }
 
-static int agps_send_to_modem(struct nrf_cloud_apgs_element *agps_data)
+static int agps_send_to_modem(
+	const struct nrf_cloud_apgs_element *agps_data)
 {
 	switch (agps_data->type) {
 	case NRF_CLOUD_AGPS_UTC_PARAMETERS: {
@@ -465,95 +498,69 @@ static int agps_send_to_modem(struct nrf_cloud_apgs_element *agps_data)
 	return 0;
 }
 
-static size_t get_next_agps_element(struct nrf_cloud_apgs_element *element,
-				    const char *buf)
+struct agps_process_ctx {
+	/* The time of week of each satellite is given before the system
+	 * clock, and all of them are injected together.
+	 */
+	struct nrf_cloud_agps_system_time sys_time;
+};
+
+static struct {
+	struct nrf_cloud_agps_parser parser;
+	struct agps_process_ctx ctx;
+	bool active;
+} stream;
+
+static int element_process(const struct nrf_cloud_apgs_element *element,
+			   void *user_data)
 {
-	static uint16_t elements_left_to_process;
-	static enum nrf_cloud_agps_type element_type;
-	size_t len = 0;
+	struct agps_process_ctx *ctx = user_data;
+	struct nrf_cloud_apgs_element clock;
+	int err;
 
-	/* Check if there are more elements left in the array to process.
-	 * The element type is only given once before the array, and not for
-	 * each element.
-	 */
-	if (elements_left_to_process == 0) {
-		element->type =
-			(enum nrf_cloud_agps_type)buf[NRF_CLOUD_AGPS_BIN_TYPE_OFFSET];
-		element_type = element->type;
-		elements_left_to_process =
-			*(uint16_t *)&buf[NRF_CLOUD_AGPS_BIN_COUNT_OFFSET] - 1;
-		len += NRF_CLOUD_AGPS_BIN_TYPE_SIZE +
-			NRF_CLOUD_AGPS_BIN_COUNT_SIZE;
-	} else {
-		element->type = element_type;
-		elements_left_to_process -= 1;
-	}
+	if (element->type == NRF_CLOUD_AGPS_GPS_TOWS) {
+		uint8_t sv_id = element->tow->sv_id;
+
+		if ((sv_id < 1) || (sv_id > NRF_CLOUD_AGPS_MAX_SV_TOW)) {
+			LOG_ERR("Invalid satellite ID in TOW: %d", sv_id);
+			return -EBADMSG;
+		}
+
+		memcpy(&ctx->sys_time.sv_tow[sv_id - 1], element->tow,
+		       sizeof(ctx->sys_time.sv_tow[0]));
+
+		LOG_DBG("TOW %d copied", sv_id - 1);
 
-	switch (element->type) {
-	case NRF_CLOUD_AGPS_UTC_PARAMETERS:
-		element->utc = (struct nrf_cloud_agps_utc *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_utc);
-		break;
-	case NRF_CLOUD_AGPS_EPHEMERIDES:
-		element->ephemeris = (struct nrf_cloud_agps_ephemeris *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_ephemeris);
-		break;
-	case NRF_CLOUD_AGPS_ALMANAC:
-		element->almanac = (struct nrf_cloud_agps_almanac *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_almanac);
-		break;
-	case NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION:
-		element->ion_correction.klobuchar =
-			(struct nrf_cloud_agps_klobuchar *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_klobuchar);
-		break;
-	case NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK:
-		element->time_and_tow =
-			(struct nrf_cloud_agps_system_time *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_system_time) -
-			sizeof(element->time_and_tow->sv_tow) + 4;
-		break;
-	case NRF_CLOUD_AGPS_GPS_TOWS:
-		element->tow =
-			(struct nrf_cloud_agps_tow_element *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_tow_element);
-		break;
-	case NRF_CLOUD_AGPS_LOCATION:
-		element->location = (struct nrf_cloud_agps_location *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_location);
-		break;
-	case NRF_CLOUD_AGPS_INTEGRITY:
-		element->integrity =
-			(struct nrf_cloud_agps_integrity *)(buf + len);
-		len += sizeof(struct nrf_cloud_agps_integrity);
-		break;
-	default:
-		LOG_DBG("Unhandled A-GPS data type: %d", element->type);
 		return 0;
-	}
+	} else if (element->type == NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK) {
+		memcpy(&ctx->sys_time, element->time_and_tow,
+		       sizeof(ctx->sys_time) - sizeof(ctx->sys_time.sv_tow));
 
-	return len;
-}
+		LOG_DBG("TOWs copied, bitmask: 0x%08x",
+			ctx->sys_time.sv_mask);
 
-int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket)
-{
-	int err;
-	struct nrf_cloud_apgs_element element = {};
-	struct nrf_cloud_agps_system_time sys_time;
-	size_t parsed_len = 0;
-	uint8_t version;
+		clock.type = NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK;
+		clock.time_and_tow = &ctx->sys_time;
+		element = &clock;
+	}
 
-	version = buf[NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION_INDEX];
-	parsed_len += NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION_SIZE;
+	err = agps_send_to_modem(element);
+	if (err) {
+		LOG_ERR("Failed to send data to modem, error: %d", err);
+		return err;
+	}
 
-	__ASSERT(version == NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION,
-		 "Cannot parse schema version: %d", version);
+#if defined(CONFIG_NRF_CLOUD_AGPS_CACHE)
+	nrf_cloud_agps_cache_store(element);
+#endif
 
-	LOG_DBG("Receievd AGPS data. Schema version: %d, length: %d",
-		version, buf_len);
+	return 0;
+}
 
+static int modem_target_set(const int *socket)
+{
 	if (socket) {
-		LOG_DBG("Using user-provided socket, fd %d", fd);
+		LOG_DBG("Using user-provided socket, fd %d", *socket);
 
 		gps_dev = NULL;
 		fd = *socket;
@@ -565,41 +572,85 @@ int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket)
 		}
 	}
 
-	while (parsed_len < buf_len) {
-		size_t element_size =
-			get_next_agps_element(&element, &buf[parsed_len]);
+	return 0;
+}
 
-		if (element_size == 0) {
-			LOG_DBG("Parsing finished\n");
-			break;
-		}
+int nrf_cloud_agps_process(const char *buf, size_t buf_len, const int *socket)
+{
+	int err;
+	struct agps_process_ctx ctx = {0};
+	struct nrf_cloud_agps_parser parser;
 
-		parsed_len += element_size;
+	LOG_DBG("Received AGPS data, length: %d", buf_len);
 
-		LOG_DBG("Parsed_len: %d\n", parsed_len);
+	err = modem_target_set(socket);
+	if (err) {
+		return err;
+	}
 
-		if (element.type == NRF_CLOUD_AGPS_GPS_TOWS) {
-			memcpy(&sys_time.sv_tow[element.tow->sv_id - 1],
-				element.tow,
-				sizeof(sys_time.sv_tow[0]));
+	nrf_cloud_agps_parser_init(&parser, element_process, &ctx);
 
-			LOG_DBG("TOW %d copied", element.tow->sv_id - 1);
+	err = nrf_cloud_agps_parser_feed(&parser, (const uint8_t *)buf,
+					 buf_len);
+	if (err == 0) {
+		err = nrf_cloud_agps_parser_finish(&parser);
+	}
 
-			continue;
-		} else if (element.type == NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK) {
-			memcpy(&sys_time, element.time_and_tow,
-				sizeof(sys_time) - sizeof(sys_time.sv_tow));
+	if (err) {
+		LOG_ERR("Failed to process A-GPS data, error: %d", err);
+	}
 
-			LOG_DBG("TOWs copied, bitmask: 0x%08x",
-				element.time_and_tow->sv_mask);
-		}
+	return err;
+}
 
-		err = agps_send_to_modem(&element);
-		if (err) {
-			LOG_ERR("Failed to send data to modem, error: %d", err);
-			return err;
-		}
+int nrf_cloud_agps_process_begin(const int *socket)
+{
+	int err;
+
+	err = modem_target_set(socket);
+	if (err) {
+		return err;
 	}
 
+	memset(&stream.ctx, 0, sizeof(stream.ctx));
+	nrf_cloud_agps_parser_init(&stream.parser, element_process,
+				   &stream.ctx);
+	stream.active = true;
+
 	return 0;
 }
+
+int nrf_cloud_agps_process_fragment(const char *buf, size_t len)
+{
+	int err;
+
+	if (!stream.active) {
+		return -EINVAL;
+	}
+
+	err = nrf_cloud_agps_parser_feed(&stream.parser, (const uint8_t *)buf,
+					 len);
+	if (err) {
+		LOG_ERR("Failed to process A-GPS data, error: %d", err);
+	}
+
+	return err;
+}
+
+int nrf_cloud_agps_process_end(void)
+{
+	int err;
+
+	if (!stream.active) {
+		return -EINVAL;
+	}
+
+	stream.active = false;
+
+	err = nrf_cloud_agps_parser_finish(&stream.parser);
+	if (err) {
+		LOG_ERR("Incomplete A-GPS data, error: %d", err);
+	}
+
+	return err;
+}
@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <settings/settings.h>
+#include <date_time.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_REGISTER(nrf_cloud_agps_cache, CONFIG_NRF_CLOUD_AGPS_LOG_LEVEL);
+
+#include "nrf_cloud_agps_cache.h"
+
+#define SETTINGS_NAME		"nrf_cloud_agps"
+#define SETTINGS_KEY_EPHE	"e"
+#define SETTINGS_KEY_ALM	"a"
+#define SETTINGS_KEY_UTC	"u"
+#define SETTINGS_KEY_KLOBUCHAR	"k"
+
+#define EPHE_VALIDITY_S	(CONFIG_NRF_CLOUD_AGPS_CACHE_EPHE_VALIDITY_MIN * 60U)
+#define ALM_VALIDITY_S	(CONFIG_NRF_CLOUD_AGPS_CACHE_ALM_VALIDITY_DAYS * 86400U)
+#define IONO_UTC_VALIDITY_S \
+	(CONFIG_NRF_CLOUD_AGPS_CACHE_IONO_UTC_VALIDITY_HOURS * 3600U)
+
+/* Satellite IDs are 1 to 32, bit n - 1 of the request masks. */
+#define SV_COUNT 32
+
+/* Entries are stored in flash as they are in RAM: the time the element
+ * was received, in seconds since the epoch, followed by the element in
+ * the nRF Cloud binary format. A time of 0 marks an empty entry.
+ */
+struct ephe_entry {
+	uint32_t stored;
+	struct nrf_cloud_agps_ephemeris data;
+} __packed;
+
+struct alm_entry {
+	uint32_t stored;
+	struct nrf_cloud_agps_almanac data;
+} __packed;
+
+struct utc_entry {
+	uint32_t stored;
+	struct nrf_cloud_agps_utc data;
+} __packed;
+
+struct klobuchar_entry {
+	uint32_t stored;
+	struct nrf_cloud_agps_klobuchar data;
+} __packed;
+
+static struct {
+	struct ephe_entry ephe[SV_COUNT];
+	struct alm_entry alm[SV_COUNT];
+	struct utc_entry utc;
+	struct klobuchar_entry klobuchar;
+} cache;
+
+/* Entries changed since they were last written to flash. */
+static struct {
+	uint32_t ephe;
+	uint32_t alm;
+	bool utc;
+	bool klobuchar;
+} dirty;
+
+static bool loaded;
+static K_MUTEX_DEFINE(cache_lock);
+
+static void cache_save_work_fn(struct k_work *work);
+static K_WORK_DEFINE(cache_save_work, cache_save_work_fn);
+
+static int cache_settings_set(const char *key, size_t len_rd,
+			      settings_read_cb read_cb, void *cb_arg);
+
+SETTINGS_STATIC_HANDLER_DEFINE(nrf_cloud_agps, SETTINGS_NAME, NULL,
+			       cache_settings_set, NULL, NULL);
+
+static int read_entry(void *entry, size_t entry_len, size_t len_rd,
+		      settings_read_cb read_cb, void *cb_arg)
+{
+	if (len_rd != entry_len) {
+		/* Stored by a different version, ignore it. */
+		return 0;
+	}
+
+	if (read_cb(cb_arg, entry, entry_len) != (ssize_t)entry_len) {
+		memset(entry, 0, entry_len);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int cache_settings_set(const char *key, size_t len_rd,
+			      settings_read_cb read_cb, void *cb_arg)
+{
+	const char *next;
+	int sv;
+
+	if (!key) {
+		return -EINVAL;
+	}
+
+	if (settings_name_steq(key, SETTINGS_KEY_UTC, NULL)) {
+		return read_entry(&cache.utc, sizeof(cache.utc), len_rd,
+				  read_cb, cb_arg);
+	}
+
+	if (settings_name_steq(key, SETTINGS_KEY_KLOBUCHAR, NULL)) {
+		return read_entry(&cache.klobuchar, sizeof(cache.klobuchar),
+				  len_rd, read_cb, cb_arg);
+	}
+
+	settings_name_next(key, &next);
+	if (next == NULL) {
+		return -ENOENT;
+	}
+
+	sv = atoi(next);
+	if ((sv < 1) || (sv > SV_COUNT)) {
+		return -ENOENT;
+	}
+
+	if (settings_name_steq(key, SETTINGS_KEY_EPHE, &next)) {
+		return read_entry(&cache.ephe[sv - 1], sizeof(cache.ephe[0]),
+				  len_rd, read_cb, cb_arg);
+	}
+
+	if (settings_name_steq(key, SETTINGS_KEY_ALM, &next)) {
+		return read_entry(&cache.alm[sv - 1], sizeof(cache.alm[0]),
+				  len_rd, read_cb, cb_arg);
+	}
+
+	return -ENOENT;
+}
+
+/* Must be called with the cache locked. */
+static void cache_load(void)
+{
+	int err;
+
+	if (loaded) {
+		return;
+	}
+
+	loaded = true;
+
+	err = settings_subsys_init();
+	if (err) {
+		LOG_ERR("Settings init failed: %d", err);
+		return;
+	}
+
+	err = settings_load_subtree(SETTINGS_NAME);
+	if (err) {
+		LOG_ERR("Cannot load A-GPS cache: %d", err);
+	}
+}
+
+static int save_entry(const char *key, int sv, const void *entry,
+		      size_t len)
+{
+	char name[sizeof(SETTINGS_NAME "/e/32")];
+
+	if (sv > 0) {
+		snprintk(name, sizeof(name), SETTINGS_NAME "/%s/%d", key, sv);
+	} else {
+		snprintk(name, sizeof(name), SETTINGS_NAME "/%s", key);
+	}
+
+	return settings_save_one(name, entry, len);
+}
+
+static void cache_save_work_fn(struct k_work *work)
+{
+	int err = 0;
+
+	ARG_UNUSED(work);
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	for (int i = 0; (i < SV_COUNT) && !err; i++) {
+		if (dirty.ephe & BIT(i)) {
+			err = save_entry(SETTINGS_KEY_EPHE, i + 1,
+					 &cache.ephe[i], sizeof(cache.ephe[i]));
+			dirty.ephe &= ~BIT(i);
+		}
+
+		if (!err && (dirty.alm & BIT(i))) {
+			err = save_entry(SETTINGS_KEY_ALM, i + 1,
+					 &cache.alm[i], sizeof(cache.alm[i]));
+			dirty.alm &= ~BIT(i);
+		}
+	}
+
+	if (!err && dirty.utc) {
+		err = save_entry(SETTINGS_KEY_UTC, 0, &cache.utc,
+				 sizeof(cache.utc));
+		dirty.utc = false;
+	}
+
+	if (!err && dirty.klobuchar) {
+		err = save_entry(SETTINGS_KEY_KLOBUCHAR, 0, &cache.klobuchar,
+				 sizeof(cache.klobuchar));
+		dirty.klobuchar = false;
+	}
+
+	k_mutex_unlock(&cache_lock);
+
+	if (err) {
+		LOG_ERR("Failed to store A-GPS data, error: %d", err);
+	}
+}
+
+static int time_now(uint32_t *now)
+{
+	int64_t unix_time_ms;
+	int err;
+
+	err = date_time_now(&unix_time_ms);
+	if (err) {
+		return err;
+	}
+
+	*now = (uint32_t)(unix_time_ms / MSEC_PER_SEC);
+
+	return 0;
+}
+
+static bool entry_valid(uint32_t stored, uint32_t now, uint32_t validity)
+{
+	return (stored != 0) && (stored <= now) && ((now - stored) < validity);
+}
+
+void nrf_cloud_agps_cache_store(const struct nrf_cloud_apgs_element *element)
+{
+	uint32_t now;
+	int sv;
+
+	/* Without the current time, the age of the data cannot be told. */
+	if (time_now(&now)) {
+		return;
+	}
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	cache_load();
+
+	switch (element->type) {
+	case NRF_CLOUD_AGPS_EPHEMERIDES:
+		sv = element->ephemeris->sv_id;
+		if ((sv < 1) || (sv > SV_COUNT)) {
+			break;
+		}
+
+		memcpy(&cache.ephe[sv - 1].data, element->ephemeris,
+		       sizeof(cache.ephe[0].data));
+		cache.ephe[sv - 1].stored = now;
+		dirty.ephe |= BIT(sv - 1);
+		break;
+	case NRF_CLOUD_AGPS_ALMANAC:
+		sv = element->almanac->sv_id;
+		if ((sv < 1) || (sv > SV_COUNT)) {
+			break;
+		}
+
+		memcpy(&cache.alm[sv - 1].data, element->almanac,
+		       sizeof(cache.alm[0].data));
+		cache.alm[sv - 1].stored = now;
+		dirty.alm |= BIT(sv - 1);
+		break;
+	case NRF_CLOUD_AGPS_UTC_PARAMETERS:
+		memcpy(&cache.utc.data, element->utc, sizeof(cache.utc.data));
+		cache.utc.stored = now;
+		dirty.utc = true;
+		break;
+	case NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION:
+		memcpy(&cache.klobuchar.data,
+		       element->ion_correction.klobuchar,
+		       sizeof(cache.klobuchar.data));
+		cache.klobuchar.stored = now;
+		dirty.klobuchar = true;
+		break;
+	default:
+		k_mutex_unlock(&cache_lock);
+		return;
+	}
+
+	k_mutex_unlock(&cache_lock);
+
+	/* The whole response is normally processed before the work item
+	 * runs, so that it is written to flash in one go.
+	 */
+	k_work_submit(&cache_save_work);
+}
+
+int nrf_cloud_agps_cache_inject(struct gps_agps_request *request,
+				nrf_cloud_agps_cache_send_t send)
+{
+	struct nrf_cloud_apgs_element element;
+	uint32_t now;
+	int count = 0;
+	int err;
+
+	err = time_now(&now);
+	if (err) {
+		LOG_DBG("Time unknown, A-GPS cache not used");
+		return err;
+	}
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+
+	cache_load();
+
+	for (int i = 0; i < SV_COUNT; i++) {
+		if ((request->sv_mask_ephe & BIT(i)) &&
+		    entry_valid(cache.ephe[i].stored, now, EPHE_VALIDITY_S)) {
+			element.type = NRF_CLOUD_AGPS_EPHEMERIDES;
+			element.ephemeris = &cache.ephe[i].data;
+
+			if (send(&element) == 0) {
+				request->sv_mask_ephe &= ~BIT(i);
+				count++;
+			}
+		}
+
+		if ((request->sv_mask_alm & BIT(i)) &&
+		    entry_valid(cache.alm[i].stored, now, ALM_VALIDITY_S)) {
+			element.type = NRF_CLOUD_AGPS_ALMANAC;
+			element.almanac = &cache.alm[i].data;
+
+			if (send(&element) == 0) {
+				request->sv_mask_alm &= ~BIT(i);
+				count++;
+			}
+		}
+	}
+
+	if (request->utc &&
+	    entry_valid(cache.utc.stored, now, IONO_UTC_VALIDITY_S)) {
+		element.type = NRF_CLOUD_AGPS_UTC_PARAMETERS;
+		element.utc = &cache.utc.data;
+
+		if (send(&element) == 0) {
+			request->utc = 0;
+			count++;
+		}
+	}
+
+	if (request->klobuchar &&
+	    entry_valid(cache.klobuchar.stored, now, IONO_UTC_VALIDITY_S)) {
+		element.type = NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION;
+		element.ion_correction.klobuchar = &cache.klobuchar.data;
+
+		if (send(&element) == 0) {
+			request->klobuchar = 0;
+			count++;
+		}
+	}
+
+	k_mutex_unlock(&cache_lock);
+
+	return count;
+}
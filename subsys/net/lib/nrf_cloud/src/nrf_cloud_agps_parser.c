@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <sys/byteorder.h>
+
+#include "nrf_cloud_agps_parser.h"
+
+#define ARRAY_HEADER_SIZE \
+	(NRF_CLOUD_AGPS_BIN_TYPE_SIZE + NRF_CLOUD_AGPS_BIN_COUNT_SIZE)
+
+/* The system clock element is followed by four bytes that are not used,
+ * the time of week of each satellite is given in separate elements.
+ */
+#define SYSTEM_CLOCK_SIZE \
+	(sizeof(struct nrf_cloud_agps_system_time) - \
+	 sizeof(((struct nrf_cloud_agps_system_time *)0)->sv_tow) + 4)
+
+enum parser_state {
+	STATE_VERSION,
+	STATE_ARRAY_HEADER,
+	STATE_ELEMENT,
+	/* An unknown type was found, the rest of the data is ignored. */
+	STATE_IGNORE,
+	STATE_ERROR,
+};
+
+static size_t element_size(enum nrf_cloud_agps_type type)
+{
+	switch (type) {
+	case NRF_CLOUD_AGPS_UTC_PARAMETERS:
+		return sizeof(struct nrf_cloud_agps_utc);
+	case NRF_CLOUD_AGPS_EPHEMERIDES:
+		return sizeof(struct nrf_cloud_agps_ephemeris);
+	case NRF_CLOUD_AGPS_ALMANAC:
+		return sizeof(struct nrf_cloud_agps_almanac);
+	case NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION:
+		return sizeof(struct nrf_cloud_agps_klobuchar);
+	case NRF_CLOUD_AGPS_NEQUICK_CORRECTION:
+		return sizeof(struct nrf_cloud_agps_nequick);
+	case NRF_CLOUD_AGPS_GPS_TOWS:
+		return sizeof(struct nrf_cloud_agps_tow_element);
+	case NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK:
+		return SYSTEM_CLOCK_SIZE;
+	case NRF_CLOUD_AGPS_LOCATION:
+		return sizeof(struct nrf_cloud_agps_location);
+	case NRF_CLOUD_AGPS_INTEGRITY:
+		return sizeof(struct nrf_cloud_agps_integrity);
+	default:
+		return 0;
+	}
+}
+
+BUILD_ASSERT(SYSTEM_CLOCK_SIZE <= NRF_CLOUD_AGPS_PARSER_BUF_SIZE);
+BUILD_ASSERT(sizeof(struct nrf_cloud_agps_almanac) <=
+	     NRF_CLOUD_AGPS_PARSER_BUF_SIZE);
+BUILD_ASSERT(sizeof(struct nrf_cloud_agps_location) <=
+	     NRF_CLOUD_AGPS_PARSER_BUF_SIZE);
+
+/* Number of bytes needed to complete the current item. */
+static size_t bytes_needed(const struct nrf_cloud_agps_parser *parser)
+{
+	switch (parser->state) {
+	case STATE_VERSION:
+		return NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION_SIZE;
+	case STATE_ARRAY_HEADER:
+		return ARRAY_HEADER_SIZE;
+	case STATE_ELEMENT:
+		return element_size(parser->type);
+	default:
+		return 0;
+	}
+}
+
+static int element_handle(struct nrf_cloud_agps_parser *parser,
+			  const uint8_t *data)
+{
+	struct nrf_cloud_apgs_element element = {
+		.type = parser->type,
+	};
+	void *ptr = (void *)data;
+
+	switch (element.type) {
+	case NRF_CLOUD_AGPS_UTC_PARAMETERS:
+		element.utc = ptr;
+		break;
+	case NRF_CLOUD_AGPS_EPHEMERIDES:
+		element.ephemeris = ptr;
+		break;
+	case NRF_CLOUD_AGPS_ALMANAC:
+		element.almanac = ptr;
+		break;
+	case NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION:
+		element.ion_correction.klobuchar = ptr;
+		break;
+	case NRF_CLOUD_AGPS_NEQUICK_CORRECTION:
+		element.ion_correction.nequick = ptr;
+		break;
+	case NRF_CLOUD_AGPS_GPS_TOWS:
+		element.tow = ptr;
+		break;
+	case NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK:
+		element.time_and_tow = ptr;
+		break;
+	case NRF_CLOUD_AGPS_LOCATION:
+		element.location = ptr;
+		break;
+	case NRF_CLOUD_AGPS_INTEGRITY:
+		element.integrity = ptr;
+		break;
+	default:
+		return -EBADMSG;
+	}
+
+	return parser->cb(&element, parser->user_data);
+}
+
+static int item_handle(struct nrf_cloud_agps_parser *parser,
+		       const uint8_t *data)
+{
+	switch (parser->state) {
+	case STATE_VERSION:
+		if (data[0] != NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION) {
+			return -EBADMSG;
+		}
+
+		parser->state = STATE_ARRAY_HEADER;
+		return 0;
+	case STATE_ARRAY_HEADER:
+		parser->type = data[NRF_CLOUD_AGPS_BIN_TYPE_OFFSET];
+		parser->elements_left =
+			sys_get_le16(&data[NRF_CLOUD_AGPS_BIN_COUNT_OFFSET]);
+
+		if (element_size(parser->type) == 0) {
+			/* The size of an unknown type cannot be told, so
+			 * parsing cannot continue.
+			 */
+			parser->state = STATE_IGNORE;
+		} else if (parser->elements_left > 0) {
+			parser->state = STATE_ELEMENT;
+		}
+
+		return 0;
+	case STATE_ELEMENT:
+		if (--parser->elements_left == 0) {
+			parser->state = STATE_ARRAY_HEADER;
+		}
+
+		return element_handle(parser, data);
+	default:
+		return -EBADMSG;
+	}
+}
+
+void nrf_cloud_agps_parser_init(struct nrf_cloud_agps_parser *parser,
+				nrf_cloud_agps_parser_cb_t cb, void *user_data)
+{
+	__ASSERT_NO_MSG(parser != NULL);
+	__ASSERT_NO_MSG(cb != NULL);
+
+	memset(parser, 0, sizeof(*parser));
+	parser->cb = cb;
+	parser->user_data = user_data;
+	parser->state = STATE_VERSION;
+}
+
+int nrf_cloud_agps_parser_feed(struct nrf_cloud_agps_parser *parser,
+			       const uint8_t *data, size_t len)
+{
+	const uint8_t *item;
+	size_t needed;
+	size_t copy;
+	int err;
+
+	while (len > 0) {
+		if (parser->state == STATE_IGNORE) {
+			return 0;
+		}
+
+		if (parser->state == STATE_ERROR) {
+			return -EBADMSG;
+		}
+
+		needed = bytes_needed(parser);
+
+		if ((parser->fill == 0) && (len >= needed)) {
+			/* Complete within the fragment, no copy needed. */
+			item = data;
+			data += needed;
+			len -= needed;
+		} else {
+			copy = MIN(needed - parser->fill, len);
+			memcpy(&parser->buf[parser->fill], data, copy);
+			parser->fill += copy;
+			data += copy;
+			len -= copy;
+
+			if (parser->fill < needed) {
+				return 0;
+			}
+
+			item = parser->buf;
+			parser->fill = 0;
+		}
+
+		err = item_handle(parser, item);
+		if (err) {
+			parser->state = STATE_ERROR;
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+int nrf_cloud_agps_parser_finish(struct nrf_cloud_agps_parser *parser)
+{
+	if (((parser->state == STATE_ARRAY_HEADER) && (parser->fill == 0)) ||
+	    (parser->state == STATE_IGNORE)) {
+		return 0;
+	}
+
+	return -EBADMSG;
+}
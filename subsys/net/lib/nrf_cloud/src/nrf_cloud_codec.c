@@ -13,6 +13,8 @@
 #include <logging/log.h>
 #include "cJSON.h"
 #include "cJSON_os.h"
+#include <json_reader.h>
+#include <json_writer.h>
 
 LOG_MODULE_REGISTER(nrf_cloud_codec, CONFIG_NRF_CLOUD_LOG_LEVEL);
 
@@ -53,18 +55,6 @@ static int json_add_str(cJSON *parent, const char *str, const char *item)
 	return json_add_obj(parent, str, json_str);
 }
 
-static int json_add_null(cJSON *parent, const char *str)
-{
-	cJSON *json_null;
-
-	json_null = cJSON_CreateNull();
-	if (json_null == NULL) {
-		return -ENOMEM;
-	}
-
-	return json_add_obj(parent, str, json_null);
-}
-
 static cJSON *json_object_decode(cJSON *obj, const char *str)
 {
 	return obj ? cJSON_GetObjectItem(obj, str) : NULL;
@@ -205,54 +195,51 @@ int nrf_cloud_decode_requested_state(const struct nrf_cloud_data *input,
 	__ASSERT_NO_MSG(input->ptr != NULL);
 	__ASSERT_NO_MSG(input->len != 0);
 
-	cJSON *root_obj;
-	cJSON *desired_obj;
-	cJSON *pairing_obj;
-	cJSON *pairing_state_obj;
-	cJSON *topic_prefix_obj;
+	static struct json_token tokens[CONFIG_NRF_CLOUD_JSON_MAX_TOKENS];
+	struct json_reader r;
+	int desired;
+	int pairing_state;
+	int err;
 
-	root_obj = cJSON_Parse(input->ptr);
-	if (root_obj == NULL) {
-		LOG_ERR("cJSON_Parse failed: %s",
-			log_strdup((char *)input->ptr));
+	err = json_reader_parse(&r, input->ptr, input->len, tokens,
+				ARRAY_SIZE(tokens));
+	if (err < 0) {
+		LOG_ERR("JSON parsing failed: %d", err);
 		return -ENOENT;
 	}
 
-	nrf_cloud_decode_desired_obj(root_obj, &desired_obj);
+	/* On initial pairing, a shadow delta event is sent */
+	/* which does not include the "desired" JSON key, */
+	/* "state" is used instead */
+	desired = json_reader_member(&r, 0, "state");
+	if (desired < 0) {
+		desired = json_reader_member(&r, 0, "desired");
+	}
 
-	topic_prefix_obj =
-		json_object_decode(desired_obj, "nrfcloud_mqtt_topic_prefix");
-	if (topic_prefix_obj != NULL) {
+	if (json_reader_member(&r, desired,
+			       "nrfcloud_mqtt_topic_prefix") >= 0) {
 		(*requested_state) = STATE_UA_PIN_COMPLETE;
-		cJSON_Delete(root_obj);
 		return 0;
 	}
 
-	pairing_obj = json_object_decode(desired_obj, "pairing");
-	pairing_state_obj = json_object_decode(pairing_obj, "state");
+	pairing_state = json_reader_find(&r, desired, "/pairing/state");
 
-	if (!pairing_state_obj || pairing_state_obj->type != cJSON_String) {
-		if (cJSON_HasObjectItem(desired_obj, "config") == false) {
+	if (json_reader_type(&r, pairing_state) != JSON_TOKEN_STRING) {
+		if (json_reader_member(&r, desired, "config") < 0) {
 			LOG_WRN("Unhandled data received from nRF Cloud.");
 			LOG_INF("Ensure device firmware is up to date.");
 			LOG_INF("Delete and re-add device to nRF Cloud if problem persists.");
 		}
-		cJSON_Delete(root_obj);
 		return -ENOENT;
 	}
 
-	const char *state_str = pairing_state_obj->valuestring;
-
-	if (compare(state_str, DUA_PIN_STR)) {
+	if (json_reader_str_eq(&r, pairing_state, DUA_PIN_STR)) {
 		(*requested_state) = STATE_UA_PIN_WAIT;
 	} else {
 		LOG_ERR("Deprecated state. Delete device from nRF Cloud and update device with JITP certificates.");
-		cJSON_Delete(root_obj);
 		return -ENOTSUP;
 	}
 
-	cJSON_Delete(root_obj);
-
 	return 0;
 }
 
@@ -338,41 +325,26 @@ int nrf_cloud_encode_config_response(struct nrf_cloud_data const *const input,
 	return 0;
 }
 
-int nrf_cloud_encode_state(uint32_t reported_state, struct nrf_cloud_data *output)
+static int state_write(uint32_t reported_state, struct json_writer *w)
 {
-	int ret;
-
-	__ASSERT_NO_MSG(output != NULL);
-
-	cJSON *root_obj = cJSON_CreateObject();
-	cJSON *state_obj = cJSON_CreateObject();
-	cJSON *reported_obj = cJSON_CreateObject();
-	cJSON *pairing_obj = cJSON_CreateObject();
-	cJSON *connection_obj = cJSON_CreateObject();
-
-	if ((root_obj == NULL) || (state_obj == NULL) ||
-	    (reported_obj == NULL) || (pairing_obj == NULL) ||
-	    (connection_obj == NULL)) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(state_obj);
-		cJSON_Delete(reported_obj);
-		cJSON_Delete(pairing_obj);
-		cJSON_Delete(connection_obj);
-
-		return -ENOMEM;
-	}
-
-	ret = 0;
+	json_writer_object_begin(w, NULL);
+	json_writer_object_begin(w, "state");
+	json_writer_object_begin(w, "reported");
 
 	switch (reported_state) {
 	case STATE_UA_PIN_WAIT: {
-		ret += json_add_str(pairing_obj, "state", DUA_PIN_STR);
-		ret += json_add_null(pairing_obj, "topics");
-		ret += json_add_null(pairing_obj, "config");
-		ret += json_add_null(reported_obj, "stage");
-		ret += json_add_null(reported_obj,
-				     "nrfcloud_mqtt_topic_prefix");
-		ret += json_add_null(connection_obj, "keepalive");
+		json_writer_null(w, "stage");
+		json_writer_null(w, "nrfcloud_mqtt_topic_prefix");
+
+		json_writer_object_begin(w, "pairing");
+		json_writer_str(w, "state", DUA_PIN_STR);
+		json_writer_null(w, "topics");
+		json_writer_null(w, "config");
+		json_writer_object_end(w);
+
+		json_writer_object_begin(w, "connection");
+		json_writer_null(w, "keepalive");
+		json_writer_object_end(w);
 		break;
 	}
 	case STATE_UA_PIN_COMPLETE: {
@@ -382,78 +354,66 @@ int nrf_cloud_encode_state(uint32_t reported_state, struct nrf_cloud_data *outpu
 
 		/* Get the endpoint information. */
 		nct_dc_endpoint_get(&tx_endp, &rx_endp, &m_endp);
-		ret += json_add_str(reported_obj, "nrfcloud_mqtt_topic_prefix",
-				    m_endp.ptr);
+		json_writer_str(w, "nrfcloud_mqtt_topic_prefix", m_endp.ptr);
 
 		/* Clear pairing config and pairingStatus fields. */
-		ret += json_add_str(pairing_obj, "state", PAIRED_STR);
-		ret += json_add_null(pairing_obj, "config");
-		ret += json_add_null(reported_obj, "pairingStatus");
+		json_writer_null(w, "pairingStatus");
 
-		/* Report keepalive value. */
-		if (cJSON_AddNumberToObject(connection_obj, "keepalive",
-					    CONFIG_MQTT_KEEPALIVE) == NULL) {
-			ret = -ENOMEM;
-		}
+		json_writer_object_begin(w, "pairing");
+		json_writer_str(w, "state", PAIRED_STR);
+		json_writer_null(w, "config");
 
 		/* Report pairing topics. */
-		cJSON *topics_obj = cJSON_CreateObject();
-
-		if (topics_obj == NULL) {
-			cJSON_Delete(root_obj);
-			cJSON_Delete(state_obj);
-			cJSON_Delete(reported_obj);
-			cJSON_Delete(pairing_obj);
-			cJSON_Delete(connection_obj);
+		json_writer_object_begin(w, "topics");
+		json_writer_str(w, "d2c", tx_endp.ptr);
+		json_writer_str(w, "c2d", rx_endp.ptr);
+		json_writer_object_end(w);
+		json_writer_object_end(w);
 
-			return -ENOMEM;
-		}
-
-		ret += json_add_str(topics_obj, "d2c", tx_endp.ptr);
-		ret += json_add_str(topics_obj, "c2d", rx_endp.ptr);
-		ret += json_add_obj(pairing_obj, "topics", topics_obj);
-
-		if (ret != 0) {
-			cJSON_Delete(topics_obj);
-		}
+		/* Report keepalive value. */
+		json_writer_object_begin(w, "connection");
+		json_writer_int(w, "keepalive", CONFIG_MQTT_KEEPALIVE);
+		json_writer_object_end(w);
 		break;
 	}
-	default: {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(state_obj);
-		cJSON_Delete(reported_obj);
-		cJSON_Delete(pairing_obj);
-		cJSON_Delete(connection_obj);
+	default:
 		return -ENOTSUP;
 	}
-	}
 
-	ret += json_add_obj(reported_obj, "pairing", pairing_obj);
-	ret += json_add_obj(reported_obj, "connection", connection_obj);
-	ret += json_add_obj(state_obj, "reported", reported_obj);
-	ret += json_add_obj(root_obj, "state", state_obj);
+	json_writer_object_end(w);
+	json_writer_object_end(w);
+	json_writer_object_end(w);
 
-	if (ret != 0) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(state_obj);
-		cJSON_Delete(reported_obj);
-		cJSON_Delete(pairing_obj);
-		cJSON_Delete(connection_obj);
-
-		return -ENOMEM;
-	}
+	return json_writer_finish(w);
+}
 
+int nrf_cloud_encode_state(uint32_t reported_state, struct nrf_cloud_data *output)
+{
+	struct json_writer w;
 	char *buffer;
+	int len;
 
-	buffer = cJSON_PrintUnformatted(root_obj);
-	cJSON_Delete(root_obj);
+	__ASSERT_NO_MSG(output != NULL);
+
+	json_writer_init(&w, NULL, 0);
+	len = state_write(reported_state, &w);
+	if (len < 0) {
+		return (len == -ENOTSUP) ? len : -ENOMEM;
+	}
 
+	buffer = nrf_cloud_malloc(len + 1);
 	if (buffer == NULL) {
 		return -ENOMEM;
 	}
 
+	json_writer_init(&w, buffer, len + 1);
+	if (state_write(reported_state, &w) != len) {
+		nrf_cloud_free(buffer);
+		return -ENOMEM;
+	}
+
 	output->ptr = buffer;
-	output->len = strlen(buffer);
+	output->len = len;
 
 	return 0;
 }
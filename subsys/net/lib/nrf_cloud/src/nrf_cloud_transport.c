@@ -25,6 +25,11 @@
 #include <net/aws_fota.h>
 #endif
 
+#if defined(CONFIG_NRF_CLOUD_AGPS_STREAM)
+#include <net/nrf_cloud_agps.h>
+#include "nrf_cloud_agps_schema_v1.h"
+#endif
+
 LOG_MODULE_REGISTER(nrf_cloud_transport, CONFIG_NRF_CLOUD_LOG_LEVEL);
 
 #if defined(CONFIG_NRF_CLOUD_PROVISION_CERTIFICATES)
@@ -761,8 +766,103 @@ int nct_mqtt_connect(void)
 	return err;
 }
 
-static int publish_get_payload(struct mqtt_client *client, size_t length)
+#if defined(CONFIG_NRF_CLOUD_AGPS_STREAM)
+/* Inject A-GPS data into the modem while it is read, one payload buffer
+ * at a time, so that the response does not have to fit in the buffer.
+ * The first byte of the payload has already been read.
+ */
+static int agps_stream_payload(struct mqtt_client *client, size_t length)
+{
+	size_t offset = 1;
+	size_t chunk;
+	int agps_err;
+	int err;
+
+	agps_err = nrf_cloud_agps_process_begin(NULL);
+	if (agps_err == 0) {
+		agps_err = nrf_cloud_agps_process_fragment(
+			(const char *)nct.payload_buf, 1);
+	}
+
+	while (offset < length) {
+		chunk = MIN(length - offset, sizeof(nct.payload_buf));
+
+		err = mqtt_readall_publish_payload(client, nct.payload_buf,
+						   chunk);
+		if (err) {
+			if (agps_err == 0) {
+				(void)nrf_cloud_agps_process_end();
+			}
+
+			return err;
+		}
+
+		offset += chunk;
+
+		/* The rest of the payload must be read even if it cannot be
+		 * processed.
+		 */
+		if (agps_err == 0) {
+			agps_err = nrf_cloud_agps_process_fragment(
+				(const char *)nct.payload_buf, chunk);
+		}
+	}
+
+	if (agps_err == 0) {
+		agps_err = nrf_cloud_agps_process_end();
+	}
+
+	if (agps_err) {
+		LOG_ERR("A-GPS data not processed, error: %d", agps_err);
+	} else {
+		LOG_DBG("A-GPS data processed, length: %d", length);
+	}
+
+	return 1;
+}
+
+/* A-GPS data is received on the data channel RX topic. */
+static bool agps_topic_match(const struct mqtt_topic *topic)
 {
+	return (nct.dc_rx_endp.utf8 != NULL) &&
+	       (topic->topic.size == nct.dc_rx_endp.size) &&
+	       strings_compare(topic->topic.utf8, nct.dc_rx_endp.utf8,
+			       topic->topic.size, nct.dc_rx_endp.size);
+}
+#endif /* CONFIG_NRF_CLOUD_AGPS_STREAM */
+
+/* Returns a positive value if the payload was consumed while it was
+ * read, and need not be passed on.
+ */
+static int publish_get_payload(struct mqtt_client *client,
+			       const struct mqtt_topic *topic, size_t length)
+{
+#if defined(CONFIG_NRF_CLOUD_AGPS_STREAM)
+	int err;
+
+	/* A-GPS data is binary, and is told apart from JSON messages on the
+	 * same topic by its first byte.
+	 */
+	if ((length > 0) && agps_topic_match(topic)) {
+		err = mqtt_readall_publish_payload(client, nct.payload_buf, 1);
+		if (err) {
+			return err;
+		}
+
+		if (nct.payload_buf[0] == NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION) {
+			return agps_stream_payload(client, length);
+		}
+
+		if (length > sizeof(nct.payload_buf)) {
+			return -EMSGSIZE;
+		}
+
+		return mqtt_readall_publish_payload(client,
+						    &nct.payload_buf[1],
+						    length - 1);
+	}
+#endif /* CONFIG_NRF_CLOUD_AGPS_STREAM */
+
 	if (length > sizeof(nct.payload_buf)) {
 		return -EMSGSIZE;
 	}
@@ -821,7 +921,7 @@ static void nct_mqtt_evt_handler(struct mqtt_client *const mqtt_client,
 			p->message_id,
 			p->message.payload.len);
 
-		int err = publish_get_payload(mqtt_client,
+		int err = publish_get_payload(mqtt_client, &p->message.topic,
 					      p->message.payload.len);
 
 		if (err < 0) {
@@ -832,10 +932,14 @@ static void nct_mqtt_evt_handler(struct mqtt_client *const mqtt_client,
 		}
 
 		/* If the data arrives on one of the subscribed control channel
-		 * topic. Then we notify the same.
+		 * topic. Then we notify the same. A-GPS data that was injected
+		 * while it was read is only acknowledged.
 		 */
-		if (control_channel_topic_match(NCT_RX_LIST, &p->message.topic,
-						&cc.opcode)) {
+		if (err > 0) {
+			LOG_DBG("Payload consumed");
+		} else if (control_channel_topic_match(NCT_RX_LIST,
+						       &p->message.topic,
+						       &cc.opcode)) {
 			cc.id = p->message_id;
 			cc.data.ptr = nct.payload_buf;
 			cc.data.len = p->message.payload.len;
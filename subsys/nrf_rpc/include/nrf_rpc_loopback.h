@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef NRF_RPC_TR_LOOPBACK_H_
+#define NRF_RPC_TR_LOOPBACK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @defgroup nrf_rpc_tr_loopback nRF PRC loopback transport
+ * @{
+ * @brief nRF PRC transport connecting two sides within one image
+ *
+ * The local side implements the nrf_rpc_tr API. The remote side is
+ * driven by the code that emulates the other core, for example a test
+ * or a benchmark. Each side has a ring buffer in RAM and a thread that
+ * passes the received packets to the receive handler.
+ *
+ * API is compatible with nrf_rpc_tr API. For API documentation
+ * @see nrf_rpc_tr_tmpl.h
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NRF_RPC_TR_MAX_HEADER_SIZE 0
+#define NRF_RPC_TR_AUTO_FREE_RX_BUF 1
+
+/** @brief Side of the loopback transport. */
+enum nrf_rpc_loopback_side {
+	NRF_RPC_LOOPBACK_LOCAL,
+	NRF_RPC_LOOPBACK_REMOTE,
+
+	NRF_RPC_LOOPBACK_SIDE_COUNT
+};
+
+typedef void (*nrf_rpc_tr_receive_handler_t)(const uint8_t *packet, size_t len);
+
+/** @brief Initializes a side of the loopback transport.
+ *
+ * @param side     side to initialize
+ * @param callback handler called from the receive thread of @a side
+ *                 for every packet sent by the other side. The packet
+ *                 is valid until the handler returns.
+ *
+ * @return 0 on success or negative error code.
+ */
+int nrf_rpc_loopback_init(enum nrf_rpc_loopback_side side,
+			  nrf_rpc_tr_receive_handler_t callback);
+
+/** @brief Sends a packet to the other side.
+ *
+ * The packet is copied to the ring buffer of the other side. The function
+ * waits if the ring buffer is full.
+ *
+ * @param side side that sends the packet
+ * @param buf  packet
+ * @param len  length of @a buf
+ *
+ * @return 0 on success or negative error code.
+ */
+int nrf_rpc_loopback_send(enum nrf_rpc_loopback_side side,
+			  const uint8_t *buf, size_t len);
+
+int nrf_rpc_tr_init(nrf_rpc_tr_receive_handler_t callback);
+
+static inline void nrf_rpc_tr_free_rx_buf(const uint8_t *buf)
+{
+}
+
+#define nrf_rpc_tr_alloc_tx_buf(buf, len)				       \
+	uint32_t _nrf_rpc_tr_buf_vla[(sizeof(uint32_t) - 1 + (len)) /	       \
+				     sizeof(uint32_t)];			       \
+	*(buf) = (uint8_t *)(&_nrf_rpc_tr_buf_vla)
+
+#define nrf_rpc_tr_free_tx_buf(buf)
+
+int nrf_rpc_tr_send(uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ *@}
+ */
+
+#endif /* NRF_RPC_TR_LOOPBACK_H_ */
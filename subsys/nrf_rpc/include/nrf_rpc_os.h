@@ -34,10 +34,30 @@ struct nrf_rpc_os_msg {
 
 typedef void (*nrf_rpc_os_work_t)(const uint8_t *data, size_t len);
 
+/** @brief Thread pool statistics. */
+struct nrf_rpc_os_pool_stats {
+	/** Number of packets passed to the pool. */
+	uint32_t cnt;
+	/** Largest number of packets waiting for a thread. */
+	uint32_t depth_max;
+	/** Sum of the times packets waited for a thread, in microseconds. */
+	uint64_t wait_total_us;
+	/** Longest time a packet waited for a thread, in microseconds. */
+	uint32_t wait_max_us;
+};
+
 int nrf_rpc_os_init(nrf_rpc_os_work_t callback);
 
 void nrf_rpc_os_thread_pool_send(const uint8_t *data, size_t len);
 
+/** @brief Gets the thread pool statistics.
+ *
+ * Requires CONFIG_NRF_RPC_THREAD_POOL_STATS.
+ *
+ * @param stats statistics to be filled
+ */
+void nrf_rpc_os_thread_pool_stats_get(struct nrf_rpc_os_pool_stats *stats);
+
 static inline int nrf_rpc_os_event_init(struct nrf_rpc_os_event *event)
 {
 	return k_sem_init(&event->sem, 0, 1);
@@ -36,6 +36,26 @@ static inline void nrf_rpc_tr_free_rx_buf(const uint8_t *buf)
 {
 }
 
+#if defined(CONFIG_NRF_RPC_TR_RPMSG_ZERO_COPY)
+
+uint8_t *nrf_rpc_tr_rpmsg_alloc_tx_buf(uint8_t *local_buf, size_t len);
+
+void nrf_rpc_tr_rpmsg_free_tx_buf(uint8_t *buf);
+
+/* Packets are serialized directly into the shared memory. The local buffer
+ * is used only for packets that do not fit in a shared memory buffer.
+ * nrf_rpc_tr_send releases the buffer also if the packet is not sent.
+ */
+#define nrf_rpc_tr_alloc_tx_buf(buf, len)				       \
+	uint32_t _nrf_rpc_tr_buf_vla[(sizeof(uint32_t) - 1 + (len)) /	       \
+				     sizeof(uint32_t)];			       \
+	*(buf) = nrf_rpc_tr_rpmsg_alloc_tx_buf(				       \
+		(uint8_t *)(&_nrf_rpc_tr_buf_vla), (len))
+
+#define nrf_rpc_tr_free_tx_buf(buf) nrf_rpc_tr_rpmsg_free_tx_buf(buf)
+
+#else
+
 #define nrf_rpc_tr_alloc_tx_buf(buf, len)				       \
 	uint32_t _nrf_rpc_tr_buf_vla[(sizeof(uint32_t) - 1 + (len)) /	       \
 				     sizeof(uint32_t)];			       \
@@ -43,6 +63,8 @@ static inline void nrf_rpc_tr_free_rx_buf(const uint8_t *buf)
 
 #define nrf_rpc_tr_free_tx_buf(buf)
 
+#endif /* defined(CONFIG_NRF_RPC_TR_RPMSG_ZERO_COPY) */
+
 int nrf_rpc_tr_send(uint8_t *buf, size_t len);
 
 #ifdef __cplusplus
@@ -51,6 +51,10 @@ struct rp_ll_endpoint {
 	struct rpmsg_endpoint rpmsg_ep;
 	rp_ll_event_handler callback;
 	uint32_t flags;
+#if defined(CONFIG_NRF_RPC_TR_RPMSG_ZERO_COPY)
+	/* TX buffers that were released without being sent. */
+	struct k_fifo free_tx_bufs;
+#endif
 };
 
 /** @brief Initializes the communication
@@ -88,6 +92,52 @@ void rp_ll_endpoint_uninit(struct rp_ll_endpoint *endpoint);
 int rp_ll_send(struct rp_ll_endpoint *endpoint, const uint8_t *buf,
 	       size_t buf_len);
 
+/** @brief Checks if a buffer was allocated with @ref rp_ll_alloc_tx_buf.
+ *
+ * @param buf data buffer to check
+ */
+bool rp_ll_is_tx_buf(const uint8_t *buf);
+
+/** @brief Allocates a buffer for a packet in the shared memory.
+ *
+ * The caller fills the buffer and passes it to @ref rp_ll_send_nocopy,
+ * so the packet is not copied. If the packet is not sent, the buffer
+ * must be released with @ref rp_ll_free_tx_buf. The function does not
+ * wait for a buffer to be released by the other core.
+ *
+ * @param endpoint endpoint that will send the packet
+ * @param len      length of the packet
+ *
+ * @return Pointer to the buffer, or NULL if the packet does not fit in
+ *         a shared memory buffer or no buffer was available.
+ */
+uint8_t *rp_ll_alloc_tx_buf(struct rp_ll_endpoint *endpoint, size_t len);
+
+/** @brief Sends a packet from a buffer in the shared memory.
+ *
+ * The buffer must not be used after the call. It is owned by the other
+ * core if the packet was sent. Otherwise, it is released as with
+ * @ref rp_ll_free_tx_buf.
+ *
+ * @param endpoint endpoint to use
+ * @param buf      buffer allocated with @ref rp_ll_alloc_tx_buf
+ * @param buf_len  length of the packet in @a buf
+ */
+int rp_ll_send_nocopy(struct rp_ll_endpoint *endpoint, uint8_t *buf,
+		      size_t buf_len);
+
+/** @brief Releases a buffer that was not sent.
+ *
+ * RPMsg returns TX buffers to the shared pool only when they are sent, so
+ * the buffer is sent as an empty packet, which the other core ignores.
+ * Before the handshake is done, the buffer stays with the endpoint and is
+ * reused by the next allocation instead.
+ *
+ * @param endpoint endpoint that allocated the buffer
+ * @param buf      buffer allocated with @ref rp_ll_alloc_tx_buf
+ */
+void rp_ll_free_tx_buf(struct rp_ll_endpoint *endpoint, uint8_t *buf);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#define NRF_RPC_LOG_MODULE NRF_RPC_TR
+#include <nrf_rpc_log.h>
+
+#include <zephyr.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/ring_buffer.h>
+
+#include <nrf_errno.h>
+
+#include "nrf_rpc_loopback.h"
+
+#define RING_SIZE CONFIG_NRF_RPC_TR_LOOPBACK_BUF_SIZE
+
+/* Every packet in the ring is preceded by its length. */
+#define PACKET_MAX (RING_SIZE - sizeof(uint16_t))
+
+BUILD_ASSERT(RING_SIZE <= UINT16_MAX);
+
+struct loopback_side {
+	nrf_rpc_tr_receive_handler_t callback;
+	/* Ring buffer with packets received by this side. */
+	struct ring_buf ring;
+	/* Serializes senders to the ring. */
+	struct k_mutex tx_mutex;
+	/* Number of packets in the ring. */
+	struct k_sem rx_sem;
+	/* Given when the receive thread frees space in the ring. */
+	struct k_sem space_sem;
+	struct k_thread thread;
+};
+
+static struct loopback_side sides[NRF_RPC_LOOPBACK_SIDE_COUNT];
+
+static uint8_t ring_data[NRF_RPC_LOOPBACK_SIDE_COUNT][RING_SIZE] __aligned(4);
+static uint8_t rx_buf[NRF_RPC_LOOPBACK_SIDE_COUNT][PACKET_MAX] __aligned(4);
+
+static K_THREAD_STACK_ARRAY_DEFINE(rx_stacks, NRF_RPC_LOOPBACK_SIDE_COUNT,
+				   CONFIG_NRF_RPC_TR_LOOPBACK_RX_STACK_SIZE);
+
+static void rx_thread_entry(void *p1, void *p2, void *p3)
+{
+	enum nrf_rpc_loopback_side side_id =
+		(enum nrf_rpc_loopback_side)(uintptr_t)p1;
+	struct loopback_side *side = &sides[side_id];
+	uint8_t *buf = rx_buf[side_id];
+	uint16_t len;
+
+	do {
+		k_sem_take(&side->rx_sem, K_FOREVER);
+
+		(void)ring_buf_get(&side->ring, (uint8_t *)&len, sizeof(len));
+		(void)ring_buf_get(&side->ring, buf, len);
+
+		k_sem_give(&side->space_sem);
+
+		NRF_RPC_DBG("Side %d received %u bytes", side_id, len);
+
+		side->callback(buf, len);
+	} while (1);
+}
+
+int nrf_rpc_loopback_init(enum nrf_rpc_loopback_side side_id,
+			  nrf_rpc_tr_receive_handler_t callback)
+{
+	struct loopback_side *side;
+
+	NRF_RPC_ASSERT(side_id < NRF_RPC_LOOPBACK_SIDE_COUNT);
+	NRF_RPC_ASSERT(callback != NULL);
+
+	side = &sides[side_id];
+
+	if (side->callback) {
+		return -NRF_EALREADY;
+	}
+
+	side->callback = callback;
+
+	ring_buf_init(&side->ring, RING_SIZE, ring_data[side_id]);
+	k_mutex_init(&side->tx_mutex);
+	k_sem_init(&side->rx_sem, 0, UINT_MAX);
+	k_sem_init(&side->space_sem, 0, 1);
+
+	k_thread_create(&side->thread, rx_stacks[side_id],
+			K_THREAD_STACK_SIZEOF(rx_stacks[side_id]),
+			rx_thread_entry, (void *)(uintptr_t)side_id, NULL, NULL,
+			CONFIG_NRF_RPC_TR_LOOPBACK_RX_PRIORITY, 0, K_NO_WAIT);
+
+	return 0;
+}
+
+int nrf_rpc_loopback_send(enum nrf_rpc_loopback_side side_id,
+			  const uint8_t *buf, size_t len)
+{
+	struct loopback_side *peer;
+	uint16_t hdr = len;
+
+	NRF_RPC_ASSERT(side_id < NRF_RPC_LOOPBACK_SIDE_COUNT);
+	NRF_RPC_ASSERT(buf != NULL);
+
+	if (len > PACKET_MAX) {
+		return -NRF_EINVAL;
+	}
+
+	peer = &sides[(side_id == NRF_RPC_LOOPBACK_LOCAL) ?
+		      NRF_RPC_LOOPBACK_REMOTE : NRF_RPC_LOOPBACK_LOCAL];
+
+	if (!peer->callback) {
+		return -NRF_EIO;
+	}
+
+	k_mutex_lock(&peer->tx_mutex, K_FOREVER);
+
+	while (ring_buf_space_get(&peer->ring) < len + sizeof(hdr)) {
+		k_sem_take(&peer->space_sem, K_FOREVER);
+	}
+
+	(void)ring_buf_put(&peer->ring, (uint8_t *)&hdr, sizeof(hdr));
+	(void)ring_buf_put(&peer->ring, buf, len);
+
+	k_mutex_unlock(&peer->tx_mutex);
+
+	k_sem_give(&peer->rx_sem);
+
+	return 0;
+}
+
+int nrf_rpc_tr_init(nrf_rpc_tr_receive_handler_t callback)
+{
+	return nrf_rpc_loopback_init(NRF_RPC_LOOPBACK_LOCAL, callback);
+}
+
+int nrf_rpc_tr_send(uint8_t *buf, size_t len)
+{
+	return nrf_rpc_loopback_send(NRF_RPC_LOOPBACK_LOCAL, buf, len);
+}
@@ -12,25 +12,34 @@
 /* Maximum number of remote thread that this implementation allows. */
 #define MAX_REMOTE_THREADS 255
 
-/* Initial value contains ones (context free) on the
- * CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE most significant bits.
+/* The remote side reserves one of CONFIG_NRF_RPC_THREAD_POOL_SIZE remote
+ * threads for every command and event it sends, so no more packets can wait
+ * for a thread.
  */
-#define CONTEXT_MASK_INIT_VALUE						       \
-	(~(((atomic_val_t)1 << (8 * sizeof(atomic_val_t) -		       \
-				CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE)) - 1))
+#define POOL_QUEUE_SIZE CONFIG_NRF_RPC_THREAD_POOL_SIZE
 
 struct pool_start_msg {
 	const uint8_t *data;
 	size_t len;
+#if CONFIG_NRF_RPC_THREAD_POOL_STATS
+	uint32_t timestamp;
+#endif
 };
 
 static nrf_rpc_os_work_t thread_pool_callback;
 
-static struct pool_start_msg pool_start_msg_buf[2];
+static struct pool_start_msg pool_start_msg_buf[POOL_QUEUE_SIZE];
 static struct k_msgq pool_start_msg;
 
+#if CONFIG_NRF_RPC_THREAD_POOL_STATS
+static struct k_spinlock pool_stats_lock;
+static struct nrf_rpc_os_pool_stats pool_stats;
+#endif
+
 static struct k_sem context_reserved;
-static atomic_t context_mask;
+
+/* Bit is set if the context is free. */
+static ATOMIC_DEFINE(context_free, CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE);
 
 static uint32_t remote_thread_total;
 
@@ -44,10 +53,35 @@ static struct k_thread pool_threads[CONFIG_NRF_RPC_THREAD_POOL_SIZE];
 
 BUILD_ASSERT(CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE > 0,
 	     "CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE must be greaten than zero");
-BUILD_ASSERT(CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE <= 8 * sizeof(atomic_val_t),
-	     "CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE too big");
-BUILD_ASSERT(sizeof(uint32_t) == sizeof(atomic_val_t),
-	     "Only atomic_val_t is implemented that is the same as uint32_t");
+BUILD_ASSERT(CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE < 255,
+	     "Context numbers are sent in one byte");
+
+#if CONFIG_NRF_RPC_THREAD_POOL_STATS
+static void stats_send_update(struct pool_start_msg *msg)
+{
+	k_spinlock_key_t key = k_spin_lock(&pool_stats_lock);
+
+	pool_stats.cnt++;
+	pool_stats.depth_max = MAX(pool_stats.depth_max,
+				   k_msgq_num_used_get(&pool_start_msg) + 1);
+
+	k_spin_unlock(&pool_stats_lock, key);
+
+	msg->timestamp = k_cycle_get_32();
+}
+
+static void stats_start_update(const struct pool_start_msg *msg)
+{
+	uint32_t wait_us = k_cyc_to_us_floor32(k_cycle_get_32() -
+					       msg->timestamp);
+	k_spinlock_key_t key = k_spin_lock(&pool_stats_lock);
+
+	pool_stats.wait_total_us += wait_us;
+	pool_stats.wait_max_us = MAX(pool_stats.wait_max_us, wait_us);
+
+	k_spin_unlock(&pool_stats_lock, key);
+}
+#endif /* CONFIG_NRF_RPC_THREAD_POOL_STATS */
 
 static void thread_pool_entry(void *p1, void *p2, void *p3)
 {
@@ -55,6 +89,9 @@ static void thread_pool_entry(void *p1, void *p2, void *p3)
 
 	do {
 		k_msgq_get(&pool_start_msg, &msg, K_FOREVER);
+#if CONFIG_NRF_RPC_THREAD_POOL_STATS
+		stats_start_update(&msg);
+#endif
 		thread_pool_callback(msg.data, msg.len);
 	} while (1);
 }
@@ -80,7 +117,9 @@ int nrf_rpc_os_init(nrf_rpc_os_work_t callback)
 	}
 	remote_thread_total = 0;
 
-	atomic_set(&context_mask, CONTEXT_MASK_INIT_VALUE);
+	for (i = 0; i < CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE; i++) {
+		atomic_set_bit(context_free, i);
+	}
 
 	k_msgq_init(&pool_start_msg, (char *)pool_start_msg_buf,
 		    sizeof(struct pool_start_msg),
@@ -103,9 +142,29 @@ void nrf_rpc_os_thread_pool_send(const uint8_t *data, size_t len)
 
 	msg.data = data;
 	msg.len = len;
-	k_msgq_put(&pool_start_msg, &msg, K_FOREVER);
+#if CONFIG_NRF_RPC_THREAD_POOL_STATS
+	stats_send_update(&msg);
+#endif
+	/* The queue cannot fill up, so the receive thread does not wait here
+	 * and the following packets are not delayed.
+	 */
+	if (k_msgq_put(&pool_start_msg, &msg, K_NO_WAIT) != 0) {
+		NRF_RPC_ERR("Too many packets for the thread pool");
+		k_msgq_put(&pool_start_msg, &msg, K_FOREVER);
+	}
 }
 
+#if CONFIG_NRF_RPC_THREAD_POOL_STATS
+void nrf_rpc_os_thread_pool_stats_get(struct nrf_rpc_os_pool_stats *stats)
+{
+	k_spinlock_key_t key = k_spin_lock(&pool_stats_lock);
+
+	*stats = pool_stats;
+
+	k_spin_unlock(&pool_stats_lock, key);
+}
+#endif /* CONFIG_NRF_RPC_THREAD_POOL_STATS */
+
 void nrf_rpc_os_msg_set(struct nrf_rpc_os_msg *msg, const uint8_t *data,
 			size_t len)
 {
@@ -129,25 +188,25 @@ void nrf_rpc_os_msg_get(struct nrf_rpc_os_msg *msg, const uint8_t **data,
 uint32_t nrf_rpc_os_ctx_pool_reserve(void)
 {
 	uint32_t number;
-	atomic_val_t old_mask;
-	atomic_val_t new_mask;
 
 	k_sem_take(&context_reserved, K_FOREVER);
 
+	/* The semaphore guarantees that at least one context is free. */
 	do {
-		old_mask = atomic_get(&context_mask);
-		number = __CLZ(old_mask);
-		new_mask = old_mask & ~(0x80000000u >> number);
-	} while (!atomic_cas(&context_mask, old_mask, new_mask));
-
-	return number;
+		for (number = 0; number < CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE;
+		     number++) {
+			if (atomic_test_and_clear_bit(context_free, number)) {
+				return number;
+			}
+		}
+	} while (1);
 }
 
 void nrf_rpc_os_ctx_pool_release(uint32_t number)
 {
 	__ASSERT_NO_MSG(number < CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE);
 
-	atomic_or(&context_mask, 0x80000000u >> number);
+	atomic_set_bit(context_free, number);
 	k_sem_give(&context_reserved);
 }
 
@@ -123,7 +123,28 @@ int nrf_rpc_tr_send(uint8_t *buf, size_t len)
 
 	DUMP_LIMITED_DBG(buf, len, "Send data");
 
-	err = rp_ll_send(&ll_endpoint, buf, len);
+	if (IS_ENABLED(CONFIG_NRF_RPC_TR_RPMSG_ZERO_COPY) &&
+	    rp_ll_is_tx_buf(buf)) {
+		err = rp_ll_send_nocopy(&ll_endpoint, buf, len);
+	} else {
+		err = rp_ll_send(&ll_endpoint, buf, len);
+	}
 
 	return translate_error(err);
 }
+
+#if CONFIG_NRF_RPC_TR_RPMSG_ZERO_COPY
+uint8_t *nrf_rpc_tr_rpmsg_alloc_tx_buf(uint8_t *local_buf, size_t len)
+{
+	uint8_t *buf = rp_ll_alloc_tx_buf(&ll_endpoint, len);
+
+	return buf ? buf : local_buf;
+}
+
+void nrf_rpc_tr_rpmsg_free_tx_buf(uint8_t *buf)
+{
+	if (rp_ll_is_tx_buf(buf)) {
+		rp_ll_free_tx_buf(&ll_endpoint, buf);
+	}
+}
+#endif /* CONFIG_NRF_RPC_TR_RPMSG_ZERO_COPY */
@@ -24,6 +24,12 @@ LOG_MODULE_REGISTER(rp_ll_api);
 static struct k_work_q my_work_q;
 static struct k_work work_item;
 
+#if CONFIG_NRF_RPC_TR_RPMSG_NOTIFY_DELAY > 0
+/* Notifications requested while this timer runs are sent as one. */
+static struct k_timer notify_timer;
+static atomic_t notify_pending;
+#endif
+
 /* Indicates that handshake was done by this endpoint */
 #define EP_FLAG_HANSHAKE_DONE 1
 
@@ -106,7 +112,7 @@ static void virtio_set_features(struct virtio_device *vdev, uint32_t features)
 	/* No need for implementation */
 }
 
-static void virtio_notify(struct virtqueue *vq)
+static void ipm_notify(void)
 {
 	int status;
 
@@ -116,6 +122,31 @@ static void virtio_notify(struct virtqueue *vq)
 	}
 }
 
+#if CONFIG_NRF_RPC_TR_RPMSG_NOTIFY_DELAY > 0
+static void notify_timer_handler(struct k_timer *timer)
+{
+	atomic_clear(&notify_pending);
+	ipm_notify();
+}
+#endif
+
+static void virtio_notify(struct virtqueue *vq)
+{
+#if CONFIG_NRF_RPC_TR_RPMSG_NOTIFY_DELAY > 0
+	/* The other core processes all buffers in the virtqueue on a single
+	 * notification, so packets sent within the delay share one.
+	 */
+	if (atomic_set(&notify_pending, true)) {
+		return;
+	}
+
+	k_timer_start(&notify_timer,
+		      K_USEC(CONFIG_NRF_RPC_TR_RPMSG_NOTIFY_DELAY), K_NO_WAIT);
+#else
+	ipm_notify();
+#endif
+}
+
 const struct virtio_dispatch dispatch = {
 	.get_status = virtio_get_status,
 	.get_features = virtio_get_features,
@@ -176,6 +207,74 @@ int rp_ll_send(struct rp_ll_endpoint *endpoint, const uint8_t *buf,
 	return ret;
 }
 
+#if CONFIG_NRF_RPC_TR_RPMSG_ZERO_COPY
+bool rp_ll_is_tx_buf(const uint8_t *buf)
+{
+	return ((uintptr_t)buf >= SHM_START_ADDR) &&
+	       ((uintptr_t)buf < SHM_START_ADDR + SHM_SIZE);
+}
+
+uint8_t *rp_ll_alloc_tx_buf(struct rp_ll_endpoint *endpoint, size_t len)
+{
+	uint32_t size;
+	void *buf;
+
+	if (len > rpmsg_virtio_get_buffer_size(rdev)) {
+		return NULL;
+	}
+
+	buf = k_fifo_get(&endpoint->free_tx_bufs, K_NO_WAIT);
+	if (buf) {
+		return buf;
+	}
+
+	/* The caller may not be allowed to sleep. If no buffer is free,
+	 * the packet is copied instead.
+	 */
+	buf = rpmsg_get_tx_payload_buffer(&endpoint->rpmsg_ep, &size, false);
+	if (!buf) {
+		LOG_DBG("No TX buffer available");
+		return NULL;
+	}
+
+	return buf;
+}
+
+int rp_ll_send_nocopy(struct rp_ll_endpoint *endpoint, uint8_t *buf,
+		      size_t buf_len)
+{
+	int ret;
+
+	__ASSERT_NO_MSG(rp_ll_is_tx_buf(buf));
+
+	ret = rpmsg_send_nocopy(&endpoint->rpmsg_ep, buf, buf_len);
+	if (ret < 0) {
+		/* The buffer was not passed to the other core. */
+		rp_ll_free_tx_buf(endpoint, buf);
+		return ret;
+	}
+	return 0;
+}
+
+void rp_ll_free_tx_buf(struct rp_ll_endpoint *endpoint, uint8_t *buf)
+{
+	__ASSERT_NO_MSG(rp_ll_is_tx_buf(buf));
+
+	/* RPMsg returns a TX buffer to the pool only when it is sent. After
+	 * the handshake, the buffer is sent as an empty packet, which the
+	 * other side ignores. Before the handshake, the other side could
+	 * take it for a handshake, so the buffer is kept for the next
+	 * allocation instead.
+	 */
+	if ((endpoint->flags & EP_FLAG_HANSHAKE_DONE) &&
+	    (rpmsg_send_nocopy(&endpoint->rpmsg_ep, buf, 0) >= 0)) {
+		return;
+	}
+
+	k_fifo_put(&endpoint->free_tx_bufs, buf);
+}
+#endif /* CONFIG_NRF_RPC_TR_RPMSG_ZERO_COPY */
+
 int rp_ll_init(void)
 {
 	int err;
@@ -226,6 +325,10 @@ int rp_ll_init(void)
 
 	ipm_register_callback(ipm_rx_handle, ipm_callback, NULL);
 
+#if CONFIG_NRF_RPC_TR_RPMSG_NOTIFY_DELAY > 0
+	k_timer_init(&notify_timer, notify_timer_handler, NULL);
+#endif
+
 	/* Virtqueue setup. */
 	vq[0] = virtqueue_allocate(VRING_SIZE);
 	if (!vq[0]) {
@@ -295,6 +398,10 @@ int rp_ll_endpoint_init(struct rp_ll_endpoint *endpoint,
 
 	endpoint->callback = callback;
 
+#if CONFIG_NRF_RPC_TR_RPMSG_ZERO_COPY
+	k_fifo_init(&endpoint->free_tx_bufs);
+#endif
+
 	err = rpmsg_create_ept(&endpoint->rpmsg_ep, rdev, "", endpoint_number,
 		endpoint_number, endpoint_cb, rpmsg_service_unbind);
 
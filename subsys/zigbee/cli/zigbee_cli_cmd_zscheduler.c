@@ -4,12 +4,17 @@
  * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
  */
 
+#include <errno.h>
+#include <string.h>
 #include <shell/shell.h>
 
 #include <zboss_api.h>
 #include <zb_nrf_platform.h>
 #include "zigbee_cli.h"
 
+#define STATS_HELP \
+	("Print application callback queue statistics.\n" \
+	 "Usage: stats [reset]")
 
 #ifdef CONFIG_ZIGBEE_SHELL_DEBUG_CMD
 /**@brief Suspend Zigbee scheduler processing
@@ -48,13 +53,70 @@ static int cmd_zb_resume(const struct shell *shell, size_t argc, char **argv)
 	return 0;
 }
 
+#endif /* CONFIG_ZIGBEE_SHELL_DEBUG_CMD */
+
+/**@brief Print statistics of the queue, that passes application callbacks
+ *        and alarms to the Zigbee scheduler.
+ *
+ * @code
+ * zscheduler stats [reset]
+ * @endcode
+ *
+ * @code
+ * > zscheduler stats
+ * Queued: 1234
+ * Overflows: 0
+ * Max depth: 5
+ * ZBOSS scheduler overflows: 2
+ * Processed: 1234
+ * Latency avg: 412 us, max: 10230 us
+ * Done
+ * @endcode
+ *
+ * Use the optional @c reset argument to clear the statistics after printing.
+ */
+static int cmd_zb_stats(const struct shell *shell, size_t argc, char **argv)
+{
+	struct zigbee_app_cb_stats stats;
+
+	if ((argc == 2) && strcmp(argv[1], "reset")) {
+		zb_cli_print_error(shell, "Invalid argument", ZB_FALSE);
+		return -EINVAL;
+	}
+
+	zigbee_app_cb_stats_get(&stats);
+
+	shell_print(shell, "Queued: %u", stats.queued);
+	shell_print(shell, "Overflows: %u", stats.overflows);
+	shell_print(shell, "Max depth: %u", stats.max_depth);
+	shell_print(shell, "ZBOSS scheduler overflows: %u",
+		    stats.zboss_overflows);
+	shell_print(shell, "Processed: %u", stats.processed);
+	shell_print(shell, "Latency avg: %u us, max: %u us",
+		    stats.latency_avg_us, stats.latency_max_us);
+
+	if (argc == 2) {
+		zigbee_app_cb_stats_reset();
+	}
+
+	zb_cli_print_done(shell, ZB_FALSE);
+
+	return 0;
+}
+
+#ifdef CONFIG_ZIGBEE_SHELL_DEBUG_CMD
 SHELL_STATIC_SUBCMD_SET_CREATE(sub_zigbee,
 	SHELL_CMD_ARG(resume, NULL, "Suspend Zigbee scheduler processing",
 		      cmd_zb_resume, 1, 0),
+	SHELL_CMD_ARG(stats, NULL, STATS_HELP, cmd_zb_stats, 1, 1),
 	SHELL_CMD_ARG(suspend, NULL, "Suspend Zigbee scheduler processing",
 		      cmd_zb_suspend, 1, 0),
 	SHELL_SUBCMD_SET_END);
+#else
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_zigbee,
+	SHELL_CMD_ARG(stats, NULL, STATS_HELP, cmd_zb_stats, 1, 1),
+	SHELL_SUBCMD_SET_END);
+#endif /* CONFIG_ZIGBEE_SHELL_DEBUG_CMD */
 
 SHELL_CMD_REGISTER(zscheduler, &sub_zigbee, "Zigbee scheduler manipulation",
 		   NULL);
-#endif
@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
  */
 
+#include <kernel.h>
 #include <sys/__assert.h>
 #include <random/rand32.h>
 #include <logging/log.h>
@@ -13,6 +14,7 @@
 #elif CONFIG_BT_CTLR
 #include <bluetooth/crypto.h>
 #elif CONFIG_ZIGBEE_USE_SOFTWARE_AES
+#include <string.h>
 #include <tinycrypt/aes.h>
 #include <tinycrypt/constants.h>
 #else
@@ -75,15 +77,60 @@ static void encrypt_aes(zb_uint8_t *key, zb_uint8_t *msg, zb_uint8_t *c)
 	__ASSERT(!err, "Encryption failed");
 }
 #elif CONFIG_ZIGBEE_USE_SOFTWARE_AES
-static void encrypt_aes(zb_uint8_t *key, zb_uint8_t *msg, zb_uint8_t *c)
+/* ZBOSS encrypts every frame with a few keys only, so the key schedules
+ * are cached to avoid expanding the key for every block. The callout may be
+ * called from any thread, so the cache is protected with a mutex.
+ */
+struct key_cache_entry {
+	uint8_t key[ECB_AES_KEY_SIZE];
+	struct tc_aes_key_sched_struct sched;
+	uint32_t last_use;
+	bool valid;
+};
+
+static struct key_cache_entry key_cache[CONFIG_ZIGBEE_AES_KEY_CACHE_SIZE];
+static uint32_t key_cache_use_cnt;
+static K_MUTEX_DEFINE(key_cache_mutex);
+
+/* Must be called with key_cache_mutex locked. */
+static struct tc_aes_key_sched_struct *key_sched_get(const zb_uint8_t *key)
 {
+	struct key_cache_entry *entry = &key_cache[0];
 	int err;
-	struct tc_aes_key_sched_struct s;
 
-	err = tc_aes128_set_encrypt_key(&s, key);
+	for (size_t i = 0; i < ARRAY_SIZE(key_cache); i++) {
+		struct key_cache_entry *e = &key_cache[i];
+
+		if (e->valid && !memcmp(e->key, key, sizeof(e->key))) {
+			e->last_use = ++key_cache_use_cnt;
+			return &e->sched;
+		}
+
+		/* Replace a free or the least recently used entry. */
+		if (entry->valid &&
+		    (!e->valid || (e->last_use < entry->last_use))) {
+			entry = e;
+		}
+	}
+
+	err = tc_aes128_set_encrypt_key(&entry->sched, key);
 	__ASSERT(err == TC_CRYPTO_SUCCESS, "Key set failed");
 
-	err = tc_aes_encrypt(c, msg, &s);
+	memcpy(entry->key, key, sizeof(entry->key));
+	entry->valid = true;
+	entry->last_use = ++key_cache_use_cnt;
+
+	return &entry->sched;
+}
+
+static void encrypt_aes(zb_uint8_t *key, zb_uint8_t *msg, zb_uint8_t *c)
+{
+	int err;
+
+	k_mutex_lock(&key_cache_mutex, K_FOREVER);
+	err = tc_aes_encrypt(c, msg, key_sched_get(key));
+	k_mutex_unlock(&key_cache_mutex);
+
 	__ASSERT(err == TC_CRYPTO_SUCCESS, "Encryption failed");
 }
 #endif
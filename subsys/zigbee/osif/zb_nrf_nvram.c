@@ -10,6 +10,8 @@
 
 #include <zboss_api.h>
 
+#include "zb_nrf_platform.h"
+
 #ifdef ZB_USE_NVRAM
 
 /* ZBOSS uses two virtual pages in the same size. */
@@ -22,6 +24,12 @@ BUILD_ASSERT((ZBOSS_NVRAM_PAGE_SIZE % PHYSICAL_PAGE_SIZE) == 0,
 
 LOG_MODULE_DECLARE(zboss_osif, CONFIG_ZBOSS_OSIF_LOG_LEVEL);
 
+#define CACHE_SIZE CONFIG_ZIGBEE_NVRAM_CACHE_SIZE
+#define CACHE_COUNT CONFIG_ZIGBEE_NVRAM_CACHE_COUNT
+BUILD_ASSERT((CACHE_SIZE % sizeof(uint32_t)) == 0,
+	     "The cache size must be a multiple of word size.");
+BUILD_ASSERT(CACHE_COUNT <= 8, "Pending buffers must fit in a byte.");
+
 /* ZBOSS callout that should be called once flash erase page operation
  * is finished.
  */
@@ -33,6 +41,213 @@ static const struct flash_area *fa; /* ZBOSS nvram */
 static const struct flash_area *fa_pc; /* production config */
 #endif
 
+enum nvram_op_type {
+	NVRAM_OP_WRITE,
+	NVRAM_OP_ERASE,
+	NVRAM_OP_SYNC,
+};
+
+struct nvram_op {
+	enum nvram_op_type type;
+	union {
+		struct cache_buf *cache;
+		zb_uint8_t page;
+		struct k_sem *done_sem;
+	};
+};
+
+/* Sequential writes are collected in a cache buffer and written to flash
+ * at once by the flash thread.
+ */
+struct cache_buf {
+	/* Set while the buffer waits for the flash thread. */
+	atomic_t in_flight;
+	zb_uint8_t page;
+	zb_uint32_t pos;
+	zb_uint16_t len;
+	uint8_t data[CACHE_SIZE] __aligned(4);
+};
+
+/* Cache buffers are used in a ring and written to flash in the same order.
+ * The buffers in flight and the one being filled contain data that is not
+ * in flash yet.
+ */
+static struct cache_buf cache_bufs[CACHE_COUNT];
+static uint8_t cache_cur;
+static bool cache_filling;
+
+/* Number of buffers that are not waiting for the flash thread. */
+static struct k_sem cache_free_sem;
+
+/* Number of erase operations waiting for the flash thread. */
+static atomic_t erase_pending;
+
+/* Bit mask of pages with finished erase operations not reported to ZBOSS. */
+static atomic_t erase_finished;
+
+/* First error of the flash thread, reported when ZBOSS waits for it. */
+static atomic_t nvram_err;
+/* Error reported by the last wait for the flash thread. */
+static int nvram_last_err;
+
+K_MSGQ_DEFINE(nvram_op_msgq, sizeof(struct nvram_op),
+	      CACHE_COUNT + ZBOSS_NVRAM_PAGE_COUNT + 1, 4);
+
+K_THREAD_STACK_DEFINE(nvram_stack_area, CONFIG_ZIGBEE_NVRAM_THREAD_STACK_SIZE);
+static struct k_thread nvram_thread_data;
+static k_tid_t nvram_tid;
+
+zb_uint32_t zb_get_nvram_page_length(void)
+{
+	return ZBOSS_NVRAM_PAGE_SIZE;
+}
+
+zb_uint8_t zb_get_nvram_page_count(void)
+{
+	return ZBOSS_NVRAM_PAGE_COUNT;
+}
+
+static zb_uint32_t get_page_base_offset(int page_num)
+{
+	return (page_num * zb_get_nvram_page_length());
+}
+
+static void nvram_op_write(struct cache_buf *cache)
+{
+	int err = flash_area_write(fa,
+				   get_page_base_offset(cache->page) +
+				   cache->pos, cache->data, cache->len);
+
+	if (err) {
+		LOG_ERR("Write error: %d", err);
+		(void)atomic_cas(&nvram_err, 0, err);
+	}
+
+	atomic_clear(&cache->in_flight);
+	k_sem_give(&cache_free_sem);
+}
+
+static void nvram_op_erase(zb_uint8_t page)
+{
+	int err = flash_area_erase(fa, get_page_base_offset(page),
+				   zb_get_nvram_page_length());
+
+	if (err) {
+		LOG_ERR("Erase error: %d", err);
+		(void)atomic_cas(&nvram_err, 0, err);
+	}
+
+	atomic_or(&erase_finished, BIT(page));
+	atomic_dec(&erase_pending);
+
+	/* The end of the operation is reported by ZBOSS thread, which may be
+	 * waiting for this thread, so only a flag is set here.
+	 */
+	zigbee_event_notify(ZIGBEE_EVENT_NVRAM);
+}
+
+static void nvram_thread(void *arg1, void *arg2, void *arg3)
+{
+	struct nvram_op op;
+
+	while (1) {
+		k_msgq_get(&nvram_op_msgq, &op, K_FOREVER);
+
+		switch (op.type) {
+		case NVRAM_OP_WRITE:
+			nvram_op_write(op.cache);
+			break;
+		case NVRAM_OP_ERASE:
+			nvram_op_erase(op.page);
+			break;
+		case NVRAM_OP_SYNC:
+			k_sem_give(op.done_sem);
+			break;
+		default:
+			__ASSERT_NO_MSG(false);
+			break;
+		}
+	}
+}
+
+static void nvram_op_submit(const struct nvram_op *op)
+{
+	k_msgq_put(&nvram_op_msgq, op, K_FOREVER);
+}
+
+static void cache_submit(void)
+{
+	struct nvram_op op = {
+		.type = NVRAM_OP_WRITE,
+		.cache = &cache_bufs[cache_cur],
+	};
+
+	if (!cache_filling) {
+		return;
+	}
+
+	cache_filling = false;
+	atomic_set(&op.cache->in_flight, true);
+	nvram_op_submit(&op);
+}
+
+static struct cache_buf *cache_start(zb_uint8_t page, zb_uint32_t pos)
+{
+	struct cache_buf *cache;
+
+	cache_submit();
+
+	/* Buffers are written in order, so the next one is free first. */
+	k_sem_take(&cache_free_sem, K_FOREVER);
+	cache_cur = (cache_cur + 1) % CACHE_COUNT;
+
+	cache = &cache_bufs[cache_cur];
+	cache->page = page;
+	cache->pos = pos;
+	cache->len = 0;
+	cache_filling = true;
+
+	return cache;
+}
+
+/* Get a bit mask of the buffers with data that is not in flash yet. */
+static uint8_t cache_pending_get(void)
+{
+	uint8_t pending = 0;
+
+	for (size_t i = 0; i < CACHE_COUNT; i++) {
+		if (atomic_get(&cache_bufs[i].in_flight) ||
+		    (cache_filling && (i == cache_cur))) {
+			pending |= BIT(i);
+		}
+	}
+
+	return pending;
+}
+
+static void cache_read(zb_uint8_t page, zb_uint32_t pos, zb_uint8_t *buf,
+		       zb_uint16_t len, uint8_t pending)
+{
+	/* Apply buffers from the oldest, so that newer data wins. */
+	for (size_t i = 1; i <= CACHE_COUNT; i++) {
+		uint8_t idx = (cache_cur + i) % CACHE_COUNT;
+		struct cache_buf *cache = &cache_bufs[idx];
+		zb_uint32_t start = MAX(pos, cache->pos);
+		zb_uint32_t end = MIN(pos + len, cache->pos + cache->len);
+
+		if (!(pending & BIT(idx))) {
+			continue;
+		}
+
+		if ((cache->page != page) || (start >= end)) {
+			continue;
+		}
+
+		memcpy(&buf[start - pos], &cache->data[start - cache->pos],
+		       end - start);
+	}
+}
+
 void zb_osif_nvram_init(const zb_char_t *name)
 {
 	ARG_UNUSED(name);
@@ -49,21 +264,21 @@ void zb_osif_nvram_init(const zb_char_t *name)
 		LOG_ERR("Can't open product config flash area");
 	}
 #endif
-}
 
-zb_uint32_t zb_get_nvram_page_length(void)
-{
-	return ZBOSS_NVRAM_PAGE_SIZE;
-}
+	if (nvram_tid) {
+		return;
+	}
 
-zb_uint8_t zb_get_nvram_page_count(void)
-{
-	return ZBOSS_NVRAM_PAGE_COUNT;
-}
+	k_sem_init(&cache_free_sem, CACHE_COUNT, CACHE_COUNT);
 
-static zb_uint32_t get_page_base_offset(int page_num)
-{
-	return (page_num * zb_get_nvram_page_length());
+	nvram_tid = k_thread_create(&nvram_thread_data,
+				    nvram_stack_area,
+				    K_THREAD_STACK_SIZEOF(nvram_stack_area),
+				    nvram_thread,
+				    NULL, NULL, NULL,
+				    CONFIG_ZIGBEE_NVRAM_THREAD_PRIORITY,
+				    0, K_NO_WAIT);
+	k_thread_name_set(&nvram_thread_data, "zboss_nvram");
 }
 
 zb_ret_t zb_osif_nvram_read(zb_uint8_t page, zb_uint32_t pos, zb_uint8_t *buf,
@@ -87,6 +302,16 @@ zb_ret_t zb_osif_nvram_read(zb_uint8_t page, zb_uint32_t pos, zb_uint8_t *buf,
 	LOG_DBG("Function: %s, page: %d, pos: %d, len: %d",
 		__func__, page, pos, len);
 
+	/* Data written before an erase must not be read from the cache. */
+	if (atomic_get(&erase_pending)) {
+		zb_osif_nvram_wait_for_last_op();
+	}
+
+	/* A buffer may be stored by the flash thread while flash is read,
+	 * so the buffers to apply are taken before. Only the ZBOSS thread
+	 * refills the buffers, so their data stays valid.
+	 */
+	uint8_t pending = cache_pending_get();
 	uint32_t flash_addr = get_page_base_offset(page) + pos;
 
 	int err = flash_area_read(fa, flash_addr, buf, len);
@@ -95,13 +320,17 @@ zb_ret_t zb_osif_nvram_read(zb_uint8_t page, zb_uint32_t pos, zb_uint8_t *buf,
 		LOG_ERR("Read error: %d", err);
 		return RET_ERROR;
 	}
+
+	cache_read(page, pos, buf, len, pending);
+
 	return RET_OK;
 }
 
 zb_ret_t zb_osif_nvram_write(zb_uint8_t page, zb_uint32_t pos, void *buf,
 			     zb_uint16_t len)
 {
-	uint32_t flash_addr = get_page_base_offset(page) + pos;
+	struct cache_buf *cache = &cache_bufs[cache_cur];
+	const uint8_t *data = buf;
 
 	if (page >= zb_get_nvram_page_count()) {
 		return RET_PAGE_NOT_FOUND;
@@ -122,11 +351,27 @@ zb_ret_t zb_osif_nvram_write(zb_uint8_t page, zb_uint32_t pos, void *buf,
 	LOG_DBG("Function: %s, page: %d, pos: %d, len: %d",
 		__func__, page, pos, len);
 
-	int err = flash_area_write(fa, flash_addr, buf, len);
+	while (len > 0) {
+		zb_uint16_t chunk;
 
-	if (err) {
-		LOG_ERR("Write error: %d", err);
-		return RET_ERROR;
+		/* Append to the current buffer if the data follows it. */
+		if (!cache_filling || (cache->page != page) ||
+		    (cache->pos + cache->len != pos) ||
+		    (cache->len == CACHE_SIZE)) {
+			cache = cache_start(page, pos);
+		}
+
+		chunk = MIN(len, CACHE_SIZE - cache->len);
+		memcpy(&cache->data[cache->len], data, chunk);
+		cache->len += chunk;
+
+		pos += chunk;
+		data += chunk;
+		len -= chunk;
+	}
+
+	if (cache->len == CACHE_SIZE) {
+		cache_submit();
 	}
 
 	return RET_OK;
@@ -134,28 +379,64 @@ zb_ret_t zb_osif_nvram_write(zb_uint8_t page, zb_uint32_t pos, void *buf,
 
 zb_ret_t zb_osif_nvram_erase_async(zb_uint8_t page)
 {
-	zb_ret_t ret = RET_OK;
+	struct nvram_op op = {
+		.type = NVRAM_OP_ERASE,
+		.page = page,
+	};
 
-	if (page < zb_get_nvram_page_count()) {
-		int err = flash_area_erase(fa, get_page_base_offset(page),
-					   zb_get_nvram_page_length());
-		if (err) {
-			LOG_ERR("Erase error: %d", err);
-			ret = RET_ERROR;
-		}
+	if (page >= zb_get_nvram_page_count()) {
+		zb_nvram_erase_finished(page);
+		return RET_OK;
 	}
-	zb_nvram_erase_finished(page);
-	return ret;
+
+	/* Data written before the erase is stored first. */
+	cache_submit();
+
+	atomic_inc(&erase_pending);
+	nvram_op_submit(&op);
+
+	return RET_OK;
 }
 
 void zb_osif_nvram_wait_for_last_op(void)
 {
-	/* empty for synchronous erase and write */
+	struct k_sem done_sem;
+	struct nvram_op op = {
+		.type = NVRAM_OP_SYNC,
+		.done_sem = &done_sem,
+	};
+
+	k_sem_init(&done_sem, 0, 1);
+
+	nvram_op_submit(&op);
+	k_sem_take(&done_sem, K_FOREVER);
+
+	nvram_last_err = atomic_set(&nvram_err, 0);
+	if (nvram_last_err) {
+		LOG_ERR("NVRAM operation failed: %d", nvram_last_err);
+	}
 }
 
 void zb_osif_nvram_flush(void)
 {
-	/* empty for synchronous erase and write */
+	cache_submit();
+	zb_osif_nvram_wait_for_last_op();
+}
+
+int zigbee_nvram_result_get(void)
+{
+	return nvram_last_err;
+}
+
+void zigbee_nvram_erase_finished_process(void)
+{
+	atomic_val_t finished = atomic_set(&erase_finished, 0);
+
+	for (zb_uint8_t page = 0; page < ZBOSS_NVRAM_PAGE_COUNT; page++) {
+		if (finished & BIT(page)) {
+			zb_nvram_erase_finished(page);
+		}
+	}
 }
 
 
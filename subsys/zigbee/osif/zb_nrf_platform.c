@@ -58,18 +58,81 @@ static struct k_poll_signal zigbee_sig = K_POLL_SIGNAL_INITIALIZER(zigbee_sig);
  */
 static K_MUTEX_DEFINE(zigbee_mutex);
 
+/* Number of slots in the application callback queue, rounded up to
+ * a power of two, so the slot index can be taken from the free running
+ * queue positions.
+ */
+#define APP_CB_QUEUE_LEN CONFIG_ZIGBEE_APP_CB_QUEUE_LENGTH
+#define APP_CB_QUEUE_SIZE						 \
+	((APP_CB_QUEUE_LEN <= 2) ? 2 :				 \
+	 (APP_CB_QUEUE_LEN <= 4) ? 4 :				 \
+	 (APP_CB_QUEUE_LEN <= 8) ? 8 :				 \
+	 (APP_CB_QUEUE_LEN <= 16) ? 16 :			 \
+	 (APP_CB_QUEUE_LEN <= 32) ? 32 :			 \
+	 (APP_CB_QUEUE_LEN <= 64) ? 64 :			 \
+	 (APP_CB_QUEUE_LEN <= 128) ? 128 : 256)
+#define APP_CB_QUEUE_MASK (APP_CB_QUEUE_SIZE - 1)
+
+BUILD_ASSERT(APP_CB_QUEUE_LEN <= 256,
+	     "Application callback queue can have up to 256 elements");
+
+/* The queue positions start close to their wrap, so that the wrap happens
+ * shortly after boot and is not hidden until the device runs for long.
+ */
+#define APP_CB_QUEUE_START ((uint32_t)(-4 * APP_CB_QUEUE_SIZE))
+
+/**
+ * Slot of the application callback queue.
+ *
+ * The sequence number tells who owns the slot. A producer can fill the slot
+ * if it is equal to the queue position, the consumer can read it if it is
+ * one more than the queue position.
+ */
+struct zb_app_cb_slot {
+	atomic_t seq;
+	uint32_t timestamp;
+	zb_app_cb_t app_cb;
+};
+
 /**
- * Message queue, that is used to pass ZBOSS callbacks and alarms from
+ * Lock-free queue, that is used to pass ZBOSS callbacks and alarms from
  * ISR and other threads to ZBOSS main loop context.
+ *
+ * Any number of producers claim slots by incrementing the enqueue position.
+ * The only consumer is the ZBOSS main loop.
  */
-K_MSGQ_DEFINE(zb_app_cb_msgq, sizeof(zb_app_cb_t),
-	      CONFIG_ZIGBEE_APP_CB_QUEUE_LENGTH, 4);
+static struct {
+	atomic_t enqueue_pos;
+	atomic_t dequeue_pos;
+	struct zb_app_cb_slot slots[APP_CB_QUEUE_SIZE];
+} zb_app_cb_queue;
+
+/** Statistics of the application callback queue. */
+static struct {
+	atomic_t queued;
+	atomic_t overflows;
+	atomic_t max_depth;
+	atomic_t zboss_overflows;
+	/* Set by zigbee_app_cb_stats_reset. The fields below are cleared
+	 * in ZBOSS main loop context, because only it updates them.
+	 */
+	atomic_t reset_pending;
+	uint32_t processed;
+	uint64_t latency_sum_us;
+	uint32_t latency_max_us;
+} zb_app_cb_stats;
 
 /**
- * Work queue that will schedule processing of callbacks from the message queue.
+ * Work queue that will schedule processing of callbacks from the queue.
  */
 static struct k_work zb_app_cb_work;
 
+/**
+ * Delayed work that retries scheduling of the processing callback if
+ * ZBOSS scheduler queue is full.
+ */
+static struct k_delayed_work zb_app_cb_retry_work;
+
 /**
  * Atomic flag, indicating that the processing callback is still scheduled for
  * execution,
@@ -120,9 +183,154 @@ bool zigbee_is_stack_started(void)
 	return stack_is_started;
 }
 
+void zigbee_app_cb_stats_get(struct zigbee_app_cb_stats *stats)
+{
+	stats->queued = atomic_get(&zb_app_cb_stats.queued);
+	stats->overflows = atomic_get(&zb_app_cb_stats.overflows);
+	stats->max_depth = atomic_get(&zb_app_cb_stats.max_depth);
+	stats->zboss_overflows = atomic_get(&zb_app_cb_stats.zboss_overflows);
+
+	if (atomic_get(&zb_app_cb_stats.reset_pending)) {
+		stats->processed = 0;
+		stats->latency_avg_us = 0;
+		stats->latency_max_us = 0;
+		return;
+	}
+
+	stats->processed = zb_app_cb_stats.processed;
+	stats->latency_avg_us = stats->processed ?
+		(uint32_t)(zb_app_cb_stats.latency_sum_us / stats->processed) :
+		0;
+	stats->latency_max_us = zb_app_cb_stats.latency_max_us;
+}
+
+void zigbee_app_cb_stats_reset(void)
+{
+	(void)atomic_clear(&zb_app_cb_stats.queued);
+	(void)atomic_clear(&zb_app_cb_stats.overflows);
+	(void)atomic_clear(&zb_app_cb_stats.max_depth);
+	(void)atomic_clear(&zb_app_cb_stats.zboss_overflows);
+	(void)atomic_set(&zb_app_cb_stats.reset_pending, 1);
+}
+
+static void zb_app_cb_queue_init(void)
+{
+	for (uint32_t pos = APP_CB_QUEUE_START;
+	     pos != APP_CB_QUEUE_START + APP_CB_QUEUE_SIZE; pos++) {
+		atomic_set(&zb_app_cb_queue.slots[pos & APP_CB_QUEUE_MASK].seq,
+			   pos);
+	}
+
+	atomic_set(&zb_app_cb_queue.enqueue_pos, APP_CB_QUEUE_START);
+	atomic_set(&zb_app_cb_queue.dequeue_pos, APP_CB_QUEUE_START);
+}
+
+static void zb_app_cb_depth_update(int32_t depth)
+{
+	atomic_val_t max_depth;
+
+	do {
+		max_depth = atomic_get(&zb_app_cb_stats.max_depth);
+		if (depth <= max_depth) {
+			return;
+		}
+	} while (!atomic_cas(&zb_app_cb_stats.max_depth, max_depth, depth));
+}
+
+/**@brief Put a request to the application callback queue.
+ *
+ * Thread- and ISR- safe. Does not block, the caller is informed about
+ * the full queue with RET_OVERFLOW.
+ */
+static zb_ret_t zb_app_cb_enqueue(const zb_app_cb_t *app_cb)
+{
+	struct zb_app_cb_slot *slot;
+	uint32_t pos = atomic_get(&zb_app_cb_queue.enqueue_pos);
+	int32_t diff;
+
+	while (true) {
+		slot = &zb_app_cb_queue.slots[pos & APP_CB_QUEUE_MASK];
+		diff = (int32_t)((uint32_t)atomic_get(&slot->seq) - pos);
+
+		if (diff == 0) {
+			/* Slot is free, try to claim it. */
+			if (atomic_cas(&zb_app_cb_queue.enqueue_pos,
+				       pos, pos + 1)) {
+				break;
+			}
+		} else if (diff < 0) {
+			/* Slot was not yet released by the consumer. */
+			(void)atomic_inc(&zb_app_cb_stats.overflows);
+			return RET_OVERFLOW;
+		}
+
+		/* Another producer claimed the slot, retry with a new one. */
+		pos = atomic_get(&zb_app_cb_queue.enqueue_pos);
+	}
+
+	slot->app_cb = *app_cb;
+	slot->timestamp = k_cycle_get_32();
+	atomic_set(&slot->seq, pos + 1);
+
+	(void)atomic_inc(&zb_app_cb_stats.queued);
+	/* The consumer may already be past this request. */
+	zb_app_cb_depth_update((int32_t)(pos + 1 -
+			       atomic_get(&zb_app_cb_queue.dequeue_pos)));
+
+	k_work_submit(&zb_app_cb_work);
+	return RET_OK;
+}
+
+/**@brief Get the oldest request from the application callback queue.
+ *
+ * The request stays in the queue until @ref zb_app_cb_release is called.
+ *
+ * @return Slot with the request or NULL if the queue is empty.
+ */
+static struct zb_app_cb_slot *zb_app_cb_peek(void)
+{
+	uint32_t pos = atomic_get(&zb_app_cb_queue.dequeue_pos);
+	struct zb_app_cb_slot *slot =
+		&zb_app_cb_queue.slots[pos & APP_CB_QUEUE_MASK];
+
+	if ((uint32_t)atomic_get(&slot->seq) != pos + 1) {
+		return NULL;
+	}
+
+	return slot;
+}
+
+/**@brief Remove the oldest request from the application callback queue.
+ *
+ * Called only from ZBOSS main loop context.
+ */
+static void zb_app_cb_release(struct zb_app_cb_slot *slot)
+{
+	uint32_t pos = atomic_get(&zb_app_cb_queue.dequeue_pos);
+	uint32_t latency_us =
+		k_cyc_to_us_floor32(k_cycle_get_32() - slot->timestamp);
+
+	if (atomic_clear(&zb_app_cb_stats.reset_pending)) {
+		zb_app_cb_stats.processed = 0;
+		zb_app_cb_stats.latency_sum_us = 0;
+		zb_app_cb_stats.latency_max_us = 0;
+	}
+
+	zb_app_cb_stats.processed++;
+	zb_app_cb_stats.latency_sum_us += latency_us;
+	if (latency_us > zb_app_cb_stats.latency_max_us) {
+		zb_app_cb_stats.latency_max_us = latency_us;
+	}
+
+	/* Hand the slot over to the producers. */
+	atomic_set(&slot->seq, pos + APP_CB_QUEUE_SIZE);
+	atomic_set(&zb_app_cb_queue.dequeue_pos, pos + 1);
+}
+
 static void zb_app_cb_process(zb_bufid_t bufid)
 {
 	zb_ret_t ret_code = RET_OK;
+	struct zb_app_cb_slot *slot;
 	zb_app_cb_t new_app_cb;
 
 	/* Mark te processing callback as non-scheduled. */
@@ -133,7 +341,9 @@ static void zb_app_cb_process(zb_bufid_t bufid)
 	 *
 	 * Note: the ZB_SCHEDULE_APP_ALARM is not thread-safe.
 	 */
-	while (!k_msgq_peek(&zb_app_cb_msgq, &new_app_cb)) {
+	while ((slot = zb_app_cb_peek()) != NULL) {
+		new_app_cb = slot->app_cb;
+
 		switch (new_app_cb.type) {
 		case ZB_CALLBACK_TYPE_SINGLE_PARAM:
 			ret_code = zb_schedule_app_callback(
@@ -206,24 +416,26 @@ static void zb_app_cb_process(zb_bufid_t bufid)
 			break;
 		}
 
-		/* Flush the element from the message queue. */
-		k_msgq_get(&zb_app_cb_msgq, &new_app_cb, K_NO_WAIT);
+		/* Flush the element from the queue. */
+		zb_app_cb_release(slot);
 	}
 
 	/**
 	 * In case of overflow error - reschedule the processing callback
-	 * to process remaining requests later.
+	 * to process remaining requests, when ZBOSS had a chance to execute
+	 * some of the already scheduled callbacks.
 	 */
 	if (ret_code == RET_OVERFLOW) {
-		k_work_submit(&zb_app_cb_work);
+		(void)atomic_inc(&zb_app_cb_stats.zboss_overflows);
+		k_delayed_work_submit(
+			&zb_app_cb_retry_work,
+			K_MSEC(CONFIG_ZIGBEE_APP_CB_RETRY_INTERVAL));
 	}
 }
 
 static void zb_app_cb_process_schedule(struct k_work *item)
 {
-	zb_app_cb_t new_app_cb;
-
-	if (k_msgq_peek(&zb_app_cb_msgq, &new_app_cb)) {
+	if (!zb_app_cb_peek()) {
 		return;
 	}
 
@@ -234,14 +446,21 @@ static void zb_app_cb_process_schedule(struct k_work *item)
 
 	/**
 	 * From working thread, non-ISR context: schedule processing callback.
-	 * Repeat endlessly, because the user was already informed that the
-	 * request will be handled.
+	 * If ZBOSS scheduler queue is full, retry later without blocking
+	 * the workqueue, because the user was already informed that the
+	 * request will be handled. The requests wait in the queue meanwhile
+	 * and new ones are rejected once it is full.
 	 *
 	 * Note: the ZB_SCHEDULE_APP_CALLBACK is thread-safe.
 	 */
-	while (zb_schedule_app_callback(zb_app_cb_process,
-					0, ZB_FALSE, 0, ZB_FALSE) != RET_OK) {
-		k_sleep(K_MSEC(1000));
+	if (zb_schedule_app_callback(zb_app_cb_process,
+				     0, ZB_FALSE, 0, ZB_FALSE) != RET_OK) {
+		(void)atomic_set((atomic_t *)&zb_app_cb_process_scheduled, 0);
+		(void)atomic_inc(&zb_app_cb_stats.zboss_overflows);
+		k_delayed_work_submit(
+			&zb_app_cb_retry_work,
+			K_MSEC(CONFIG_ZIGBEE_APP_CB_RETRY_INTERVAL));
+		return;
 	}
 	zigbee_event_notify(ZIGBEE_EVENT_APP);
 
@@ -251,7 +470,9 @@ static void zb_app_cb_process_schedule(struct k_work *item)
 int zigbee_init(void)
 {
 	/* Initialise work queue for processing app callback and alarms. */
+	zb_app_cb_queue_init();
 	k_work_init(&zb_app_cb_work, zb_app_cb_process_schedule);
+	k_delayed_work_init(&zb_app_cb_retry_work, zb_app_cb_process_schedule);
 
 #if ZB_TRACE_LEVEL
 	/* Set Zigbee stack logging level and traffic dump subsystem. */
@@ -318,6 +539,9 @@ static void zboss_thread(void *arg1, void *arg2, void *arg3)
 
 	while (1) {
 		zboss_main_loop_iteration();
+#ifdef ZB_USE_NVRAM
+		zigbee_nvram_erase_finished_process();
+#endif
 	}
 }
 
@@ -329,12 +553,7 @@ zb_ret_t zigbee_schedule_callback(zb_callback_t func, zb_uint8_t param)
 		.param = param,
 	};
 
-	if (k_msgq_put(&zb_app_cb_msgq, &new_app_cb, K_NO_WAIT)) {
-		return RET_OVERFLOW;
-	}
-
-	k_work_submit(&zb_app_cb_work);
-	return RET_OK;
+	return zb_app_cb_enqueue(&new_app_cb);
 }
 
 zb_ret_t zigbee_schedule_callback2(zb_callback2_t func,
@@ -348,12 +567,7 @@ zb_ret_t zigbee_schedule_callback2(zb_callback2_t func,
 		.user_param = user_param,
 	};
 
-	if (k_msgq_put(&zb_app_cb_msgq, &new_app_cb, K_NO_WAIT)) {
-		return RET_OVERFLOW;
-	}
-
-	k_work_submit(&zb_app_cb_work);
-	return RET_OK;
+	return zb_app_cb_enqueue(&new_app_cb);
 }
 
 zb_ret_t zigbee_schedule_alarm(zb_callback_t func,
@@ -368,12 +582,7 @@ zb_ret_t zigbee_schedule_alarm(zb_callback_t func,
 				   ZB_TIME_BEACON_INTERVAL_TO_MSEC(run_after),
 	};
 
-	if (k_msgq_put(&zb_app_cb_msgq, &new_app_cb, K_NO_WAIT)) {
-		return RET_OVERFLOW;
-	}
-
-	k_work_submit(&zb_app_cb_work);
-	return RET_OK;
+	return zb_app_cb_enqueue(&new_app_cb);
 }
 
 zb_ret_t zigbee_schedule_alarm_cancel(zb_callback_t func, zb_uint8_t param)
@@ -384,12 +593,7 @@ zb_ret_t zigbee_schedule_alarm_cancel(zb_callback_t func, zb_uint8_t param)
 		.param = param,
 	};
 
-	if (k_msgq_put(&zb_app_cb_msgq, &new_app_cb, K_NO_WAIT)) {
-		return RET_OVERFLOW;
-	}
-
-	k_work_submit(&zb_app_cb_work);
-	return RET_OK;
+	return zb_app_cb_enqueue(&new_app_cb);
 }
 
 zb_ret_t zigbee_get_out_buf_delayed(zb_callback_t func)
@@ -399,12 +603,7 @@ zb_ret_t zigbee_get_out_buf_delayed(zb_callback_t func)
 		.func = func,
 	};
 
-	if (k_msgq_put(&zb_app_cb_msgq, &new_app_cb, K_NO_WAIT)) {
-		return RET_OVERFLOW;
-	}
-
-	k_work_submit(&zb_app_cb_work);
-	return RET_OK;
+	return zb_app_cb_enqueue(&new_app_cb);
 }
 
 zb_ret_t zigbee_get_in_buf_delayed(zb_callback_t func)
@@ -414,12 +613,7 @@ zb_ret_t zigbee_get_in_buf_delayed(zb_callback_t func)
 		.func = func,
 	};
 
-	if (k_msgq_put(&zb_app_cb_msgq, &new_app_cb, K_NO_WAIT)) {
-		return RET_OVERFLOW;
-	}
-
-	k_work_submit(&zb_app_cb_work);
-	return RET_OK;
+	return zb_app_cb_enqueue(&new_app_cb);
 }
 
 zb_ret_t zigbee_get_out_buf_delayed_ext(zb_callback2_t func, zb_uint16_t param,
@@ -432,12 +626,7 @@ zb_ret_t zigbee_get_out_buf_delayed_ext(zb_callback2_t func, zb_uint16_t param,
 		.param = max_size,
 	};
 
-	if (k_msgq_put(&zb_app_cb_msgq, &new_app_cb, K_NO_WAIT)) {
-		return RET_OVERFLOW;
-	}
-
-	k_work_submit(&zb_app_cb_work);
-	return RET_OK;
+	return zb_app_cb_enqueue(&new_app_cb);
 }
 
 zb_ret_t zigbee_get_in_buf_delayed_ext(zb_callback2_t func, zb_uint16_t param,
@@ -450,12 +639,7 @@ zb_ret_t zigbee_get_in_buf_delayed_ext(zb_callback2_t func, zb_uint16_t param,
 		.param = max_size,
 	};
 
-	if (k_msgq_put(&zb_app_cb_msgq, &new_app_cb, K_NO_WAIT)) {
-		return RET_OVERFLOW;
-	}
-
-	k_work_submit(&zb_app_cb_work);
-	return RET_OK;
+	return zb_app_cb_enqueue(&new_app_cb);
 }
 
 /**@brief SoC general initialization. */
@@ -15,8 +15,31 @@ typedef enum {
 	ZIGBEE_EVENT_TX_DONE,
 	ZIGBEE_EVENT_RX_DONE,
 	ZIGBEE_EVENT_APP,
+	ZIGBEE_EVENT_NVRAM,
 } zigbee_event_t;
 
+/**@brief Statistics of the application callback queue.
+ *
+ * The queue passes requests of the zigbee_schedule_* and zigbee_get_*
+ * functions to ZBOSS main loop context.
+ */
+struct zigbee_app_cb_stats {
+	/** Number of requests put to the queue. */
+	uint32_t queued;
+	/** Number of requests rejected, because the queue was full. */
+	uint32_t overflows;
+	/** Highest number of requests waiting in the queue. */
+	uint32_t max_depth;
+	/** Number of times the ZBOSS scheduler queue was full. */
+	uint32_t zboss_overflows;
+	/** Number of requests passed to ZBOSS. */
+	uint32_t processed;
+	/** Average time a request waited in the queue, in microseconds. */
+	uint32_t latency_avg_us;
+	/** Longest time a request waited in the queue, in microseconds. */
+	uint32_t latency_max_us;
+};
+
 #ifdef CONFIG_ZIGBEE_DEBUG_FUNCTIONS
 /**@brief Function for suspending zboss thread.
  */
@@ -50,6 +73,38 @@ int zigbee_init(void);
  */
 bool zigbee_is_stack_started(void);
 
+/**@brief Function for getting the application callback queue statistics.
+ *
+ * @param[out] stats  Statistics.
+ */
+void zigbee_app_cb_stats_get(struct zigbee_app_cb_stats *stats);
+
+/**@brief Function for resetting the application callback queue statistics.
+ *
+ * Can be called from any thread. The statistics of processed requests are
+ * updated only in ZBOSS main loop context, so they are cleared there, when
+ * the next request is processed. Until then they are reported as zero.
+ */
+void zigbee_app_cb_stats_reset(void);
+
+/**@brief Function for getting the result of the NVRAM operations.
+ *
+ * Flash writes and erases of the ZBOSS NVRAM are done in a background
+ * thread. The first error is kept until ZBOSS waits for the operations
+ * with zb_osif_nvram_wait_for_last_op or zb_osif_nvram_flush, which log it.
+ *
+ * @return 0 if the operations finished by the last wait succeeded,
+ *         negative error code of the first failed operation otherwise.
+ */
+int zigbee_nvram_result_get(void);
+
+/**@brief Function for reporting the finished NVRAM erase operations to ZBOSS.
+ *
+ * The background thread only marks the erased pages and notifies ZBOSS
+ * thread with ZIGBEE_EVENT_NVRAM. Must be called from ZBOSS main loop context.
+ */
+void zigbee_nvram_erase_finished_process(void);
+
 /* Function for starting Zigbee thread. */
 void zigbee_enable(void);
 
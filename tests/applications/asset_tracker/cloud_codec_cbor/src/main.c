@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <math.h>
+#include <string.h>
+#include <date_time.h>
+#include <tinycbor/cbor.h>
+#include <tinycbor/cbor_buf_reader.h>
+
+#include "cloud_codec.h"
+
+/* Offset added to the uptime by the date_time stub. */
+#define UNIX_TIME_OFFSET 1600000000000LL
+
+static enum cloud_cmd_state gps_state;
+
+/* Stubs for date_time */
+int date_time_uptime_to_unix_time_ms(int64_t *uptime)
+{
+	*uptime += UNIX_TIME_OFFSET;
+
+	return 0;
+}
+
+int date_time_timestamp_clear(int64_t *unix_timestamp)
+{
+	*unix_timestamp = 0;
+
+	return 0;
+}
+
+/* Stub for cloud_codec.c */
+enum cloud_cmd_state cloud_get_channel_enable_state(
+	const enum cloud_channel channel)
+{
+	zassert_equal(channel, CLOUD_CHANNEL_GPS, "Unexpected channel");
+
+	return gps_state;
+}
+
+static struct cbor_buf_reader reader;
+static CborParser parser;
+
+/* Parses the message and enters its root map. */
+static void msg_enter(const struct cloud_msg *msg, CborValue *map)
+{
+	CborValue root;
+	CborError err;
+
+	cbor_buf_reader_init(&reader, (uint8_t *)msg->buf, msg->len);
+	err = cbor_parser_init(&reader.r, 0, &parser, &root);
+	zassert_equal(err, CborNoError, "Invalid message");
+	zassert_true(cbor_value_is_map(&root), "Message is not a map");
+
+	err = cbor_value_enter_container(&root, map);
+	zassert_equal(err, CborNoError, "Invalid map");
+}
+
+static void container_leave(CborValue *parent, CborValue *it)
+{
+	CborError err;
+
+	zassert_true(cbor_value_at_end(it), "Unexpected items");
+	err = cbor_value_leave_container(parent, it);
+	zassert_equal(err, CborNoError, "Invalid container");
+}
+
+static void uint_check(CborValue *it, uint64_t expected)
+{
+	uint64_t val;
+
+	zassert_true(cbor_value_is_unsigned_integer(it), "Not an uint");
+	cbor_value_get_uint64(it, &val);
+	zassert_equal(val, expected, "Unexpected value");
+	zassert_equal(cbor_value_advance_fixed(it), CborNoError, NULL);
+}
+
+static void int_check(CborValue *it, int64_t expected)
+{
+	int64_t val;
+
+	zassert_true(cbor_value_is_integer(it), "Not an integer");
+	cbor_value_get_int64(it, &val);
+	zassert_equal(val, expected, "Unexpected value");
+	zassert_equal(cbor_value_advance_fixed(it), CborNoError, NULL);
+}
+
+static void float_check(CborValue *it, float expected)
+{
+	float val;
+
+	zassert_true(cbor_value_is_float(it), "Not a float");
+	cbor_value_get_float(it, &val);
+	if (isnan(expected)) {
+		zassert_true(isnan(val), "Unexpected value");
+	} else {
+		zassert_equal(val, expected, "Unexpected value");
+	}
+	zassert_equal(cbor_value_advance_fixed(it), CborNoError, NULL);
+}
+
+static void text_check(CborValue *it, const char *expected)
+{
+	char text[32];
+	size_t len = sizeof(text);
+	CborError err;
+
+	zassert_true(cbor_value_is_text_string(it), "Not a text string");
+	err = cbor_value_copy_text_string(it, text, &len, it);
+	zassert_equal(err, CborNoError, "Invalid text string");
+	zassert_equal(len, strlen(expected), "Unexpected length");
+	zassert_mem_equal(text, expected, len, "Unexpected text");
+}
+
+static void header_check(CborValue *map, enum cloud_channel type)
+{
+	uint_check(map, CLOUD_CODEC_CBOR_KEY_CHANNEL);
+	uint_check(map, type);
+	uint_check(map, CLOUD_CODEC_CBOR_KEY_DATA);
+}
+
+static void trailer_check(CborValue *map, enum cloud_cmd_group group,
+			  int64_t ts)
+{
+	uint_check(map, CLOUD_CODEC_CBOR_KEY_GROUP);
+	uint_check(map, group);
+	uint_check(map, CLOUD_CODEC_CBOR_KEY_TS);
+	int_check(map, ts + UNIX_TIME_OFFSET);
+}
+
+static void test_encode_data(void)
+{
+	static char nmea[] = "$GPGGA,123519,4807.038,N";
+	struct cloud_channel_data channel = {
+		.type = CLOUD_CHANNEL_GPS,
+		.data = {
+			.buf = nmea,
+			/* Text is not null terminated in the message. */
+			.len = 6
+		},
+		.ts = 1000
+	};
+	struct cloud_msg msg;
+	CborValue map;
+	int err;
+
+	err = cloud_encode_data(&channel, CLOUD_CMD_GROUP_DATA, &msg);
+	zassert_equal(err, 0, "Encoding failed");
+
+	msg_enter(&msg, &map);
+	header_check(&map, CLOUD_CHANNEL_GPS);
+	text_check(&map, "$GPGGA");
+	trailer_check(&map, CLOUD_CMD_GROUP_DATA, channel.ts);
+	zassert_true(cbor_value_at_end(&map), "Unexpected items");
+
+	k_free(msg.buf);
+}
+
+static void test_encode_values(void)
+{
+	const double values[] = {21.0, -3.0, 21.5, NAN, INFINITY, 1e19};
+	struct cloud_channel_data channel = {
+		.type = CLOUD_CHANNEL_TEMP,
+		.ts = 2000
+	};
+	struct cloud_msg msg;
+	CborValue map;
+	CborValue array;
+	size_t len;
+	int err;
+
+	/* A single value is not an array. */
+	err = cloud_encode_values(&channel, &values[2], 1, &msg);
+	zassert_equal(err, 0, "Encoding failed");
+
+	msg_enter(&msg, &map);
+	header_check(&map, CLOUD_CHANNEL_TEMP);
+	float_check(&map, 21.5f);
+	trailer_check(&map, CLOUD_CMD_GROUP_DATA, channel.ts);
+	k_free(msg.buf);
+
+	/* Integral values are integers. Values that are not finite or do not
+	 * fit in an integer are floats.
+	 */
+	channel.type = CLOUD_CHANNEL_ENVIRONMENT;
+	err = cloud_encode_values(&channel, values, ARRAY_SIZE(values), &msg);
+	zassert_equal(err, 0, "Encoding failed");
+
+	msg_enter(&msg, &map);
+	header_check(&map, CLOUD_CHANNEL_ENVIRONMENT);
+	zassert_true(cbor_value_is_array(&map), "Not an array");
+	cbor_value_get_array_length(&map, &len);
+	zassert_equal(len, ARRAY_SIZE(values), "Unexpected array length");
+	zassert_equal(cbor_value_enter_container(&map, &array), CborNoError,
+		      NULL);
+	int_check(&array, 21);
+	int_check(&array, -3);
+	float_check(&array, 21.5f);
+	float_check(&array, NAN);
+	float_check(&array, INFINITY);
+	float_check(&array, 1e19f);
+	container_leave(&map, &array);
+	trailer_check(&map, CLOUD_CMD_GROUP_DATA, channel.ts);
+	zassert_true(cbor_value_at_end(&map), "Unexpected items");
+
+	k_free(msg.buf);
+}
+
+static void test_encode_config(void)
+{
+	struct cloud_msg msg;
+	CborValue map;
+	CborValue config_map;
+	CborValue chan_map;
+	bool enabled;
+	int err;
+
+	/* Nothing is encoded if the state is not known. */
+	gps_state = CLOUD_CMD_STATE_UNDEFINED;
+	err = cloud_encode_config_data(&msg);
+	zassert_equal(err, 0, "Encoding failed");
+	zassert_is_null(msg.buf, "Message encoded");
+	zassert_equal(msg.len, 0, "Message encoded");
+
+	gps_state = CLOUD_CMD_STATE_TRUE;
+	err = cloud_encode_config_data(&msg);
+	zassert_equal(err, 0, "Encoding failed");
+
+	msg_enter(&msg, &map);
+	uint_check(&map, CLOUD_CODEC_CBOR_KEY_CONFIG);
+	zassert_equal(cbor_value_enter_container(&map, &config_map),
+		      CborNoError, NULL);
+	uint_check(&config_map, CLOUD_CHANNEL_GPS);
+	zassert_equal(cbor_value_enter_container(&config_map, &chan_map),
+		      CborNoError, NULL);
+	uint_check(&chan_map, CLOUD_CMD_ENABLE);
+	zassert_true(cbor_value_is_boolean(&chan_map), "Not a boolean");
+	cbor_value_get_boolean(&chan_map, &enabled);
+	zassert_true(enabled, "Unexpected state");
+	zassert_equal(cbor_value_advance_fixed(&chan_map), CborNoError, NULL);
+	container_leave(&config_map, &chan_map);
+	container_leave(&map, &config_map);
+	zassert_true(cbor_value_at_end(&map), "Unexpected items");
+
+	k_free(msg.buf);
+}
+
+static void test_encode_device_status(void)
+{
+	const char *const ui[] = {"GPS", NULL, "TEMP"};
+	const char *const fota[] = {"APP"};
+	struct cloud_msg msg;
+	CborValue map;
+	CborValue device_map;
+	CborValue service_map;
+	CborValue array;
+	int err;
+
+	err = cloud_encode_device_status_data(NULL, ui, ARRAY_SIZE(ui),
+					      fota, ARRAY_SIZE(fota), 2, &msg);
+	zassert_equal(err, 0, "Encoding failed");
+
+	msg_enter(&msg, &map);
+	uint_check(&map, CLOUD_CODEC_CBOR_KEY_DEVICE);
+	zassert_equal(cbor_value_enter_container(&map, &device_map),
+		      CborNoError, NULL);
+	uint_check(&device_map, CLOUD_CODEC_CBOR_KEY_SERVICE_INFO);
+	zassert_equal(cbor_value_enter_container(&device_map, &service_map),
+		      CborNoError, NULL);
+
+	/* Missing items are skipped. */
+	uint_check(&service_map, CLOUD_CODEC_CBOR_KEY_UI);
+	zassert_equal(cbor_value_enter_container(&service_map, &array),
+		      CborNoError, NULL);
+	text_check(&array, "GPS");
+	text_check(&array, "TEMP");
+	container_leave(&service_map, &array);
+
+	uint_check(&service_map, CLOUD_CODEC_CBOR_KEY_FOTA);
+	zassert_equal(cbor_value_enter_container(&service_map, &array),
+		      CborNoError, NULL);
+	text_check(&array, "APP");
+	container_leave(&service_map, &array);
+
+	uint_check(&service_map, CLOUD_CODEC_CBOR_KEY_FOTA_VERSION);
+	uint_check(&service_map, 2);
+	container_leave(&device_map, &service_map);
+	container_leave(&map, &device_map);
+	zassert_true(cbor_value_at_end(&map), "Unexpected items");
+
+	k_free(msg.buf);
+}
+
+static void test_encode_too_long(void)
+{
+	static char data[CONFIG_CLOUD_CODEC_CBOR_BUF_SIZE];
+	struct cloud_channel_data channel = {
+		.type = CLOUD_CHANNEL_MODEM,
+		.data = {
+			.buf = data,
+			.len = sizeof(data)
+		}
+	};
+	struct cloud_msg msg;
+	int err;
+
+	memset(data, 'A', sizeof(data));
+	err = cloud_encode_data(&channel, CLOUD_CMD_GROUP_DATA, &msg);
+	zassert_equal(err, -ENOMEM, "Unexpected err:%d", err);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(cloud_codec_cbor_test,
+			 ztest_unit_test(test_encode_data),
+			 ztest_unit_test(test_encode_values),
+			 ztest_unit_test(test_encode_config),
+			 ztest_unit_test(test_encode_device_status),
+			 ztest_unit_test(test_encode_too_long)
+			 );
+
+	ztest_run_test_suite(cloud_codec_cbor_test);
+}
@@ -0,0 +1,438 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <sys/byteorder.h>
+
+#include "event_manager.h"
+#include "config_channel_transport.h"
+#include "hid_report_desc.h"
+
+/* Report layout, as used by the host. */
+#define HEADER_SIZE		4
+#define STATUS_POS		2
+#define DATA_LEN_POS		3
+#define SEQ_POS			HEADER_SIZE
+#define WINDOWED_HEADER_SIZE	(HEADER_SIZE + 1)
+#define FRAME_WINDOWED		BIT(7)
+#define FRAME_MORE		BIT(6)
+#define FRAME_DATA_LEN_MASK	BIT_MASK(5)
+
+#define LEGACY_DATA_MAX		(REPORT_SIZE_USER_CONFIG - HEADER_SIZE)
+#define WINDOWED_DATA_MAX	(REPORT_SIZE_USER_CONFIG - WINDOWED_HEADER_SIZE)
+#define WINDOW_SIZE		CONFIG_DESKTOP_CONFIG_CHANNEL_WINDOW
+#define PAYLOAD_MAX		CONFIG_DESKTOP_CONFIG_CHANNEL_PAYLOAD_MAX
+#define TIMEOUT_MS	(CONFIG_DESKTOP_CONFIG_CHANNEL_TIMEOUT * MSEC_PER_SEC)
+
+#define EVENT_ID		0x12
+#define REQUESTS_MAX		128
+
+/* Model used to compare the framings. A report is transferred in every
+ * USB frame and the module handles the requests one by one.
+ */
+#define TRANSFER_TIME_MS	1
+#define PROCESS_TIME_MS		2
+#define BENCH_DATA_SIZE		2400
+
+struct request {
+	uint16_t transport_id;
+	uint8_t recipient;
+	uint8_t event_id;
+	uint8_t status;
+	size_t size;
+	uint8_t data[PAYLOAD_MAX];
+	int64_t ready_time;
+};
+
+static struct config_channel_transport transport;
+
+/* Requests submitted by the transport, in order. */
+static struct request requests[REQUESTS_MAX];
+static size_t req_cnt;
+static size_t req_handled;
+static int64_t module_busy_until;
+
+static uint8_t data_buf[BENCH_DATA_SIZE];
+
+static void transport_reset(void)
+{
+	config_channel_transport_disconnect(&transport);
+	req_cnt = 0;
+	req_handled = 0;
+	module_busy_until = 0;
+}
+
+/* Lets the Event Manager deliver the submitted requests. */
+static void transfer(void)
+{
+	k_sleep(K_MSEC(TRANSFER_TIME_MS));
+}
+
+static int legacy_send(uint8_t status, const uint8_t *data, size_t len)
+{
+	uint8_t buf[REPORT_SIZE_USER_CONFIG] = {0};
+
+	zassert_true(len <= LEGACY_DATA_MAX, NULL);
+
+	buf[0] = CFG_CHAN_RECIPIENT_LOCAL;
+	buf[1] = EVENT_ID;
+	buf[STATUS_POS] = status;
+	buf[DATA_LEN_POS] = len;
+	memcpy(&buf[HEADER_SIZE], data, len);
+
+	int err = config_channel_transport_set(&transport, buf, sizeof(buf));
+
+	transfer();
+
+	return err;
+}
+
+static int windowed_send(uint8_t status, uint8_t seq, const uint8_t *data,
+			 size_t len)
+{
+	size_t pos = 0;
+
+	/* A request without data is sent in a single frame too. */
+	do {
+		uint8_t buf[REPORT_SIZE_USER_CONFIG] = {0};
+		size_t frame_len = MIN(len - pos, WINDOWED_DATA_MAX);
+		bool more = (pos + frame_len < len);
+
+		buf[0] = CFG_CHAN_RECIPIENT_LOCAL;
+		buf[1] = EVENT_ID;
+		buf[STATUS_POS] = status;
+		buf[DATA_LEN_POS] = FRAME_WINDOWED | frame_len;
+		if (more) {
+			buf[DATA_LEN_POS] |= FRAME_MORE;
+		}
+		buf[SEQ_POS] = seq;
+		memcpy(&buf[WINDOWED_HEADER_SIZE], &data[pos], frame_len);
+		pos += frame_len;
+
+		int err = config_channel_transport_set(&transport, buf,
+						       sizeof(buf));
+
+		transfer();
+
+		if (err) {
+			return err;
+		}
+	} while (pos < len);
+
+	return 0;
+}
+
+static uint8_t rsp_get(uint8_t *buf)
+{
+	int err = config_channel_transport_get(&transport, buf,
+					       REPORT_SIZE_USER_CONFIG);
+
+	zassert_equal(err, 0, "Cannot get response");
+	transfer();
+
+	return buf[STATUS_POS];
+}
+
+static bool respond(const struct request *req, enum config_status status)
+{
+	struct config_event *rsp = new_config_event(0);
+
+	rsp->transport_id = req->transport_id;
+	rsp->recipient = req->recipient;
+	rsp->event_id = req->event_id;
+	rsp->status = status;
+	rsp->is_request = false;
+
+	bool consumed = config_channel_transport_rsp_receive(&transport, rsp);
+
+	k_free(rsp);
+
+	return consumed;
+}
+
+/* Responds to the requests that the module has finished handling. */
+static void module_process(void)
+{
+	while ((req_handled < req_cnt) &&
+	       (requests[req_handled].ready_time <= k_uptime_get())) {
+		zassert_true(respond(&requests[req_handled],
+				     CONFIG_STATUS_SUCCESS), NULL);
+		req_handled++;
+	}
+}
+
+static void test_legacy(void)
+{
+	static const uint8_t data[] = {1, 2, 3};
+	uint8_t buf[REPORT_SIZE_USER_CONFIG];
+
+	transport_reset();
+
+	zassert_equal(legacy_send(CONFIG_STATUS_SET, data, sizeof(data)), 0,
+		      NULL);
+	zassert_equal(req_cnt, 1, "Request not submitted");
+	zassert_equal(requests[0].size, sizeof(data), NULL);
+	zassert_mem_equal(requests[0].data, data, sizeof(data), NULL);
+
+	zassert_equal(rsp_get(buf), CONFIG_STATUS_PENDING, NULL);
+	zassert_equal(legacy_send(CONFIG_STATUS_SET, data, sizeof(data)),
+		      -EBUSY, "Request accepted while busy");
+
+	zassert_true(respond(&requests[0], CONFIG_STATUS_SUCCESS), NULL);
+	zassert_equal(rsp_get(buf), CONFIG_STATUS_SUCCESS, NULL);
+	zassert_equal(buf[1], EVENT_ID, NULL);
+	zassert_equal(buf[DATA_LEN_POS], 0, NULL);
+}
+
+static void test_windowed_order(void)
+{
+	uint8_t buf[REPORT_SIZE_USER_CONFIG];
+
+	transport_reset();
+
+	for (size_t i = 0; i < WINDOW_SIZE; i++) {
+		zassert_equal(windowed_send(CONFIG_STATUS_SET, 10 + i, NULL, 0),
+			      0, NULL);
+	}
+
+	zassert_equal(windowed_send(CONFIG_STATUS_SET, 10 + WINDOW_SIZE,
+				    NULL, 0),
+		      -EBUSY, "Request accepted with full window");
+	zassert_equal(req_cnt, WINDOW_SIZE, NULL);
+
+	/* Responses are provided in the order of requests. */
+	for (size_t i = WINDOW_SIZE - 1; i > 0; i--) {
+		zassert_true(respond(&requests[i], CONFIG_STATUS_SUCCESS),
+			     NULL);
+	}
+
+	zassert_equal(rsp_get(buf), CONFIG_STATUS_PENDING, NULL);
+	zassert_equal(buf[SEQ_POS], 10, NULL);
+
+	zassert_true(respond(&requests[0], CONFIG_STATUS_SUCCESS), NULL);
+
+	for (size_t i = 0; i < WINDOW_SIZE; i++) {
+		zassert_equal(rsp_get(buf), CONFIG_STATUS_SUCCESS, NULL);
+		zassert_equal(buf[DATA_LEN_POS], FRAME_WINDOWED, NULL);
+		zassert_equal(buf[SEQ_POS], 10 + i, "Wrong response order");
+	}
+}
+
+static void test_windowed_frames(void)
+{
+	uint8_t buf[REPORT_SIZE_USER_CONFIG];
+
+	transport_reset();
+
+	zassert_equal(windowed_send(CONFIG_STATUS_GET_WINDOW, 1, NULL, 0), 0,
+		      NULL);
+	zassert_equal(req_cnt, 0, "Window request submitted");
+	zassert_equal(rsp_get(buf), CONFIG_STATUS_SUCCESS, NULL);
+	zassert_equal(buf[DATA_LEN_POS] & FRAME_DATA_LEN_MASK, 3, NULL);
+	zassert_equal(buf[WINDOWED_HEADER_SIZE], WINDOW_SIZE, NULL);
+	zassert_equal(sys_get_le16(&buf[WINDOWED_HEADER_SIZE + 1]),
+		      PAYLOAD_MAX, NULL);
+
+	for (size_t i = 0; i < PAYLOAD_MAX + 1; i++) {
+		data_buf[i] = i;
+	}
+
+	/* Data of a request is collected from multiple frames. */
+	zassert_equal(windowed_send(CONFIG_STATUS_SET, 2, data_buf,
+				    PAYLOAD_MAX),
+		      0, NULL);
+	zassert_equal(req_cnt, 1, "Request not submitted");
+	zassert_equal(requests[0].size, PAYLOAD_MAX, NULL);
+	zassert_mem_equal(requests[0].data, data_buf, PAYLOAD_MAX, NULL);
+
+	zassert_true(respond(&requests[0], CONFIG_STATUS_SUCCESS), NULL);
+	zassert_equal(rsp_get(buf), CONFIG_STATUS_SUCCESS, NULL);
+	zassert_equal(buf[SEQ_POS], 2, NULL);
+
+	/* Requests that are too long are rejected. */
+	zassert_equal(windowed_send(CONFIG_STATUS_SET, 3, data_buf,
+				    PAYLOAD_MAX + 1),
+		      -EMSGSIZE, NULL);
+	zassert_equal(req_cnt, 1, "Too long request submitted");
+	zassert_equal(rsp_get(buf), CONFIG_STATUS_REJECT, NULL);
+	zassert_equal(buf[SEQ_POS], 3, NULL);
+}
+
+static void test_timeout(void)
+{
+	uint8_t buf[REPORT_SIZE_USER_CONFIG];
+
+	transport_reset();
+
+	zassert_equal(windowed_send(CONFIG_STATUS_SET, 1, NULL, 0), 0, NULL);
+	k_sleep(K_MSEC(TIMEOUT_MS * 3 / 5));
+
+	/* Requests that follow do not extend the timeout of the first one. */
+	zassert_equal(windowed_send(CONFIG_STATUS_SET, 2, NULL, 0), 0, NULL);
+	k_sleep(K_MSEC(TIMEOUT_MS * 3 / 5));
+
+	zassert_equal(rsp_get(buf), CONFIG_STATUS_TIMEOUT, NULL);
+	zassert_equal(buf[SEQ_POS], 1, NULL);
+	zassert_equal(rsp_get(buf), CONFIG_STATUS_PENDING, NULL);
+	zassert_equal(buf[SEQ_POS], 2, NULL);
+
+	/* Responses for transactions that timed out are not for us. */
+	zassert_false(respond(&requests[0], CONFIG_STATUS_SUCCESS), NULL);
+
+	k_sleep(K_MSEC(TIMEOUT_MS * 3 / 5));
+
+	zassert_equal(rsp_get(buf), CONFIG_STATUS_TIMEOUT, NULL);
+	zassert_equal(buf[SEQ_POS], 2, NULL);
+}
+
+static uint32_t bench_legacy(size_t *transfers)
+{
+	uint8_t buf[REPORT_SIZE_USER_CONFIG];
+	int64_t start = k_uptime_get();
+	size_t pos = 0;
+
+	while (pos < sizeof(data_buf)) {
+		size_t len = MIN(sizeof(data_buf) - pos, LEGACY_DATA_MAX);
+		uint8_t status;
+
+		zassert_equal(legacy_send(CONFIG_STATUS_SET, &data_buf[pos],
+					  len),
+			      0, NULL);
+		(*transfers)++;
+		pos += len;
+
+		do {
+			module_process();
+			status = rsp_get(buf);
+			(*transfers)++;
+		} while (status == CONFIG_STATUS_PENDING);
+
+		zassert_equal(status, CONFIG_STATUS_SUCCESS, NULL);
+	}
+
+	return k_uptime_get() - start;
+}
+
+static uint32_t bench_windowed(size_t *transfers)
+{
+	uint8_t buf[REPORT_SIZE_USER_CONFIG];
+	int64_t start = k_uptime_get();
+	size_t pos = 0;
+	size_t in_flight = 0;
+	uint8_t seq = 0;
+	uint8_t rsp_seq = 0;
+
+	while ((pos < sizeof(data_buf)) || (in_flight > 0)) {
+		if ((pos < sizeof(data_buf)) && (in_flight < WINDOW_SIZE)) {
+			size_t len = MIN(sizeof(data_buf) - pos, PAYLOAD_MAX);
+
+			zassert_equal(windowed_send(CONFIG_STATUS_SET, seq,
+						    &data_buf[pos], len),
+				      0, NULL);
+			*transfers += DIV_ROUND_UP(len, WINDOWED_DATA_MAX);
+			pos += len;
+			seq++;
+			in_flight++;
+		} else {
+			module_process();
+			uint8_t status = rsp_get(buf);
+
+			(*transfers)++;
+
+			if (status != CONFIG_STATUS_PENDING) {
+				zassert_equal(status, CONFIG_STATUS_SUCCESS,
+					      NULL);
+				zassert_equal(buf[SEQ_POS], rsp_seq,
+					      "Wrong response order");
+				rsp_seq++;
+				in_flight--;
+			}
+		}
+	}
+
+	return k_uptime_get() - start;
+}
+
+static void test_windowed_benchmark(void)
+{
+	size_t legacy_transfers = 0;
+	size_t windowed_transfers = 0;
+
+	for (size_t i = 0; i < sizeof(data_buf); i++) {
+		data_buf[i] = i;
+	}
+
+	transport_reset();
+	uint32_t legacy_ms = bench_legacy(&legacy_transfers);
+
+	transport_reset();
+	uint32_t windowed_ms = bench_windowed(&windowed_transfers);
+
+	printk("%u bytes, %u ms per transfer, %u ms per request\n",
+	       BENCH_DATA_SIZE, TRANSFER_TIME_MS, PROCESS_TIME_MS);
+	printk("legacy: %u ms, %zu transfers\n", legacy_ms, legacy_transfers);
+	printk("windowed: %u ms, %zu transfers\n", windowed_ms,
+	       windowed_transfers);
+
+	zassert_true(windowed_ms < legacy_ms, "Windowed requests not faster");
+}
+
+static bool event_handler(const struct event_header *eh)
+{
+	if (is_config_event(eh)) {
+		const struct config_event *event = cast_config_event(eh);
+
+		zassert_true(event->is_request, "Unexpected response");
+		zassert_true(req_cnt < ARRAY_SIZE(requests),
+			     "Too many requests");
+		zassert_true(event->dyndata.size <= PAYLOAD_MAX, NULL);
+
+		struct request *req = &requests[req_cnt];
+
+		req->transport_id = event->transport_id;
+		req->recipient = event->recipient;
+		req->event_id = event->event_id;
+		req->status = event->status;
+		req->size = event->dyndata.size;
+		memcpy(req->data, event->dyndata.data, event->dyndata.size);
+
+		module_busy_until = MAX(module_busy_until, k_uptime_get()) +
+				    PROCESS_TIME_MS;
+		req->ready_time = module_busy_until;
+
+		req_cnt++;
+
+		return false;
+	}
+
+	zassert_unreachable("Unexpected event");
+
+	return false;
+}
+
+EVENT_LISTENER(test, event_handler);
+EVENT_SUBSCRIBE(test, config_event);
+
+void test_main(void)
+{
+	int err = event_manager_init();
+
+	zassert_equal(err, 0, "Event Manager not initialized");
+
+	config_channel_transport_init(&transport);
+
+	ztest_test_suite(config_channel_transport_test,
+			 ztest_unit_test(test_legacy),
+			 ztest_unit_test(test_windowed_order),
+			 ztest_unit_test(test_windowed_frames),
+			 ztest_unit_test(test_timeout),
+			 ztest_unit_test(test_windowed_benchmark)
+			 );
+
+	ztest_run_test_suite(config_channel_transport_test);
+}
@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <sys/byteorder.h>
+
+#include "event_manager.h"
+
+/* The module is included to access the state of the LEDs. */
+#include "led_stream.c"
+
+#define SUBSTEP_COUNT 10
+#define SUBSTEP_TIME 5
+#define FRAME_SIZE_MAX 64
+#define PLAYED_MAX 32
+
+struct frame {
+	uint8_t data[FRAME_SIZE_MAX];
+	size_t size;
+};
+
+/* Identifies the leds module in the module state events. */
+const void * const _CONCAT(__module_, leds) = "leds";
+
+static const struct led_effect_step state_step = {
+	.color = LED_COLOR(1, 2, 3),
+	.substep_count = 1,
+};
+
+static const struct led_effect state_effect = {
+	.steps = &state_step,
+	.step_count = 1,
+	.loop_forever = true,
+};
+
+/* Effects last sent to the LEDs. */
+static const struct led_effect *shown[CONFIG_DESKTOP_LED_COUNT];
+
+static uint8_t played[PLAYED_MAX][INCOMING_LED_COLOR_COUNT];
+
+static void frame_start(struct frame *frame, uint8_t led_id, uint8_t seq)
+{
+	frame->data[0] = led_id;
+	frame->data[1] = seq;
+	frame->size = FRAME_HEADER_SIZE;
+}
+
+static void frame_step_data(struct frame *frame, const uint8_t *color)
+{
+	zassert_true(frame->size + FRAME_STEP_SIZE <= sizeof(frame->data),
+		     NULL);
+
+	memcpy(&frame->data[frame->size], color, INCOMING_LED_COLOR_COUNT);
+	frame->size += INCOMING_LED_COLOR_COUNT;
+	sys_put_le16(SUBSTEP_COUNT, &frame->data[frame->size]);
+	frame->size += sizeof(uint16_t);
+	sys_put_le16(SUBSTEP_TIME, &frame->data[frame->size]);
+	frame->size += sizeof(uint16_t);
+}
+
+static void frame_step(struct frame *frame, const uint8_t *color)
+{
+	frame->data[frame->size++] = FRAME_TAG_STEP;
+	frame_step_data(frame, color);
+}
+
+static void frame_delta(struct frame *frame, const uint8_t *prev,
+			const uint8_t *color)
+{
+	zassert_true(frame->size + 1 + FRAME_DELTA_SIZE <= sizeof(frame->data),
+		     NULL);
+
+	frame->data[frame->size++] = FRAME_TAG_DELTA;
+
+	for (size_t i = 0; i < INCOMING_LED_COLOR_COUNT; i++) {
+		frame->data[frame->size++] = color[i] - prev[i];
+	}
+}
+
+static void frame_play(struct frame *frame, uint8_t effect_id)
+{
+	frame->data[frame->size++] = FRAME_TAG_PLAY;
+	frame->data[frame->size++] = effect_id;
+}
+
+static void frame_define(struct frame *frame, uint8_t effect_id, uint8_t first,
+			 const uint8_t (*colors)[INCOMING_LED_COLOR_COUNT],
+			 uint8_t cnt)
+{
+	frame->data[frame->size++] = FRAME_TAG_DEFINE;
+	frame->data[frame->size++] = effect_id;
+	frame->data[frame->size++] = first;
+	frame->data[frame->size++] = cnt;
+
+	for (size_t i = 0; i < cnt; i++) {
+		frame_step_data(frame, colors[i]);
+	}
+}
+
+static void frame_send(const struct frame *frame)
+{
+	config_set(LED_STREAM_OPT_SET_LED_FRAMES, frame->data, frame->size);
+
+	/* Let the Event Manager deliver the LED events. */
+	k_sleep(K_MSEC(1));
+}
+
+static void stream_state_check(uint8_t led_id, uint8_t seq, uint8_t free)
+{
+	uint8_t data[CONFIG_CHANNEL_FETCHED_DATA_MAX_SIZE];
+	size_t size = 0;
+
+	config_get(LED_STREAM_OPT_GET_STREAM_STATE, data, &size);
+
+	zassert_equal(size, 1 + 2 * CONFIG_DESKTOP_LED_COUNT, NULL);
+	zassert_true(data[0], "LED stream not initialized");
+	zassert_equal(data[1 + 2 * led_id], seq, "Wrong sequence number");
+	zassert_equal(data[2 + 2 * led_id], free, "Wrong free places");
+}
+
+/* Displays the queued steps, as the leds module does, and returns their
+ * number.
+ */
+static size_t stream_play(uint8_t led_id)
+{
+	size_t cnt = 0;
+
+	while (leds[led_id].streaming) {
+		const struct led_effect *effect = shown[led_id];
+
+		zassert_not_null(effect, NULL);
+		zassert_not_equal(effect, &state_effect, NULL);
+
+		for (size_t i = 0; i < effect->step_count; i++) {
+			zassert_true(cnt < ARRAY_SIZE(played), NULL);
+			memcpy(played[cnt], effect->steps[i].color.c,
+			       INCOMING_LED_COLOR_COUNT);
+			cnt++;
+		}
+
+		struct led_ready_event *event = new_led_ready_event();
+
+		event->led_id = led_id;
+		event->led_effect = effect;
+		EVENT_SUBMIT(event);
+
+		k_sleep(K_MSEC(1));
+	}
+
+	zassert_equal_ptr(shown[led_id], &state_effect,
+			  "State effect not restored");
+
+	return cnt;
+}
+
+static void played_check(const void *colors, size_t cnt, size_t played_cnt)
+{
+	zassert_equal(played_cnt, cnt, "Wrong number of steps played");
+	zassert_mem_equal(played, colors, cnt * INCOMING_LED_COLOR_COUNT,
+			  "Wrong steps played");
+}
+
+static void led_stream_reset(void)
+{
+	memset(leds, 0, sizeof(leds));
+	memset(effects, 0, sizeof(effects));
+	memset(shown, 0, sizeof(shown));
+
+	for (size_t i = 0; i < ARRAY_SIZE(leds); i++) {
+		struct led_event *event = new_led_event();
+
+		event->led_id = i;
+		event->led_effect = &state_effect;
+		EVENT_SUBMIT(event);
+	}
+
+	k_sleep(K_MSEC(1));
+}
+
+static void test_frames_steps(void)
+{
+	static const uint8_t colors[][INCOMING_LED_COLOR_COUNT] = {
+		{250, 0, 10},
+		{4, 1, 0},
+		{4, 1, 0},
+		{0, 255, 128},
+	};
+	struct frame frame;
+
+	led_stream_reset();
+
+	frame_start(&frame, 1, 0);
+	frame_step(&frame, colors[0]);
+	/* Color changes wrap around. */
+	frame_delta(&frame, colors[0], colors[1]);
+	frame_delta(&frame, colors[1], colors[2]);
+	frame_step(&frame, colors[3]);
+	frame_send(&frame);
+
+	stream_state_check(1, ARRAY_SIZE(colors),
+			   CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE -
+			   ARRAY_SIZE(colors));
+	stream_state_check(0, 0, CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE);
+	zassert_equal_ptr(shown[0], &state_effect, "Wrong LED streaming");
+
+	played_check(colors, ARRAY_SIZE(colors), stream_play(1));
+	stream_state_check(1, ARRAY_SIZE(colors),
+			   CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE);
+}
+
+static void test_frames_resend(void)
+{
+	static const uint8_t colors[][INCOMING_LED_COLOR_COUNT] = {
+		{10, 20, 30},
+		{11, 22, 33},
+		{12, 24, 36},
+		{13, 26, 39},
+		{14, 28, 42},
+	};
+	struct frame frame;
+
+	led_stream_reset();
+
+	frame_start(&frame, 0, 0);
+	frame_step(&frame, colors[0]);
+	frame_delta(&frame, colors[0], colors[1]);
+	frame_delta(&frame, colors[1], colors[2]);
+	frame_send(&frame);
+	stream_state_check(0, 3, CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE - 3);
+
+	/* A repeated frame is ignored. */
+	frame_send(&frame);
+	stream_state_check(0, 3, CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE - 3);
+
+	/* A frame starting after the next step is rejected. */
+	frame_start(&frame, 0, 4);
+	frame_step(&frame, colors[4]);
+	frame_send(&frame);
+	stream_state_check(0, 3, CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE - 3);
+
+	/* The host sends again from the last acknowledged step. The steps
+	 * that were received are skipped and the deltas still apply to the
+	 * last queued step.
+	 */
+	frame_start(&frame, 0, 1);
+	frame_delta(&frame, colors[0], colors[1]);
+	frame_delta(&frame, colors[1], colors[2]);
+	frame_delta(&frame, colors[2], colors[3]);
+	frame_delta(&frame, colors[3], colors[4]);
+	frame_send(&frame);
+	stream_state_check(0, 5, CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE - 5);
+
+	played_check(colors, ARRAY_SIZE(colors), stream_play(0));
+}
+
+static void test_frames_queue_full(void)
+{
+	uint8_t colors[CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE + 2]
+		      [INCOMING_LED_COLOR_COUNT];
+	struct frame frame;
+
+	led_stream_reset();
+
+	for (size_t i = 0; i < ARRAY_SIZE(colors); i++) {
+		colors[i][0] = i;
+		colors[i][1] = 2 * i;
+		colors[i][2] = 255 - i;
+	}
+
+	frame_start(&frame, 0, 0);
+	frame_step(&frame, colors[0]);
+	for (size_t i = 1; i < ARRAY_SIZE(colors); i++) {
+		frame_delta(&frame, colors[i - 1], colors[i]);
+	}
+	frame_send(&frame);
+
+	/* Steps that do not fit are dropped. */
+	stream_state_check(0, CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE, 0);
+
+	played_check(colors, CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE,
+		     stream_play(0));
+
+	/* The host sends the dropped steps again. */
+	frame_start(&frame, 0, CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE);
+	frame_step(&frame, colors[CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE]);
+	frame_delta(&frame, colors[CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE],
+		    colors[CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE + 1]);
+	frame_send(&frame);
+	stream_state_check(0, ARRAY_SIZE(colors),
+			   CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE - 2);
+
+	played_check(&colors[CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE], 2,
+		     stream_play(0));
+}
+
+static void test_frames_effects(void)
+{
+	static const uint8_t effect[][INCOMING_LED_COLOR_COUNT] = {
+		{255, 0, 0},
+		{0, 255, 0},
+		{0, 0, 255},
+	};
+	static const uint8_t other[][INCOMING_LED_COLOR_COUNT] = {
+		{7, 7, 7},
+	};
+	static const uint8_t step[INCOMING_LED_COLOR_COUNT] = {100, 50, 25};
+	static const uint8_t expected[][INCOMING_LED_COLOR_COUNT] = {
+		{255, 0, 0},
+		{0, 255, 0},
+		{0, 0, 255},
+		{100, 50, 25},
+		{255, 0, 0},
+		{0, 255, 0},
+		{0, 0, 255},
+		{255, 0, 0},
+		{0, 255, 0},
+		{0, 0, 255},
+	};
+	struct frame frame;
+
+	led_stream_reset();
+
+	/* The definition is split into records, as done by the host. */
+	frame_start(&frame, 0, 0);
+	frame_define(&frame, 0, 0, &effect[0], 2);
+	frame_define(&frame, 0, 2, &effect[2], 1);
+	frame_play(&frame, 0);
+	frame_step(&frame, step);
+	frame_play(&frame, 0);
+	frame_send(&frame);
+	stream_state_check(0, 3, CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE - 3);
+	zassert_equal(effects[0].users, 2, NULL);
+
+	/* An effect that is displayed cannot be redefined. */
+	frame_start(&frame, 0, 3);
+	frame_define(&frame, 0, 0, other, 1);
+	frame_play(&frame, 0);
+	frame_send(&frame);
+	stream_state_check(0, 4, CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE - 4);
+
+	/* Effects that are not defined are not displayed. */
+	frame_start(&frame, 0, 4);
+	frame_play(&frame, 1);
+	frame_send(&frame);
+	stream_state_check(0, 4, CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE - 4);
+
+	/* Definitions longer than the effect are rejected. */
+	frame_start(&frame, 0, 4);
+	frame_define(&frame, 1, CONFIG_DESKTOP_LED_STREAM_EFFECT_STEPS - 1,
+		     effect, 2);
+	frame_play(&frame, 1);
+	frame_send(&frame);
+	stream_state_check(0, 4, CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE - 4);
+
+	played_check(expected, ARRAY_SIZE(expected), stream_play(0));
+	zassert_equal(effects[0].users, 0, NULL);
+
+	/* The effect can be redefined once it is no longer displayed. */
+	frame_start(&frame, 0, 4);
+	frame_define(&frame, 0, 0, other, 1);
+	frame_play(&frame, 0);
+	frame_send(&frame);
+	stream_state_check(0, 5, CONFIG_DESKTOP_LED_STREAM_QUEUE_SIZE - 1);
+
+	played_check(other, ARRAY_SIZE(other), stream_play(0));
+}
+
+static bool test_event_handler(const struct event_header *eh)
+{
+	if (is_led_event(eh)) {
+		const struct led_event *event = cast_led_event(eh);
+
+		shown[event->led_id] = event->led_effect;
+
+		return false;
+	}
+
+	zassert_unreachable("Unexpected event");
+
+	return false;
+}
+
+EVENT_LISTENER(test, test_event_handler);
+EVENT_SUBSCRIBE(test, led_event);
+
+void test_main(void)
+{
+	int err = event_manager_init();
+
+	zassert_equal(err, 0, "Event Manager not initialized");
+
+	struct module_state_event *event = new_module_state_event();
+
+	event->module_id = MODULE_ID(leds);
+	event->state = MODULE_STATE_READY;
+	EVENT_SUBMIT(event);
+
+	k_sleep(K_MSEC(1));
+
+	ztest_test_suite(led_stream_test,
+			 ztest_unit_test(test_frames_steps),
+			 ztest_unit_test(test_frames_resend),
+			 ztest_unit_test(test_frames_queue_full),
+			 ztest_unit_test(test_frames_effects)
+			 );
+
+	ztest_run_test_suite(led_stream_test);
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <bench_time.h>
+
+#include "motion_filter.h"
+
+#define BENCH_SAMPLES 10000
+
+/* Sample period of a mouse sending a report every 1 ms. */
+#define SAMPLE_DT 1000
+
+static struct motion_filter_lift lift;
+static struct motion_filter_accel accel;
+static struct motion_filter_snap snap;
+static struct motion_filter_sample samples[BENCH_SAMPLES];
+static bool kept[BENCH_SAMPLES];
+
+static void sample_set(struct motion_filter_sample *sample, int32_t dx,
+		       int32_t dy, uint32_t dt, uint16_t squal)
+{
+	sample->dx = dx;
+	sample->dy = dy;
+	sample->dt = dt;
+	sample->squal = squal;
+}
+
+static void test_lift(void)
+{
+	struct motion_filter *chain[] = {&lift.filter};
+	struct motion_filter_sample sample;
+
+	motion_filter_lift_init(&lift, 16);
+
+	sample_set(&sample, 5, -3, SAMPLE_DT, MOTION_FILTER_SQUAL_UNKNOWN);
+	zassert_true(motion_filter_run(chain, ARRAY_SIZE(chain), &sample),
+		     "Unknown quality must not drop motion");
+	zassert_equal(sample.dx, 5, NULL);
+	zassert_equal(sample.dy, -3, NULL);
+
+	sample_set(&sample, 5, -3, SAMPLE_DT, 16);
+	zassert_true(motion_filter_run(chain, ARRAY_SIZE(chain), &sample),
+		     "Motion dropped at threshold");
+	zassert_equal(sample.dx, 5, NULL);
+	zassert_equal(sample.dy, -3, NULL);
+
+	sample_set(&sample, 5, -3, SAMPLE_DT, 15);
+	zassert_false(motion_filter_run(chain, ARRAY_SIZE(chain), &sample),
+		      "Motion kept below threshold");
+}
+
+static void test_accel(void)
+{
+	struct motion_filter *chain[] = {&accel.filter};
+	struct motion_filter_sample sample;
+
+	motion_filter_accel_init(&accel, 4000, 10, 200);
+
+	/* 4000 counts per second is not accelerated. */
+	sample_set(&sample, 4, -1, SAMPLE_DT, MOTION_FILTER_SQUAL_UNKNOWN);
+	motion_filter_run(chain, ARRAY_SIZE(chain), &sample);
+	zassert_equal(sample.dx, 4, NULL);
+	zassert_equal(sample.dy, -1, NULL);
+
+	/* 10000 counts per second gets 160% gain. */
+	sample_set(&sample, -10, 0, SAMPLE_DT, MOTION_FILTER_SQUAL_UNKNOWN);
+	motion_filter_run(chain, ARRAY_SIZE(chain), &sample);
+	zassert_equal(sample.dx, -16, NULL);
+	zassert_equal(sample.dy, 0, NULL);
+
+	/* The same motion over a longer time is slower. */
+	sample_set(&sample, -10, 0, 4 * SAMPLE_DT,
+		   MOTION_FILTER_SQUAL_UNKNOWN);
+	motion_filter_run(chain, ARRAY_SIZE(chain), &sample);
+	zassert_equal(sample.dx, -10, NULL);
+
+	/* The gain is limited. */
+	sample_set(&sample, 0, 100, SAMPLE_DT, MOTION_FILTER_SQUAL_UNKNOWN);
+	motion_filter_run(chain, ARRAY_SIZE(chain), &sample);
+	zassert_equal(sample.dx, 0, NULL);
+	zassert_equal(sample.dy, 200, NULL);
+}
+
+static void test_accel_remainder(void)
+{
+	struct motion_filter *chain[] = {&accel.filter};
+	struct motion_filter_sample sample;
+	int32_t sum = 0;
+
+	motion_filter_accel_init(&accel, 4000, 10, 200);
+
+	/* 6000 counts per second gets 120% gain, which is 3.6 counts for
+	 * every sample. No part of a count may be lost.
+	 */
+	for (int i = 0; i < 10; i++) {
+		sample_set(&sample, 3, 0, SAMPLE_DT / 2,
+			   MOTION_FILTER_SQUAL_UNKNOWN);
+		motion_filter_run(chain, ARRAY_SIZE(chain), &sample);
+		zassert_true((sample.dx == 3) || (sample.dx == 4),
+			     "Unexpected motion %d", sample.dx);
+		sum += sample.dx;
+	}
+
+	zassert_equal(sum, 36, "Motion lost (%d)", sum);
+}
+
+static void test_snap(void)
+{
+	struct motion_filter *chain[] = {&snap.filter};
+	struct motion_filter_sample sample;
+
+	motion_filter_snap_init(&snap, 5);
+
+	sample_set(&sample, 100, 5, SAMPLE_DT, MOTION_FILTER_SQUAL_UNKNOWN);
+	motion_filter_run(chain, ARRAY_SIZE(chain), &sample);
+	zassert_equal(sample.dx, 100, NULL);
+	zassert_equal(sample.dy, 0, "Not snapped to X axis");
+
+	sample_set(&sample, -100, -8, SAMPLE_DT, MOTION_FILTER_SQUAL_UNKNOWN);
+	motion_filter_run(chain, ARRAY_SIZE(chain), &sample);
+	zassert_equal(sample.dx, -100, NULL);
+	zassert_equal(sample.dy, 0, "Not snapped to X axis");
+
+	sample_set(&sample, 3, -100, SAMPLE_DT, MOTION_FILTER_SQUAL_UNKNOWN);
+	motion_filter_run(chain, ARRAY_SIZE(chain), &sample);
+	zassert_equal(sample.dx, 0, "Not snapped to Y axis");
+	zassert_equal(sample.dy, -100, NULL);
+
+	sample_set(&sample, 100, 10, SAMPLE_DT, MOTION_FILTER_SQUAL_UNKNOWN);
+	motion_filter_run(chain, ARRAY_SIZE(chain), &sample);
+	zassert_equal(sample.dx, 100, NULL);
+	zassert_equal(sample.dy, 10, "Snapped outside of the angle");
+}
+
+static uint32_t rand_next(uint32_t *state)
+{
+	*state = *state * 1103515245U + 12345U;
+
+	return *state >> 8;
+}
+
+static void test_benchmark(void)
+{
+	struct motion_filter *chain[] = {
+		&lift.filter,
+		&snap.filter,
+		&accel.filter,
+	};
+	uint32_t seed = 1;
+	int64_t raw = 0;
+	int64_t filtered = 0;
+	uint64_t start;
+	uint64_t us;
+
+	motion_filter_lift_init(&lift, 16);
+	motion_filter_snap_init(&snap, 5);
+	motion_filter_accel_init(&accel, 4000, 10, 200);
+
+	/* Strokes of random direction and speed, with the sensor lifted
+	 * from time to time.
+	 */
+	for (int i = 0; i < BENCH_SAMPLES; i++) {
+		int32_t dx = (int32_t)(rand_next(&seed) % 61) - 30;
+		int32_t dy = (int32_t)(rand_next(&seed) % 61) - 30;
+		uint16_t squal = ((i % 100) < 10) ? 4 : 40;
+
+		sample_set(&samples[i], dx, dy, SAMPLE_DT, squal);
+		raw += abs(dx) + abs(dy);
+	}
+
+	start = bench_time_us();
+	for (int i = 0; i < BENCH_SAMPLES; i++) {
+		kept[i] = motion_filter_run(chain, ARRAY_SIZE(chain),
+					    &samples[i]);
+	}
+	us = bench_time_us() - start;
+
+	for (int i = 0; i < BENCH_SAMPLES; i++) {
+		if (kept[i]) {
+			filtered += abs(samples[i].dx) + abs(samples[i].dy);
+		}
+	}
+
+	zassert_true(filtered > raw, "Motion not accelerated");
+
+	TC_PRINT("%d samples, %d counts in, %d counts out\n", BENCH_SAMPLES,
+		 (int)raw, (int)filtered);
+	TC_PRINT("host ns per sample: %u\n",
+		 (uint32_t)(us * NSEC_PER_USEC / BENCH_SAMPLES));
+}
+
+void test_main(void)
+{
+	ztest_test_suite(motion_filter_test,
+			 ztest_unit_test(test_lift),
+			 ztest_unit_test(test_accel),
+			 ztest_unit_test(test_accel_remainder),
+			 ztest_unit_test(test_snap),
+			 ztest_unit_test(test_benchmark)
+			 );
+
+	ztest_run_test_suite(motion_filter_test);
+}
@@ -0,0 +1,488 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <bench_time.h>
+#include <sys/slist.h>
+#include <sys/byteorder.h>
+
+#include "report_queue.h"
+#include "enqueued_reports.h"
+#include "hid_event.h"
+
+#define QUEUE_SIZE 4
+#define PERIPHERAL_COUNT 2
+#define BENCH_STEPS 10000
+/* Mouse report with the report ID. */
+#define REPORT_SIZE 6
+
+static struct hid_report_event *reports[16];
+static struct hid_report_event *buf[QUEUE_SIZE];
+static struct hid_report_event *buf2[2 * QUEUE_SIZE];
+static struct hid_report_event *set_buf[ARRAY_SIZE(input_reports)][QUEUE_SIZE];
+static struct hid_report_event *set_buf2[ARRAY_SIZE(input_reports)]
+					[2 * QUEUE_SIZE];
+
+/* Used as the subscriber ID of the reports. */
+static const int usb_subscriber;
+
+static size_t irep_idx_get(uint8_t report_id)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(input_reports); i++) {
+		if (input_reports[i] == report_id) {
+			return i;
+		}
+	}
+
+	zassert_unreachable("Report %u not found", report_id);
+	return 0;
+}
+
+static struct hid_report_event *report_alloc(uint8_t report_id, uint32_t seq)
+{
+	struct hid_report_event *report = new_hid_report_event(REPORT_SIZE);
+
+	report->subscriber = &usb_subscriber;
+	report->dyndata.data[0] = report_id;
+	sys_put_le32(seq, &report->dyndata.data[1]);
+	report->dyndata.data[5] = 0;
+
+	return report;
+}
+
+static uint32_t report_seq(const struct hid_report_event *report)
+{
+	return sys_get_le32(&report->dyndata.data[1]);
+}
+
+static void test_report_queue_order(void)
+{
+	struct report_queue queue;
+
+	report_queue_init(&queue, buf, ARRAY_SIZE(buf));
+	zassert_true(report_queue_is_empty(&queue), NULL);
+	zassert_is_null(report_queue_get(&queue), NULL);
+
+	/* Go around the ring a few times. */
+	for (size_t i = 0; i < ARRAY_SIZE(reports); i += 3) {
+		for (size_t j = i; j < MIN(i + 3, ARRAY_SIZE(reports)); j++) {
+			zassert_is_null(report_queue_put(&queue, reports[j]),
+					NULL);
+		}
+
+		for (size_t j = i; j < MIN(i + 3, ARRAY_SIZE(reports)); j++) {
+			zassert_equal_ptr(report_queue_get(&queue), reports[j],
+					  NULL);
+		}
+	}
+
+	zassert_equal(report_queue_count(&queue), 0, NULL);
+}
+
+static void test_report_queue_drop_oldest(void)
+{
+	struct report_queue queue;
+
+	report_queue_init(&queue, buf, ARRAY_SIZE(buf));
+
+	for (size_t i = 0; i < ARRAY_SIZE(reports); i++) {
+		struct hid_report_event *dropped =
+			report_queue_put(&queue, reports[i]);
+
+		if (i < QUEUE_SIZE) {
+			zassert_is_null(dropped, NULL);
+		} else {
+			zassert_equal_ptr(dropped, reports[i - QUEUE_SIZE],
+					  NULL);
+		}
+	}
+
+	zassert_equal(report_queue_count(&queue), QUEUE_SIZE, NULL);
+
+	for (size_t i = ARRAY_SIZE(reports) - QUEUE_SIZE;
+	     i < ARRAY_SIZE(reports); i++) {
+		zassert_equal_ptr(report_queue_get(&queue), reports[i], NULL);
+	}
+}
+
+static void test_report_queue_move(void)
+{
+	struct report_queue per;
+	struct report_queue sub;
+
+	report_queue_init(&per, buf, ARRAY_SIZE(buf));
+	report_queue_init(&sub, buf2, ARRAY_SIZE(buf2));
+
+	/* Start in the middle of the subscriber ring. */
+	for (size_t i = 0; i < 5; i++) {
+		report_queue_put(&sub, reports[0]);
+		report_queue_get(&sub);
+	}
+
+	for (size_t i = 0; i < 6; i++) {
+		report_queue_put(&sub, reports[i]);
+	}
+
+	/* Newest reports go to the peripheral, the oldest stay. */
+	zassert_equal(report_queue_move(&per, &sub, 2), 2, NULL);
+	zassert_equal(report_queue_count(&sub), 4, NULL);
+	zassert_equal_ptr(report_queue_get(&per), reports[4], NULL);
+	zassert_equal_ptr(report_queue_get(&per), reports[5], NULL);
+
+	/* Only as many reports as fit are moved. */
+	report_queue_put(&per, reports[10]);
+	zassert_equal(report_queue_move(&per, &sub, QUEUE_SIZE), 3, NULL);
+	zassert_equal_ptr(report_queue_get(&sub), reports[0], NULL);
+	zassert_equal_ptr(report_queue_get(&per), reports[10], NULL);
+
+	for (size_t i = 1; i < 4; i++) {
+		zassert_equal_ptr(report_queue_get(&per), reports[i], NULL);
+	}
+
+	zassert_true(report_queue_is_empty(&per), NULL);
+	zassert_true(report_queue_is_empty(&sub), NULL);
+}
+
+static void test_enqueued_reports(void)
+{
+	struct enqueued_reports per;
+	struct enqueued_reports sub;
+	size_t mouse = irep_idx_get(REPORT_ID_MOUSE);
+	size_t keys = irep_idx_get(REPORT_ID_KEYBOARD_KEYS);
+	struct hid_report_event *report;
+
+	enqueued_reports_init(&per, &set_buf[0][0], QUEUE_SIZE);
+	enqueued_reports_init(&sub, &set_buf2[0][0], 2 * QUEUE_SIZE);
+	zassert_false(enqueued_reports_is_any(&per), NULL);
+	zassert_is_null(enqueued_reports_get_next(&per), NULL);
+
+	/* A full queue drops and frees the oldest report. */
+	for (uint32_t seq = 0; seq <= QUEUE_SIZE; seq++) {
+		zassert_equal(enqueued_reports_put(&per, mouse,
+					report_alloc(REPORT_ID_MOUSE, seq)),
+			      seq == QUEUE_SIZE, NULL);
+	}
+
+	zassert_false(enqueued_reports_put(&per, keys,
+				report_alloc(REPORT_ID_KEYBOARD_KEYS, 100)),
+		      NULL);
+	zassert_true(enqueued_reports_is_enqueued(&per, mouse), NULL);
+	zassert_true(enqueued_reports_is_enqueued(&per, keys), NULL);
+
+	/* Report types take turns. */
+	per.last_idx = mouse;
+	report = enqueued_reports_get_next(&per);
+	zassert_equal(report->dyndata.data[0], REPORT_ID_KEYBOARD_KEYS, NULL);
+	k_free(report);
+
+	report = enqueued_reports_get_next(&per);
+	zassert_equal(report->dyndata.data[0], REPORT_ID_MOUSE, NULL);
+	zassert_equal(report_seq(report), 1, "Oldest report not dropped");
+	k_free(report);
+
+	/* The newest reports are migrated, the oldest stay. */
+	enqueued_reports_migrate(&sub, &per, 2);
+	report = enqueued_reports_get_next(&per);
+	zassert_equal(report_seq(report), 2, NULL);
+	k_free(report);
+	zassert_false(enqueued_reports_is_any(&per), NULL);
+
+	for (uint32_t seq = 3; seq <= QUEUE_SIZE; seq++) {
+		report = enqueued_reports_get_next(&sub);
+		zassert_equal(report_seq(report), seq, NULL);
+		k_free(report);
+	}
+
+	enqueued_reports_put(&sub, keys,
+			     report_alloc(REPORT_ID_KEYBOARD_KEYS, 101));
+	enqueued_reports_drop(&sub, keys);
+	zassert_false(enqueued_reports_is_any(&sub), NULL);
+}
+
+/* HID forward reports received from peripherals while the USB HID device is
+ * busy. The report event is allocated when the report is received, and it is
+ * submitted to the USB HID device when the previous report has been sent.
+ * The benchmark does the same, on two peripherals sending motion on every
+ * step while the USB HID device sends out one report every second step, so
+ * that the queues keep overflowing. Reports passed to the USB HID device are
+ * freed when sent, instead of being submitted.
+ */
+struct forward_ops {
+	void (*init)(void);
+	bool (*enqueue)(size_t per_id, size_t irep_idx,
+			struct hid_report_event *report);
+	struct hid_report_event *(*get_next)(size_t per_id);
+	void (*drain)(void);
+};
+
+struct bench_result {
+	uint64_t us;
+	size_t received;
+	size_t sent;
+	size_t dropped;
+	size_t allocs;
+	uint32_t checksum;
+};
+
+static size_t bench_allocs;
+
+/* Queues of hid_forward. */
+static struct enqueued_reports ring_per[PERIPHERAL_COUNT];
+static struct hid_report_event *ring_buf[PERIPHERAL_COUNT]
+					[ARRAY_SIZE(input_reports)][QUEUE_SIZE];
+
+static void ring_init(void)
+{
+	for (size_t i = 0; i < PERIPHERAL_COUNT; i++) {
+		enqueued_reports_init(&ring_per[i], &ring_buf[i][0][0],
+				      QUEUE_SIZE);
+	}
+}
+
+static bool ring_enqueue(size_t per_id, size_t irep_idx,
+			 struct hid_report_event *report)
+{
+	return enqueued_reports_put(&ring_per[per_id], irep_idx, report);
+}
+
+static struct hid_report_event *ring_get_next(size_t per_id)
+{
+	return enqueued_reports_get_next(&ring_per[per_id]);
+}
+
+static void ring_drain(void)
+{
+	for (size_t i = 0; i < PERIPHERAL_COUNT; i++) {
+		for (size_t j = 0; j < ARRAY_SIZE(input_reports); j++) {
+			enqueued_reports_drop(&ring_per[i], j);
+		}
+	}
+}
+
+static const struct forward_ops ring_ops = {
+	.init = ring_init,
+	.enqueue = ring_enqueue,
+	.get_next = ring_get_next,
+	.drain = ring_drain,
+};
+
+/* Queues of hid_forward before the rings, with an allocated list node for
+ * every enqueued report.
+ */
+struct enqueued_report {
+	sys_snode_t node;
+	struct hid_report_event *report;
+};
+
+struct counted_list {
+	sys_slist_t list;
+	size_t count;
+};
+
+static struct {
+	struct counted_list reports[ARRAY_SIZE(input_reports)];
+	uint8_t last_idx;
+} list_per[PERIPHERAL_COUNT];
+
+static void list_init(void)
+{
+	for (size_t i = 0; i < PERIPHERAL_COUNT; i++) {
+		for (size_t j = 0; j < ARRAY_SIZE(input_reports); j++) {
+			sys_slist_init(&list_per[i].reports[j].list);
+			list_per[i].reports[j].count = 0;
+		}
+
+		list_per[i].last_idx = 0;
+	}
+}
+
+static struct enqueued_report *list_get(struct counted_list *reports)
+{
+	struct enqueued_report *item;
+
+	item = CONTAINER_OF(sys_slist_get(&reports->list),
+			    __typeof__(*item), node);
+	reports->count--;
+
+	return item;
+}
+
+static bool list_enqueue(size_t per_id, size_t irep_idx,
+			 struct hid_report_event *report)
+{
+	struct counted_list *reports = &list_per[per_id].reports[irep_idx];
+	struct enqueued_report *item;
+	bool dropped = false;
+
+	if (reports->count < QUEUE_SIZE) {
+		item = k_malloc(sizeof(*item));
+		zassert_not_null(item, NULL);
+		bench_allocs++;
+	} else {
+		item = list_get(reports);
+		k_free(item->report);
+		dropped = true;
+	}
+
+	item->report = report;
+	sys_slist_append(&reports->list, &item->node);
+	reports->count++;
+
+	return dropped;
+}
+
+static struct hid_report_event *list_get_next(size_t per_id)
+{
+	struct hid_report_event *report = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(input_reports); i++) {
+		size_t irep_idx = (list_per[per_id].last_idx + i + 1) %
+				  ARRAY_SIZE(input_reports);
+		struct counted_list *reports =
+			&list_per[per_id].reports[irep_idx];
+
+		if (reports->count > 0) {
+			struct enqueued_report *item = list_get(reports);
+
+			report = item->report;
+			k_free(item);
+			list_per[per_id].last_idx = irep_idx;
+			break;
+		}
+	}
+
+	return report;
+}
+
+static void list_drain(void)
+{
+	struct hid_report_event *report;
+
+	for (size_t i = 0; i < PERIPHERAL_COUNT; i++) {
+		while ((report = list_get_next(i)) != NULL) {
+			k_free(report);
+		}
+	}
+}
+
+static const struct forward_ops list_ops = {
+	.init = list_init,
+	.enqueue = list_enqueue,
+	.get_next = list_get_next,
+	.drain = list_drain,
+};
+
+static void report_sent(struct bench_result *res,
+			struct hid_report_event *report)
+{
+	res->checksum = res->checksum * 31 + report_seq(report);
+	res->sent++;
+	k_free(report);
+}
+
+static void bench_run(const struct forward_ops *ops, struct bench_result *res)
+{
+	size_t mouse = irep_idx_get(REPORT_ID_MOUSE);
+	struct hid_report_event *in_flight = NULL;
+	size_t last_per = 0;
+	uint64_t start;
+
+	ops->init();
+	bench_allocs = 0;
+	start = bench_time_us();
+
+	for (uint32_t step = 0; step < BENCH_STEPS; step++) {
+		for (size_t i = 0; i < PERIPHERAL_COUNT; i++) {
+			struct hid_report_event *report =
+				report_alloc(REPORT_ID_MOUSE,
+					     step * PERIPHERAL_COUNT + i);
+
+			bench_allocs++;
+			res->received++;
+
+			if (!in_flight) {
+				in_flight = report;
+			} else if (ops->enqueue(i, mouse, report)) {
+				res->dropped++;
+			}
+		}
+
+		if ((step % 2) && in_flight) {
+			report_sent(res, in_flight);
+			in_flight = NULL;
+
+			for (size_t i = 0; i < PERIPHERAL_COUNT; i++) {
+				size_t per_id = (last_per + i + 1) %
+						PERIPHERAL_COUNT;
+
+				in_flight = ops->get_next(per_id);
+				if (in_flight) {
+					last_per = per_id;
+					break;
+				}
+			}
+		}
+	}
+
+	res->us = bench_time_us() - start;
+	res->allocs = bench_allocs;
+
+	if (in_flight) {
+		k_free(in_flight);
+	}
+
+	ops->drain();
+}
+
+static void test_report_queue_benchmark(void)
+{
+	struct bench_result ring = {0};
+	struct bench_result list = {0};
+
+	bench_run(&list_ops, &list);
+	bench_run(&ring_ops, &ring);
+
+	/* Both queues must forward and drop the same reports. */
+	zassert_equal(ring.sent, BENCH_STEPS / 2, NULL);
+	zassert_equal(ring.sent, list.sent, NULL);
+	zassert_equal(ring.dropped, list.dropped, NULL);
+	zassert_equal(ring.checksum, list.checksum, NULL);
+
+	/* Only the report events are allocated. */
+	zassert_equal(ring.allocs, ring.received, NULL);
+
+	TC_PRINT("%d peripherals, %u reports received, %u forwarded, "
+		 "%u dropped\n",
+		 PERIPHERAL_COUNT, (unsigned int)ring.received,
+		 (unsigned int)ring.sent, (unsigned int)ring.dropped);
+	TC_PRINT("allocations per 100 reports: list %u, ring %u\n",
+		 (unsigned int)(list.allocs * 100 / list.received),
+		 (unsigned int)(ring.allocs * 100 / ring.received));
+	TC_PRINT("host ns per step: list %u, ring %u\n",
+		 (uint32_t)(list.us * NSEC_PER_USEC / BENCH_STEPS),
+		 (uint32_t)(ring.us * NSEC_PER_USEC / BENCH_STEPS));
+
+	zassert_true(list.us > 0, "Host clock did not advance");
+}
+
+void test_main(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(reports); i++) {
+		reports[i] = report_alloc(REPORT_ID_MOUSE, i);
+	}
+
+	ztest_test_suite(report_queue_test,
+			 ztest_unit_test(test_report_queue_order),
+			 ztest_unit_test(test_report_queue_drop_oldest),
+			 ztest_unit_test(test_report_queue_move),
+			 ztest_unit_test(test_enqueued_reports),
+			 ztest_unit_test(test_report_queue_benchmark)
+			 );
+
+	ztest_run_test_suite(report_queue_test);
+}
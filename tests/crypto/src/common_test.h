@@ -433,6 +433,11 @@ uint32_t get_vector_count(const test_case_t *tc);
 void start_time_measurement(void);
 void stop_time_measurement(void);
 
+/**@brief Function for running the benchmark suite instead of the test
+ *        vectors, see CONFIG_CRYPTO_TEST_BENCHMARK.
+ */
+void run_benchmark(void);
+
 /**@brief Macro(s) for decorating test vector names with file and line information.
  */
 #ifndef TV_NAME
@@ -13,7 +13,11 @@ LOG_MODULE_REGISTER(test_main);
 
 static int init_leds(void)
 {
+#if defined(CONFIG_DK_LIBRARY)
 	return dk_leds_init();
+#else
+	return 0;
+#endif
 }
 
 static void test_state_reset(void)
@@ -74,6 +78,11 @@ void test_main(void)
 	if (init_leds() != 0)
 		LOG_ERR("Bad leds init!");
 
+#if defined(CONFIG_CRYPTO_TEST_BENCHMARK)
+	run_benchmark();
+	return;
+#endif
+
 	run_suites(__start_test_case_aead_ccm_data,
 		   ITEM_COUNT(test_case_aead_ccm_data, test_case_t));
 	run_suites(__start_test_case_aead_ccm_simple_data,
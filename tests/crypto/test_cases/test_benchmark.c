@@ -0,0 +1,529 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <kernel.h>
+#include <sys/printk.h>
+#include <logging/log.h>
+
+#include "common_test.h"
+#include <mbedtls/cipher.h>
+#include <mbedtls/md.h>
+#include <mbedtls/ecp.h>
+#include <mbedtls/ecdh.h>
+#include <mbedtls/ecdsa.h>
+
+#if defined(CONFIG_BOARD_NATIVE_POSIX)
+#include <bench_time.h>
+#elif defined(CONFIG_CPU_CORTEX_M)
+#include <soc.h>
+#endif
+
+LOG_MODULE_REGISTER(test_benchmark, LOG_LEVEL_INF);
+
+#define BENCH_MAX_SIZE CONFIG_CRYPTO_TEST_BENCHMARK_MAX_SIZE
+#define BENCH_WARMUP CONFIG_CRYPTO_TEST_BENCHMARK_WARMUP
+#define BENCH_REPEAT CONFIG_CRYPTO_TEST_BENCHMARK_REPEAT
+
+#define BENCH_BLOCK_SIZE 16
+#define BENCH_NONCE_SIZE 12
+#define BENCH_TAG_SIZE 16
+#define BENCH_KEY_SIZE 32
+
+/* Message sizes used for the symmetric primitives. Sizes larger than
+ * CONFIG_CRYPTO_TEST_BENCHMARK_MAX_SIZE are skipped.
+ */
+static const size_t bench_sizes[] = { 16, 64, 256, 1024, 4096, 16384 };
+
+/* Names of the enabled backends. With more than one backend, nrf_security
+ * selects the backend per primitive.
+ */
+static const char bench_backend[] =
+#if defined(CONFIG_CC3XX_BACKEND)
+	"cc3xx+"
+#endif
+#if defined(CONFIG_OBERON_BACKEND)
+	"oberon+"
+#endif
+#if defined(CONFIG_MBEDTLS_VANILLA_BACKEND)
+	"vanilla+"
+#endif
+	"";
+
+static uint8_t m_bench_input_buf[BENCH_MAX_SIZE];
+static uint8_t m_bench_output_buf[BENCH_MAX_SIZE];
+static uint8_t m_bench_tag_buf[BENCH_TAG_SIZE];
+static uint8_t m_bench_digest_buf[MBEDTLS_MD_MAX_SIZE];
+static uint8_t m_bench_key_buf[BENCH_KEY_SIZE];
+static uint8_t m_bench_iv_buf[BENCH_BLOCK_SIZE];
+
+static mbedtls_cipher_context_t cipher_ctx;
+static const mbedtls_md_info_t *p_md_info;
+
+static mbedtls_ecp_group ecp_grp;
+static mbedtls_mpi ecp_d;
+static mbedtls_mpi ecp_r;
+static mbedtls_mpi ecp_s;
+static mbedtls_mpi ecp_z;
+static mbedtls_ecp_point ecp_q;
+
+/**
+ * Clock used for the measurements. CPU cycle counter is used when available.
+ * On native_posix the host monotonic clock is used, because the simulated
+ * time does not advance while the code runs.
+ */
+static const char *bench_clock_name;
+static uint32_t bench_clock_hz;
+
+#if defined(CONFIG_CPU_CORTEX_M) && defined(DWT_CTRL_CYCCNTENA_Msk)
+static bool bench_use_dwt;
+#endif
+
+static void bench_clock_init(void)
+{
+#if defined(CONFIG_BOARD_NATIVE_POSIX)
+	bench_clock_name = "host_us";
+	bench_clock_hz = USEC_PER_SEC;
+	return;
+#elif defined(CONFIG_CPU_CORTEX_M) && defined(DWT_CTRL_CYCCNTENA_Msk)
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	/* The counter may be unavailable, for example in Non-Secure state. */
+	k_busy_wait(10);
+	if (DWT->CYCCNT != 0) {
+		bench_use_dwt = true;
+		bench_clock_name = "cpu";
+		bench_clock_hz = SystemCoreClock;
+		return;
+	}
+#endif
+	bench_clock_name = "sys";
+	bench_clock_hz = sys_clock_hw_cycles_per_sec();
+}
+
+static uint32_t bench_clock_get(void)
+{
+#if defined(CONFIG_BOARD_NATIVE_POSIX)
+	return (uint32_t)bench_time_us();
+#else
+#if defined(CONFIG_CPU_CORTEX_M) && defined(DWT_CTRL_CYCCNTENA_Msk)
+	if (bench_use_dwt) {
+		return DWT->CYCCNT;
+	}
+#endif
+	return k_cycle_get_32();
+#endif
+}
+
+/**
+ * Tracking of the mbed TLS heap usage. The allocator installed by the
+ * heap initialization is wrapped, so that the peak usage can be reported
+ * for every measurement.
+ */
+#if defined(MBEDTLS_PLATFORM_MEMORY) && \
+	!(defined(MBEDTLS_PLATFORM_CALLOC_MACRO) && \
+	  defined(MBEDTLS_PLATFORM_FREE_MACRO))
+#define BENCH_HEAP_TRACKING 1
+
+/* Keeps the allocations aligned to 8 bytes. */
+#define BENCH_HEAP_HDR_SIZE 8
+
+static void *(*heap_calloc)(size_t n, size_t size);
+static void (*heap_free)(void *ptr);
+#endif
+
+static size_t heap_used;
+static size_t heap_peak;
+
+#if defined(BENCH_HEAP_TRACKING)
+static void *bench_calloc(size_t n, size_t size)
+{
+	uint8_t *p_mem;
+	size_t len;
+
+	if ((size != 0) && (n > (SIZE_MAX - BENCH_HEAP_HDR_SIZE) / size)) {
+		return NULL;
+	}
+
+	len = n * size;
+	p_mem = heap_calloc(1, len + BENCH_HEAP_HDR_SIZE);
+	if (p_mem == NULL) {
+		return NULL;
+	}
+
+	*(size_t *)p_mem = len;
+	heap_used += len;
+	heap_peak = MAX(heap_peak, heap_used);
+
+	return p_mem + BENCH_HEAP_HDR_SIZE;
+}
+
+static void bench_free(void *ptr)
+{
+	uint8_t *p_mem = ptr;
+
+	if (p_mem == NULL) {
+		return;
+	}
+
+	p_mem -= BENCH_HEAP_HDR_SIZE;
+	heap_used -= *(size_t *)p_mem;
+	heap_free(p_mem);
+}
+#endif /* BENCH_HEAP_TRACKING */
+
+static void bench_state_reset(void)
+{
+	/* Start every primitive with a fresh heap, see test_state_reset. */
+	_heap_free();
+	_heap_init();
+
+#if defined(BENCH_HEAP_TRACKING)
+	heap_calloc = mbedtls_calloc;
+	heap_free = mbedtls_free;
+	heap_used = 0;
+	(void)mbedtls_platform_set_calloc_free(bench_calloc, bench_free);
+#endif
+
+	TEST_VECTOR_ASSERT_EQUAL(0, init_drbg(NULL, 0));
+
+	memset(m_bench_input_buf, 0xA5, sizeof(m_bench_input_buf));
+	memset(m_bench_key_buf, 0x5A, sizeof(m_bench_key_buf));
+	memset(m_bench_iv_buf, 0x3C, sizeof(m_bench_iv_buf));
+}
+
+/**@brief Function for printing the result line.
+ *
+ * The format is:
+ * bench,<backend>,<primitive>,<size>,<iterations>,<cycles>,
+ * <cycles_per_byte>,<ops_per_sec>,<heap_peak>
+ *
+ * The cycles are ticks of the clock reported in the bench_clock line.
+ * The cycles per byte are empty for operations without a message.
+ * The heap peak is -1 if the heap usage cannot be tracked.
+ */
+static void bench_report(const char *name, size_t len, uint32_t ticks,
+			 size_t heap)
+{
+	uint64_t ops_per_sec;
+	char cpb[16] = "";
+
+	if (ticks == 0) {
+		ticks = 1;
+	}
+
+	ops_per_sec = ((uint64_t)BENCH_REPEAT * bench_clock_hz) / ticks;
+
+	if (len > 0) {
+		/* Two decimal places. */
+		uint64_t cpb_100 = ((uint64_t)ticks * 100) /
+				   ((uint64_t)BENCH_REPEAT * len);
+
+		snprintf(cpb, sizeof(cpb), "%u.%02u",
+			 (uint32_t)(cpb_100 / 100), (uint32_t)(cpb_100 % 100));
+	}
+
+	printk("bench,%.*s,%s,%u,%u,%u,%s,%u,%d\n",
+	       (int)(sizeof(bench_backend) > 1 ? sizeof(bench_backend) - 2 : 0),
+	       bench_backend, name, (uint32_t)len, BENCH_REPEAT, ticks, cpb,
+	       (uint32_t)ops_per_sec,
+	       IS_ENABLED(BENCH_HEAP_TRACKING) ? (int)heap : -1);
+}
+
+typedef int (*bench_op_t)(size_t len);
+
+/**@brief Function for measuring a single operation on a message of @p len
+ *        bytes. Use zero length for operations without a message.
+ */
+static void bench_run(const char *name, bench_op_t op, size_t len)
+{
+	uint32_t start;
+	uint32_t ticks;
+	size_t heap_base;
+	int err_code;
+
+	for (int i = 0; i < BENCH_WARMUP; i++) {
+		err_code = op(len);
+		TEST_VECTOR_ASSERT_EQUAL(0, err_code);
+	}
+
+	heap_base = heap_used;
+	heap_peak = heap_used;
+
+	start = bench_clock_get();
+	for (int i = 0; i < BENCH_REPEAT; i++) {
+		err_code = op(len);
+		TEST_VECTOR_ASSERT_EQUAL(0, err_code);
+	}
+	ticks = bench_clock_get() - start;
+
+	bench_report(name, len, ticks, heap_peak - heap_base);
+}
+
+static void bench_run_sizes(const char *name, bench_op_t op, size_t align)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(bench_sizes); i++) {
+		if (bench_sizes[i] > BENCH_MAX_SIZE) {
+			break;
+		}
+		if (bench_sizes[i] % align) {
+			continue;
+		}
+		bench_run(name, op, bench_sizes[i]);
+	}
+}
+
+static int op_cipher_ecb(size_t len)
+{
+	size_t olen;
+	int err_code;
+
+	/* ECB mode processes a single block per call. */
+	for (size_t off = 0; off < len; off += BENCH_BLOCK_SIZE) {
+		err_code = mbedtls_cipher_update(&cipher_ctx,
+						 &m_bench_input_buf[off],
+						 BENCH_BLOCK_SIZE,
+						 &m_bench_output_buf[off], &olen);
+		if (err_code) {
+			return err_code;
+		}
+	}
+
+	return 0;
+}
+
+static int op_cipher(size_t len)
+{
+	size_t olen;
+
+	return mbedtls_cipher_crypt(&cipher_ctx, m_bench_iv_buf,
+				    BENCH_BLOCK_SIZE, m_bench_input_buf, len,
+				    m_bench_output_buf, &olen);
+}
+
+static int op_aead(size_t len)
+{
+	size_t olen;
+
+	return mbedtls_cipher_auth_encrypt(&cipher_ctx, m_bench_iv_buf,
+					   BENCH_NONCE_SIZE, NULL, 0,
+					   m_bench_input_buf, len,
+					   m_bench_output_buf, &olen,
+					   m_bench_tag_buf, BENCH_TAG_SIZE);
+}
+
+static int op_hash(size_t len)
+{
+	return mbedtls_md(p_md_info, m_bench_input_buf, len,
+			  m_bench_digest_buf);
+}
+
+static int op_hmac(size_t len)
+{
+	return mbedtls_md_hmac(p_md_info, m_bench_key_buf, BENCH_KEY_SIZE,
+			       m_bench_input_buf, len, m_bench_digest_buf);
+}
+
+static void bench_cipher(const char *name, mbedtls_cipher_id_t id,
+			 int key_bits, mbedtls_cipher_mode_t mode,
+			 bench_op_t op, size_t align)
+{
+	const mbedtls_cipher_info_t *p_info =
+		mbedtls_cipher_info_from_values(id, key_bits, mode);
+	int err_code;
+
+	if (p_info == NULL) {
+		LOG_INF("%s not supported, skipped", name);
+		return;
+	}
+
+	bench_state_reset();
+
+	mbedtls_cipher_init(&cipher_ctx);
+	err_code = mbedtls_cipher_setup(&cipher_ctx, p_info);
+	TEST_VECTOR_ASSERT_EQUAL(0, err_code);
+
+	err_code = mbedtls_cipher_setkey(&cipher_ctx, m_bench_key_buf,
+					 key_bits, MBEDTLS_ENCRYPT);
+	TEST_VECTOR_ASSERT_EQUAL(0, err_code);
+
+#if defined(MBEDTLS_CIPHER_MODE_WITH_PADDING)
+	if (mode == MBEDTLS_MODE_CBC) {
+		err_code = mbedtls_cipher_set_padding_mode(
+			&cipher_ctx, MBEDTLS_PADDING_NONE);
+		TEST_VECTOR_ASSERT_EQUAL(0, err_code);
+	}
+#endif
+
+	bench_run_sizes(name, op, align);
+
+	mbedtls_cipher_free(&cipher_ctx);
+}
+
+static void bench_md(const char *name, const char *hmac_name,
+		     mbedtls_md_type_t type)
+{
+	p_md_info = mbedtls_md_info_from_type(type);
+	if (p_md_info == NULL) {
+		LOG_INF("%s not supported, skipped", name);
+		return;
+	}
+
+	bench_state_reset();
+	bench_run_sizes(name, op_hash, 1);
+	bench_run_sizes(hmac_name, op_hmac, 1);
+}
+
+void test_benchmark_aes(void)
+{
+	bench_cipher("aes128_ecb", MBEDTLS_CIPHER_ID_AES, 128,
+		     MBEDTLS_MODE_ECB, op_cipher_ecb, BENCH_BLOCK_SIZE);
+	bench_cipher("aes256_ecb", MBEDTLS_CIPHER_ID_AES, 256,
+		     MBEDTLS_MODE_ECB, op_cipher_ecb, BENCH_BLOCK_SIZE);
+#if defined(MBEDTLS_CIPHER_MODE_CBC)
+	bench_cipher("aes128_cbc", MBEDTLS_CIPHER_ID_AES, 128,
+		     MBEDTLS_MODE_CBC, op_cipher, BENCH_BLOCK_SIZE);
+#endif
+#if defined(MBEDTLS_CIPHER_MODE_CTR)
+	bench_cipher("aes128_ctr", MBEDTLS_CIPHER_ID_AES, 128,
+		     MBEDTLS_MODE_CTR, op_cipher, 1);
+#endif
+}
+
+void test_benchmark_aead(void)
+{
+#if defined(MBEDTLS_CCM_C)
+	bench_cipher("aes128_ccm", MBEDTLS_CIPHER_ID_AES, 128,
+		     MBEDTLS_MODE_CCM, op_aead, 1);
+#endif
+#if defined(MBEDTLS_GCM_C)
+	bench_cipher("aes128_gcm", MBEDTLS_CIPHER_ID_AES, 128,
+		     MBEDTLS_MODE_GCM, op_aead, 1);
+#endif
+#if defined(MBEDTLS_CHACHAPOLY_C)
+	bench_cipher("chachapoly", MBEDTLS_CIPHER_ID_CHACHA20, 256,
+		     MBEDTLS_MODE_CHACHAPOLY, op_aead, 1);
+#endif
+}
+
+void test_benchmark_hash(void)
+{
+#if defined(MBEDTLS_SHA256_C)
+	bench_md("sha256", "hmac_sha256", MBEDTLS_MD_SHA256);
+#endif
+#if defined(MBEDTLS_SHA512_C)
+	bench_md("sha512", "hmac_sha512", MBEDTLS_MD_SHA512);
+#endif
+}
+
+#if defined(MBEDTLS_ECP_C)
+static void bench_ecp_init(mbedtls_ecp_group_id grp_id)
+{
+	int err_code;
+
+	bench_state_reset();
+
+	mbedtls_ecp_group_init(&ecp_grp);
+	mbedtls_mpi_init(&ecp_d);
+	mbedtls_mpi_init(&ecp_r);
+	mbedtls_mpi_init(&ecp_s);
+	mbedtls_mpi_init(&ecp_z);
+	mbedtls_ecp_point_init(&ecp_q);
+
+	err_code = mbedtls_ecp_group_load(&ecp_grp, grp_id);
+	TEST_VECTOR_ASSERT_EQUAL(0, err_code);
+}
+
+static void bench_ecp_free(void)
+{
+	mbedtls_ecp_point_free(&ecp_q);
+	mbedtls_mpi_free(&ecp_z);
+	mbedtls_mpi_free(&ecp_s);
+	mbedtls_mpi_free(&ecp_r);
+	mbedtls_mpi_free(&ecp_d);
+	mbedtls_ecp_group_free(&ecp_grp);
+}
+#endif /* MBEDTLS_ECP_C */
+
+#if defined(MBEDTLS_ECDSA_C)
+static int op_ecdsa_genkey(size_t len)
+{
+	return mbedtls_ecp_gen_keypair(&ecp_grp, &ecp_d, &ecp_q, drbg_random,
+				       &drbg_ctx);
+}
+
+static int op_ecdsa_sign(size_t len)
+{
+	return mbedtls_ecdsa_sign(&ecp_grp, &ecp_r, &ecp_s, &ecp_d,
+				  m_bench_input_buf, 32, drbg_random,
+				  &drbg_ctx);
+}
+
+static int op_ecdsa_verify(size_t len)
+{
+	return mbedtls_ecdsa_verify(&ecp_grp, m_bench_input_buf, 32, &ecp_q,
+				    &ecp_r, &ecp_s);
+}
+#endif /* MBEDTLS_ECDSA_C */
+
+#if defined(MBEDTLS_ECDH_C)
+static int op_ecdh_gen_public(size_t len)
+{
+	return mbedtls_ecdh_gen_public(&ecp_grp, &ecp_d, &ecp_q, drbg_random,
+				       &drbg_ctx);
+}
+
+static int op_ecdh_compute_shared(size_t len)
+{
+	/* The own public key is used as the peer key. */
+	return mbedtls_ecdh_compute_shared(&ecp_grp, &ecp_z, &ecp_q, &ecp_d,
+					   drbg_random, &drbg_ctx);
+}
+#endif /* MBEDTLS_ECDH_C */
+
+void test_benchmark_ecc(void)
+{
+#if defined(MBEDTLS_ECDSA_C) && defined(MBEDTLS_ECP_DP_SECP256R1_ENABLED)
+	bench_ecp_init(MBEDTLS_ECP_DP_SECP256R1);
+	bench_run("ecdsa_p256_genkey", op_ecdsa_genkey, 0);
+	bench_run("ecdsa_p256_sign", op_ecdsa_sign, 0);
+	bench_run("ecdsa_p256_verify", op_ecdsa_verify, 0);
+	bench_ecp_free();
+#endif
+#if defined(MBEDTLS_ECDH_C) && defined(MBEDTLS_ECP_DP_SECP256R1_ENABLED)
+	bench_ecp_init(MBEDTLS_ECP_DP_SECP256R1);
+	bench_run("ecdh_p256_gen_public", op_ecdh_gen_public, 0);
+	bench_run("ecdh_p256_compute_shared", op_ecdh_compute_shared, 0);
+	bench_ecp_free();
+#endif
+#if defined(MBEDTLS_ECDH_C) && defined(MBEDTLS_ECP_DP_CURVE25519_ENABLED)
+	bench_ecp_init(MBEDTLS_ECP_DP_CURVE25519);
+	bench_run("ecdh_x25519_gen_public", op_ecdh_gen_public, 0);
+	bench_run("ecdh_x25519_compute_shared", op_ecdh_compute_shared, 0);
+	bench_ecp_free();
+#endif
+}
+
+void run_benchmark(void)
+{
+	bench_clock_init();
+
+	printk("bench_clock,%s,%u\n", bench_clock_name, bench_clock_hz);
+	printk("bench,backend,primitive,size,iterations,cycles,"
+	       "cycles_per_byte,ops_per_sec,heap_peak\n");
+
+	ztest_test_suite(crypto_benchmark,
+			 ztest_unit_test(test_benchmark_aes),
+			 ztest_unit_test(test_benchmark_aead),
+			 ztest_unit_test(test_benchmark_hash),
+			 ztest_unit_test(test_benchmark_ecc));
+
+	ztest_run_test_suite(crypto_benchmark);
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <drivers/uart.h>
+#include <drivers/uart_nrf_sw_lpuart.h>
+
+/* The test requires TX shorted with RX and REQ shorted with RDY. */
+
+#define QUEUE_SIZE CONFIG_NRF_SW_LPUART_TX_QUEUE_SIZE
+#define QUEUE_WRITES CONFIG_NRF_SW_LPUART_TX_QUEUE_WRITES
+#define LINGER_MS (CONFIG_NRF_SW_LPUART_TX_QUEUE_LINGER / 1000)
+#define TX_TIMEOUT_MS 10
+
+/* Time to complete a batch once it is started. */
+#define TX_TIME_MS 10
+
+static const struct device *lpuart;
+
+K_MSGQ_DEFINE(tx_evt_msgq, sizeof(struct uart_event), 8, 4);
+
+static uint8_t rx_buf[2][CONFIG_NRF_SW_LPUART_MAX_PACKET_SIZE];
+static uint8_t rx_buf_idx;
+static uint8_t rx_data[2 * QUEUE_SIZE];
+static size_t rx_len;
+
+static const uint8_t tx_data[QUEUE_SIZE] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+	0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F
+};
+
+static void uart_callback(const struct device *dev, struct uart_event *evt,
+			  void *user_data)
+{
+	int err;
+
+	switch (evt->type) {
+	case UART_TX_DONE:
+	case UART_TX_ABORTED:
+		err = k_msgq_put(&tx_evt_msgq, evt, K_NO_WAIT);
+		zassert_equal(err, 0, "Too many TX events");
+		break;
+
+	case UART_RX_RDY:
+		zassert_true(rx_len + evt->data.rx.len <= sizeof(rx_data),
+			     "Too much data received");
+		memcpy(&rx_data[rx_len], &evt->data.rx.buf[evt->data.rx.offset],
+		       evt->data.rx.len);
+		rx_len += evt->data.rx.len;
+		break;
+
+	case UART_RX_BUF_REQUEST:
+		rx_buf_idx ^= 1;
+		err = uart_rx_buf_rsp(dev, rx_buf[rx_buf_idx],
+				      sizeof(rx_buf[0]));
+		zassert_equal(err, 0, "Failed to provide RX buffer");
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void tx_evt_check(enum uart_event_type type, const uint8_t *buf,
+			 size_t len, k_timeout_t timeout)
+{
+	struct uart_event evt;
+	int err;
+
+	err = k_msgq_get(&tx_evt_msgq, &evt, timeout);
+	zassert_equal(err, 0, "No TX event");
+	zassert_equal(evt.type, type, "Unexpected TX event");
+	zassert_equal_ptr(evt.data.tx.buf, buf, "Unexpected TX buffer");
+	zassert_equal(evt.data.tx.len, len, "Unexpected TX length");
+}
+
+static void no_tx_evt_check(void)
+{
+	zassert_equal(k_msgq_num_used_get(&tx_evt_msgq), 0,
+		      "Unexpected TX event");
+}
+
+static void rx_check(const uint8_t *data, size_t len)
+{
+	for (int i = 0; (rx_len < len) && (i < TX_TIME_MS); i++) {
+		k_msleep(1);
+	}
+
+	zassert_equal(rx_len, len, "Unexpected RX length");
+	zassert_mem_equal(rx_data, data, len, "Unexpected RX data");
+	rx_len = 0;
+}
+
+static void stats_check(uint32_t handshakes, uint32_t bytes, uint32_t aborts)
+{
+	struct nrf_sw_lpuart_stats stats;
+
+	nrf_sw_lpuart_stats_get(lpuart, &stats);
+	zassert_equal(stats.tx_handshakes, handshakes, "Unexpected handshakes");
+	zassert_equal(stats.tx_bytes, bytes, "Unexpected TX bytes");
+	zassert_equal(stats.tx_aborts, aborts, "Unexpected aborts");
+	nrf_sw_lpuart_stats_reset(lpuart);
+}
+
+/* Runs before RX is enabled, so that the receiver does not respond. */
+static void test_tx_timeout(void)
+{
+	int64_t start;
+	int err;
+
+	nrf_sw_lpuart_stats_reset(lpuart);
+
+	err = uart_tx(lpuart, &tx_data[0], 4, TX_TIMEOUT_MS);
+	zassert_equal(err, 0, "Unexpected err:%d", err);
+
+	/* Wait until the batch is started and fill the next one. */
+	k_msleep(LINGER_MS + 1);
+	start = k_uptime_get();
+	err = uart_tx(lpuart, &tx_data[4], 4, TX_TIMEOUT_MS);
+	zassert_equal(err, 0, "Unexpected err:%d", err);
+
+	/* Only the batch being sent times out. The next one is started. */
+	tx_evt_check(UART_TX_ABORTED, &tx_data[0], 0,
+		     K_MSEC(TX_TIMEOUT_MS + TX_TIME_MS));
+	tx_evt_check(UART_TX_ABORTED, &tx_data[4], 0,
+		     K_MSEC(TX_TIMEOUT_MS + TX_TIME_MS));
+	zassert_true(k_uptime_get() - start >= TX_TIMEOUT_MS,
+		     "Timed out too early");
+	no_tx_evt_check();
+	stats_check(2, 0, 2);
+}
+
+static void rx_enable(void)
+{
+	int err;
+
+	rx_len = 0;
+	err = uart_rx_enable(lpuart, rx_buf[rx_buf_idx], sizeof(rx_buf[0]),
+			     SYS_FOREVER_MS);
+	zassert_equal(err, 0, "Failed to enable RX");
+}
+
+static void test_tx_batching(void)
+{
+	int err;
+
+	for (size_t i = 0; i < QUEUE_WRITES; i++) {
+		err = uart_tx(lpuart, &tx_data[4 * i], 4, 100);
+		zassert_equal(err, 0, "Unexpected err:%d", err);
+	}
+
+	/* Buffers must fit and the number of buffers is limited. */
+	err = uart_tx(lpuart, &tx_data[0], 1, 100);
+	zassert_equal(err, -EBUSY, "Unexpected err:%d", err);
+	err = uart_tx(lpuart, tx_data, QUEUE_SIZE + 1, 100);
+	zassert_equal(err, -EINVAL, "Unexpected err:%d", err);
+
+	/* Data from uart_poll_out is added to the same batch. */
+	uart_poll_out(lpuart, tx_data[4 * QUEUE_WRITES]);
+	no_tx_evt_check();
+
+	for (size_t i = 0; i < QUEUE_WRITES; i++) {
+		tx_evt_check(UART_TX_DONE, &tx_data[4 * i], 4,
+			     K_MSEC(LINGER_MS + TX_TIME_MS));
+	}
+
+	no_tx_evt_check();
+	rx_check(tx_data, 4 * QUEUE_WRITES + 1);
+	stats_check(1, 4 * QUEUE_WRITES + 1, 0);
+}
+
+static void test_tx_linger(void)
+{
+	int64_t start;
+	int err;
+
+	/* The batch is sent when the linger time passes. */
+	start = k_uptime_get();
+	err = uart_tx(lpuart, tx_data, 4, 100);
+	zassert_equal(err, 0, "Unexpected err:%d", err);
+
+	tx_evt_check(UART_TX_DONE, tx_data, 4, K_MSEC(LINGER_MS + TX_TIME_MS));
+	zassert_true(k_uptime_get() - start >= LINGER_MS, "Sent too early");
+	rx_check(tx_data, 4);
+
+	/* The full batch is sent immediately. */
+	err = uart_tx(lpuart, tx_data, QUEUE_SIZE, 100);
+	zassert_equal(err, 0, "Unexpected err:%d", err);
+
+	tx_evt_check(UART_TX_DONE, tx_data, QUEUE_SIZE, K_MSEC(TX_TIME_MS));
+	rx_check(tx_data, QUEUE_SIZE);
+	stats_check(2, 4 + QUEUE_SIZE, 0);
+}
+
+static void test_tx_abort(void)
+{
+	int err;
+
+	err = uart_tx_abort(lpuart);
+	zassert_equal(err, -EFAULT, "Unexpected err:%d", err);
+
+	/* The batch being filled is dropped. */
+	err = uart_tx(lpuart, tx_data, 4, 100);
+	zassert_equal(err, 0, "Unexpected err:%d", err);
+
+	err = uart_tx_abort(lpuart);
+	zassert_equal(err, 0, "Unexpected err:%d", err);
+	tx_evt_check(UART_TX_ABORTED, tx_data, 0, K_NO_WAIT);
+
+	k_msleep(LINGER_MS + TX_TIME_MS);
+	no_tx_evt_check();
+	rx_check(NULL, 0);
+	stats_check(0, 0, 0);
+
+	/* Both the batch being sent and the batch being filled are dropped. */
+	err = uart_tx(lpuart, tx_data, QUEUE_SIZE, 100);
+	zassert_equal(err, 0, "Unexpected err:%d", err);
+	err = uart_tx(lpuart, &tx_data[4], 4, 100);
+	zassert_equal(err, 0, "Unexpected err:%d", err);
+
+	err = uart_tx_abort(lpuart);
+	zassert_equal(err, 0, "Unexpected err:%d", err);
+	tx_evt_check(UART_TX_ABORTED, tx_data, 0, K_MSEC(TX_TIME_MS));
+	tx_evt_check(UART_TX_ABORTED, &tx_data[4], 0, K_NO_WAIT);
+
+	k_msleep(LINGER_MS + TX_TIME_MS);
+	no_tx_evt_check();
+	zassert_true(rx_len < QUEUE_SIZE, "Aborted batch received");
+	rx_len = 0;
+	stats_check(1, 0, 1);
+
+	err = uart_tx_abort(lpuart);
+	zassert_equal(err, -EFAULT, "Unexpected err:%d", err);
+}
+
+void test_main(void)
+{
+	int err;
+
+	lpuart = device_get_binding("LPUART");
+	zassert_not_null(lpuart, "Failed to get the device");
+
+	err = uart_callback_set(lpuart, uart_callback, NULL);
+	zassert_equal(err, 0, "Failed to set callback");
+
+	ztest_test_suite(lpuart_tx_queue_test,
+			 ztest_unit_test_setup_teardown(test_tx_timeout,
+							unit_test_noop,
+							rx_enable),
+			 ztest_unit_test(test_tx_batching),
+			 ztest_unit_test(test_tx_linger),
+			 ztest_unit_test(test_tx_abort)
+			 );
+
+	ztest_run_test_suite(lpuart_tx_queue_test);
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef BENCH_TIME_H__
+#define BENCH_TIME_H__
+
+#include <zephyr.h>
+
+#ifdef CONFIG_ARCH_POSIX
+/* Host C library. */
+#include <time.h>
+#endif
+
+/** @brief Get the time for measuring the duration of a benchmark.
+ *
+ * The simulated time of native_posix does not advance while the code runs,
+ * so the host monotonic clock is used there.
+ *
+ * @return Time in microseconds.
+ */
+static inline uint64_t bench_time_us(void)
+{
+#ifdef CONFIG_ARCH_POSIX
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * USEC_PER_SEC + ts.tv_nsec / NSEC_PER_USEC;
+#else
+	return k_ticks_to_us_floor64(k_uptime_ticks());
+#endif
+}
+
+#endif /* BENCH_TIME_H__ */
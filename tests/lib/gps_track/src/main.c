@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <drivers/gps.h>
+#include <sys/base64.h>
+#include <gps_track.h>
+
+#define TOLERANCE 10
+#define TURN_ANGLE 30
+
+/* Number of valid RMC sentences in drive.nmea. The trace is synthetic, not
+ * a recording: a drive at varying speed with turns and stops, with a fix
+ * every 5 seconds.
+ */
+#define TRACE_FIX_COUNT 134
+
+/* Meters per microdegree of latitude. */
+#define METERS_PER_UDEG 0.111195
+
+#define DEG_TO_RAD(deg) ((deg) * 3.14159265358979 / 180.0)
+
+static uint8_t buf[1024];
+/* Base64 encoded track, including the null terminator. */
+static char track_str[(sizeof(buf) + 2) / 3 * 4 + 1];
+static struct gps_track track;
+static struct gps_track_point points[TRACE_FIX_COUNT];
+
+static const struct gps_track_config config = {
+	.tolerance = TOLERANCE,
+	.turn_angle = TURN_ANGLE,
+};
+
+static struct {
+	size_t count;
+	size_t nmea_bytes;
+	int err;
+} replay;
+
+static K_SEM_DEFINE(replay_done, 0, 1);
+
+/* Taylor series, precise enough for latitudes in the tests. */
+static double cos_series(double x)
+{
+	double term = 1.0;
+	double sum = 1.0;
+
+	for (int i = 1; i < 8; i++) {
+		term *= -x * x / ((2 * i - 1) * (2 * i));
+		sum += term;
+	}
+
+	return sum;
+}
+
+static double distance(const struct gps_track_point *a, double lat, double lng)
+{
+	double dy = (a->lat - lat) * METERS_PER_UDEG;
+	double dx = (a->lng - lng) * METERS_PER_UDEG *
+		    cos_series(DEG_TO_RAD(a->lat / 1000000.0));
+
+	return dy * dy + dx * dx;
+}
+
+/* Decode a segment and check that every fix is within the tolerance of the
+ * track interpolated between the decoded fixes. Returns the number of
+ * decoded fixes.
+ */
+static size_t segment_check(const uint8_t *data, size_t len,
+			    const struct gps_track_point *fixes, size_t count)
+{
+	struct gps_track_reader reader;
+	struct gps_track_point prev;
+	struct gps_track_point next;
+	size_t decoded = 1;
+	size_t i = 0;
+	int err;
+
+	zassert_equal(gps_track_reader_init(&reader, data, len), 0, NULL);
+	zassert_equal(gps_track_read(&reader, &prev), 0, NULL);
+	zassert_equal(memcmp(&prev, &fixes[0], sizeof(prev)), 0,
+		      "First fix differs");
+
+	while ((err = gps_track_read(&reader, &next)) == 0) {
+		decoded++;
+		zassert_true(next.time > prev.time, "Time not increasing");
+
+		for (; (i < count) && (fixes[i].time <= next.time); i++) {
+			double f = (double)(fixes[i].time - prev.time) /
+				   (next.time - prev.time);
+			double lat = prev.lat + f * (next.lat - prev.lat);
+			double lng = prev.lng + f * (next.lng - prev.lng);
+
+			zassert_true(distance(&fixes[i], lat, lng) <=
+				     (TOLERANCE + 0.5) * (TOLERANCE + 0.5),
+				     "Fix %d out of tolerance", (int)i);
+		}
+
+		prev = next;
+	}
+
+	zassert_equal(err, -ENODATA, "Segment malformed");
+	zassert_equal(i, count, "Not all fixes covered");
+	zassert_equal(memcmp(&prev, &fixes[count - 1], sizeof(prev)), 0,
+		      "Last fix differs");
+
+	return decoded;
+}
+
+static void fix_set(struct gps_track_fix *fix, uint32_t time, int32_t lat,
+		    int32_t lng)
+{
+	memset(fix, 0, sizeof(*fix));
+	fix->point.time = time;
+	fix->point.lat = lat;
+	fix->point.lng = lng;
+}
+
+static void test_gps_track_line(void)
+{
+	struct gps_track_fix fix;
+	size_t len;
+
+	zassert_equal(gps_track_init(&track, &config, buf, sizeof(buf)), 0,
+		      NULL);
+	zassert_equal(gps_track_flush(&track), 0, "Empty segment flushed");
+
+	/* Constant speed, 10 m per fix, drops all but the ends. */
+	for (int i = 0; i < 10; i++) {
+		fix_set(&fix, 1600000000 + i * 10, 63000000 + i * 90,
+			10000000 + i * 90);
+		points[i] = fix.point;
+		zassert_equal(gps_track_add(&track, &fix), 0, NULL);
+	}
+
+	len = gps_track_flush(&track);
+	zassert_equal(segment_check(buf, len, points, 10), 2, NULL);
+	zassert_true(len <= GPS_TRACK_HEADER_SIZE + 8, "Segment too large");
+
+	/* Stopping halfway is not a straight track in time. */
+	for (int i = 0; i < 10; i++) {
+		fix_set(&fix, 1600000000 + i * 10, 63000000 + MIN(i, 5) * 900,
+			10000000);
+		points[i] = fix.point;
+		zassert_equal(gps_track_add(&track, &fix), 0, NULL);
+	}
+
+	len = gps_track_flush(&track);
+	zassert_equal(segment_check(buf, len, points, 10), 3, NULL);
+}
+
+static void test_gps_track_turn(void)
+{
+	struct gps_track_fix fix;
+	size_t len;
+
+	zassert_equal(gps_track_init(&track, &config, buf, sizeof(buf)), 0,
+		      NULL);
+
+	/* Where the heading changes, the fixes on both sides of the turn
+	 * are kept. The same track without speed is a straight line.
+	 */
+	for (int i = 0; i < 6; i++) {
+		fix_set(&fix, 1000 + i, 63000000 + i * 10, 10000000);
+		fix.speed = 500;
+		fix.heading = (i < 3) ? 0 : 90;
+		points[i] = fix.point;
+		zassert_equal(gps_track_add(&track, &fix), 0, NULL);
+	}
+
+	len = gps_track_flush(&track);
+	zassert_equal(segment_check(buf, len, points, 6), 4, NULL);
+
+	for (int i = 0; i < 6; i++) {
+		fix_set(&fix, 1000 + i, 63000000 + i * 10, 10000000);
+		fix.heading = (i < 3) ? 0 : 90;
+		zassert_equal(gps_track_add(&track, &fix), 0, NULL);
+	}
+
+	len = gps_track_flush(&track);
+	zassert_equal(segment_check(buf, len, points, 6), 2, NULL);
+}
+
+static uint32_t rand_next(uint32_t *state)
+{
+	*state = *state * 1103515245U + 12345U;
+
+	return *state >> 8;
+}
+
+static void test_gps_track_random(void)
+{
+	struct gps_track_fix fix;
+	uint32_t seed = 1;
+	uint32_t time = 2000;
+	int32_t lat = -33000000;
+	int32_t lng = -70000000;
+	size_t len;
+
+	zassert_equal(gps_track_init(&track, &config, buf, sizeof(buf)), 0,
+		      NULL);
+
+	/* A random walk with up to 100 m steps and irregular intervals. */
+	for (int i = 0; i < 50; i++) {
+		lat += (int32_t)(rand_next(&seed) % 1800) - 900;
+		lng += (int32_t)(rand_next(&seed) % 1800) - 900;
+		time += 1 + rand_next(&seed) % 300;
+		fix_set(&fix, time, lat, lng);
+		points[i] = fix.point;
+		zassert_equal(gps_track_add(&track, &fix), 0, NULL);
+	}
+
+	len = gps_track_flush(&track);
+	segment_check(buf, len, points, 50);
+}
+
+static void test_gps_track_flush_request(void)
+{
+	struct gps_track_config cfg = config;
+	struct gps_track_fix fix;
+	size_t len;
+	int err;
+
+	/* Room for the header and two fixes only. */
+	zassert_equal(gps_track_init(&track, &cfg, buf,
+				     GPS_TRACK_HEADER_SIZE +
+				     2 * GPS_TRACK_POINT_MAX_SIZE - 1),
+		      -EINVAL, NULL);
+	zassert_equal(gps_track_init(&track, &cfg, buf,
+				     GPS_TRACK_HEADER_SIZE +
+				     2 * GPS_TRACK_POINT_MAX_SIZE), 0, NULL);
+
+	for (int i = 0; i < 3; i++) {
+		fix_set(&fix, 100 + i, i * 100000, (i % 2) * 100000);
+		points[i] = fix.point;
+		err = gps_track_add(&track, &fix);
+		zassert_equal(err, (i < 2) ? 0 : 1, "Fix %d: %d", i, err);
+	}
+
+	/* The zigzag needs the third fix written, which does not fit. */
+	fix_set(&fix, 103, 300000, 100000);
+	zassert_equal(gps_track_add(&track, &fix), -ENOMEM, NULL);
+
+	len = gps_track_flush(&track);
+	zassert_equal(segment_check(buf, len, points, 3), 3, NULL);
+
+	/* Moving away from the start of the segment requests a flush. */
+	cfg.flush_distance = 1000;
+	zassert_equal(gps_track_init(&track, &cfg, buf, sizeof(buf)), 0,
+		      NULL);
+
+	for (int i = 0; i < 10; i++) {
+		fix_set(&fix, 100 + i, i * 2000, 0);
+		err = gps_track_add(&track, &fix);
+		zassert_equal(err, (i < 5) ? 0 : 1, "Fix %d: %d", i, err);
+	}
+}
+
+static void test_gps_track_invalid(void)
+{
+	struct gps_track_reader reader;
+	struct gps_track_point point;
+	struct gps_track_fix fix;
+	size_t len;
+
+	zassert_equal(gps_track_init(&track, &config, buf, sizeof(buf)), 0,
+		      NULL);
+
+	fix_set(&fix, 100, 0, 0);
+	zassert_equal(gps_track_add(&track, &fix), 0, NULL);
+	zassert_equal(gps_track_add(&track, &fix), -EINVAL, NULL);
+	fix_set(&fix, 200, 1000, 0);
+	zassert_equal(gps_track_add(&track, &fix), 0, NULL);
+	fix_set(&fix, 150, 1000, 0);
+	zassert_equal(gps_track_add(&track, &fix), -EINVAL, NULL);
+
+	len = gps_track_flush(&track);
+	zassert_equal(len, GPS_TRACK_HEADER_SIZE + 4, NULL);
+
+	/* Truncated in the middle of a varint. */
+	buf[len - 1] |= 0x80;
+	zassert_equal(gps_track_reader_init(&reader, buf, len), 0, NULL);
+	zassert_equal(gps_track_read(&reader, &point), 0, NULL);
+	zassert_equal(gps_track_read(&reader, &point), -EBADMSG, NULL);
+
+	zassert_equal(gps_track_reader_init(&reader, buf,
+					    GPS_TRACK_HEADER_SIZE - 1),
+		      -EBADMSG, NULL);
+
+	buf[0] = GPS_TRACK_FORMAT_VERSION + 1;
+	zassert_equal(gps_track_reader_init(&reader, buf, len), -EBADMSG,
+		      NULL);
+}
+
+static void gps_handler(const struct device *dev, struct gps_event *evt)
+{
+	struct gps_track_fix fix;
+	int err;
+
+	if (replay.count >= TRACE_FIX_COUNT) {
+		return;
+	}
+
+	switch (evt->type) {
+	case GPS_EVT_PVT_FIX:
+		gps_track_fix_from_pvt(&evt->pvt, &fix);
+		points[replay.count] = fix.point;
+
+		err = gps_track_add(&track, &fix);
+		if (err && !replay.err) {
+			replay.err = err;
+		}
+		break;
+	case GPS_EVT_NMEA_FIX:
+		/* Without the track, the asset tracker sends the GPGGA sentence
+		 * of each fix, generated here by the simulator.
+		 */
+		replay.nmea_bytes += evt->nmea.len;
+
+		if (++replay.count == TRACE_FIX_COUNT) {
+			k_sem_give(&replay_done);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void test_gps_track_replay(void)
+{
+	const struct device *gps_dev;
+	struct gps_config gps_cfg = {
+		.nav_mode = GPS_NAV_MODE_CONTINUOUS,
+		.timeout = 1,
+		.interval = 2,
+	};
+	size_t decoded;
+	size_t str_len;
+	size_t len;
+
+	zassert_equal(gps_track_init(&track, &config, buf, sizeof(buf)), 0,
+		      NULL);
+
+	gps_dev = device_get_binding(CONFIG_GPS_SIM_DEV_NAME);
+	zassert_not_null(gps_dev, "GPS simulator not found");
+	zassert_equal(gps_init(gps_dev, gps_handler), 0, NULL);
+	zassert_equal(gps_start(gps_dev, &gps_cfg), 0, NULL);
+
+	zassert_equal(k_sem_take(&replay_done, K_SECONDS(100)), 0,
+		      "Replay timed out");
+	gps_stop(gps_dev);
+
+	zassert_equal(replay.err, 0, "Adding fix failed: %d", replay.err);
+
+	len = gps_track_flush(&track);
+	decoded = segment_check(buf, len, points, TRACE_FIX_COUNT);
+
+	/* The asset tracker sends the track base64 encoded. */
+	zassert_equal(base64_encode(track_str, sizeof(track_str), &str_len,
+				    buf, len), 0, NULL);
+
+	TC_PRINT("%d fixes, %d kept, %d bytes of track\n",
+		 TRACE_FIX_COUNT, (int)decoded, (int)len);
+	TC_PRINT("payload: %d bytes of NMEA, %d bytes of base64 track\n",
+		 (int)replay.nmea_bytes, (int)str_len);
+	TC_PRINT("compression ratio %d:1\n",
+		 (int)(replay.nmea_bytes / str_len));
+
+	zassert_true(replay.nmea_bytes >= 10 * str_len,
+		     "Compression below 10:1");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(gps_track_test,
+			 ztest_unit_test(test_gps_track_line),
+			 ztest_unit_test(test_gps_track_turn),
+			 ztest_unit_test(test_gps_track_random),
+			 ztest_unit_test(test_gps_track_flush_request),
+			 ztest_unit_test(test_gps_track_invalid),
+			 ztest_unit_test(test_gps_track_replay)
+			 );
+
+	ztest_run_test_suite(gps_track_test);
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <json_reader.h>
+
+static struct json_token tokens[32];
+static struct json_reader r;
+
+static const char doc[] =
+	"{\"state\": {\"config\": {\"GPS\": {\"enable\": true, "
+	"\"interval\": 60.5}}, \"items\": [1, \"two\", null, {}]},"
+	" \"a/b~c\": -2e3, \"esc\": \"q\\\"\\u00e6\\n\"}";
+
+static void parse_doc(void)
+{
+	zassert_equal(json_reader_parse(&r, doc, sizeof(doc) - 1, tokens,
+					ARRAY_SIZE(tokens)), 21,
+		      "Wrong token count");
+}
+
+static void test_json_reader_lookup(void)
+{
+	double num;
+	bool enable;
+	int tok;
+
+	parse_doc();
+
+	zassert_equal(json_reader_type(&r, 0), JSON_TOKEN_OBJECT, NULL);
+
+	tok = json_reader_find(&r, 0, "/state/config/GPS/enable");
+	zassert_equal(json_reader_bool(&r, tok, &enable), 0, NULL);
+	zassert_true(enable, NULL);
+
+	tok = json_reader_find(&r, 0, "/state/config/GPS");
+	zassert_equal(json_reader_num(&r, json_reader_member(&r, tok,
+							      "interval"),
+				      &num), 0, NULL);
+	zassert_equal(num, 60.5, NULL);
+
+	zassert_equal(json_reader_num(&r, json_reader_find(&r, 0, "/a~1b~0c"),
+				      &num), 0, NULL);
+	zassert_equal(num, -2000, NULL);
+
+	zassert_equal(json_reader_find(&r, 0, ""), 0, NULL);
+}
+
+static void test_json_reader_array(void)
+{
+	int tok;
+
+	parse_doc();
+
+	tok = json_reader_find(&r, 0, "/state/items/1");
+	zassert_true(json_reader_str_eq(&r, tok, "two"), NULL);
+
+	tok = json_reader_find(&r, 0, "/state/items/2");
+	zassert_equal(json_reader_type(&r, tok), JSON_TOKEN_NULL, NULL);
+
+	tok = json_reader_find(&r, 0, "/state/items/3");
+	zassert_equal(json_reader_type(&r, tok), JSON_TOKEN_OBJECT, NULL);
+
+	zassert_equal(json_reader_find(&r, 0, "/state/items/4"), -ENOENT,
+		      NULL);
+	zassert_equal(json_reader_find(&r, 0, "/state/items/01"), -ENOENT,
+		      NULL);
+}
+
+static void test_json_reader_missing(void)
+{
+	double num;
+	int tok;
+
+	parse_doc();
+
+	tok = json_reader_find(&r, 0, "/state/missing");
+	zassert_equal(tok, -ENOENT, NULL);
+
+	/* Failed lookups propagate through chained calls. */
+	zassert_equal(json_reader_member(&r, tok, "x"), -ENOENT, NULL);
+	zassert_equal(json_reader_type(&r, tok), JSON_TOKEN_NONE, NULL);
+	zassert_equal(json_reader_num(&r, tok, &num), -EINVAL, NULL);
+
+	/* Wrong type */
+	tok = json_reader_find(&r, 0, "/state/config/GPS/enable");
+	zassert_equal(json_reader_num(&r, tok, &num), -EINVAL, NULL);
+}
+
+static void test_json_reader_strings(void)
+{
+	char doc_copy[sizeof(doc)];
+	char buf[8];
+	char *str;
+	int tok;
+
+	parse_doc();
+
+	tok = json_reader_member(&r, 0, "esc");
+	zassert_true(json_reader_str_eq(&r, tok, "q\"\xc3\xa6\n"), NULL);
+	zassert_false(json_reader_str_eq(&r, tok, "q\""), NULL);
+
+	zassert_equal(json_reader_str_copy(&r, tok, buf, sizeof(buf)), 5,
+		      NULL);
+	zassert_true(strcmp(buf, "q\"\xc3\xa6\n") == 0, NULL);
+
+	/* Truncated copy */
+	zassert_equal(json_reader_str_copy(&r, tok, buf, 3), 5, NULL);
+	zassert_true(strcmp(buf, "q\"") == 0, NULL);
+
+	/* In place, in a writable copy of the document */
+	memcpy(doc_copy, doc, sizeof(doc));
+	zassert_true(json_reader_parse(&r, doc_copy, sizeof(doc) - 1, tokens,
+				       ARRAY_SIZE(tokens)) > 0, NULL);
+	str = json_reader_str_inplace(&r, json_reader_member(&r, 0, "esc"),
+				      doc_copy);
+	zassert_not_null(str, NULL);
+	zassert_true(strcmp(str, "q\"\xc3\xa6\n") == 0, NULL);
+}
+
+static void test_json_reader_invalid(void)
+{
+	static const char *const invalid[] = {
+		"",
+		"{",
+		"{\"a\":1,}",
+		"{\"a\" 1}",
+		"{a:1}",
+		"[1 2]",
+		"[1,]",
+		"{\"a\":1]",
+		"01",
+		"-",
+		"1.",
+		"tru",
+		"\"\\x\"",
+		"\"\\u12\"",
+		"\"a\nb\"",
+		"{} {}",
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(invalid); i++) {
+		zassert_equal(json_reader_parse(&r, invalid[i],
+						strlen(invalid[i]), tokens,
+						ARRAY_SIZE(tokens)),
+			      -EINVAL, "Accepted %s", invalid[i]);
+	}
+
+	zassert_equal(json_reader_parse(&r, doc, sizeof(doc) - 1, tokens, 10),
+		      -ENOMEM, NULL);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(json_reader_test,
+			 ztest_unit_test(test_json_reader_lookup),
+			 ztest_unit_test(test_json_reader_array),
+			 ztest_unit_test(test_json_reader_missing),
+			 ztest_unit_test(test_json_reader_strings),
+			 ztest_unit_test(test_json_reader_invalid)
+			 );
+
+	ztest_run_test_suite(json_reader_test);
+}
@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <stdio.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <math.h>
+#include <ztest.h>
+#include <bench_time.h>
+#include <json_writer.h>
+#include <cJSON.h>
+#include "service_info.h"
+
+#define BENCH_ITERATIONS 1000
+
+static char buf[256];
+
+/* Heap use of cJSON, tracked through its allocation hooks. */
+static size_t heap_allocs;
+static size_t heap_bytes;
+static size_t heap_live;
+static size_t heap_peak;
+
+static void *counting_malloc(size_t size)
+{
+	size_t *block = k_malloc(sizeof(size_t) + size);
+
+	if (block == NULL) {
+		return NULL;
+	}
+
+	*block = size;
+	heap_allocs++;
+	heap_bytes += size;
+	heap_live += size;
+	heap_peak = MAX(heap_peak, heap_live);
+
+	return block + 1;
+}
+
+static void counting_free(void *ptr)
+{
+	size_t *block = (size_t *)ptr - 1;
+
+	if (ptr == NULL) {
+		return;
+	}
+
+	heap_live -= *block;
+	k_free(block);
+}
+
+static void heap_stats_reset(void)
+{
+	heap_allocs = 0;
+	heap_bytes = 0;
+	heap_live = 0;
+	heap_peak = 0;
+}
+
+static int write_doc(char *out, size_t size)
+{
+	struct json_writer w;
+
+	json_writer_init(&w, out, size);
+	json_writer_object_begin(&w, NULL);
+	json_writer_str(&w, "str", "text");
+	json_writer_int(&w, "int", -42);
+	json_writer_bool(&w, "bool", true);
+	json_writer_null(&w, "null");
+	json_writer_array_begin(&w, "arr");
+	json_writer_int(&w, NULL, 1);
+	json_writer_object_begin(&w, NULL);
+	json_writer_object_end(&w);
+	json_writer_array_begin(&w, NULL);
+	json_writer_array_end(&w);
+	json_writer_array_end(&w);
+	json_writer_object_end(&w);
+
+	return json_writer_finish(&w);
+}
+
+static void test_json_writer_doc(void)
+{
+	static const char expected[] =
+		"{\"str\":\"text\",\"int\":-42,\"bool\":true,\"null\":null,"
+		"\"arr\":[1,{},[]]}";
+
+	zassert_equal(write_doc(buf, sizeof(buf)), strlen(expected),
+		      "Wrong length");
+	zassert_true(strcmp(buf, expected) == 0, "Wrong output: %s", buf);
+}
+
+static void test_json_writer_escape(void)
+{
+	struct json_writer w;
+
+	json_writer_init(&w, buf, sizeof(buf));
+	json_writer_array_begin(&w, NULL);
+	json_writer_str(&w, NULL, "q\"b\\n\nt\tc\x01");
+	json_writer_str(&w, NULL, NULL);
+	json_writer_array_end(&w);
+
+	zassert_true(json_writer_finish(&w) > 0, "Write failed");
+	zassert_true(strcmp(buf, "[\"q\\\"b\\\\n\\nt\\tc\\u0001\",null]") == 0,
+		     "Wrong output: %s", buf);
+}
+
+static void test_json_writer_numbers(void)
+{
+	struct json_writer w;
+
+	json_writer_init(&w, buf, sizeof(buf));
+	json_writer_array_begin(&w, NULL);
+	json_writer_int(&w, NULL, INT64_MIN);
+	json_writer_num(&w, NULL, 3600.0);
+	json_writer_num(&w, NULL, -0.5);
+	json_writer_num(&w, NULL, NAN);
+	json_writer_array_end(&w);
+
+	zassert_true(json_writer_finish(&w) > 0, "Write failed");
+	zassert_true(strcmp(buf, "[-9223372036854775808,3600,-0.5,null]") == 0,
+		     "Wrong output: %s", buf);
+}
+
+static void test_json_writer_measure(void)
+{
+	int len = write_doc(buf, sizeof(buf));
+
+	zassert_equal(write_doc(NULL, 0), len, "Measured length differs");
+}
+
+static void test_json_writer_no_space(void)
+{
+	int len = write_doc(buf, sizeof(buf));
+
+	/* The null terminator must fit as well. */
+	zassert_equal(write_doc(buf, len), -ENOMEM, "Overflow not detected");
+	zassert_equal(write_doc(buf, len + 1), len, "Exact fit failed");
+}
+
+static void test_json_writer_malformed(void)
+{
+	struct json_writer w;
+
+	/* Member without a name */
+	json_writer_init(&w, buf, sizeof(buf));
+	json_writer_object_begin(&w, NULL);
+	zassert_equal(json_writer_int(&w, NULL, 1), -EINVAL, "No error");
+	zassert_equal(json_writer_finish(&w), -EINVAL, "Error not sticky");
+
+	/* Array element with a name */
+	json_writer_init(&w, buf, sizeof(buf));
+	json_writer_array_begin(&w, NULL);
+	zassert_equal(json_writer_int(&w, "a", 1), -EINVAL, "No error");
+
+	/* Mismatched and unclosed containers */
+	json_writer_init(&w, buf, sizeof(buf));
+	json_writer_object_begin(&w, NULL);
+	zassert_equal(json_writer_array_end(&w), -EINVAL, "No error");
+
+	json_writer_init(&w, buf, sizeof(buf));
+	json_writer_object_begin(&w, NULL);
+	zassert_equal(json_writer_finish(&w), -EINVAL, "Unclosed accepted");
+
+	/* Second value at the top level and empty document */
+	json_writer_init(&w, buf, sizeof(buf));
+	json_writer_null(&w, NULL);
+	zassert_equal(json_writer_null(&w, NULL), -EINVAL, "No error");
+
+	json_writer_init(&w, buf, sizeof(buf));
+	zassert_equal(json_writer_finish(&w), -EINVAL, "Empty accepted");
+}
+
+/* Implementation of service_info_json_object_encode() before it was ported
+ * to the JSON writer, used as the reference for the benchmark.
+ */
+static int service_info_cjson_encode(const char *const ui[],
+				     const uint32_t ui_count,
+				     const char *const fota[],
+				     const uint32_t fota_count,
+				     const uint16_t fota_version,
+				     cJSON *const obj_out)
+{
+	cJSON *service_info_obj;
+	cJSON *array;
+	char fota_name[sizeof("fota_v") + 5];
+
+	service_info_obj = cJSON_CreateObject();
+	if (service_info_obj == NULL) {
+		return -ENOMEM;
+	}
+
+	array = cJSON_AddArrayToObject(service_info_obj, "ui");
+	for (uint32_t cnt = 0; cnt < ui_count; ++cnt) {
+		cJSON_AddItemToArray(array, cJSON_CreateString(ui[cnt]));
+	}
+
+	snprintf(fota_name, sizeof(fota_name), "fota_v%hu", fota_version);
+	array = cJSON_AddArrayToObject(service_info_obj, fota_name);
+	for (uint32_t cnt = 0; cnt < fota_count; ++cnt) {
+		cJSON_AddItemToArray(array, cJSON_CreateString(fota[cnt]));
+	}
+
+	cJSON_AddItemToObject(obj_out, "serviceInfo", service_info_obj);
+
+	return 0;
+}
+
+static const char *const ui[] = {
+	"GPS", "FLIP", "TEMP", "HUMID", "AIR_PRESS", "BUTTON", "RSRP"
+};
+static const char *const fota[] = {
+	SERVICE_INFO_FOTA_STR_APP, SERVICE_INFO_FOTA_STR_MODEM,
+	SERVICE_INFO_FOTA_STR_BOOTLOADER
+};
+
+/* Same steps as the cJSON based encoders of the device status: build the
+ * tree, print it to a heap string, delete the tree.
+ */
+static char *status_cjson(void)
+{
+	cJSON *root = cJSON_CreateObject();
+	cJSON *state = cJSON_AddObjectToObject(root, "state");
+	cJSON *reported = cJSON_AddObjectToObject(state, "reported");
+	cJSON *device = cJSON_AddObjectToObject(reported, "device");
+	char *str;
+
+	service_info_cjson_encode(ui, ARRAY_SIZE(ui), fota, ARRAY_SIZE(fota),
+				  SERVICE_INFO_FOTA_VER_CURRENT, device);
+	str = cJSON_PrintUnformatted(root);
+	cJSON_Delete(root);
+
+	return str;
+}
+
+static int status_write(struct json_writer *w)
+{
+	json_writer_object_begin(w, NULL);
+	json_writer_object_begin(w, "state");
+	json_writer_object_begin(w, "reported");
+	json_writer_object_begin(w, "device");
+	service_info_json_write(ui, ARRAY_SIZE(ui), fota, ARRAY_SIZE(fota),
+				SERVICE_INFO_FOTA_VER_CURRENT, w);
+	json_writer_object_end(w);
+	json_writer_object_end(w);
+	json_writer_object_end(w);
+	json_writer_object_end(w);
+
+	return json_writer_finish(w);
+}
+
+/* Same steps as the ported encoders: measure, allocate, write. */
+static char *status_writer(void)
+{
+	struct json_writer w;
+	char *str;
+	int len;
+
+	json_writer_init(&w, NULL, 0);
+	len = status_write(&w);
+	if (len < 0) {
+		return NULL;
+	}
+
+	str = counting_malloc(len + 1);
+	if (str == NULL) {
+		return NULL;
+	}
+
+	json_writer_init(&w, str, len + 1);
+	if (status_write(&w) != len) {
+		counting_free(str);
+		return NULL;
+	}
+
+	return str;
+}
+
+static void test_json_writer_benchmark(void)
+{
+	static cJSON_Hooks hooks = {
+		.malloc_fn = counting_malloc,
+		.free_fn = counting_free,
+	};
+	uint64_t start;
+	uint64_t cjson_us;
+	uint64_t writer_us;
+	size_t allocs;
+	size_t bytes;
+	char *ref;
+	char *str;
+
+	cJSON_InitHooks(&hooks);
+
+	/* Both paths must produce the same document. */
+	heap_stats_reset();
+	ref = status_cjson();
+	zassert_not_null(ref, "cJSON failed");
+	TC_PRINT("cJSON: %zu allocations, %zu bytes, %zu bytes peak\n",
+		 heap_allocs, heap_bytes, heap_peak);
+
+	allocs = heap_allocs;
+	bytes = heap_bytes;
+	str = status_writer();
+	zassert_not_null(str, "Writer failed");
+	TC_PRINT("json_writer: %zu allocations, %zu bytes\n",
+		 heap_allocs - allocs, heap_bytes - bytes);
+
+	zassert_true(strcmp(str, ref) == 0, "Output differs: %s", str);
+	counting_free(str);
+	cJSON_free(ref);
+
+	start = bench_time_us();
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		cJSON_free(status_cjson());
+	}
+	cjson_us = bench_time_us() - start;
+
+	start = bench_time_us();
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		counting_free(status_writer());
+	}
+	writer_us = bench_time_us() - start;
+
+	TC_PRINT("host ns per document: cJSON %u, json_writer %u\n",
+		 (uint32_t)(cjson_us * NSEC_PER_USEC / BENCH_ITERATIONS),
+		 (uint32_t)(writer_us * NSEC_PER_USEC / BENCH_ITERATIONS));
+
+	zassert_true(cjson_us > 0, "Host clock did not advance");
+	zassert_equal(heap_live, 0, "Memory leaked");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(json_writer_test,
+			 ztest_unit_test(test_json_writer_doc),
+			 ztest_unit_test(test_json_writer_escape),
+			 ztest_unit_test(test_json_writer_numbers),
+			 ztest_unit_test(test_json_writer_measure),
+			 ztest_unit_test(test_json_writer_no_space),
+			 ztest_unit_test(test_json_writer_malformed),
+			 ztest_unit_test(test_json_writer_benchmark)
+			 );
+
+	ztest_run_test_suite(json_writer_test);
+}
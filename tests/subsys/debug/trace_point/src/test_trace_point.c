@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <ztest.h>
+#include <string.h>
+#include <debug/trace_point.h>
+
+#define BUF_SIZE CONFIG_TRACE_POINT_BUF_SIZE
+
+TRACE_POINT_DEFINE(test_a);
+TRACE_POINT_DEFINE(test_b);
+
+static uint16_t id_get(const char *name)
+{
+	const struct trace_point *tp;
+
+	for (uint16_t id = 0; (tp = trace_point_get(id)) != NULL; id++) {
+		if (strcmp(tp->name, name) == 0) {
+			return id;
+		}
+	}
+
+	zassert_unreachable("Trace point %s not found", name);
+	return 0;
+}
+
+static void flush(void)
+{
+	struct trace_point_record record;
+
+	while (trace_point_read(&record, 1, NULL)) {
+	}
+}
+
+static void test_record(void)
+{
+	struct trace_point_record records[4];
+	uint32_t lost;
+	size_t count;
+
+	zassert_equal(trace_point_init(), 0, "Init failed");
+	flush();
+
+	TRACE_POINT(test_a, 1);
+	TRACE_POINT(test_b, 2);
+	TRACE_POINT(test_a, 3);
+
+	count = trace_point_read(records, ARRAY_SIZE(records), &lost);
+	zassert_equal(count, 3, "Unexpected count:%zu", count);
+	zassert_equal(lost, 0, "Unexpected lost:%u", lost);
+
+	zassert_equal(records[0].id, id_get("test_a"), "Unexpected id");
+	zassert_equal(records[1].id, id_get("test_b"), "Unexpected id");
+	zassert_equal(records[2].id, id_get("test_a"), "Unexpected id");
+
+	for (size_t i = 0; i < count; i++) {
+		zassert_equal(records[i].arg, i + 1, "Unexpected arg");
+	}
+
+	zassert_true(records[1].timestamp - records[0].timestamp <
+		     trace_point_timestamp_freq_get(), "Unexpected timestamp");
+	zassert_true(records[2].timestamp - records[1].timestamp <
+		     trace_point_timestamp_freq_get(), "Unexpected timestamp");
+
+	count = trace_point_read(records, ARRAY_SIZE(records), &lost);
+	zassert_equal(count, 0, "Unexpected count:%zu", count);
+}
+
+static void test_overwrite(void)
+{
+	struct trace_point_record records[BUF_SIZE];
+	uint32_t lost;
+	size_t count;
+
+	flush();
+
+	for (uint32_t i = 0; i < BUF_SIZE + 5; i++) {
+		TRACE_POINT(test_a, i);
+	}
+
+	count = trace_point_read(records, ARRAY_SIZE(records), &lost);
+	zassert_equal(count, BUF_SIZE, "Unexpected count:%zu", count);
+	zassert_equal(lost, 5, "Unexpected lost:%u", lost);
+	zassert_equal(records[0].arg, 5, "Oldest records not overwritten");
+	zassert_equal(records[BUF_SIZE - 1].arg, BUF_SIZE + 4,
+		      "Unexpected arg");
+}
+
+static void test_disable(void)
+{
+	struct trace_point_record record;
+
+	flush();
+
+	trace_point_enable(false);
+	TRACE_POINT(test_a, 0);
+	trace_point_enable(true);
+
+	zassert_equal(trace_point_read(&record, 1, NULL), 0,
+		      "Recorded when disabled");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(trace_point,
+		ztest_unit_test(test_record),
+		ztest_unit_test(test_overwrite),
+		ztest_unit_test(test_disable)
+	);
+	ztest_run_test_suite(trace_point);
+}
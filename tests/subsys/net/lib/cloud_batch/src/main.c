@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <net/cloud.h>
+#include <net/cloud_batch.h>
+
+static char sent_buf[CONFIG_CLOUD_BATCH_BUF_SIZE + 1];
+static struct cloud_msg sent_msg;
+static int send_count;
+static int send_err;
+
+static int test_backend_send(const struct cloud_backend *const backend,
+			     const struct cloud_msg *const msg)
+{
+	zassert_true(msg->len < sizeof(sent_buf), "Batch too large");
+
+	if (send_err) {
+		return send_err;
+	}
+
+	memcpy(sent_buf, msg->buf, msg->len);
+	sent_buf[msg->len] = '\0';
+	sent_msg = *msg;
+	send_count++;
+
+	return 0;
+}
+
+static const struct cloud_api test_backend_api = {
+	.send = test_backend_send,
+};
+
+CLOUD_BACKEND_DEFINE(TEST_BACKEND, test_backend_api);
+
+static void add(const char *payload, enum cloud_qos qos,
+		enum cloud_endpoint_type ep, enum cloud_batch_prio prio)
+{
+	struct cloud_msg msg = {
+		.buf = (char *)payload,
+		.len = strlen(payload),
+		.qos = qos,
+		.endpoint.type = ep,
+	};
+
+	zassert_equal(cloud_batch_add(&msg, prio), 0, "Add failed");
+}
+
+static void setup(void)
+{
+	struct cloud_backend *backend = cloud_get_binding("TEST_BACKEND");
+
+	zassert_not_null(backend, "Test backend not found");
+	zassert_equal(cloud_batch_init(backend), 0, "Init failed");
+
+	send_count = 0;
+	send_err = 0;
+	memset(sent_buf, 0, sizeof(sent_buf));
+}
+
+static void test_cloud_batch_flush(void)
+{
+	setup();
+
+	add("{\"a\":1}", CLOUD_QOS_AT_MOST_ONCE, CLOUD_EP_MSG,
+	    CLOUD_BATCH_PRIO_LOW);
+	add("{\"b\":2}", CLOUD_QOS_AT_LEAST_ONCE, CLOUD_EP_MSG,
+	    CLOUD_BATCH_PRIO_LOW);
+	zassert_equal(send_count, 0, "Batch sent too early");
+	zassert_equal(cloud_batch_count(), 2, "Wrong message count");
+
+	zassert_equal(cloud_batch_flush(), 0, "Flush failed");
+	zassert_equal(send_count, 1, "Batch not sent");
+	zassert_equal(cloud_batch_count(), 0, "Batch not emptied");
+	zassert_equal(strcmp(sent_buf, "[{\"a\":1},{\"b\":2}]"), 0,
+		      "Wrong payload: %s", sent_buf);
+	zassert_equal(sent_msg.qos, CLOUD_QOS_AT_LEAST_ONCE, "Wrong QoS");
+	zassert_equal(sent_msg.endpoint.type, CLOUD_EP_MSG, "Wrong endpoint");
+
+	/* Flushing an empty batch is a no-op */
+	zassert_equal(cloud_batch_flush(), 0, "Flush failed");
+	zassert_equal(send_count, 1, "Empty batch sent");
+}
+
+static void test_cloud_batch_prio(void)
+{
+	setup();
+
+	add("1", CLOUD_QOS_AT_MOST_ONCE, CLOUD_EP_MSG, CLOUD_BATCH_PRIO_LOW);
+	add("2", CLOUD_QOS_AT_MOST_ONCE, CLOUD_EP_MSG, CLOUD_BATCH_PRIO_HIGH);
+	zassert_equal(send_count, 1, "High priority did not flush");
+	zassert_equal(strcmp(sent_buf, "[1,2]"), 0,
+		      "Wrong payload: %s", sent_buf);
+}
+
+static void test_cloud_batch_size(void)
+{
+	const char *payload = "\"0123456789abcdef\"";
+
+	setup();
+
+	/* 18 bytes plus a 2 byte header per message, flush size is 48 */
+	add(payload, CLOUD_QOS_AT_MOST_ONCE, CLOUD_EP_MSG,
+	    CLOUD_BATCH_PRIO_LOW);
+	add(payload, CLOUD_QOS_AT_MOST_ONCE, CLOUD_EP_MSG,
+	    CLOUD_BATCH_PRIO_LOW);
+	zassert_equal(send_count, 0, "Batch sent too early");
+
+	add(payload, CLOUD_QOS_AT_MOST_ONCE, CLOUD_EP_MSG,
+	    CLOUD_BATCH_PRIO_LOW);
+	zassert_equal(send_count, 1, "Size threshold did not flush");
+	zassert_equal(strlen(sent_buf), 3 * strlen(payload) + 4,
+		      "Wrong payload length");
+}
+
+static void test_cloud_batch_endpoint(void)
+{
+	setup();
+
+	add("1", CLOUD_QOS_AT_MOST_ONCE, CLOUD_EP_MSG, CLOUD_BATCH_PRIO_LOW);
+	add("2", CLOUD_QOS_AT_MOST_ONCE, CLOUD_EP_STATE, CLOUD_BATCH_PRIO_LOW);
+	zassert_equal(send_count, 1, "Endpoint change did not flush");
+	zassert_equal(strcmp(sent_buf, "[1]"), 0,
+		      "Wrong payload: %s", sent_buf);
+	zassert_equal(sent_msg.endpoint.type, CLOUD_EP_MSG, "Wrong endpoint");
+	zassert_equal(cloud_batch_count(), 1, "Wrong message count");
+
+	cloud_batch_clear();
+}
+
+static void test_cloud_batch_time(void)
+{
+	setup();
+
+	add("1", CLOUD_QOS_AT_MOST_ONCE, CLOUD_EP_MSG, CLOUD_BATCH_PRIO_LOW);
+	zassert_equal(send_count, 0, "Batch sent too early");
+
+	k_sleep(K_MSEC(CONFIG_CLOUD_BATCH_FLUSH_TIME * MSEC_PER_SEC + 100));
+	zassert_equal(send_count, 1, "Flush time did not flush");
+}
+
+static void test_cloud_batch_too_large(void)
+{
+	char payload[CONFIG_CLOUD_BATCH_BUF_SIZE];
+	struct cloud_msg msg = {
+		.buf = payload,
+		.len = sizeof(payload),
+		.endpoint.type = CLOUD_EP_MSG,
+	};
+
+	setup();
+
+	memset(payload, '0', sizeof(payload));
+	zassert_equal(cloud_batch_add(&msg, CLOUD_BATCH_PRIO_LOW), -EMSGSIZE,
+		      "Oversized message accepted");
+}
+
+static void test_cloud_batch_send_error(void)
+{
+	struct cloud_msg msg = {
+		.buf = "3",
+		.len = 1,
+		.endpoint.type = CLOUD_EP_STATE,
+	};
+
+	setup();
+
+	add("1", CLOUD_QOS_AT_MOST_ONCE, CLOUD_EP_MSG, CLOUD_BATCH_PRIO_LOW);
+	add("2", CLOUD_QOS_AT_MOST_ONCE, CLOUD_EP_MSG, CLOUD_BATCH_PRIO_LOW);
+
+	/* Failed send keeps the messages */
+	send_err = -EAGAIN;
+	zassert_equal(cloud_batch_flush(), -EAGAIN, "Error not returned");
+	zassert_equal(cloud_batch_count(), 2, "Messages dropped");
+
+	/* Endpoint change flush fails, the new message is not added */
+	zassert_equal(cloud_batch_add(&msg, CLOUD_BATCH_PRIO_LOW), -EAGAIN,
+		      "Error not returned");
+	zassert_equal(cloud_batch_count(), 2, "Wrong message count");
+
+	/* Retried after the flush time */
+	send_err = 0;
+	k_sleep(K_MSEC(CONFIG_CLOUD_BATCH_FLUSH_TIME * MSEC_PER_SEC + 100));
+	zassert_equal(send_count, 1, "Send not retried");
+	zassert_equal(strcmp(sent_buf, "[1,2]"), 0,
+		      "Wrong payload: %s", sent_buf);
+	zassert_equal(cloud_batch_count(), 0, "Batch not emptied");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(cloud_batch_test,
+			 ztest_unit_test(test_cloud_batch_flush),
+			 ztest_unit_test(test_cloud_batch_prio),
+			 ztest_unit_test(test_cloud_batch_size),
+			 ztest_unit_test(test_cloud_batch_endpoint),
+			 ztest_unit_test(test_cloud_batch_time),
+			 ztest_unit_test(test_cloud_batch_too_large),
+			 ztest_unit_test(test_cloud_batch_send_error)
+			 );
+
+	ztest_run_test_suite(cloud_batch_test);
+}
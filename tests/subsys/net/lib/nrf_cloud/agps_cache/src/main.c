@@ -0,0 +1,496 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <settings/settings.h>
+#include <date_time.h>
+
+#include "nrf_cloud_agps_cache.h"
+
+#define SETTINGS_NAME "nrf_cloud_agps"
+
+#define EPHE_VALIDITY_S	(CONFIG_NRF_CLOUD_AGPS_CACHE_EPHE_VALIDITY_MIN * 60U)
+#define ALM_VALIDITY_S	(CONFIG_NRF_CLOUD_AGPS_CACHE_ALM_VALIDITY_DAYS * 86400U)
+#define IONO_UTC_VALIDITY_S \
+	(CONFIG_NRF_CLOUD_AGPS_CACHE_IONO_UTC_VALIDITY_HOURS * 3600U)
+
+/* Time of the first download, in seconds since the epoch. */
+#define T0 1600000000U
+
+#define STORE_ENTRIES 80
+#define SENT_MAX 80
+
+/* Layout of an ephemeris entry in flash. */
+struct ephe_entry {
+	uint32_t stored;
+	struct nrf_cloud_agps_ephemeris data;
+} __packed;
+
+struct store_entry {
+	char name[32];
+	uint8_t value[64];
+	size_t len;
+};
+
+struct sent_element {
+	enum nrf_cloud_agps_type type;
+	int sv;
+	uint16_t toc;
+};
+
+/* RAM settings backend, standing in for flash. */
+static struct store_entry store[STORE_ENTRIES];
+static size_t store_count;
+static size_t store_writes;
+
+static int64_t time_ms;
+static int time_err;
+
+static struct sent_element sent[SENT_MAX];
+static size_t sent_count;
+static int send_err;
+
+static struct store_entry *store_find(const char *name, bool create)
+{
+	for (size_t i = 0; i < store_count; i++) {
+		if (strcmp(store[i].name, name) == 0) {
+			return &store[i];
+		}
+	}
+
+	if (!create || (store_count == ARRAY_SIZE(store))) {
+		return NULL;
+	}
+
+	strncpy(store[store_count].name, name,
+		sizeof(store[store_count].name) - 1);
+
+	return &store[store_count++];
+}
+
+static int ram_save(struct settings_store *cs, const char *name,
+		    const char *value, size_t val_len)
+{
+	struct store_entry *entry = store_find(name, true);
+
+	zassert_not_null(entry, "Store full");
+	zassert_true(val_len <= sizeof(entry->value), "Entry too long");
+
+	memcpy(entry->value, value, val_len);
+	entry->len = val_len;
+	store_writes++;
+
+	return 0;
+}
+
+static ssize_t ram_read(void *cb_arg, void *data, size_t len)
+{
+	const struct store_entry *entry = cb_arg;
+
+	len = MIN(len, entry->len);
+	memcpy(data, entry->value, len);
+
+	return len;
+}
+
+static int ram_load(struct settings_store *cs,
+		    const struct settings_load_arg *arg)
+{
+	for (size_t i = 0; i < store_count; i++) {
+		settings_call_set_handler(store[i].name, store[i].len,
+					  ram_read, &store[i], arg);
+	}
+
+	return 0;
+}
+
+static const struct settings_store_itf ram_itf = {
+	.csi_load = ram_load,
+	.csi_save = ram_save,
+};
+
+static struct settings_store ram_store = {
+	.cs_itf = &ram_itf,
+};
+
+int settings_backend_init(void)
+{
+	settings_dst_register(&ram_store);
+	settings_src_register(&ram_store);
+
+	return 0;
+}
+
+int date_time_now(int64_t *unix_time_ms)
+{
+	if (time_err) {
+		return time_err;
+	}
+
+	*unix_time_ms = time_ms;
+
+	return 0;
+}
+
+static void time_set(uint32_t unix_time)
+{
+	time_ms = (int64_t)unix_time * MSEC_PER_SEC;
+}
+
+static int send_cb(const struct nrf_cloud_apgs_element *element)
+{
+	struct sent_element *s;
+
+	if (send_err) {
+		return send_err;
+	}
+
+	zassert_true(sent_count < ARRAY_SIZE(sent), "Too many elements");
+
+	s = &sent[sent_count++];
+	s->type = element->type;
+	s->sv = 0;
+	s->toc = 0;
+
+	if (element->type == NRF_CLOUD_AGPS_EPHEMERIDES) {
+		s->sv = element->ephemeris->sv_id;
+		s->toc = element->ephemeris->toc;
+	} else if (element->type == NRF_CLOUD_AGPS_ALMANAC) {
+		s->sv = element->almanac->sv_id;
+	}
+
+	return 0;
+}
+
+static int inject(struct gps_agps_request *request)
+{
+	sent_count = 0;
+
+	return nrf_cloud_agps_cache_inject(request, send_cb);
+}
+
+static void store_ephemeris(int sv, uint16_t toc)
+{
+	struct nrf_cloud_agps_ephemeris ephe = {
+		.sv_id = sv,
+		.toc = toc,
+	};
+	struct nrf_cloud_apgs_element element = {
+		.type = NRF_CLOUD_AGPS_EPHEMERIDES,
+		.ephemeris = &ephe,
+	};
+
+	nrf_cloud_agps_cache_store(&element);
+}
+
+static void store_almanac(int sv)
+{
+	struct nrf_cloud_agps_almanac alm = {
+		.sv_id = sv,
+	};
+	struct nrf_cloud_apgs_element element = {
+		.type = NRF_CLOUD_AGPS_ALMANAC,
+		.almanac = &alm,
+	};
+
+	nrf_cloud_agps_cache_store(&element);
+}
+
+static void store_iono_utc(void)
+{
+	struct nrf_cloud_agps_utc utc = { 0 };
+	struct nrf_cloud_agps_klobuchar klobuchar = { 0 };
+	struct nrf_cloud_apgs_element element = {
+		.type = NRF_CLOUD_AGPS_UTC_PARAMETERS,
+		.utc = &utc,
+	};
+
+	nrf_cloud_agps_cache_store(&element);
+
+	element.type = NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION;
+	element.ion_correction.klobuchar = &klobuchar;
+	nrf_cloud_agps_cache_store(&element);
+}
+
+static const struct sent_element *sent_find(enum nrf_cloud_agps_type type,
+					    int sv)
+{
+	for (size_t i = 0; i < sent_count; i++) {
+		if ((sent[i].type == type) && (sent[i].sv == sv)) {
+			return &sent[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void save_wait(void)
+{
+	/* Let the system work queue write the cache to flash. */
+	k_sleep(K_MSEC(10));
+}
+
+static void test_agps_cache_no_time(void)
+{
+	struct gps_agps_request request = {
+		.sv_mask_ephe = BIT(1),
+	};
+	int ret;
+
+	time_err = -ENODATA;
+
+	store_ephemeris(2, 20);
+	ret = inject(&request);
+
+	zassert_equal(ret, -ENODATA, "Unexpected result %d", ret);
+	zassert_equal(request.sv_mask_ephe, BIT(1), "Request changed");
+	zassert_equal(sent_count, 0, "Data injected without time");
+
+	time_err = 0;
+}
+
+static void test_agps_cache_load(void)
+{
+	struct ephe_entry ephe = {
+		.stored = T0 - 60,
+		.data = {
+			.sv_id = 10,
+			.toc = 100,
+		},
+	};
+	struct gps_agps_request request = {
+		.sv_mask_ephe = BIT(1) | BIT(9),
+		.sv_mask_alm = BIT(3),
+	};
+	struct store_entry *entry;
+	int ret;
+
+	/* Stored before the reset. */
+	entry = store_find(SETTINGS_NAME "/e/10", true);
+	memcpy(entry->value, &ephe, sizeof(ephe));
+	entry->len = sizeof(ephe);
+
+	/* Stored by a version with a different entry layout. */
+	entry = store_find(SETTINGS_NAME "/a/4", true);
+	memset(entry->value, 0xFF, 10);
+	entry->len = 10;
+
+	time_set(T0);
+	ret = inject(&request);
+
+	zassert_equal(ret, 1, "Unexpected count %d", ret);
+	zassert_not_null(sent_find(NRF_CLOUD_AGPS_EPHEMERIDES, 10),
+			 "Stored ephemeris not injected");
+	zassert_equal(sent[0].toc, 100, "Wrong ephemeris injected");
+	zassert_equal(request.sv_mask_ephe, BIT(1),
+		      "Ephemeris stored without time not requested");
+	zassert_equal(request.sv_mask_alm, BIT(3),
+		      "Almanac of a different layout used");
+	zassert_equal(store_writes, 0, "Unexpected flash write");
+}
+
+static void test_agps_cache_hit(void)
+{
+	struct gps_agps_request request = {
+		.sv_mask_ephe = 0xFFFFFFFF,
+		.sv_mask_alm = 0xFFFFFFFF,
+		.utc = 1,
+		.klobuchar = 1,
+		.system_time_tow = 1,
+		.position = 1,
+	};
+	struct ephe_entry ephe;
+	struct store_entry *entry;
+	int ret;
+
+	time_set(T0);
+
+	for (int sv = 1; sv <= 8; sv++) {
+		store_ephemeris(sv, sv * 10);
+	}
+
+	for (int sv = 1; sv <= 32; sv++) {
+		store_almanac(sv);
+	}
+
+	store_iono_utc();
+	save_wait();
+
+	/* 8 ephemerides, 32 almanacs, UTC and Klobuchar. */
+	zassert_equal(store_writes, 42, "Unexpected flash writes %d",
+		      (int)store_writes);
+
+	entry = store_find(SETTINGS_NAME "/e/8", false);
+	zassert_not_null(entry, "Ephemeris not written to flash");
+	zassert_equal(entry->len, sizeof(ephe), "Wrong entry length");
+	memcpy(&ephe, entry->value, sizeof(ephe));
+	zassert_equal(ephe.stored, T0, "Wrong time stored");
+	zassert_equal(ephe.data.toc, 80, "Wrong ephemeris stored");
+	zassert_not_null(store_find(SETTINGS_NAME "/u", false),
+			 "UTC parameters not written to flash");
+	zassert_not_null(store_find(SETTINGS_NAME "/k", false),
+			 "Klobuchar correction not written to flash");
+
+	ret = inject(&request);
+
+	/* The ephemeris of satellite 10 loaded from flash is still valid. */
+	zassert_equal(ret, 43, "Unexpected count %d", ret);
+	zassert_equal(sent_count, 43, "Unexpected injections");
+	zassert_equal(request.sv_mask_ephe, 0xFFFFFD00,
+		      "Unexpected ephemeris request 0x%08x",
+		      request.sv_mask_ephe);
+	zassert_equal(request.sv_mask_alm, 0, "Almanacs still requested");
+	zassert_equal(request.utc, 0, "UTC still requested");
+	zassert_equal(request.klobuchar, 0, "Klobuchar still requested");
+	zassert_equal(request.system_time_tow, 1, "Time request dropped");
+	zassert_equal(request.position, 1, "Position request dropped");
+	zassert_not_null(sent_find(NRF_CLOUD_AGPS_EPHEMERIDES, 5),
+			 "Ephemeris not injected");
+	zassert_equal(sent_find(NRF_CLOUD_AGPS_EPHEMERIDES, 5)->toc, 50,
+		      "Wrong ephemeris injected");
+}
+
+static void test_agps_cache_miss(void)
+{
+	struct gps_agps_request request = {
+		.sv_mask_ephe = 0xFFFFFD00,
+		.nequick = 1,
+	};
+	int ret;
+
+	ret = inject(&request);
+
+	zassert_equal(ret, 0, "Unexpected count %d", ret);
+	zassert_equal(request.sv_mask_ephe, 0xFFFFFD00, "Request changed");
+	zassert_equal(request.nequick, 1, "NeQuick request dropped");
+
+	/* Data the modem did not accept must still be requested. */
+	request.sv_mask_ephe = BIT(0);
+	request.utc = 1;
+	send_err = -EIO;
+	ret = inject(&request);
+	send_err = 0;
+
+	zassert_equal(ret, 0, "Unexpected count %d", ret);
+	zassert_equal(request.sv_mask_ephe, BIT(0), "Ephemeris not requested");
+	zassert_equal(request.utc, 1, "UTC not requested");
+}
+
+static void test_agps_cache_expiry(void)
+{
+	struct gps_agps_request request;
+	int ret;
+
+	time_set(T0 + EPHE_VALIDITY_S - 1);
+	request = (struct gps_agps_request){
+		.sv_mask_ephe = BIT(0) | BIT(9),
+	};
+	ret = inject(&request);
+
+	/* The ephemeris of satellite 10 was stored a minute earlier. */
+	zassert_equal(ret, 1, "Unexpected count %d", ret);
+	zassert_equal(request.sv_mask_ephe, BIT(9), "Ephemeris not expired");
+
+	time_set(T0 + EPHE_VALIDITY_S);
+	request = (struct gps_agps_request){
+		.sv_mask_ephe = BIT(0),
+		.sv_mask_alm = BIT(0),
+		.utc = 1,
+	};
+	ret = inject(&request);
+
+	zassert_equal(ret, 2, "Unexpected count %d", ret);
+	zassert_equal(request.sv_mask_ephe, BIT(0), "Ephemeris not expired");
+	zassert_equal(request.sv_mask_alm, 0, "Almanac expired");
+	zassert_equal(request.utc, 0, "UTC expired");
+
+	time_set(T0 + IONO_UTC_VALIDITY_S);
+	request = (struct gps_agps_request){
+		.sv_mask_alm = BIT(0),
+		.utc = 1,
+		.klobuchar = 1,
+	};
+	ret = inject(&request);
+
+	zassert_equal(ret, 1, "Unexpected count %d", ret);
+	zassert_equal(request.sv_mask_alm, 0, "Almanac expired");
+	zassert_equal(request.utc, 1, "UTC not expired");
+	zassert_equal(request.klobuchar, 1, "Klobuchar not expired");
+
+	time_set(T0 + ALM_VALIDITY_S);
+	request = (struct gps_agps_request){
+		.sv_mask_alm = 0xFFFFFFFF,
+	};
+	ret = inject(&request);
+
+	zassert_equal(ret, 0, "Unexpected count %d", ret);
+	zassert_equal(request.sv_mask_alm, 0xFFFFFFFF, "Almanac not expired");
+}
+
+static void test_agps_cache_invalidate(void)
+{
+	const uint32_t t1 = T0 + ALM_VALIDITY_S;
+	struct gps_agps_request request;
+	struct nrf_cloud_agps_nequick nequick = { 0 };
+	struct nrf_cloud_apgs_element element = {
+		.type = NRF_CLOUD_AGPS_NEQUICK_CORRECTION,
+		.ion_correction.nequick = &nequick,
+	};
+	struct ephe_entry ephe;
+	size_t writes;
+	int ret;
+
+	/* Newer data replaces the cached element. */
+	time_set(t1);
+	store_ephemeris(1, 1234);
+	store_ephemeris(1, 4321);
+	save_wait();
+
+	request = (struct gps_agps_request){
+		.sv_mask_ephe = BIT(0),
+	};
+	ret = inject(&request);
+
+	zassert_equal(ret, 1, "Unexpected count %d", ret);
+	zassert_equal(sent[0].toc, 4321, "Replaced ephemeris injected");
+
+	memcpy(&ephe, store_find(SETTINGS_NAME "/e/1", false)->value,
+	       sizeof(ephe));
+	zassert_equal(ephe.stored, t1, "Wrong time stored");
+	zassert_equal(ephe.data.toc, 4321, "Replaced ephemeris stored");
+
+	/* Data received after the current time, after the clock has been
+	 * set back, has an unknown age.
+	 */
+	time_set(t1 - 1);
+	ret = inject(&request);
+
+	zassert_equal(ret, 0, "Unexpected count %d", ret);
+	zassert_equal(request.sv_mask_ephe, BIT(0), "Future data used");
+
+	/* Types that are only valid when received are not cached. */
+	writes = store_writes;
+	nrf_cloud_agps_cache_store(&element);
+	save_wait();
+
+	zassert_equal(store_writes, writes, "NeQuick correction cached");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(agps_cache_test,
+			 ztest_unit_test(test_agps_cache_no_time),
+			 ztest_unit_test(test_agps_cache_load),
+			 ztest_unit_test(test_agps_cache_hit),
+			 ztest_unit_test(test_agps_cache_miss),
+			 ztest_unit_test(test_agps_cache_expiry),
+			 ztest_unit_test(test_agps_cache_invalidate)
+			 );
+
+	ztest_run_test_suite(agps_cache_test);
+}
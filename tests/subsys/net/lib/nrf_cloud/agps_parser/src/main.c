@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <bench_time.h>
+
+#include "nrf_cloud_agps_parser.h"
+
+#define BENCH_ITERATIONS 1000
+#define FUZZ_ITERATIONS 2000
+
+/* Size of the system clock element in the binary format. */
+#define SYSTEM_CLOCK_SIZE 16
+
+struct result {
+	size_t count[NRF_CLOUD_AGPS_INTEGRITY + 1];
+	/* Hash of the types and contents of all elements, in order. */
+	uint32_t hash;
+	/* Elements passed on from the parser buffer instead of in place. */
+	size_t copied;
+	const struct nrf_cloud_agps_parser *parser;
+	int fail_at;
+};
+
+static uint8_t blob[2048];
+static size_t blob_len;
+static struct nrf_cloud_agps_parser parser;
+static struct result result;
+static struct result expected;
+
+static size_t type_size(enum nrf_cloud_agps_type type)
+{
+	switch (type) {
+	case NRF_CLOUD_AGPS_UTC_PARAMETERS:
+		return sizeof(struct nrf_cloud_agps_utc);
+	case NRF_CLOUD_AGPS_EPHEMERIDES:
+		return sizeof(struct nrf_cloud_agps_ephemeris);
+	case NRF_CLOUD_AGPS_ALMANAC:
+		return sizeof(struct nrf_cloud_agps_almanac);
+	case NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION:
+		return sizeof(struct nrf_cloud_agps_klobuchar);
+	case NRF_CLOUD_AGPS_NEQUICK_CORRECTION:
+		return sizeof(struct nrf_cloud_agps_nequick);
+	case NRF_CLOUD_AGPS_GPS_TOWS:
+		return sizeof(struct nrf_cloud_agps_tow_element);
+	case NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK:
+		return SYSTEM_CLOCK_SIZE;
+	case NRF_CLOUD_AGPS_LOCATION:
+		return sizeof(struct nrf_cloud_agps_location);
+	case NRF_CLOUD_AGPS_INTEGRITY:
+		return sizeof(struct nrf_cloud_agps_integrity);
+	default:
+		return 0;
+	}
+}
+
+static uint32_t hash_update(uint32_t hash, const uint8_t *data, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		hash = (hash ^ data[i]) * 16777619U;
+	}
+
+	return hash;
+}
+
+static int element_cb(const struct nrf_cloud_apgs_element *element,
+		      void *user_data)
+{
+	struct result *res = user_data;
+	/* All members of the union are pointers to the element data. */
+	const uint8_t *data = (const uint8_t *)element->utc;
+	uint8_t type = element->type;
+
+	zassert_true(type < ARRAY_SIZE(res->count), "Bad type %d", type);
+
+	res->count[type]++;
+	res->hash = hash_update(res->hash, &type, 1);
+	res->hash = hash_update(res->hash, data, type_size(type));
+
+	if ((data >= res->parser->buf) &&
+	    (data < res->parser->buf + sizeof(res->parser->buf))) {
+		res->copied++;
+	}
+
+	if (res->fail_at && (--res->fail_at == 0)) {
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static void blob_array(enum nrf_cloud_agps_type type, uint16_t count)
+{
+	size_t size = type_size(type);
+
+	blob[blob_len++] = type;
+	blob[blob_len++] = count & 0xFF;
+	blob[blob_len++] = count >> 8;
+
+	for (uint16_t i = 0; i < count; i++) {
+		for (size_t j = 0; j < size; j++) {
+			blob[blob_len + j] = (uint8_t)(type * 31 + i * 7 + j);
+		}
+
+		/* Satellite ID comes first where there is one. */
+		blob[blob_len] = i + 1;
+		blob_len += size;
+	}
+}
+
+static void blob_build(void)
+{
+	blob_len = 0;
+	blob[blob_len++] = NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION;
+
+	blob_array(NRF_CLOUD_AGPS_UTC_PARAMETERS, 1);
+	blob_array(NRF_CLOUD_AGPS_EPHEMERIDES, 10);
+	blob_array(NRF_CLOUD_AGPS_ALMANAC, 10);
+	blob_array(NRF_CLOUD_AGPS_KLOBUCHAR_CORRECTION, 1);
+	blob_array(NRF_CLOUD_AGPS_GPS_TOWS, 5);
+	blob_array(NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK, 1);
+	blob_array(NRF_CLOUD_AGPS_LOCATION, 1);
+	blob_array(NRF_CLOUD_AGPS_INTEGRITY, 1);
+
+	zassert_true(blob_len <= sizeof(blob), "Blob too large");
+}
+
+static int parse(const uint8_t *data, size_t len, size_t fragment,
+		 struct result *res)
+{
+	int err = 0;
+
+	memset(res, 0, sizeof(*res));
+	res->parser = &parser;
+	nrf_cloud_agps_parser_init(&parser, element_cb, res);
+
+	for (size_t offset = 0; (offset < len) && !err; offset += fragment) {
+		err = nrf_cloud_agps_parser_feed(&parser, &data[offset],
+						 MIN(fragment, len - offset));
+	}
+
+	return err ? err : nrf_cloud_agps_parser_finish(&parser);
+}
+
+static void test_agps_parser_whole(void)
+{
+	blob_build();
+
+	zassert_equal(parse(blob, blob_len, blob_len, &expected), 0,
+		      "Parsing failed");
+	zassert_equal(expected.count[NRF_CLOUD_AGPS_EPHEMERIDES], 10, NULL);
+	zassert_equal(expected.count[NRF_CLOUD_AGPS_ALMANAC], 10, NULL);
+	zassert_equal(expected.count[NRF_CLOUD_AGPS_GPS_TOWS], 5, NULL);
+	zassert_equal(expected.count[NRF_CLOUD_AGPS_GPS_SYSTEM_CLOCK], 1, NULL);
+	zassert_equal(expected.count[NRF_CLOUD_AGPS_INTEGRITY], 1, NULL);
+	zassert_equal(expected.copied, 0, "Elements copied");
+}
+
+static void test_agps_parser_fragments(void)
+{
+	blob_build();
+	zassert_equal(parse(blob, blob_len, blob_len, &expected), 0, NULL);
+
+	for (size_t fragment = 1; fragment < blob_len; fragment++) {
+		zassert_equal(parse(blob, blob_len, fragment, &result), 0,
+			      "Fragment size %d failed", (int)fragment);
+		zassert_equal(result.hash, expected.hash,
+			      "Fragment size %d differs", (int)fragment);
+	}
+
+	/* Byte by byte, every element goes through the parser buffer. */
+	parse(blob, blob_len, 1, &result);
+	zassert_equal(result.copied, 30, NULL);
+}
+
+static void test_agps_parser_truncated(void)
+{
+	size_t last = type_size(NRF_CLOUD_AGPS_INTEGRITY);
+
+	blob_build();
+
+	/* Cut within the last element, at its start, and in the middle of
+	 * the last array header.
+	 */
+	zassert_equal(parse(blob, blob_len - 1, 16, &result), -EBADMSG, NULL);
+	zassert_equal(parse(blob, blob_len - last, 16, &result), -EBADMSG,
+		      NULL);
+	zassert_equal(parse(blob, blob_len - last - 1, 16, &result), -EBADMSG,
+		      NULL);
+
+	/* A response without arrays is valid, an empty one is not. */
+	zassert_equal(parse(blob, 1, 16, &result), 0, NULL);
+	zassert_equal(parse(blob, 0, 16, &result), -EBADMSG, NULL);
+}
+
+static void test_agps_parser_invalid(void)
+{
+	blob_build();
+
+	/* Unknown schema version */
+	blob[0] = NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION + 1;
+	zassert_equal(parse(blob, blob_len, 7, &result), -EBADMSG, NULL);
+	zassert_equal(result.hash, 0, "Elements passed on");
+
+	/* The size of an unknown type cannot be told, the rest is ignored
+	 * like before.
+	 */
+	blob_build();
+	blob[1] = 0x7F;
+	zassert_equal(parse(blob, blob_len, 7, &result), 0, NULL);
+	zassert_equal(result.hash, 0, "Elements passed on");
+
+	/* Errors from the callback stop parsing. */
+	blob_build();
+	memset(&result, 0, sizeof(result));
+	result.parser = &parser;
+	result.fail_at = 3;
+	nrf_cloud_agps_parser_init(&parser, element_cb, &result);
+	zassert_equal(nrf_cloud_agps_parser_feed(&parser, blob, blob_len),
+		      -EIO, NULL);
+	zassert_equal(nrf_cloud_agps_parser_feed(&parser, blob, 1), -EBADMSG,
+		      NULL);
+	zassert_equal(nrf_cloud_agps_parser_finish(&parser), -EBADMSG, NULL);
+}
+
+static uint32_t rand_next(uint32_t *state)
+{
+	*state = *state * 1103515245U + 12345U;
+
+	return *state >> 8;
+}
+
+static void test_agps_parser_fuzz(void)
+{
+	static uint8_t data[sizeof(blob)];
+	uint32_t seed = 1;
+	size_t len;
+	size_t elements;
+
+	blob_build();
+
+	for (int i = 0; i < FUZZ_ITERATIONS; i++) {
+		/* Mutate a few bytes of a valid blob, or use random data. */
+		if (i % 2) {
+			memcpy(data, blob, blob_len);
+			len = blob_len;
+
+			for (int j = 0; j < 4; j++) {
+				data[rand_next(&seed) % len] = rand_next(&seed);
+			}
+		} else {
+			len = rand_next(&seed) % sizeof(data);
+
+			for (size_t j = 0; j < len; j++) {
+				data[j] = rand_next(&seed);
+			}
+
+			data[0] = NRF_CLOUD_AGPS_BIN_SCHEMA_VERSION;
+		}
+
+		(void)parse(data, len, 1 + rand_next(&seed) % 64, &result);
+
+		/* Every element passed on must have been within the data. */
+		elements = 0;
+		for (size_t t = 0; t < ARRAY_SIZE(result.count); t++) {
+			elements += result.count[t];
+		}
+
+		zassert_true(elements <= len, "Too many elements");
+	}
+}
+
+static void test_agps_parser_benchmark(void)
+{
+	uint64_t start;
+	uint64_t whole_us;
+	uint64_t fragment_us;
+
+	blob_build();
+
+	start = bench_time_us();
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		parse(blob, blob_len, blob_len, &result);
+	}
+	whole_us = bench_time_us() - start;
+
+	start = bench_time_us();
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		parse(blob, blob_len, 64, &result);
+	}
+	fragment_us = bench_time_us() - start;
+
+	TC_PRINT("%d byte response, %d elements copied in 64 byte fragments\n",
+		 (int)blob_len, (int)result.copied);
+	TC_PRINT("host ns per response: whole %u, 64 byte fragments %u\n",
+		 (uint32_t)(whole_us * NSEC_PER_USEC / BENCH_ITERATIONS),
+		 (uint32_t)(fragment_us * NSEC_PER_USEC / BENCH_ITERATIONS));
+
+	zassert_true(whole_us > 0, "Host clock did not advance");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(agps_parser_test,
+			 ztest_unit_test(test_agps_parser_whole),
+			 ztest_unit_test(test_agps_parser_fragments),
+			 ztest_unit_test(test_agps_parser_truncated),
+			 ztest_unit_test(test_agps_parser_invalid),
+			 ztest_unit_test(test_agps_parser_fuzz),
+			 ztest_unit_test(test_agps_parser_benchmark)
+			 );
+
+	ztest_run_test_suite(agps_parser_test);
+}
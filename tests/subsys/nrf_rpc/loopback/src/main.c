@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <ztest.h>
+#include <bench_time.h>
+
+#include <nrf_errno.h>
+
+#include <nrf_rpc_os.h>
+#include <nrf_rpc_loopback.h>
+
+#define CLIENT_MAX	4
+#define CMD_CNT		100
+#define EVT_CNT		1000
+
+#define PAYLOAD_MAX	256
+
+/* Time a command handler waits, for example for a peripheral. The waits use
+ * the simulated time, so they are not included in the measured host times.
+ */
+#define HANDLER_WAIT_US	200
+
+/* Time a handler of a bulk transfer waits. */
+#define SLOW_HANDLER_WAIT_MS	50
+
+enum packet_type {
+	PACKET_CMD,
+	PACKET_CMD_SLOW,
+	PACKET_EVT,
+	PACKET_RSP,
+};
+
+struct packet_hdr {
+	uint8_t type;
+	uint8_t client;
+	/* Set if a remote thread was reserved for the command. */
+	uint8_t reserved;
+};
+
+struct client {
+	struct k_thread thread;
+	struct k_sem start_sem;
+	struct k_sem rsp_sem;
+	uint32_t payload_len;
+};
+
+static struct client clients[CLIENT_MAX];
+static K_THREAD_STACK_ARRAY_DEFINE(client_stacks, CLIENT_MAX, 1024);
+
+static K_SEM_DEFINE(clients_done_sem, 0, CLIENT_MAX);
+static K_SEM_DEFINE(decoding_done_sem, 0, 1);
+static K_SEM_DEFINE(evt_done_sem, 0, 1);
+
+static uint32_t rtt[CLIENT_MAX * CMD_CNT];
+static atomic_t rtt_cnt;
+
+static uint32_t evt_cnt;
+static uint32_t evt_target;
+
+/* Time the remote receive thread waited for a free thread in the pool. */
+static uint64_t pool_wait_us;
+
+static void remote_cmd_handler(const uint8_t *packet, size_t len)
+{
+	const struct packet_hdr *hdr = (const struct packet_hdr *)packet;
+	bool slow = (hdr->type == PACKET_CMD_SLOW);
+	struct packet_hdr rsp;
+
+	rsp.type = PACKET_RSP;
+	rsp.client = hdr->client;
+	rsp.reserved = hdr->reserved;
+
+	k_sem_give(&decoding_done_sem);
+
+	if (slow) {
+		k_sleep(K_MSEC(SLOW_HANDLER_WAIT_MS));
+	} else {
+		k_sleep(K_USEC(HANDLER_WAIT_US));
+	}
+
+	zassert_equal(nrf_rpc_loopback_send(NRF_RPC_LOOPBACK_REMOTE,
+					    (const uint8_t *)&rsp, sizeof(rsp)),
+		      0, "Cannot send response");
+}
+
+static void remote_receive_handler(const uint8_t *packet, size_t len)
+{
+	const struct packet_hdr *hdr = (const struct packet_hdr *)packet;
+	uint64_t start;
+
+	zassert_true(len >= sizeof(*hdr), "Packet too short");
+
+	if (hdr->type == PACKET_EVT) {
+		evt_cnt++;
+		if (evt_cnt == evt_target) {
+			k_sem_give(&evt_done_sem);
+		}
+		return;
+	}
+
+	zassert_true(hdr->type < PACKET_EVT, "Unexpected packet type");
+
+	/* The packet is valid until the handler returns, like for nRF RPC
+	 * that waits until the command is decoded by the pool thread.
+	 */
+	start = bench_time_us();
+	nrf_rpc_os_thread_pool_send(packet, len);
+	pool_wait_us += bench_time_us() - start;
+
+	k_sem_take(&decoding_done_sem, K_FOREVER);
+}
+
+static void local_receive_handler(const uint8_t *packet, size_t len)
+{
+	const struct packet_hdr *hdr = (const struct packet_hdr *)packet;
+
+	zassert_equal(hdr->type, PACKET_RSP, "Unexpected packet type");
+	zassert_true(hdr->client < CLIENT_MAX, "Unexpected client");
+
+	/* Like nRF RPC, the remote thread is released when the response
+	 * is received.
+	 */
+	if (hdr->reserved) {
+		nrf_rpc_os_remote_release();
+	}
+
+	k_sem_give(&clients[hdr->client].rsp_sem);
+}
+
+static void client_entry(void *p1, void *p2, void *p3)
+{
+	struct client *client = p1;
+	uint8_t packet[sizeof(struct packet_hdr) + PAYLOAD_MAX];
+	struct packet_hdr *hdr = (struct packet_hdr *)packet;
+	uint64_t start;
+
+	hdr->type = PACKET_CMD;
+	hdr->client = client - clients;
+	hdr->reserved = 0;
+	memset(&packet[sizeof(*hdr)], 0xA5, PAYLOAD_MAX);
+
+	do {
+		k_sem_take(&client->start_sem, K_FOREVER);
+
+		for (int i = 0; i < CMD_CNT; i++) {
+			start = bench_time_us();
+
+			zassert_equal(nrf_rpc_tr_send(packet, sizeof(*hdr) +
+						      client->payload_len), 0,
+				      "Cannot send command");
+			k_sem_take(&client->rsp_sem, K_FOREVER);
+
+			rtt[atomic_inc(&rtt_cnt)] = bench_time_us() - start;
+		}
+
+		k_sem_give(&clients_done_sem);
+	} while (1);
+}
+
+static void sort(uint32_t *array, size_t cnt)
+{
+	for (size_t i = 1; i < cnt; i++) {
+		uint32_t val = array[i];
+		size_t j = i;
+
+		while ((j > 0) && (array[j - 1] > val)) {
+			array[j] = array[j - 1];
+			j--;
+		}
+		array[j] = val;
+	}
+}
+
+static void run_commands(uint32_t client_cnt, uint32_t payload_len)
+{
+	uint64_t start;
+	uint64_t time;
+	uint32_t cnt = client_cnt * CMD_CNT;
+
+	atomic_set(&rtt_cnt, 0);
+	pool_wait_us = 0;
+
+	start = bench_time_us();
+
+	for (uint32_t i = 0; i < client_cnt; i++) {
+		clients[i].payload_len = payload_len;
+		k_sem_give(&clients[i].start_sem);
+	}
+
+	for (uint32_t i = 0; i < client_cnt; i++) {
+		k_sem_take(&clients_done_sem, K_FOREVER);
+	}
+
+	time = bench_time_us() - start;
+
+	zassert_equal(atomic_get(&rtt_cnt), cnt, "Responses lost");
+	zassert_true(time > 0, "Host clock did not advance");
+
+	sort(rtt, cnt);
+
+	TC_PRINT("%u clients, %3u B: %6u cmd/s, host rtt p50 %4u us, "
+		 "p90 %4u us, p99 %4u us, pool wait %3u%%\n",
+		 client_cnt, payload_len,
+		 (uint32_t)(cnt * USEC_PER_SEC / time),
+		 rtt[cnt / 2], rtt[cnt * 9 / 10], rtt[cnt * 99 / 100],
+		 (uint32_t)(pool_wait_us * 100 / time));
+}
+
+static void print_stats(void)
+{
+#if CONFIG_NRF_RPC_THREAD_POOL_STATS
+	struct nrf_rpc_os_pool_stats stats;
+
+	nrf_rpc_os_thread_pool_stats_get(&stats);
+	TC_PRINT("Pool: %u packets, depth max %u, wait avg %u us, "
+		 "wait max %u us\n", stats.cnt, stats.depth_max,
+		 (uint32_t)(stats.wait_total_us / MAX(stats.cnt, 1)),
+		 stats.wait_max_us);
+#endif
+}
+
+static void test_init(void)
+{
+	for (size_t i = 0; i < CLIENT_MAX; i++) {
+		k_sem_init(&clients[i].start_sem, 0, 1);
+		k_sem_init(&clients[i].rsp_sem, 0, K_SEM_MAX_LIMIT);
+		k_thread_create(&clients[i].thread, client_stacks[i],
+				K_THREAD_STACK_SIZEOF(client_stacks[i]),
+				client_entry, &clients[i], NULL, NULL,
+				K_PRIO_PREEMPT(1), 0, K_NO_WAIT);
+	}
+
+	zassert_equal(nrf_rpc_os_init(remote_cmd_handler), 0, NULL);
+	zassert_equal(nrf_rpc_loopback_init(NRF_RPC_LOOPBACK_REMOTE,
+					    remote_receive_handler), 0, NULL);
+	zassert_equal(nrf_rpc_tr_init(local_receive_handler), 0, NULL);
+}
+
+static void test_too_big(void)
+{
+	static uint8_t packet[CONFIG_NRF_RPC_TR_LOOPBACK_BUF_SIZE];
+
+	zassert_equal(nrf_rpc_tr_send(packet, sizeof(packet)), -NRF_EINVAL,
+		      "Packet bigger than the ring buffer accepted");
+}
+
+static void test_commands(void)
+{
+	static const uint32_t payload_len[] = {8, 64, PAYLOAD_MAX};
+
+	TC_PRINT("Thread pool size: %d\n", CONFIG_NRF_RPC_THREAD_POOL_SIZE);
+
+	for (uint32_t client_cnt = 1; client_cnt <= CLIENT_MAX;
+	     client_cnt *= 2) {
+		for (size_t i = 0; i < ARRAY_SIZE(payload_len); i++) {
+			run_commands(client_cnt, payload_len[i]);
+		}
+	}
+}
+
+static void test_events(void)
+{
+	static const uint32_t payload_len[] = {8, 64, PAYLOAD_MAX};
+	static uint8_t packet[sizeof(struct packet_hdr) + PAYLOAD_MAX];
+	struct packet_hdr *hdr = (struct packet_hdr *)packet;
+	uint64_t start;
+	uint64_t time;
+
+	hdr->type = PACKET_EVT;
+	hdr->client = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(payload_len); i++) {
+		evt_cnt = 0;
+		evt_target = EVT_CNT;
+
+		start = bench_time_us();
+
+		for (int j = 0; j < EVT_CNT; j++) {
+			zassert_equal(nrf_rpc_tr_send(packet, sizeof(*hdr) +
+						      payload_len[i]), 0,
+				      "Cannot send event");
+		}
+
+		zassert_equal(k_sem_take(&evt_done_sem, K_SECONDS(10)), 0,
+			      "Events lost");
+
+		time = bench_time_us() - start;
+
+		zassert_true(time > 0, "Host clock did not advance");
+
+		TC_PRINT("%3u B: %7u evt/s\n", payload_len[i],
+			 (uint32_t)(EVT_CNT * USEC_PER_SEC / time));
+	}
+}
+
+static void test_remote_threads(void)
+{
+	struct packet_hdr hdr;
+	int64_t start;
+	int64_t time;
+	int cmd_cnt = 2 * CONFIG_NRF_RPC_THREAD_POOL_SIZE;
+
+	/* The number of remote threads is known from the remote side. */
+	nrf_rpc_os_remote_count(CONFIG_NRF_RPC_THREAD_POOL_SIZE);
+
+	hdr.type = PACKET_CMD_SLOW;
+	hdr.client = 1;
+	hdr.reserved = 1;
+
+	/* Like nRF RPC, a remote thread is reserved for every command. When
+	 * all remote threads are busy, the sender waits instead of the remote
+	 * receive thread.
+	 */
+	start = k_uptime_get();
+
+	for (int i = 0; i < cmd_cnt; i++) {
+		nrf_rpc_os_remote_reserve();
+		zassert_equal(nrf_rpc_tr_send((uint8_t *)&hdr, sizeof(hdr)), 0,
+			      "Cannot send command");
+	}
+
+	time = k_uptime_get() - start;
+	zassert_true(time >= SLOW_HANDLER_WAIT_MS,
+		     "Sender did not wait for a remote thread");
+
+	for (int i = 0; i < cmd_cnt; i++) {
+		zassert_equal(k_sem_take(&clients[1].rsp_sem,
+					 K_MSEC(2 * SLOW_HANDLER_WAIT_MS)), 0,
+			      "Slow command not completed");
+	}
+
+	/* All remote threads are released. */
+	for (int i = 0; i < CONFIG_NRF_RPC_THREAD_POOL_SIZE; i++) {
+		nrf_rpc_os_remote_reserve();
+	}
+
+	for (int i = 0; i < CONFIG_NRF_RPC_THREAD_POOL_SIZE; i++) {
+		nrf_rpc_os_remote_release();
+	}
+
+	print_stats();
+}
+
+static void test_queue_full(void)
+{
+	/* Packets stay valid until they are decoded. */
+	static struct packet_hdr slow[2 * CONFIG_NRF_RPC_THREAD_POOL_SIZE];
+	int64_t start;
+
+	/* The test passes the packets to the pool like the receive thread.
+	 * The first half keeps the threads busy and the second half fills up
+	 * the queue.
+	 */
+	for (size_t i = 0; i < ARRAY_SIZE(slow); i++) {
+		slow[i].type = PACKET_CMD_SLOW;
+		slow[i].client = 1;
+		slow[i].reserved = 0;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(slow) / 2; i++) {
+		nrf_rpc_os_thread_pool_send((const uint8_t *)&slow[i],
+					    sizeof(slow[i]));
+	}
+
+	/* Let the threads take the packets. */
+	k_sleep(K_MSEC(1));
+
+	start = k_uptime_get();
+
+	for (size_t i = ARRAY_SIZE(slow) / 2; i < ARRAY_SIZE(slow); i++) {
+		nrf_rpc_os_thread_pool_send((const uint8_t *)&slow[i],
+					    sizeof(slow[i]));
+	}
+
+	zassert_true(k_uptime_get() - start < SLOW_HANDLER_WAIT_MS,
+		     "Receive thread waited for a full queue");
+
+	for (size_t i = 0; i < ARRAY_SIZE(slow); i++) {
+		zassert_equal(k_sem_take(&clients[1].rsp_sem,
+					 K_MSEC(3 * SLOW_HANDLER_WAIT_MS)), 0,
+			      "Slow command not completed");
+	}
+
+	/* Nobody waited for the decoding of the packets. */
+	k_sem_reset(&decoding_done_sem);
+
+	print_stats();
+}
+
+static void test_ctx_pool(void)
+{
+	static uint32_t ctx[CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE];
+	static ATOMIC_DEFINE(reserved, CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE);
+
+	for (size_t i = 0; i < ARRAY_SIZE(ctx); i++) {
+		ctx[i] = nrf_rpc_os_ctx_pool_reserve();
+
+		zassert_true(ctx[i] < CONFIG_NRF_RPC_CMD_CTX_POOL_SIZE,
+			     "Invalid context %u", ctx[i]);
+		zassert_false(atomic_test_and_set_bit(reserved, ctx[i]),
+			      "Context %u reserved twice", ctx[i]);
+	}
+
+	/* The only free context is reserved again. */
+	nrf_rpc_os_ctx_pool_release(ctx[ARRAY_SIZE(ctx) - 1]);
+	zassert_equal(nrf_rpc_os_ctx_pool_reserve(), ctx[ARRAY_SIZE(ctx) - 1],
+		      "Wrong context reserved");
+
+	for (size_t i = 0; i < ARRAY_SIZE(ctx); i++) {
+		nrf_rpc_os_ctx_pool_release(ctx[i]);
+		atomic_clear_bit(reserved, ctx[i]);
+	}
+}
+
+void test_main(void)
+{
+	ztest_test_suite(nrf_rpc_loopback_test,
+			 ztest_unit_test(test_init),
+			 ztest_unit_test(test_too_big),
+			 ztest_unit_test(test_commands),
+			 ztest_unit_test(test_events),
+			 ztest_unit_test(test_remote_threads),
+			 ztest_unit_test(test_queue_full),
+			 ztest_unit_test(test_ctx_pool)
+			 );
+
+	ztest_run_test_suite(nrf_rpc_loopback_test);
+}
@@ -5,6 +5,7 @@
  */
 
 #include <ztest.h>
+#include <bench_time.h>
 #include <logging/log.h>
 #include <zb_nrf_crypto.h>
 #include <zboss_api.h>
@@ -14,6 +15,8 @@ LOG_MODULE_REGISTER(zboss_osif, CONFIG_ZBOSS_OSIF_LOG_LEVEL);
 #define AES_KEY_LENGTH       16
 #define AES_PLAINTEXT_LENGTH 16
 
+#define BENCH_BLOCKS         2000
+
 /* AES test values (taken from FIPS-197) */
 uint8_t aes_key[AES_KEY_LENGTH] = {
 	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
@@ -28,6 +31,26 @@ uint8_t aes_ciphertext[AES_PLAINTEXT_LENGTH] = {
 	0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
 };
 
+/* More AES test values (taken from NIST SP 800-38A, F.1.1) */
+uint8_t aes_key_2[AES_KEY_LENGTH] = {
+	0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+	0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+uint8_t aes_plaintext_2[AES_PLAINTEXT_LENGTH] = {
+	0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+	0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a
+};
+uint8_t aes_ciphertext_2[AES_PLAINTEXT_LENGTH] = {
+	0x3a, 0xd7, 0x7b, 0xb4, 0x0d, 0x7a, 0x36, 0x60,
+	0xa8, 0x9e, 0xca, 0xf3, 0x24, 0x66, 0xef, 0x97
+};
+
+/* Encryption of a zero block with a zero key */
+uint8_t aes_ciphertext_zero[AES_PLAINTEXT_LENGTH] = {
+	0x66, 0xe9, 0x4b, 0xd4, 0xef, 0x8a, 0x2c, 0x3b,
+	0x88, 0x4c, 0xfa, 0x59, 0xca, 0x34, 0x2b, 0x2e
+};
+
 
 static void test_crypto(void)
 {
@@ -43,10 +66,90 @@ static void test_crypto(void)
 	}
 }
 
+static void test_crypto_key_switch(void)
+{
+	uint8_t other_key[AES_KEY_LENGTH] = {0};
+	uint8_t encrypted[AES_PLAINTEXT_LENGTH];
+
+	/* Use another key in between to check that keys are not mixed. */
+	zb_osif_aes128_hw_encrypt(other_key, aes_plaintext, encrypted);
+	zassert_true(memcmp(encrypted, aes_ciphertext, AES_PLAINTEXT_LENGTH),
+		     "Wrong key used");
+
+	zb_osif_aes128_hw_encrypt(aes_key, aes_plaintext, encrypted);
+	zassert_mem_equal(encrypted, aes_ciphertext, AES_PLAINTEXT_LENGTH,
+			  "Encrypted data mismatch");
+}
+
+static void test_crypto_key_eviction(void)
+{
+	static uint8_t zero[AES_KEY_LENGTH];
+	const struct {
+		uint8_t *key;
+		uint8_t *plaintext;
+		uint8_t *ciphertext;
+	} vectors[] = {
+		{aes_key, aes_plaintext, aes_ciphertext},
+		{aes_key_2, aes_plaintext_2, aes_ciphertext_2},
+		{zero, zero, aes_ciphertext_zero},
+	};
+	uint8_t encrypted[AES_PLAINTEXT_LENGTH];
+
+	BUILD_ASSERT(ARRAY_SIZE(vectors) > CONFIG_ZIGBEE_AES_KEY_CACHE_SIZE,
+		     "Keys must not fit in the cache");
+
+	/* Every key evicts the least recently used one. Each key is then
+	 * used twice in a row, so that it is also found in the cache.
+	 */
+	for (size_t i = 0; i < 4 * ARRAY_SIZE(vectors); i++) {
+		unsigned int v = (i < 2 * ARRAY_SIZE(vectors)) ?
+				 (i % ARRAY_SIZE(vectors)) :
+				 ((i / 2) % ARRAY_SIZE(vectors));
+
+		zb_osif_aes128_hw_encrypt(vectors[v].key, vectors[v].plaintext,
+					  encrypted);
+		zassert_mem_equal(encrypted, vectors[v].ciphertext,
+				  AES_PLAINTEXT_LENGTH,
+				  "Encrypted data mismatch for key %u", v);
+	}
+}
+
+static void bench_print(const char *name, uint64_t us)
+{
+	zassert_true(us > 0, "Clock did not advance");
+
+	TC_PRINT("%s: %u blocks/s\n", name,
+		 (uint32_t)(BENCH_BLOCKS * USEC_PER_SEC / us));
+}
+
+static void test_crypto_benchmark(void)
+{
+	static uint8_t blocks[AES_PLAINTEXT_LENGTH];
+	uint8_t other_key[AES_KEY_LENGTH] = {0};
+	uint8_t *keys[] = {aes_key, other_key};
+	uint64_t start;
+
+	start = bench_time_us();
+	for (int i = 0; i < BENCH_BLOCKS; i++) {
+		zb_osif_aes128_hw_encrypt(aes_key, blocks, blocks);
+	}
+	bench_print("Single blocks, one key", bench_time_us() - start);
+
+	start = bench_time_us();
+	for (int i = 0; i < BENCH_BLOCKS; i++) {
+		zb_osif_aes128_hw_encrypt(keys[i % ARRAY_SIZE(keys)], blocks,
+					  blocks);
+	}
+	bench_print("Single blocks, two keys", bench_time_us() - start);
+}
+
 void test_main(void)
 {
 	ztest_test_suite(nrf_osif_crypto_tests,
-			ztest_unit_test(test_crypto)
+			ztest_unit_test(test_crypto),
+			ztest_unit_test(test_crypto_key_switch),
+			ztest_unit_test(test_crypto_key_eviction),
+			ztest_unit_test(test_crypto_benchmark)
 	);
 
 	ztest_run_test_suite(nrf_osif_crypto_tests);
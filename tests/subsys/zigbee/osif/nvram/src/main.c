@@ -97,13 +97,63 @@ static void test_zb_nvram_write(void)
 	}
 }
 
+static void test_zb_nvram_write_cached(void)
+{
+	const uint8_t page = 0;
+	uint32_t word;
+	uint32_t read_word;
+	int ret;
+
+	ret = zb_osif_nvram_erase_async(page);
+	zassert_true(ret == RET_OK, "Erasing failed");
+
+	/* Small sequential writes, like dataset updates. */
+	for (uint32_t i = 0; i < (PAGE_SIZE / sizeof(word)); i++) {
+		word = i;
+		ret = zb_osif_nvram_write(page, i * sizeof(word), &word,
+					  sizeof(word));
+		zassert_true(ret == RET_OK, "writing failed");
+	}
+
+	/* Written data is visible before it is stored in flash. */
+	for (uint32_t i = 0; i < (PAGE_SIZE / sizeof(word)); i++) {
+		zb_osif_nvram_read(page, i * sizeof(word),
+				   (zb_uint8_t *)&read_word, sizeof(read_word));
+		zassert_equal(read_word, i, "Cached data not read");
+	}
+
+	zb_osif_nvram_flush();
+
+	zb_osif_nvram_read(page, 0, zb_nvram_buf, PAGE_SIZE);
+	for (uint32_t i = 0; i < (PAGE_SIZE / sizeof(word)); i++) {
+		memcpy(&read_word, &zb_nvram_buf[i * sizeof(word)],
+		       sizeof(read_word));
+		zassert_equal(read_word, i, "Data not stored in flash");
+	}
+
+	/* Data written before an erase is not read after it. */
+	word = 0x12345678;
+	ret = zb_osif_nvram_write(page, PAGE_SIZE, &word, sizeof(word));
+	zassert_true(ret == RET_OK, "writing failed");
+	ret = zb_osif_nvram_erase_async(page);
+	zassert_true(ret == RET_OK, "Erasing failed");
+
+	zb_osif_nvram_read(page, 0, zb_nvram_buf, PAGE_SIZE);
+	zb_osif_nvram_read(page, PAGE_SIZE, (zb_uint8_t *)&read_word,
+			   sizeof(read_word));
+	zassert_equal(read_word, UINT32_MAX, "Erasing failed");
+	for (int i = 0; i < PAGE_SIZE; i++) {
+		zassert_true(zb_nvram_buf[i] == 0xFF, "Erasing failed");
+	}
+}
 
 void test_main(void)
 {
 	ztest_test_suite(osif_test,
 			 ztest_unit_test(test_zb_nvram_memory_size),
 			 ztest_unit_test(test_zb_nvram_erase),
-			 ztest_unit_test(test_zb_nvram_write)
+			 ztest_unit_test(test_zb_nvram_write),
+			 ztest_unit_test(test_zb_nvram_write_cached)
 			 );
 
 	ztest_run_test_suite(osif_test);
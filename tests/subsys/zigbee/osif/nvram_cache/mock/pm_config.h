@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef PM_CONFIG_H__
+#define PM_CONFIG_H__
+
+/* Two virtual pages of a single physical page each. */
+#define PM_ZBOSS_NVRAM_ID 0
+#define PM_ZBOSS_NVRAM_SIZE 0x2000
+
+#endif /* PM_CONFIG_H__ */
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <logging/log.h>
+#include <storage/flash_map.h>
+#include <pm_config.h>
+#include <zboss_api.h>
+
+#include "zb_nrf_platform.h"
+
+LOG_MODULE_REGISTER(zboss_osif, CONFIG_ZBOSS_OSIF_LOG_LEVEL);
+
+#define CACHE_SIZE CONFIG_ZIGBEE_NVRAM_CACHE_SIZE
+
+/* NVRAM kept in RAM. */
+static uint8_t flash[PM_ZBOSS_NVRAM_SIZE];
+static const struct flash_area nvram_area = {
+	.fa_id = PM_ZBOSS_NVRAM_ID,
+	.fa_size = PM_ZBOSS_NVRAM_SIZE,
+};
+
+static int write_err;
+static int erase_err;
+
+/* Writes wait until a read lets them complete. */
+static bool writes_held;
+static bool read_hook_armed;
+static K_SEM_DEFINE(write_go_sem, 0, 1);
+static K_SEM_DEFINE(write_done_sem, 0, 1);
+
+static uint8_t erased_pages;
+static K_SEM_DEFINE(nvram_event_sem, 0, 1);
+
+/* Stubs for flash map */
+int flash_area_open(uint8_t id, const struct flash_area **fa)
+{
+	*fa = &nvram_area;
+
+	return 0;
+}
+
+int flash_area_read(const struct flash_area *fa, off_t off, void *dst,
+		    size_t len)
+{
+	memcpy(dst, &flash[off], len);
+
+	/* Complete a pending write after flash is read, but before
+	 * the read returns.
+	 */
+	if (read_hook_armed) {
+		read_hook_armed = false;
+		k_sem_give(&write_go_sem);
+		k_sem_take(&write_done_sem, K_FOREVER);
+	}
+
+	return 0;
+}
+
+int flash_area_write(const struct flash_area *fa, off_t off, const void *src,
+		     size_t len)
+{
+	if (writes_held) {
+		k_sem_take(&write_go_sem, K_FOREVER);
+	}
+
+	if (write_err) {
+		return write_err;
+	}
+
+	memcpy(&flash[off], src, len);
+	k_sem_give(&write_done_sem);
+
+	return 0;
+}
+
+int flash_area_erase(const struct flash_area *fa, off_t off, size_t len)
+{
+	if (erase_err) {
+		return erase_err;
+	}
+
+	memset(&flash[off], 0xFF, len);
+
+	return 0;
+}
+
+/* Stub for ZBOSS callout */
+void zb_nvram_erase_finished(zb_uint8_t page)
+{
+	erased_pages |= BIT(page);
+}
+
+/* Stub for ZBOSS thread notification */
+void zigbee_event_notify(zigbee_event_t event)
+{
+	k_sem_give(&nvram_event_sem);
+}
+
+static void page_erase(zb_uint8_t page)
+{
+	zassert_equal(zb_osif_nvram_erase_async(page), RET_OK,
+		      "Erasing failed");
+	zb_osif_nvram_wait_for_last_op();
+	zassert_equal(zigbee_nvram_result_get(), 0, "Erasing failed");
+}
+
+static void test_read_during_write(void)
+{
+	static uint8_t data[CACHE_SIZE];
+	static uint8_t read_buf[CACHE_SIZE];
+	zb_ret_t ret;
+
+	page_erase(0);
+	memset(data, 0xA5, sizeof(data));
+
+	writes_held = true;
+	k_sem_reset(&write_go_sem);
+	k_sem_reset(&write_done_sem);
+
+	/* The full buffer is handed to the NVRAM thread, which waits. */
+	ret = zb_osif_nvram_write(0, 0, data, sizeof(data));
+	zassert_equal(ret, RET_OK, "Writing failed");
+
+	/* The buffer is stored while flash is read and is no longer in
+	 * flight when the cached data is applied.
+	 */
+	read_hook_armed = true;
+	ret = zb_osif_nvram_read(0, 0, read_buf, sizeof(read_buf));
+	zassert_equal(ret, RET_OK, "Reading failed");
+	zassert_false(read_hook_armed, "Write not completed during the read");
+	zassert_mem_equal(read_buf, data, sizeof(data), "Old data read");
+
+	writes_held = false;
+	zb_osif_nvram_flush();
+	zassert_equal(zigbee_nvram_result_get(), 0, "Writing failed");
+
+	ret = zb_osif_nvram_read(0, 0, read_buf, sizeof(read_buf));
+	zassert_equal(ret, RET_OK, "Reading failed");
+	zassert_mem_equal(read_buf, data, sizeof(data), "Data not stored");
+}
+
+static void test_erase_finished(void)
+{
+	zb_ret_t ret;
+
+	erased_pages = 0;
+	k_sem_reset(&nvram_event_sem);
+
+	/* The erase is reported only from ZBOSS context. */
+	ret = zb_osif_nvram_erase_async(0);
+	zassert_equal(ret, RET_OK, "Erasing failed");
+	ret = zb_osif_nvram_erase_async(1);
+	zassert_equal(ret, RET_OK, "Erasing failed");
+	zb_osif_nvram_wait_for_last_op();
+	zassert_equal(erased_pages, 0, "Erase reported by the NVRAM thread");
+	zassert_equal(k_sem_take(&nvram_event_sem, K_NO_WAIT), 0,
+		      "ZBOSS thread not notified");
+
+	zigbee_nvram_erase_finished_process();
+	zassert_equal(erased_pages, BIT(0) | BIT(1), "Erase not reported");
+
+	/* An erase is reported once. */
+	erased_pages = 0;
+	zigbee_nvram_erase_finished_process();
+	zassert_equal(erased_pages, 0, "Erase reported twice");
+}
+
+static void test_error_report(void)
+{
+	uint32_t word = 0x12345678;
+	zb_ret_t ret;
+
+	page_erase(1);
+
+	/* Errors of the NVRAM thread are reported when ZBOSS waits. */
+	write_err = -EIO;
+	ret = zb_osif_nvram_write(1, 0, &word, sizeof(word));
+	zassert_equal(ret, RET_OK, "Writing failed");
+	zb_osif_nvram_flush();
+	zassert_equal(zigbee_nvram_result_get(), -EIO,
+		      "Write error not reported");
+	write_err = 0;
+
+	erase_err = -EINVAL;
+	ret = zb_osif_nvram_erase_async(1);
+	zassert_equal(ret, RET_OK, "Erasing failed");
+	zb_osif_nvram_wait_for_last_op();
+	zassert_equal(zigbee_nvram_result_get(), -EINVAL,
+		      "Erase error not reported");
+	erase_err = 0;
+
+	/* An error is reported once. */
+	zb_osif_nvram_flush();
+	zassert_equal(zigbee_nvram_result_get(), 0, "Error reported twice");
+}
+
+void test_main(void)
+{
+	zb_osif_nvram_init("test");
+
+	ztest_test_suite(nvram_cache_test,
+			 ztest_unit_test(test_read_during_write),
+			 ztest_unit_test(test_erase_finished),
+			 ztest_unit_test(test_error_report)
+			 );
+
+	ztest_run_test_suite(nvram_cache_test);
+}
@@ -19,6 +19,16 @@
 
 #define IEEE_CHANNEL_MASK       (1l << CONFIG_ZIGBEE_CHANNEL)
 
+#define RECORD_MAX              256
+#define RECORD_TIMEOUT_MS       1000
+
+#define ORDER_ROUNDS            8
+
+#define PRODUCER_THREADS        2
+#define PRODUCER_CNT            (PRODUCER_THREADS + 1)
+#define PRODUCER_REQS           32
+#define PRODUCER_SHIFT          5
+
 
 K_SEM_DEFINE(zboss_init_lock, 0, 1);
 static uint32_t zboss_signals_collected;
@@ -166,6 +176,226 @@ void test_zboss_app_callbacks(void)
 	}
 }
 
+/* Parameters of the executed callbacks, in the order of execution. */
+static uint8_t records[RECORD_MAX];
+static atomic_t record_cnt;
+
+static void record_cb(zb_uint8_t param)
+{
+	atomic_val_t idx = atomic_inc(&record_cnt);
+
+	if (idx < RECORD_MAX) {
+		records[idx] = param;
+	}
+}
+
+static void records_reset(void)
+{
+	atomic_clear(&record_cnt);
+}
+
+static void records_wait(size_t cnt)
+{
+	for (int i = 0; i < RECORD_TIMEOUT_MS; i++) {
+		if (atomic_get(&record_cnt) >= cnt) {
+			break;
+		}
+		k_sleep(K_MSEC(1));
+	}
+
+	zassert_equal(atomic_get(&record_cnt), cnt,
+		      "Wrong number of callbacks executed");
+}
+
+static size_t app_cb_queue_size(void)
+{
+	size_t size = 2;
+
+	/* The queue length is rounded up to a power of two. */
+	while (size < CONFIG_ZIGBEE_APP_CB_QUEUE_LENGTH) {
+		size *= 2;
+	}
+
+	return size;
+}
+
+static void zboss_suspend(void)
+{
+	/* Let ZBOSS finish the current iteration and wait for events. */
+	k_sleep(K_MSEC(10));
+	zigbee_debug_suspend_zboss_thread();
+}
+
+void test_app_cb_overflow(void)
+{
+	struct zigbee_app_cb_stats stats;
+	size_t size = app_cb_queue_size();
+	zb_ret_t ret;
+
+	records_reset();
+	zigbee_app_cb_stats_reset();
+	zboss_suspend();
+
+	for (size_t i = 0; i < size; i++) {
+		ret = zigbee_schedule_callback(record_cb, i);
+		zassert_equal(ret, RET_OK, "Request %u rejected",
+			      (unsigned int)i);
+	}
+
+	ret = zigbee_schedule_callback(record_cb, size);
+	zassert_equal(ret, RET_OVERFLOW, "Full queue not reported");
+
+	zigbee_app_cb_stats_get(&stats);
+	zassert_equal(stats.overflows, 1, "Overflow not counted");
+	zassert_equal(stats.max_depth, size, "Wrong max depth");
+
+	zigbee_debug_resume_zboss_thread();
+	records_wait(size);
+
+	for (size_t i = 0; i < size; i++) {
+		zassert_equal(records[i], i, "Wrong order");
+	}
+}
+
+void test_app_cb_order_wrap(void)
+{
+	size_t size = app_cb_queue_size();
+	uint8_t param = 0;
+	zb_ret_t ret;
+
+	/* The queue positions start close to their wrap. The rounds pass
+	 * more requests than needed to reach it, filling the queue almost
+	 * up, so that every slot is reused.
+	 */
+	for (int round = 0; round < ORDER_ROUNDS; round++) {
+		uint8_t first = param;
+
+		records_reset();
+		zboss_suspend();
+
+		for (size_t i = 0; i < size - 1; i++) {
+			ret = zigbee_schedule_callback(record_cb, param++);
+			zassert_equal(ret, RET_OK, "Request rejected");
+		}
+
+		zigbee_debug_resume_zboss_thread();
+		records_wait(size - 1);
+
+		for (size_t i = 0; i < size - 1; i++) {
+			zassert_equal(records[i], (uint8_t)(first + i),
+				      "Wrong order in round %d", round);
+		}
+	}
+}
+
+static void produce(int producer, int n)
+{
+	while (zigbee_schedule_callback(record_cb,
+					(producer << PRODUCER_SHIFT) | n) !=
+	       RET_OK) {
+		k_sleep(K_MSEC(1));
+	}
+}
+
+static void producer_thread(void *arg1, void *arg2, void *arg3)
+{
+	int producer = POINTER_TO_INT(arg1);
+
+	for (int n = 0; n < PRODUCER_REQS; n++) {
+		produce(producer, n);
+		k_yield();
+	}
+}
+
+static int isr_producer_next;
+
+static void isr_producer(struct k_timer *timer)
+{
+	/* A rejected request is retried on the next expiry. */
+	if (zigbee_schedule_callback(record_cb,
+				     (PRODUCER_THREADS << PRODUCER_SHIFT) |
+				     isr_producer_next) != RET_OK) {
+		return;
+	}
+
+	if (++isr_producer_next == PRODUCER_REQS) {
+		k_timer_stop(timer);
+	}
+}
+
+K_TIMER_DEFINE(isr_producer_timer, isr_producer, NULL);
+K_THREAD_STACK_ARRAY_DEFINE(producer_stacks, PRODUCER_THREADS, STACKSIZE);
+static struct k_thread producer_threads[PRODUCER_THREADS];
+
+void test_app_cb_producers(void)
+{
+	int next[PRODUCER_CNT] = {0};
+
+	BUILD_ASSERT(PRODUCER_CNT * PRODUCER_REQS <= RECORD_MAX,
+		     "Too many requests");
+	BUILD_ASSERT(PRODUCER_REQS <= BIT(PRODUCER_SHIFT),
+		     "Too many requests");
+
+	records_reset();
+	isr_producer_next = 0;
+	k_timer_start(&isr_producer_timer, K_MSEC(1), K_MSEC(1));
+
+	for (int i = 0; i < PRODUCER_THREADS; i++) {
+		k_thread_create(&producer_threads[i], producer_stacks[i],
+				K_THREAD_STACK_SIZEOF(producer_stacks[i]),
+				producer_thread, INT_TO_POINTER(i), NULL, NULL,
+				PRIORITY, 0, K_NO_WAIT);
+	}
+
+	records_wait(PRODUCER_CNT * PRODUCER_REQS);
+
+	/* Requests of every producer are executed once and in order. */
+	for (int i = 0; i < PRODUCER_CNT * PRODUCER_REQS; i++) {
+		int producer = records[i] >> PRODUCER_SHIFT;
+		int n = records[i] & BIT_MASK(PRODUCER_SHIFT);
+
+		zassert_true(producer < PRODUCER_CNT, "Unknown producer");
+		zassert_equal(n, next[producer],
+			      "Wrong order of producer %d", producer);
+		next[producer]++;
+	}
+}
+
+static void dummy_cb(zb_uint8_t param)
+{
+}
+
+void test_app_cb_zboss_queue_full(void)
+{
+	struct zigbee_app_cb_stats stats;
+	int filled = 0;
+	zb_ret_t ret;
+
+	records_reset();
+	zigbee_app_cb_stats_reset();
+	zboss_suspend();
+
+	/* Fill the ZBOSS scheduler queue. */
+	while (ZB_SCHEDULE_APP_CALLBACK(dummy_cb, 0) == RET_OK) {
+		filled++;
+		zassert_true(filled < RECORD_MAX, "ZBOSS queue not full");
+	}
+
+	ret = zigbee_schedule_callback(record_cb, 1);
+	zassert_equal(ret, RET_OK, "Request rejected");
+
+	/* The request waits and passing it to ZBOSS is retried. */
+	k_sleep(K_MSEC(3 * CONFIG_ZIGBEE_APP_CB_RETRY_INTERVAL));
+
+	zigbee_app_cb_stats_get(&stats);
+	zassert_true(stats.zboss_overflows > 1, "No retry");
+	zassert_equal(atomic_get(&record_cnt), 0, "Callback executed");
+
+	zigbee_debug_resume_zboss_thread();
+	records_wait(1);
+	zassert_equal(records[0], 1, "Wrong callback executed");
+}
+
 void test_main(void)
 {
 	/* Erase NVRAM to have repeatability of test runs. */
@@ -176,7 +406,11 @@ void test_main(void)
 
 	ztest_test_suite(zboss_api_callback,
 			 ztest_unit_test(test_zboss_startup_signals),
-			 ztest_unit_test(test_zboss_app_callbacks));
+			 ztest_unit_test(test_zboss_app_callbacks),
+			 ztest_unit_test(test_app_cb_overflow),
+			 ztest_unit_test(test_app_cb_order_wrap),
+			 ztest_unit_test(test_app_cb_producers),
+			 ztest_unit_test(test_app_cb_zboss_queue_full));
 
 	ztest_run_test_suite(zboss_api_callback);
 }